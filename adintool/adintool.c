@@ -178,6 +178,8 @@ put_status(AdinTool *a)
     }
     if (recog->adin->down_sample) {
       fprintf(stderr, "\t  SampleRate: 48000Hz -> %d Hz\n", a->conf.sfreq);
+    } else if (recog->adin->rs) {
+      fprintf(stderr, "\t  SampleRate: %d Hz -> %d Hz\n", recog->adin->rs->in_rate, a->conf.sfreq);
     } else {
       fprintf(stderr, "\t  SampleRate: %d Hz\n", a->conf.sfreq);
     }
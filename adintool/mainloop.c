@@ -310,6 +310,11 @@ vecnet_prepare(Recog *recog)
   MFCCCalc *mfcc;
 
   r->windownum = 0;
+  r->windowhead = 0;
+  if (recog->jconf->input.type == INPUT_WAVEFORM && r->window == NULL) {
+    /* sample buffer, windows are shifted on it as in the 1st pass */
+    r->window = (SP16 *)mymalloc(sizeof(SP16) * r->ringlen);
+  }
   for(mfcc = recog->mfcclist; mfcc; mfcc = mfcc->next) {
     mfcc->param->veclen = a->conf.vecnet_veclen;
     if (mfcc->para->cmn || mfcc->para->cvn) CMN_realtime_prepare(mfcc->cmn.wrk);
@@ -337,12 +342,17 @@ vecnet_sub(SP16 *Speech, int nowlen, Recog *recog)
   now = 0;
   
   while (now < nowlen) {
+    /* move the rest samples to the head if the window exceeds the buffer */
+    if (r->windowhead + r->windowlen > r->ringlen) {
+      memmove(r->window, &(r->window[r->windowhead]), sizeof(SP16) * r->windownum);
+      r->windowhead = 0;
+    }
     for(i = min(r->windowlen - r->windownum, nowlen - now); i > 0 ; i--)
-      r->window[r->windownum++] = (float) Speech[now++];
+      r->window[r->windowhead + r->windownum++] = Speech[now++];
     if (r->windownum < r->windowlen) break;
     for (mfcc = recog->mfcclist; mfcc; mfcc = mfcc->next) {
       mfcc->valid = FALSE;
-      if (RealTimeMFCC(mfcc, r->window, r->windowlen)) {
+      if (RealTimeMFCC(mfcc, &(r->window[r->windowhead]), r->windowlen)) {
         mfcc->valid = TRUE;
 	param_alloc(mfcc->param, mfcc->f + 1, mfcc->param->veclen);
 	memcpy(mfcc->param->parvec[mfcc->f], mfcc->tmpmfcc, sizeof(VECT) * mfcc->param->veclen);
@@ -363,7 +373,7 @@ vecnet_sub(SP16 *Speech, int nowlen, Recog *recog)
       }
     }
     /* shift window */
-    memmove(r->window, &(r->window[recog->jconf->input.frameshift]), sizeof(SP16) * (r->windowlen - recog->jconf->input.frameshift));
+    r->windowhead += recog->jconf->input.frameshift;
     r->windownum -= recog->jconf->input.frameshift;
   }
 }
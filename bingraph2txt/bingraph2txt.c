@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+/*
+ * bingraph2txt --- convert binary word graphs to text
+ *
+ * Read word graphs written by Julius with "-graphbin", and output them
+ * in the same text format as the word graph output of Julius.
+ *
+ */
+
+#include <julius/juliuslib.h>
+
+void
+usage(char *s)
+{
+  fprintf(stderr, "bingraph2txt --- convert binary word graphs to text\n");
+  fprintf(stderr, "\nUsage: %s [infile]\n", s);
+  fprintf(stderr, "    Read word graphs written by \"-graphbin\" from infile (default: stdin),\n");
+  fprintf(stderr, "    and output them to stdout as text.\n");
+  fprintf(stderr, "\nLibrary configuration: ");
+  confout_version(stderr);
+  confout_process(stderr);
+  fprintf(stderr, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  FILE *fp;
+  WordGraphBin *g;
+  int c;
+
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1] != '\0')) {
+    usage(argv[0]);
+    return 1;
+  }
+  /* output messages of the reader to stderr */
+  jlog_set_output(stderr);
+
+  if (argc == 2 && strcmp(argv[1], "-") != 0) {
+    if ((fp = fopen(argv[1], "rb")) == NULL) {
+      perror("bingraph2txt");
+      fprintf(stderr, "Error: failed to open \"%s\"\n", argv[1]);
+      return 1;
+    }
+  } else {
+    fp = stdin;
+  }
+
+  while ((c = getc(fp)) != EOF) {
+    ungetc(c, fp);
+    if ((g = wordgraph_read_binary(fp)) == NULL) {
+      fprintf(stderr, "Error: failed to read word graph\n");
+      return 1;
+    }
+    if (g->pass == 1) printf("--- begin wordgraph data pass1 ---\n");
+    wordgraph_dump(stdout, g->root, g->winfo);
+    if (g->pass == 1) printf("--- end wordgraph data pass1 ---\n");
+    wordgraph_binary_free(g);
+  }
+
+  if (fp != stdin) fclose(fp);
+
+  return 0;
+}
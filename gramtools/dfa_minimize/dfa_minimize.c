@@ -2,6 +2,8 @@
  * @file   dfa_minimize.c
  * 
  * @brief  Minimize DFA for Julian grammar.
+ *
+ * The minimization itself is done by dfa_minimize() in libsent.
  * 
  * @author Akinobu Lee
  * @date   Wed Oct  4 17:42:16 2006
@@ -90,233 +92,6 @@ usage()
   fprintf(stderr, "usage: dfa_minimize [dfafile] [-o outfile]\n");
 }
 
-/************************************************************************/
-/** 
- * @brief  Perform minimization.
- *
- * The result will be output in DFA format, to the specified file pointer.
- * 
- * 
- * @param dfa [in] original DFA info
- * @param fpout [in] output file pointer
- */
-void
-minimize(DFA_INFO *dfa, FILE *fpout)
-{
-  int *group;			/* group ID assigned for states */
-  int gnum;			/* number of groups currently assigned */
-  int *gmark;			/* mark states of different transition pattern in a group */
-  int **l;			/* transition pattern for states */
-  int **pt;			/* uniq transition pattern within a group */
-  int i, n, s, g;
-  DFA_ARC *ac;
-  boolean modified;
-  int starting;
-  int *glist;
-  int groupnum, arcnum;
-  int *is_start;
-  
-  /* allocate work area */
-  group = (int *)malloc(sizeof(int) * dfa->state_num);
-  gmark = (int *)malloc(sizeof(int) * dfa->state_num);
-  l = (int **)malloc(sizeof(int *) * dfa->state_num);
-  for(i=0;i<dfa->state_num;i++) {
-    l[i] = (int *)malloc(sizeof(int) * dfa->term_num);
-  }
-  pt = (int **)malloc(sizeof(int *) * dfa->state_num);
-  
-  /* set initial group */
-  /* acceptable = 0, others = 1 */
-  for(i=0;i<dfa->state_num;i++) {
-    if ((dfa->st[i].status & ACCEPT_S) != 0) {
-      group[i] = 0;
-    } else {
-      group[i] = 1;
-    }
-  }
-  gnum = 2;
-  
-  /* loop until nothing has been modified in the last loop */
-  do {
-    modified = FALSE;
-#ifdef DEBUG
-    printf("-----\n");
-#endif
-    
-    /* list transition pattern of each state */
-    for(s=0;s<dfa->state_num;s++) {
-      for(i=0;i<dfa->term_num;i++) l[s][i] = -1;
-      for(ac=dfa->st[s].arc;ac;ac=ac->next) {
-	l[s][ac->label] = group[ac->to_state];
-      }
-    }
-    
-#ifdef DEBUG
-    for(s=0;s<dfa->state_num;s++) {
-      printf("state %d: group=%d\n  ", s, group[s]);
-      for(i=0;i<dfa->term_num;i++) {
-	if (l[s][i] == -1) {
-	  printf(" *");
-	} else {
-	  printf(" %d", l[s][i]);
-	}
-      }
-      printf("\n");
-    }
-#endif
-
-    /* check for each group if they has different trans. pattern in it */
-    for(g=0;g<gnum;g++) {
-      n = 0;
-      for(s=0;s<dfa->state_num;s++) {
-	if (group[s] != g) continue;
-	/* compare the trans. pattern with the already detected ones */
-	for(i=0;i<n;i++) {
-	  if (memcmp(l[s], pt[i], sizeof(int) * dfa->term_num) == 0) break;
-	}
-	if (i < n) {
-	  /* same pattern has already detected */
-	  /* mark the state with the pattern ID */
-	  gmark[s] = i;
-	} else {
-	  /* same pattern was not found */
-	  /* it's a new pattern, so store it to the pattern list and
-	     annotate a new pattern ID */
-	  pt[n] = l[s];
-	  gmark[s] = n;
-	  n++;
-	}
-      }
-      /* "n" now holds the number of trans. patterns */
-      if (n > 1) {
-	/* several diffrent pattern has been found in a group */
-	/* divide this group into a new subgroup, by assigning
-	   new group ID for each different patterns */
-	for(s=0;s<dfa->state_num;s++) {
-	  if (group[s] != g) continue;
-	  group[s] = gnum + gmark[s];
-	}
-	/* now the number of groups has increased */
-	gnum += n;
-	modified = TRUE;
-      }
-    }
-  } while (modified);		/* loop until no group has been divided */
-  
-  /* rebuild the final transition pattern */
-  for(s=0;s<dfa->state_num;s++) {
-    for(i=0;i<dfa->term_num;i++) l[s][i] = -1;
-    for(ac=dfa->st[s].arc;ac;ac=ac->next) {
-      l[s][ac->label] = group[ac->to_state];
-    }
-  }
-  
-  /* relocate group ID for output */
-  /* glist[gnum] -> new ID */
-  glist = (int *)malloc(sizeof(int) * gnum);
-  for(g=0;g<gnum;g++) glist[g] = -1;
-  n = 0;
-  for(s=0;s<dfa->state_num;s++) {
-    if (glist[group[s]] == -1) {
-      glist[group[s]] = n;
-      n++;
-    }
-  }
-  groupnum = n;
-  
-  /* Julian DFA assumes the state 0 to be the starting state.
-     So we should find starting states
-     and swap the ID with the one with group ID=0. */
-  is_start = (int *)malloc(sizeof(int) * groupnum);
-  for(g=0;g<groupnum;g++) is_start[g] = 0;
-  for(s=0;s<dfa->state_num;s++) {
-    if (dfa->st[s].status & INITIAL_S) {
-      is_start[glist[group[s]]] = 1;
-    }
-  }
-  starting = -1;
-  for(g=0;g<groupnum;g++) {
-    if (is_start[g] == 1) {
-      if (starting == -1) {
-	starting = g;
-      } else {
-	printf("Error: more than one initial node??\n");
-	for(g=0;g<groupnum;g++) {
-	  if (is_start[g] == 1) printf(" %d", g);
-	}
-	printf("\n");
-	printf("Warning: resulting DFA may not be used in Julian by multiple initial nodes!!\n");
-	starting = 0;
-	break;
-      }
-    }
-  }
-#ifdef DEBUG
-  printf("starting=%d\n", starting);
-#endif
-  free(is_start);
-  for(g=0;g<gnum;g++) {
-    if (glist[g] == 0) {
-      glist[g] = starting;
-    } else if (glist[g] == starting) {
-      glist[g] = 0;
-    }
-  }
-
-#ifdef DEBUG
-  printf("renumber:\n");
-  for(g=0;g<gnum;g++) {
-    printf("  %d %d\n", g, glist[g]);
-  }
-#endif
-
-  /* output the result in DFA form */
-  {
-    int *is_accept;
-
-    is_accept = (int *)malloc(sizeof(int) * groupnum);
-    for(g=0;g<groupnum;g++) is_accept[g] = 0;
-    for(s=0;s<dfa->state_num;s++) {
-      if (dfa->st[s].status & ACCEPT_S) {
-	is_accept[glist[group[s]]] = 1;
-      }
-    }
-
-    arcnum = 0;
-    for(g=0;g<groupnum;g++) {
-      for(s=0;s<dfa->state_num;s++) {
-	if (glist[group[s]] != g) continue;
-	for(i=0;i<dfa->term_num;i++) {
-	  if (l[s][i] == -1) continue;
-	  if (is_accept[g] == 1) {
-	    fprintf(fpout, "%d %d %d 1 0\n", g, i, glist[l[s][i]]);
-	    is_accept[g] = 0;
-	  } else {
-	    fprintf(fpout, "%d %d %d 0 0\n", g, i, glist[l[s][i]]);
-	  }
-	  arcnum++;
-	}
-	break;
-      }
-      if (is_accept[g] == 1) {
-	fprintf(fpout, "%d -1 -1 1 0\n", g);
-      }
-    }
-
-    free(is_accept);
-  }
-  
-  fprintf(stderr, "-> minimized: %d nodes, %d arcs\n", groupnum, arcnum);
-
-  /* free work area */
-  free(glist);
-  free(pt);
-  for(i=0;i<dfa->state_num;i++) free(l[i]);
-  free(l);
-  free(gmark);
-  free(group);
-}
-
 /************************************************************************/
 /** 
  * Main function.
@@ -332,7 +107,11 @@ main(int argc, char *argv[])
   FILE *fp, *fpout;
   char *infile, *outfile;
   int i;
+  DFA_INFO *result;
   
+  /* messages from library go to stderr, not to the output */
+  jlog_set_output(stderr);
+
   /* option parsing */
   infile = NULL; outfile = NULL;
   for(i=1;i<argc;i++) {
@@ -386,7 +165,16 @@ main(int argc, char *argv[])
   fprintf(stderr, "%d categories, %d nodes, %d arcs\n", dfa->term_num, dfa->state_num, dfa->arc_num);
 
   /* execute minimization */
-  minimize(dfa, fpout);
+  if ((result = dfa_minimize(dfa)) == NULL) {
+    fprintf(stderr, "Error in minimization\n");
+    return -1;
+  }
+  if (wrdfa(fpout, result) == FALSE) {
+    fprintf(stderr, "Error: failed to write result\n");
+    return -1;
+  }
+  fprintf(stderr, "-> minimized: %d nodes, %d arcs\n", result->state_num, result->arc_num);
+  dfa_info_free(result);
 
   if (fpout != stdout) {
     fclose(fpout);
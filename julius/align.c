@@ -0,0 +1,428 @@
+/**
+ * @file   align.c
+ *
+ * <JA>
+ * @brief  ファイルリストに対する forced alignment を行う.
+ *
+ * "-alignlist file" を指定すると，認識を行わずに，リストに書かれた
+ * 入力ファイルと書き起こしの組に対して forced alignment を行う．
+ * リストの各行は入力ファイル名と，それに続く空白区切りの単語列からなる．
+ * モデルは全スレッドで共有され，入力ごとに複数のスレッドで並列に
+ * アラインメントを計算する．出力確率はスレッドごとのワークエリア上の
+ * キャッシュを通して計算される．結果はリストの順に，入力ごとに
+ * ファイルへ書き出される．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Forced alignment for a list of files.
+ *
+ * When "-alignlist file" is specified, forced alignment is performed
+ * for pairs of input file and transcription in the list, instead of
+ * recognition.  Each line of the list consists of an input file name
+ * and a space-separated word sequence.  The models are shared among
+ * threads, and the inputs are aligned in parallel by multiple threads.
+ * Output probabilities are computed through the cache on the work
+ * area of each thread.  The results are written to the output per
+ * input, in the order of the list.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/// Maximum length of a line in the alignment list
+#define ALIGN_MAXLINELEN 8192
+/// Number of inputs to be read at once per thread
+#define ALIGN_BATCH_PER_THREAD 4
+
+static char *align_listfile = NULL; ///< Alignment list file, NULL if not used
+static char *align_outfile = NULL; ///< Output file, NULL for stdout
+static int align_thread_num = 1; ///< Number of alignment threads
+
+/// An input to be aligned
+typedef struct {
+  char *filename;		///< Input file name
+  WORD_ID *words;		///< Transcription
+  int wnum;			///< Length of @a words
+  HTK_Param *param;		///< Input parameter vectors
+  SentenceAlign *align;		///< Alignment results, NULL on error
+  char *error;			///< Error message, NULL on success
+} ALIGN_ENTRY;
+
+/************************************************************************/
+static boolean
+opt_alignlist(Jconf *jconf, char *arg[], int argnum)
+{
+  align_listfile = strdup(arg[0]);
+  return TRUE;
+}
+
+static boolean
+opt_alignout(Jconf *jconf, char *arg[], int argnum)
+{
+  align_outfile = strdup(arg[0]);
+  return TRUE;
+}
+
+static boolean
+opt_alignthreads(Jconf *jconf, char *arg[], int argnum)
+{
+  align_thread_num = atoi(arg[0]);
+  if (align_thread_num < 1) {
+    fprintf(stderr, "Error: -alignthreads: number of threads should be >= 1: %s\n", arg[0]);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void
+align_add_option()
+{
+  j_add_option("-alignlist", 1, 1, "forced alignment for list of \"file words..\" instead of recognition", opt_alignlist);
+  j_add_option("-alignout", 1, 1, "output file of -alignlist (default: stdout)", opt_alignout);
+  j_add_option("-alignthreads", 1, 1, "number of threads for -alignlist", opt_alignthreads);
+}
+
+boolean
+is_align_mode()
+{
+  return(align_listfile != NULL);
+}
+
+/************************************************************************/
+/**
+ * Read an input and compute its feature vectors.
+ *
+ * @param recog [i/o] engine instance
+ * @param r [in] recognition process instance to align
+ * @param filename [in] input file name
+ *
+ * @return newly allocated parameter, or NULL on error.
+ */
+static HTK_Param *
+align_read_input(Recog *recog, RecogProcess *r, char *filename)
+{
+  Jconf *jconf;
+  HTK_Param *param;
+  int ret;
+
+  jconf = recog->jconf;
+
+  if (j_open_stream(recog, filename) < 0) return NULL;
+  if (jconf->input.type == INPUT_WAVEFORM) {
+    /* store the whole input to recog->speech */
+    recog->speechlen = 0;
+    ret = adin_go(adin_cut_callback_store_buffer, NULL, recog);
+    adin_end(recog->adin);
+    if (ret < 0) return NULL;
+    if (wav2mfcc(recog->speech, recog->speechlen, recog) == FALSE) return NULL;
+  } else if (jconf->input.speech_input == SP_MFCFILE && jconf->input.paramtype_check_flag) {
+    if (param_check_and_adjust(r->am->hmminfo, r->am->mfcc->param, verbose_flag) == -1) return NULL;
+  }
+
+  /* take the parameter, and leave a new holder to the instance */
+  param = r->am->mfcc->param;
+  r->am->mfcc->param = new_param();
+
+  return(param);
+}
+
+/**
+ * Align the inputs in parallel.
+ *
+ * @param r [in] recognition process instance
+ * @param e [i/o] inputs
+ * @param num [in] number of inputs
+ * @param wrk [i/o] HMM computation work area for each thread
+ * @param nthread [in] number of threads
+ */
+static void
+align_entries(RecogProcess *r, ALIGN_ENTRY *e, int num, HMMWork **wrk, int nthread)
+{
+  int i;
+  HMMWork *w;
+  SentenceAlign *now, *prev;
+  boolean word_flag, phoneme_flag, state_flag;
+
+  word_flag = r->config->annotate.align_result_word_flag;
+  phoneme_flag = r->config->annotate.align_result_phoneme_flag;
+  state_flag = r->config->annotate.align_result_state_flag;
+  if (!word_flag && !phoneme_flag && !state_flag) word_flag = TRUE;
+
+#pragma omp parallel for schedule(dynamic) num_threads(nthread) private(w, now, prev)
+  for (i = 0; i < num; i++) {
+#ifdef _OPENMP
+    w = wrk[omp_get_thread_num()];
+#else
+    w = wrk[0];
+#endif
+    if (e[i].error != NULL) continue;
+    outprob_prepare(w, e[i].param->samplenum);
+    prev = NULL;
+    if (word_flag) {
+      now = result_align_new();
+      unit_align(e[i].words, e[i].wnum, e[i].param, PER_WORD, now, r, w);
+      if (prev == NULL) e[i].align = now; else prev->next = now;
+      prev = now;
+    }
+    if (phoneme_flag) {
+      now = result_align_new();
+      unit_align(e[i].words, e[i].wnum, e[i].param, PER_PHONEME, now, r, w);
+      if (prev == NULL) e[i].align = now; else prev->next = now;
+      prev = now;
+    }
+    if (state_flag) {
+      now = result_align_new();
+      unit_align(e[i].words, e[i].wnum, e[i].param, PER_STATE, now, r, w);
+      if (prev == NULL) e[i].align = now; else prev->next = now;
+      prev = now;
+    }
+  }
+}
+
+/**
+ * Output the alignment results of an input.
+ *
+ * @param fp [in] file pointer to output
+ * @param e [in] the input
+ * @param r [in] recognition process instance
+ */
+static void
+align_output(FILE *fp, ALIGN_ENTRY *e, RecogProcess *r)
+{
+  SentenceAlign *align;
+  WORD_INFO *winfo;
+  HMM_Logical *p;
+  int i;
+
+  winfo = r->lm->winfo;
+
+  fprintf(fp, "input: %s\n", e->filename);
+  if (e->error != NULL) {
+    fprintf(fp, "error: %s\n", e->error);
+    return;
+  }
+  fprintf(fp, "frames: %d\n", e->param->samplenum);
+  for (align = e->align; align; align = align->next) {
+    fprintf(fp, "=== begin forced alignment ===\n");
+    switch(align->unittype) {
+    case PER_WORD:
+      fprintf(fp, "-- word alignment --\n"); break;
+    case PER_PHONEME:
+      fprintf(fp, "-- phoneme alignment --\n"); break;
+    case PER_STATE:
+      fprintf(fp, "-- state alignment --\n"); break;
+    }
+    fprintf(fp, " id: from  to    n_score    unit\n");
+    fprintf(fp, " ----------------------------------------\n");
+    for(i=0;i<align->num;i++) {
+      fprintf(fp, "[%4d %4d]  %f  ", align->begin_frame[i], align->end_frame[i], align->avgscore[i]);
+      switch(align->unittype) {
+      case PER_WORD:
+	fprintf(fp, "%s\t[%s]\n", winfo->wname[align->w[i]], winfo->woutput[align->w[i]]);
+	break;
+      case PER_PHONEME:
+      case PER_STATE:
+	p = align->ph[i];
+	if (p->is_pseudo) {
+	  fprintf(fp, "{%s}", p->name);
+	} else if (strmatch(p->name, p->body.defined->name)) {
+	  fprintf(fp, "%s", p->name);
+	} else {
+	  fprintf(fp, "%s[%s]", p->name, p->body.defined->name);
+	}
+	if (align->unittype == PER_STATE) {
+	  if (r->am->hmminfo->multipath && align->is_iwsp[i]) {
+	    fprintf(fp, " #%d (sp)", align->loc[i]);
+	  } else {
+	    fprintf(fp, " #%d", align->loc[i]);
+	  }
+	}
+	fprintf(fp, "\n");
+	break;
+      }
+    }
+    fprintf(fp, "re-computed AM score: %f\n", align->allscore);
+    fprintf(fp, "=== end forced alignment ===\n");
+  }
+}
+
+/**
+ * Free an input.
+ *
+ * @param e [i/o] the input
+ */
+static void
+align_entry_free(ALIGN_ENTRY *e)
+{
+  SentenceAlign *a, *atmp;
+
+  free(e->filename);
+  if (e->words) free(e->words);
+  if (e->param) free_param(e->param);
+  a = e->align;
+  while (a) {
+    atmp = a->next;
+    result_align_free(a);
+    a = atmp;
+  }
+}
+
+/**
+ * @brief  Perform forced alignment for the list given by "-alignlist".
+ *
+ * The inputs are read and their features are computed in the main
+ * thread, a batch at a time.  Then the batch is aligned in parallel,
+ * and the results are written in the order of the list.
+ *
+ * @param recog [i/o] engine instance
+ *
+ * @return 0 when all inputs are aligned, 1 on error.
+ */
+int
+align_main(Recog *recog)
+{
+  RecogProcess *r;
+  PROCESS_AM *am;
+  Jconf *jconf;
+  FILE *lfp, *ofp;
+  char *buf, *name, *c;
+  HMMWork **wrk;
+  ALIGN_ENTRY *e;
+  int nthread, batch, num, i;
+  int total, failed;
+  boolean eof;
+
+  jconf = recog->jconf;
+  r = recog->process_list;
+  am = r->am;
+
+  if (jconf->input.speech_input != SP_RAWFILE && jconf->input.speech_input != SP_MFCFILE && jconf->input.speech_input != SP_OUTPROBFILE) {
+    jlog("ERROR: align: -alignlist needs file input (-input rawfile, mfcfile or outprob)\n");
+    return 1;
+  }
+  if (r->lm->winfo == NULL) {
+    jlog("ERROR: align: no dictionary\n");
+    return 1;
+  }
+  if (recog->process_list->next != NULL) {
+    jlog("Warning: align: multiple recognition processes, use only the first one \"%s\"\n", r->config->name);
+  }
+
+  /* set up threads: each thread has its own work area for outprob cache */
+  nthread = align_thread_num;
+  if (nthread > 1 && (am->dnn != NULL || am->config->gprune_method == GPRUNE_SEL_USER)) {
+    jlog("Warning: align: DNN or calcmix plugin computes in a single thread, -alignthreads ignored\n");
+    nthread = 1;
+  }
+#ifndef _OPENMP
+  nthread = 1;
+#endif
+  wrk = (HMMWork **)mymalloc(sizeof(HMMWork *) * nthread);
+  wrk[0] = &(am->hmmwrk);
+  for (i = 1; i < nthread; i++) {
+    wrk[i] = (HMMWork *)mymalloc(sizeof(HMMWork));
+    memset(wrk[i], 0, sizeof(HMMWork));
+    if (outprob_init(wrk[i], am->hmminfo, (am->config->hmm_gs_filename != NULL) ? am->hmm_gs : NULL, am->config->gs_statenum, am->config->gprune_method, am->config->mixnum_thres, am->dnn) == FALSE) {
+      jlog("ERROR: align: failed to initialize work area for thread #%d\n", i);
+      return 1;
+    }
+  }
+  /* alignment proceeds frame by frame, no need to cache all frames */
+  for (i = 0; i < nthread; i++) {
+    outprob_cache_set_window(wrk[i], 1);
+  }
+
+  /* open files */
+  if ((lfp = fopen(align_listfile, "r")) == NULL) {
+    jlog("ERROR: align: failed to open list \"%s\"\n", align_listfile);
+    return 1;
+  }
+  if (align_outfile != NULL) {
+    if ((ofp = fopen(align_outfile, "w")) == NULL) {
+      jlog("ERROR: align: failed to open output \"%s\"\n", align_outfile);
+      fclose(lfp);
+      return 1;
+    }
+  } else {
+    ofp = stdout;
+  }
+
+  if (j_adin_init(recog) == FALSE) return 1;
+  j_recog_info(recog);
+
+  jlog("STAT: align: aligning inputs in \"%s\" by %d threads\n", align_listfile, nthread);
+
+  batch = nthread * ALIGN_BATCH_PER_THREAD;
+  e = (ALIGN_ENTRY *)mymalloc(sizeof(ALIGN_ENTRY) * batch);
+  buf = (char *)mymalloc(ALIGN_MAXLINELEN);
+  total = failed = 0;
+  eof = FALSE;
+  while (!eof) {
+    /* read a batch of inputs */
+    num = 0;
+    while (num < batch) {
+      if (getl_fp(buf, ALIGN_MAXLINELEN, lfp) == NULL) {
+	eof = TRUE;
+	break;
+      }
+      /* split into file name and words */
+      for (c = buf; *c != '\0'; c++) if (*c == '\t') *c = ' ';
+      for (name = buf; *name == ' '; name++);
+      if (*name == '\0') continue;
+      for (c = name; *c != ' ' && *c != '\0'; c++);
+      if (*c != '\0') *(c++) = '\0';
+      e[num].filename = strdup(name);
+      e[num].words = NULL;
+      e[num].param = NULL;
+      e[num].align = NULL;
+      e[num].error = NULL;
+      if ((e[num].words = new_str2wordseq(r->lm->winfo, c, &(e[num].wnum))) == NULL) {
+	e[num].error = "word not in dictionary";
+      } else if (e[num].wnum == 0) {
+	e[num].error = "no transcription";
+      } else if ((e[num].param = align_read_input(recog, r, e[num].filename)) == NULL) {
+	e[num].error = "failed to read input";
+      } else if (e[num].param->samplenum == 0) {
+	e[num].error = "no input frame";
+      }
+      num++;
+    }
+    if (num == 0) break;
+
+    /* align them in parallel */
+    align_entries(r, e, num, wrk, nthread);
+
+    /* output in the order of the list */
+    for (i = 0; i < num; i++) {
+      align_output(ofp, &(e[i]), r);
+      if (e[i].error != NULL) failed++;
+      align_entry_free(&(e[i]));
+    }
+    fflush(ofp);
+    total += num;
+  }
+
+  jlog("STAT: align: %d inputs, %d failed\n", total, failed);
+
+  free(buf);
+  free(e);
+  for (i = 1; i < nthread; i++) {
+    outprob_free(wrk[i]);
+    free(wrk[i]);
+  }
+  free(wrk);
+  fclose(lfp);
+  if (ofp != stdout) fclose(ofp);
+
+  return((failed > 0) ? 1 : 0);
+}
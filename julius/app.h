@@ -28,6 +28,7 @@ void main_recognition_stream_loop(Recog *recog);
 /* module.c */
 int module_send(char *fmt, ...);
 void module_add_option();
+void module_shift_port(int offset);
 boolean is_module_mode();
 void module_setup(Recog *recog, void *data);
 void module_server();
@@ -51,6 +52,23 @@ void outfile_set_fname(char *input_filename);
 void record_add_option();
 void record_setup(Recog *recog, void *data);
 
+/* output_graphbin.c */
+void graphbin_add_option();
+void graphbin_set_worker(int id);
+boolean graphbin_setup(Recog *recog, void *data);
+
+/* worker.c */
+void worker_add_option();
+boolean worker_check(Jconf *jconf);
+boolean worker_load_begin();
+void worker_load_end();
+void worker_fork(Recog *recog);
+
+/* align.c */
+void align_add_option();
+boolean is_align_mode();
+int align_main(Recog *recog);
+
 
 
 
@@ -84,6 +84,7 @@ main(int argc, char *argv[])
   FILE *fp;
   Recog *recog;
   Jconf *jconf;
+  int ret;
 
   /* inihibit system log output (default: stdout) */
   //jlog_set_output(NULL);
@@ -101,7 +102,10 @@ main(int argc, char *argv[])
 
   /* add application options */
   record_add_option();
+  graphbin_add_option();
   module_add_option();
+  worker_add_option();
+  align_add_option();
   charconv_add_option();
   j_add_option("-separatescore", 0, 0, "output AM and LM scores separately", opt_separatescore);
   j_add_option("-noxmlescape", 0, 0, "disable XML escape", opt_noxmlescape);
@@ -139,6 +143,16 @@ main(int argc, char *argv[])
     if (logfile) fclose(fp);
     return -1;
   }
+  if (worker_check(jconf) == FALSE) {
+    if (logfile) fclose(fp);
+    return -1;
+  }
+
+  /* models to be shared by worker processes are placed on the arena */
+  if (worker_load_begin() == FALSE) {
+    if (logfile) fclose(fp);
+    return -1;
+  }
 
   /* create a recognition instance */
   recog = j_recog_new();
@@ -168,6 +182,18 @@ main(int argc, char *argv[])
     if (logfile) fclose(fp);
     return -1;
   }
+  worker_load_end();
+
+  /* if -alignlist specified, perform forced alignment instead of recognition */
+  if (is_align_mode()) {
+    ret = align_main(recog);
+    j_recog_free(recog);
+    if (logfile) fclose(fp);
+    return ret;
+  }
+
+  /* if -workers specified, fork worker processes here */
+  worker_fork(recog);
   
   /* Set up some application functions */
   /* set character conversion mode */
@@ -197,6 +223,9 @@ main(int argc, char *argv[])
   /* setup recording if option was specified */
   record_setup(recog, NULL);
 
+  /* setup binary word graph output if option was specified */
+  if (graphbin_setup(recog, NULL) == FALSE) return -1;
+
   /* on module connect with client */
   if (is_module_mode()) module_server();
 
@@ -790,6 +790,12 @@ module_add_option()
   j_add_option("-outcode", 1, 1, "select info to output to the module: WLPSCwlps", opt_outcode);
 }
 
+void
+module_shift_port(int offset)
+{
+  module_port += offset;
+}
+
 boolean
 is_module_mode()
 {
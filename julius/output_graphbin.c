@@ -0,0 +1,160 @@
+/**
+ * @file   output_graphbin.c
+ *
+ * <JA>
+ * @brief  単語グラフをバイナリ形式でファイルに出力する.
+ *
+ * "-graphbin file" を指定すると，単語グラフが得られるたびに，
+ * それをバイナリ形式の1レコードとしてファイルに追記する．
+ * 第1パスの単語グラフ (-1pass -lattice) と第2パスの単語グラフの
+ * 両方が出力される．"-pass1lattice" 指定時は，第1パスで逐次生成される
+ * ラティスも出力間隔ごとにその時点までの部分ラティスとして出力される．
+ * 形式については libjulius の graphbin.c を参照のこと．
+ * 出力は単語グラフごとにフラッシュされるので，名前付きパイプを
+ * 指定して他のプロセスに逐次渡すこともできる．-workers の場合は，
+ * 各ワーカーはファイル名に ".番号" を付けたファイルに出力する．
+ * テキスト形式への変換には bingraph2txt を用いる．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Output word graphs to a file in binary format.
+ *
+ * When "-graphbin file" is specified, each word graph is appended to
+ * the file as a record of the binary format as soon as it is obtained.
+ * Both word graphs of the 1st pass (-1pass -lattice) and the 2nd pass
+ * are written.  With "-pass1lattice", the lattice built incrementally
+ * on the 1st pass is also written at every output interval as a partial
+ * lattice up to that time.  See graphbin.c in libjulius for the
+ * format.  The output is flushed per word graph, so a named pipe can be
+ * given to pass them to another process successively.  With -workers, each
+ * worker writes to the file name appended by ".number".  Use
+ * bingraph2txt to convert them to text.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+static char *graphbin_filename = NULL; ///< Output file, NULL if not used
+static FILE *graphbin_fp = NULL;       ///< File pointer of the output
+
+/**
+ * Write a word graph of a recognition process.  On failure, the output
+ * will be stopped.
+ *
+ * @param r [in] recognition process instance
+ * @param root [in] root of the word graph
+ * @param pass [in] 1 for the 1st pass, 2 for the 2nd pass
+ * @param framenum [in] number of frames covered by the word graph
+ */
+static void
+graphbin_put(RecogProcess *r, WordGraph *root, int pass, int framenum)
+{
+  if (graphbin_fp == NULL) return;
+  if (wordgraph_write_binary(graphbin_fp, root, r->lm->winfo, pass, r->config->id, framenum) == FALSE) {
+    fprintf(stderr, "Error: failed to write word graph to \"%s\", output stopped\n", graphbin_filename);
+    fclose(graphbin_fp);
+    graphbin_fp = NULL;
+  }
+}
+
+/**
+ * Write the word graphs of all recognition processes.
+ *
+ * @param recog [in] engine instance
+ * @param pass [in] 1 for the 1st pass, 2 for the 2nd pass
+ */
+static void
+graphbin_write(Recog *recog, int pass)
+{
+  RecogProcess *r;
+  WordGraph *root;
+
+  for(r=recog->process_list;r;r=r->next) {
+    if (! r->live) continue;
+    root = (pass == 1) ? r->result.wg1 : r->result.wg;
+    if (root == NULL) continue;
+    graphbin_put(r, root, pass, r->peseqlen);
+  }
+}
+
+static void
+graphbin_pass1(Recog *recog, void *dummy)
+{
+  graphbin_write(recog, 1);
+}
+
+static void
+graphbin_pass2(Recog *recog, void *dummy)
+{
+  graphbin_write(recog, 2);
+}
+
+static void
+graphbin_pass1_lattice(Recog *recog, void *dummy)
+{
+  RecogProcess *r;
+
+  for(r=recog->process_list;r;r=r->next) {
+    if (! r->live) continue;
+    if (r->result.lat1 == NULL) continue;
+    if (r->result.lat1_final) {
+      graphbin_put(r, r->result.lat1, 1, r->peseqlen);
+    } else if (r->have_lattice) {
+      graphbin_put(r, r->result.lat1, 1, r->result.lat1_frame + 1);
+    }
+  }
+}
+
+/************************************************************************/
+static boolean
+opt_graphbin(Jconf *jconf, char *arg[], int argnum)
+{
+  if (graphbin_filename) free(graphbin_filename);
+  graphbin_filename = strdup(arg[0]);
+  return TRUE;
+}
+
+void
+graphbin_add_option()
+{
+  j_add_option("-graphbin", 1, 1, "output word graphs to file in binary format", opt_graphbin);
+}
+
+/**
+ * Make the output file name of a worker process by appending its number.
+ *
+ * @param id [in] worker number
+ */
+void
+graphbin_set_worker(int id)
+{
+  char *buf;
+
+  if (graphbin_filename == NULL) return;
+  buf = (char *)malloc(strlen(graphbin_filename) + 16);
+  sprintf(buf, "%s.%d", graphbin_filename, id);
+  free(graphbin_filename);
+  graphbin_filename = buf;
+}
+
+/************************************************************************/
+boolean
+graphbin_setup(Recog *recog, void *data)
+{
+  if (graphbin_filename == NULL) return TRUE;
+  if ((graphbin_fp = fopen(graphbin_filename, "wb")) == NULL) {
+    perror("graphbin_setup");
+    fprintf(stderr, "Error: failed to open \"%s\" for word graph output\n", graphbin_filename);
+    return FALSE;
+  }
+  callback_add(recog, CALLBACK_RESULT_PASS1_GRAPH, graphbin_pass1, data);
+  callback_add(recog, CALLBACK_RESULT_PASS1_LATTICE, graphbin_pass1_lattice, data);
+  callback_add(recog, CALLBACK_RESULT_GRAPH, graphbin_pass2, data);
+  return TRUE;
+}
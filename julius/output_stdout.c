@@ -573,6 +573,43 @@ result_pass1_graph(Recog *recog, void *dummy)
 
 #endif
 
+/** 
+ * <JA>
+ * 第1パス：逐次生成されたラティスの出力．生成中は単語数のみを，
+ * 第1パス終了時にはラティス全体を出力する. 
+ * 
+ * </JA>
+ * <EN>
+ * 1st pass: output the lattice built incrementally.  Only the number
+ * of words is output while building, and the whole lattice at the end
+ * of the 1st pass.
+ * 
+ * </EN>
+ */
+static void
+result_pass1_lattice(Recog *recog, void *dummy)
+{
+  RecogProcess *r;
+  boolean multi;
+
+  if (recog->process_list->next != NULL) multi = TRUE;
+  else multi = FALSE;
+
+  for(r=recog->process_list;r;r=r->next) {
+    if (! r->live) continue;
+    if (r->result.lat1_final) {
+      if (multi) printf("[#%d %s]\n", r->config->id, r->config->name);
+      printf("--- begin wordgraph data pass1lattice ---\n");
+      wordgraph_dump(stdout, r->result.lat1, r->lm->winfo);
+      printf("--- end wordgraph data pass1lattice ---\n");
+    } else if (r->have_lattice) {
+      if (multi) printf("[#%d %s] ", r->config->id, r->config->name);
+      printf("pass1lattice: frame %d: %d words (%d new)\n", r->result.lat1_frame, r->result.lat1_num, r->result.lat1_num - r->result.lat1_newid);
+    }
+  }
+  fflush(stdout);
+}
+
 /** 
  * <JA>
  * 第1パス：終了時の出力（第1パスの終了時に必ず呼ばれる）
@@ -698,14 +735,13 @@ put_hypo_phoneme(WORD_ID *seq, int n, WORD_INFO *winfo)
  */
 #ifdef CM_MULTIPLE_ALPHA
 static void
-put_hypo_cmscore(NODE *hypo, int id)
+put_hypo_cmscore(LOGPROB (*cmscore)[100], int n, int id)
 {
   int i;
-  int j;
   
-  if (hypo != NULL) {
-    for (i=hypo->seqnum-1;i>=0;i--) {
-      printf(" %5.3f", hypo->cmscore[i][id]);
+  if (cmscore != NULL) {
+    for (i=0;i<n;i++) {
+      printf(" %5.3f", cmscore[i][id]);
     }
   }
   printf("\n");  
@@ -892,8 +928,8 @@ result_pass2(Recog *recog, void *dummy)
 	{
 	  int i;
 	  for(i=0;i<r->config->annotate.cm_alpha_num;i++) {
-	    printf("cmscore%d[%f]:", rank, r->config->annotate.cm_alpha_bgn + i * r->config->annotate.cm_alpha_step);
-	    put_hypo_cmscore(hypo, i);
+	    printf("cmscore%d[%f]:", n+1, r->config->annotate.cm_alpha_bgn + i * r->config->annotate.cm_alpha_step);
+	    put_hypo_cmscore(s->confidence_alpha, seqnum, i);
 	  }
 	}
 #else
@@ -1322,6 +1358,7 @@ setup_output_tty(Recog *recog, void *data)
 #ifdef WORD_GRAPH
   callback_add(recog, CALLBACK_RESULT_PASS1_GRAPH, result_pass1_graph, data);
 #endif
+  callback_add(recog, CALLBACK_RESULT_PASS1_LATTICE, result_pass1_lattice, data);
   callback_add(recog, CALLBACK_EVENT_PASS1_END, status_pass1_end, data);
   callback_add(recog, CALLBACK_STATUS_PARAM, status_param, data);
   callback_add(recog, CALLBACK_EVENT_PASS2_BEGIN, status_pass2_begin, data);
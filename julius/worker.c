@@ -0,0 +1,250 @@
+/**
+ * @file   worker.c
+ *
+ * <JA>
+ * @brief  複数の認識プロセスでモデルを共有する.
+ *
+ * "-workers N" を指定すると，モデルの読み込みと木構造化辞書の構築を
+ * 一度だけ行ったのち，N 個のワーカープロセスを fork() して，それぞれ
+ * で認識を行う．読み込んだモデルは専用のメモリ領域(アリーナ)に置かれ，
+ * ワーカー間でコピーオンライトにより共有される．k 番目のワーカー
+ * (k = 0..N-1) は adinnet およびモジュールのポート番号に k を加えた
+ * ポートで待ち受ける．各ワーカーが別々の入力を持つよう，2 個以上の
+ * ワーカーは adinnet 入力かモジュールモードでのみ使用できる．親プロセスに
+ * 送られた SIGINT, SIGTERM は全ワーカーに転送される．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Share models among multiple recognition processes.
+ *
+ * When "-workers N" is specified, models are loaded and the lexicon
+ * trees are built only once, and then N worker processes are forked
+ * to perform recognition.  The loaded models are placed on a
+ * dedicated memory area (arena), and shared among the workers by
+ * copy-on-write.  The k-th worker (k = 0..N-1) listens at the adinnet
+ * and module port number plus k.  More than one worker is allowed only
+ * with adinnet input or module mode, so that each worker has its own
+ * input.  SIGINT and SIGTERM sent to the parent are forwarded to all
+ * workers.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+/**
+ * Address space to be reserved for the arena (16GB on 64-bit, 1GB on
+ * 32-bit).  Only the used part consumes memory.
+ */
+#define WORKER_ARENA_SIZE (((size_t)1 << 30) * (sizeof(void *) >= 8 ? 16 : 1))
+
+static int worker_num = 0;	///< Number of worker processes, 0 if not used
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+static pid_t *worker_pid = NULL; ///< Process IDs of the forked workers
+static int worker_pidnum = 0;	///< Number of forked workers
+static volatile sig_atomic_t worker_signaled = 0; ///< Set when a termination signal was forwarded
+#endif
+
+/************************************************************************/
+static boolean
+opt_workers(Jconf *jconf, char *arg[], int argnum)
+{
+#if defined(_WIN32) && !defined(__CYGWIN32__)
+  fprintf(stderr, "Error: -workers is not supported on this system\n");
+  return FALSE;
+#else
+  worker_num = atoi(arg[0]);
+  if (worker_num < 1) {
+    fprintf(stderr, "Error: -workers: number of workers should be >= 1: %s\n", arg[0]);
+    return FALSE;
+  }
+  return TRUE;
+#endif
+}
+
+void
+worker_add_option()
+{
+  j_add_option("-workers", 1, 1, "fork N recognition processes sharing models", opt_workers);
+}
+
+/************************************************************************/
+/**
+ * Check whether the input can be shared by the workers.  When more than
+ * one worker is specified, each of them should have its own input, so
+ * only adinnet input and module mode are allowed.  Should be called
+ * after j_jconf_finalize().
+ *
+ * @param jconf [in] global configuration
+ *
+ * @return TRUE if OK, FALSE if the input is not available with workers.
+ */
+boolean
+worker_check(Jconf *jconf)
+{
+  if (worker_num <= 1) return TRUE;
+  if (jconf->input.speech_input != SP_ADINNET && !is_module_mode()) {
+    fprintf(stderr, "Error: -workers: more than one worker requires \"-input adinnet\" or \"-module\", since all workers would read the same input\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/************************************************************************/
+/**
+ * Prepare for model loading: place the models on the arena.
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+worker_load_begin()
+{
+  if (worker_num == 0) return TRUE;
+  if (mybmalloc_arena_open(WORKER_ARENA_SIZE) == FALSE) {
+    fprintf(stderr, "Error: failed to reserve shared memory area for workers\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * End of model loading: stop using the arena.
+ */
+void
+worker_load_end()
+{
+  if (worker_num == 0) return;
+  mybmalloc_arena_close();
+  jlog("Stat: worker: %lu bytes of models are shared by %d workers\n", (unsigned long)mybmalloc_arena_used(), worker_num);
+}
+
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+/**
+ * Signal handler of the parent process: forward the signal to all
+ * workers.  The parent keeps waiting for them to exit.
+ *
+ * @param signum [in] signal number
+ */
+static void
+worker_forward_signal(int signum)
+{
+  int i;
+
+  worker_signaled = 1;
+  for (i = 0; i < worker_pidnum; i++) {
+    if (worker_pid[i] > 0) kill(worker_pid[i], signum);
+  }
+}
+#endif
+
+/**
+ * @brief  Fork worker processes.
+ *
+ * This function returns only in the worker processes, after shifting
+ * the adinnet and module port numbers by the worker index.  The
+ * parent process waits for all the workers to exit, and then exits.
+ * Nothing is done when "-workers" is not specified.
+ *
+ * @param recog [i/o] engine instance
+ */
+void
+worker_fork(Recog *recog)
+{
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+  int i, j;
+  pid_t pid;
+  int status;
+  int alive;
+  int ret;
+  sigset_t sigs, oldsigs;
+
+  if (worker_num == 0) return;
+
+  /* output to stdout should not be duplicated in the children */
+  fflush(stdout);
+  fflush(stderr);
+
+  worker_pid = (pid_t *)mymalloc(sizeof(pid_t) * worker_num);
+  for (i = 0; i < worker_num; i++) worker_pid[i] = 0;
+
+  /* parent: pass termination requests to the workers.  This is set
+     before forking so that a signal during the fork loop does not
+     leave the already forked workers behind */
+  if (signal(SIGINT, worker_forward_signal) == SIG_ERR
+      || signal(SIGTERM, worker_forward_signal) == SIG_ERR) {
+    fprintf(stderr, "Warning: worker: failed to set signal handler, workers may not be terminated with this process\n");
+  }
+
+  /* the signals are blocked while forking, so that every forked worker
+     is recorded before the signal is forwarded */
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+
+  alive = 0;
+  for (i = 0; i < worker_num; i++) {
+    sigprocmask(SIG_BLOCK, &sigs, &oldsigs);
+    if (worker_signaled) {
+      /* terminated while forking: no more workers */
+      sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+      break;
+    }
+    pid = fork();
+    if (pid < 0) {
+      sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+      perror("worker");
+      fprintf(stderr, "Error: failed to fork worker #%d\n", i);
+      break;
+    }
+    if (pid == 0) {
+      /* worker: terminate by signals as usual */
+      signal(SIGINT, SIG_DFL);
+      signal(SIGTERM, SIG_DFL);
+      sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+      /* worker: listen at its own ports */
+      recog->jconf->input.adinnet_port += i;
+      module_shift_port(i);
+      graphbin_set_worker(i);
+      jlog("Stat: worker: worker #%d started as process [%d]\n", i, getpid());
+      return;
+    }
+    worker_pid[worker_pidnum++] = pid;
+    alive++;
+    sigprocmask(SIG_SETMASK, &oldsigs, NULL);
+  }
+
+  /* parent: wait for the workers */
+  ret = 0;
+  while (alive > 0) {
+    pid = wait(&status);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    alive--;
+    for (j = 0; j < worker_pidnum; j++) {
+      if (worker_pid[j] == pid) worker_pid[j] = 0;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      jlog("Stat: worker: process [%d] exited\n", pid);
+    } else {
+      jlog("Warning: worker: process [%d] exited abnormally\n", pid);
+      ret = 1;
+    }
+  }
+  if (i < worker_num) ret = 1;
+  exit(ret);
+#endif
+}
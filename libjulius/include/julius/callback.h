@@ -235,6 +235,14 @@ enum {
   CALLBACK_DEBUG_PASS2_POP,
   CALLBACK_DEBUG_PASS2_PUSH,
   CALLBACK_RESULT_PASS1_DETERMINED,
+  /**
+   * Result callback to provide the word lattice built incrementally on
+   * the 1st pass.  With "-pass1lattice", this will be called periodically
+   * while the 1st pass with the partial lattice, and once at the end of
+   * the 1st pass with the final one.
+   * 
+   */
+  CALLBACK_RESULT_PASS1_LATTICE,
 
   SIZEOF_CALLBACK_ID
 };
@@ -140,6 +140,7 @@
 #ifdef GMM_VAD
 #define DEFAULT_GMM_MARGIN 20	/* backstep margin / determine buffer length */
 #define GMM_VAD_AUTOSHRINK_LIMIT 500
+#define GMM_VAD_PRUNE_MARGIN 0.01 /* safety margin of -gmmvadprune bound */
 #undef GMM_VAD_DEBUG		/* output debug message */
 #endif
 
@@ -284,6 +285,20 @@
  */
 #define FAST_FACTOR1_SUCCESSOR_LIST
 
+/**
+ * Number of last words whose factoring score is cached per node on the
+ * 1st pass.
+ * 
+ */
+#define FACTOR_CACHE_WAYS 4
+
+/**
+ * Maximum number of frequent contexts whose 2-gram factoring scores of
+ * all successor lists are held in dense rows (2-gram factoring only).
+ * 
+ */
+#define FACTOR2_ROW_NUM 32
+
 /**
  * Enable score based pruning at the 1st pass.
  * 
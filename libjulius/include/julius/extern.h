@@ -69,6 +69,12 @@ void decode_end_segmented(Recog *recog);
 void decode_end(Recog *recog);
 boolean get_back_trellis(Recog *recog);
 
+/* pass1_lattice.c */
+void pass1_lattice_init(RecogProcess *r, int wshift);
+void pass1_lattice_extend(RecogProcess *r, int t);
+void pass1_lattice_finish(RecogProcess *r, int framelen);
+void pass1_lattice_free(RecogProcess *r);
+
 /* spsegment.c */
 boolean is_sil(WORD_ID w, RecogProcess *r);
 void mfcc_copy_to_rest_and_shrink(MFCCCalc *mfcc, int start, int end);
@@ -85,8 +91,10 @@ void spsegment_restart_mfccs(Recog *recog, int rewind_frame, boolean reprocess);
 #ifdef PASS1_IWCD
 void outprob_style_cache_init(WCHMM_INFO *wchmm);
 CD_Set *lcdset_lookup_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID category);
+void lcdset_register_with_category_words(WCHMM_INFO *wchmm, WORD_ID bgn, WORD_ID end);
 void lcdset_register_with_category_all(WCHMM_INFO *wchmm);
 void lcdset_remove_with_category_all(WCHMM_INFO *wchmm);
+void lcdset_remove_with_category_from(WCHMM_INFO *wchmm, int cate_begin);
 #endif
 LOGPROB outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param);
 void error_missing_right_triphone(HMM_Logical *base, char *rc_name);
@@ -136,6 +144,12 @@ void wchmm_free(WCHMM_INFO *w);
 void print_wchmm_info(WCHMM_INFO *wchmm);
 boolean build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf);
 boolean build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf);
+boolean wchmm_add_segment(WCHMM_INFO *wchmm, JCONF_LM *lmconf, WORD_ID bgn, WORD_ID end);
+WORD_ID wchmm_truncate_segment(WCHMM_INFO *wchmm, WORD_ID wnum);
+
+/* wchmm_cache.c */
+boolean wchmm_cache_save(WCHMM_INFO *wchmm, JCONF_LM *lmconf, char *filename);
+boolean wchmm_cache_load(WCHMM_INFO *wchmm, JCONF_LM *lmconf, char *filename);
 
 /* wchmm_check.c */
 void wchmm_check_interactive(WCHMM_INFO *wchmm);
@@ -161,6 +175,7 @@ void state_align(WORD_ID *words, short wnum, HTK_Param *param, SentenceAlign *al
 void word_rev_align(WORD_ID *revwords, short wnum, HTK_Param *param, SentenceAlign *align, RecogProcess *r);
 void phoneme_rev_align(WORD_ID *revwords, short wnum, HTK_Param *param, SentenceAlign *align, RecogProcess *r);
 void state_rev_align(WORD_ID *revwords, short wnum, HTK_Param *param, SentenceAlign *align, RecogProcess *r);
+void unit_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAlign *align, RecogProcess *r, HMMWork *wrk);
 void do_alignment_all(RecogProcess *r, HTK_Param *param);
 
 /* m_usage.c */
@@ -220,11 +235,16 @@ void gmm_check_trigger(Recog *recog);
 #endif
 
 /* graphout.c */
-void wordgraph_init(WCHMM_INFO *wchmm);
+void wordgraph_init(RecogProcess *r);
+WordGraph *wordgraph_alloc(RecogProcess *r);
 void wordgraph_free(WordGraph *wg);
+void wordgraph_release_all(RecogProcess *r);
+void wordgraph_work_free(RecogProcess *r);
 void put_wordgraph(FILE *fp, WordGraph *wg, WORD_INFO *winfo);
 void wordgraph_dump(FILE *fp, WordGraph *root, WORD_INFO *winfo);
 WordGraph *wordgraph_assign(WORD_ID wid, WORD_ID wid_left, WORD_ID wid_right, int leftframe, int rightframe, LOGPROB fscore_head, LOGPROB fscore_tail, LOGPROB gscore_head, LOGPROB gscore_tail, LOGPROB lscore, LOGPROB cmscore, RecogProcess *r);
+void wordgraph_add_leftword(WordGraph *wg, WordGraph *left, LOGPROB lscore);
+void wordgraph_add_rightword(WordGraph *wg, WordGraph *right, LOGPROB lscore);
 boolean wordgraph_check_and_add_rightword(WordGraph *wg, WordGraph *right, LOGPROB lscore);
 boolean wordgraph_check_and_add_leftword(WordGraph *wg, WordGraph *left, LOGPROB lscore);
 void wordgraph_save(WordGraph *wg, WordGraph *right, WordGraph **root);
@@ -241,6 +261,11 @@ int wordgraph_sort_and_annotate_id(WordGraph **rootp, RecogProcess *r);
 void wordgraph_check_coherence(WordGraph *rootp, RecogProcess *r);
 void graph_forward_backward(WordGraph *root, RecogProcess *r);
 
+/* graphbin.c */
+boolean wordgraph_write_binary(FILE *fp, WordGraph *root, WORD_INFO *winfo, int pass, int id, int framenum);
+WordGraphBin *wordgraph_read_binary(FILE *fp);
+void wordgraph_binary_free(WordGraphBin *g);
+
 /* default.c */
 void jconf_set_default_values(Jconf *j);
 void jconf_set_default_values_am(JCONF_AM *j);
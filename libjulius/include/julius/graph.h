@@ -73,6 +73,8 @@ typedef struct __word_graph__ {
   boolean purged;		///< Purged mark for graph generation
 #endif
   LOGPROB graph_cm;		///< Confidense score computed from the graph
+  struct __word_graph__ *hashnext; ///< Next word in the same hash bucket
+  struct __recogprocess__ *region; ///< Where this word belongs to
 } WordGraph;
 
 /**
@@ -95,4 +97,27 @@ typedef struct __confnet_cluster__ {
  */
 #define CN_CLUSTER_WG_STEP 10
 
+/**
+ * <JA>
+ * バイナリ形式から読み込まれた単語グラフ. 
+ * </JA>
+ * <EN>
+ * Word graph read from the binary format.
+ * </EN>
+ */
+typedef struct {
+  int pass;			///< 1 for the 1st pass lattice, 2 for the 2nd pass
+  int id;			///< ID of the recognition process
+  int framenum;			///< Input length in frames
+  WordGraph *root;		///< First graph word, linked in the order of ID
+  int num;			///< Number of graph words
+  WORD_INFO *winfo;		///< Word strings indexed by word ID
+  HMM_Logical *phone;		///< Head and tail phones holding only names
+  int phonenum;			///< Number of @a phone
+  WordGraph *wlist;		///< Area of the graph words
+  WordGraph **context;		///< Area of the context words
+  LOGPROB *lscore;		///< Area of the LM scores of the contexts
+  unsigned char *buf;		///< Record body, holding the strings
+} WordGraphBin;
+
 #endif /* __J_GRAPH_H__ */
@@ -180,6 +180,10 @@ typedef struct __jconf_am__ {
      * CMN: TRUE if static CMN/CVN only applies CVN at file input
      */
     boolean cmn_static_cvn_only;
+    /**
+     * CMN: length of sliding window in frames, 0 to disable (-cmnwindow)
+     */
+    int cmn_window;
 
   } analysis;
 
@@ -215,6 +219,11 @@ typedef struct __jconf_am__ {
      * Load noise spectrum data from file (-ssload), that was made by "mkss".
      */
     char *ssload_filename;
+
+    /**
+     * Number of threads to extract features from buffered input (-fethreads)
+     */
+    int thread_num;
   } frontend;
 
   /**
@@ -370,6 +379,16 @@ typedef struct __jconf_lm__ {
   int separate_wnum;
 #endif
 
+  /**
+   * Cache file of the lexicon tree for N-gram (-wchmmcache)
+   */
+  char *wchmm_cache_file;
+
+  /**
+   * Number of threads to build the lexicon tree (-wchmmthreads)
+   */
+  int wchmm_threads;
+
   /**
    * For isolated word recognition mode: name of head silence model
    */
@@ -654,6 +673,34 @@ typedef struct __jconf_search__ {
     boolean graphout_search_delay;
 #endif
 
+    /**
+     * Build word lattice incrementally on the 1st pass (-pass1lattice)
+     */
+    boolean pass1lattice;
+
+    /**
+     * Score beam width for the 1st pass lattice from the best trellis
+     * word at each frame (-pass1latbeam)
+     */
+    LOGPROB pass1lattice_beam;
+
+    /**
+     * Maximum number of words added to the 1st pass lattice per frame,
+     * 0 for no limit (-pass1latmax)
+     */
+    int pass1lattice_maxnum;
+
+    /**
+     * Interval in msec to output the partial 1st pass lattice
+     * (-pass1latinterval)
+     */
+    int pass1lattice_interval;
+
+    /**
+     * Interval in frames, computed from @a pass1lattice_interval
+     */
+    int pass1lattice_interval_frame;
+
   } graph;
   
   /**
@@ -758,6 +805,10 @@ typedef struct __jconf_search__ {
      * Forced alignment: per state (-salign)
      */
     boolean align_result_state_flag;
+    /**
+     * Forced alignment: score beam width, 0 to disable (-alignbeam)
+     */
+    LOGPROB align_beam;
 
   } annotate;
 
@@ -907,6 +958,12 @@ typedef struct __Jconf__ {
      * Use 48kHz input and perform down sampling to 16kHz (-48)
      */
     boolean use_ds48to16;
+    /**
+     * Sampling rate of input device in Hz, converted to the rate of
+     * acoustic model on-the-fly if differs (-inrate).  0 means the same
+     * rate as acoustic model.
+     */
+    int input_freq;
     /**
      * List of input files for rawfile / mfcfile input (-filelist) 
      */
@@ -987,6 +1044,11 @@ typedef struct __Jconf__ {
      * the value gets lower than this value, Julius will stop recognition.
      */
     float gmm_downtrigger_thres;
+    /**
+     * (GMM_VAD) Skip computing GMMs that cannot be the best in their
+     * class before speech trigger (-gmmvadprune)
+     */
+    boolean gmm_vad_prune;
 #endif
 
 #ifdef HAVE_LIBFVAD
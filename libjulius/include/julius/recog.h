@@ -182,9 +182,12 @@ typedef struct __RealBeam__ {
   /* input parameter */
   int maxframelen;              ///< Maximum allowed input frame length
 
-  SP16 *window;         ///< Window buffer for MFCC calculation
-  int windowlen;                ///< Buffer length of @a window
-  int windownum;                ///< Currently left samples in @a window
+  SP16 *window;         ///< Sample buffer for MFCC calculation by user function
+  float *fwindow;       ///< Sample buffer for MFCC calculation, converted to float
+  int windowlen;                ///< Window length
+  int windowhead;               ///< Start point of current window in the sample buffer
+  int windownum;                ///< Currently left samples in current window
+  int ringlen;                  ///< Allocated length of the sample buffer
 
   /* for short-pause segmentation */
   boolean last_is_segmented; ///<  TRUE if last pass was a segmented input
@@ -228,8 +231,8 @@ typedef struct __StackDecode__ {
   NODE *l_bottom;       ///< bottom node of local stack for CM
 # endif
 # ifdef CM_NBEST
-  LOGPROB *sentcm = NULL;       ///< Confidence score of each sentence
-  LOGPROB *wordcm = NULL;       ///< Confidence score of each word voted from @a sentcm
+  LOGPROB *sentcm;       ///< Confidence score of each sentence
+  LOGPROB *wordcm;       ///< Confidence score of each word voted from @a sentcm
   int sentnum;          ///< Allocated length of @a sentcm
   int wordnum;          ///< Allocated length of @a wordcm
 # endif
@@ -300,6 +303,9 @@ typedef struct __gmm_calc__{
   boolean want_rewind_reprocess; ///< TRUE if GMM wants re-processing after rewind
   int rewind_frame;             ///< Frame to rewind
   int duration;                 ///< Current GMM duration work
+  LOGPROB *prune_offset;        ///< Bound of GMM score above its maximum weighted Gaussian score for -gmmvadprune, NULL if disabled
+  int best_v;                   ///< Best voice GMM at last frame
+  int best_n;                   ///< Best noise GMM at last frame
 #endif
 } GMMCalc;
 
@@ -330,6 +336,9 @@ typedef struct __sentence__ {
   int word_num;                 ///< Number of words in the sentence
   LOGPROB score;                ///< Likelihood (LM+AM)
   LOGPROB confidence[MAXSEQNUM]; ///< Word confidence scores
+#ifdef CM_MULTIPLE_ALPHA
+  LOGPROB confidence_alpha[MAXSEQNUM][100]; ///< Word confidence scores for each alpha (the first one is also in @a confidence)
+#endif
   LOGPROB score_lm;             ///< Language model likelihood (scaled) for N-gram
   LOGPROB score_am;             ///< Acoustic model likelihood for N-gram
   int gram_id;                  ///< The grammar ID this sentence belongs to for DFA
@@ -427,6 +436,7 @@ typedef struct __adin__ {
   boolean down_sample; ///< TRUE if perform down sampling from 48kHz to 16kHz
   SP16 *buffer48; ///< Another temporary buffer to hold 48kHz inputs
   int io_rate; ///< frequency rate (should be 3 always for 48/16 conversion
+  RESAMPLER *rs; ///< Resampler for input of other sampling rate, NULL if not used
 
   boolean is_valid_data;        ///< TRUE if we are now triggered
   int nc;               ///< count of current tail silence segments
@@ -484,6 +494,12 @@ typedef struct __Output__ {
   WordGraph *wg1;               ///< List of word graph generated on 1st pass
   int wg1_num;                  ///< Num of words in the wg1
 
+  WordGraph *lat1;              ///< Word lattice built incrementally on 1st pass (-pass1lattice)
+  int lat1_num;                 ///< Num of words in the lat1
+  int lat1_frame;               ///< Last frame up to which lat1 has been built
+  int lat1_newid;               ///< ID of the first word added to lat1 since the last output
+  boolean lat1_final;           ///< TRUE if lat1 is the final one at the end of 1st pass
+
   WordGraph *wg;                ///< List of word graph
 
   CN_CLUSTER *confnet;          ///< List of confusion network clusters
@@ -575,6 +591,10 @@ typedef struct __mfcc_calc__ {
      * CMN: MAP weight for initial cepstral mean on (-cmnmapweight)
    */
     float map_weight;
+    /**
+     * CMN: length of sliding window in frames, 0 if not used (-cmnwindow)
+     */
+    int window;
 
     /**
      * TRUE if CMN parameter loaded from file at boot up
@@ -642,6 +662,11 @@ typedef struct __mfcc_calc__ {
      * 
      */
     MFCCWork *mfccwrk_ss;
+
+    /**
+     * Number of threads to extract features from buffered input (-fethreads)
+     */
+    int thread_num;
     
   } frontend;
 
@@ -877,6 +902,14 @@ typedef struct __process_lm__ {
    */
   boolean global_modified;
 
+  /**
+   * Number of words at the head of the global dictionary whose IDs and
+   * categories are kept unchanged since the last lexicon build.  The tree
+   * lexicon of these words can be reused at multigram_build().
+   * 
+   */
+  WORD_ID global_kept_wnum;
+
   /**
    * LM User function entry point
    * 
@@ -1032,11 +1065,11 @@ typedef struct __recogprocess__ {
   boolean graphout;
 
   /**
-   * Temporal matrix work area to hold the order relations between words
-   * for confusion network construction.
+   * Temporal bit matrix work area to hold the order relations between
+   * words for confusion network construction.
    * 
    */
-  char *order_matrix;
+  unsigned int *order_matrix;
 
   /**
    * Number of words to be expressed in the order matrix for confusion network
@@ -1045,6 +1078,38 @@ typedef struct __recogprocess__ {
    */
   int order_matrix_count;
 
+  /**
+   * Memory blocks from which graph words and their context lists are
+   * allocated.  They are released at once for each input.
+   *
+   */
+  BMALLOC_BASE *graph_mroot;
+
+  /**
+   * Graph words released while search, kept for recycle.
+   *
+   */
+  WordGraph *graph_stocker;
+
+  /**
+   * Hash table of graph words saved on the 2nd pass, to find the same
+   * word on the same position for merging (GRAPHOUT_DYNAMIC).
+   *
+   */
+  WordGraph **graph_hash;
+
+  /**
+   * Size of @a graph_hash minus 1.
+   *
+   */
+  int graph_hash_mask;
+
+  /**
+   * Number of words in @a graph_hash.
+   *
+   */
+  int graph_hash_num;
+
 #ifdef DETERMINE
   int determine_count;
   LOGPROB determine_maxnodescore;
@@ -1059,6 +1124,28 @@ typedef struct __recogprocess__ {
    */
   boolean have_interim;
 
+  /**
+   * TRUE if has something to output at CALLBACK_RESULT_PASS1_LATTICE.
+   * 
+   */
+  boolean have_lattice;
+
+  /**
+   * Work area to build word lattice on the 1st pass (-pass1lattice)
+   * 
+   */
+  struct {
+    WordGraph **wlist;		///< Lattice words indexed by ID
+    int wlistlen;		///< Allocated length of @a wlist
+    int *fbgn;			///< ID of the first word ending at each frame
+    int fbgnlen;		///< Allocated length of @a fbgn
+    int *wmark;			///< Latest word ID per word at the current frame
+    int wmarklen;		///< Allocated length of @a wmark
+    TRELLIS_ATOM **cand;	///< Candidate trellis words at the current frame
+    int candlen;		///< Allocated length of @a cand
+    int lastnum;		///< Number of words at the last output
+  } lat1work;
+
   /**
    * User-defined data hook.  JuliusLib does not concern about its content.
    * 
@@ -115,10 +115,27 @@ typedef enum {
  * 
  */
 typedef struct {
-  /// Word-internal factoring cache indexed by scid, holding last score
+  /// Word-internal factoring cache [scid * FACTOR_CACHE_WAYS + n], holding recent scores
   LOGPROB *probcache;
-  /// Word-internal factoring cache indexed by scid, holding last N-gram entry ID
+  /// Word-internal factoring cache [scid * FACTOR_CACHE_WAYS + n], holding recent N-gram entry IDs, most recent first
   WORD_ID *lastwcache;
+#ifndef UNIGRAM_FACTORING
+  /* compact successor lists and dense 2-gram rows for 2-gram factoring */
+  WORD_ID *scnword;		///< N-gram word IDs of all successor lists, stored contiguously grouped by node depth
+#ifdef CLASS_NGRAM
+  LOGPROB *sccprob;		///< Class probabilities of words in @a scnword
+#endif
+  int *scofs;			///< Beginning of successor list [scid] in @a scnword
+  int sctotal;			///< Length of @a scnword
+  LOGPROB **row;		///< Dense factoring rows over @a scnword for frequent contexts [0..FACTOR2_ROW_NUM-1], NULL if rows are not used
+  WORD_ID *rowword;		///< Context N-gram word of each row, WORD_INVALID if empty
+  unsigned int *rowtime;	///< Last access time of each row
+  unsigned int rowclock;	///< Clock for @a rowtime
+  int *ctxrow;			///< Row index of context [last_nword], -1 if none
+  int *ctxcost;			///< Number of 2-gram lookups done for context [last_nword] since it lost its row
+  int rowthres;			///< A context gets a row when @a ctxcost exceeds this
+  LOGPROB *vocrow;		///< Work area to compute 2-gram of all N-gram words
+#endif
 /**
  * @brief  Cross-word factoring cache to hold last-word-dependent factoring
  * score toward word head nodes.
@@ -204,6 +221,20 @@ typedef struct {
   int out_from_len;
 } WCHMM_WORK;
 
+/**
+ * Word segment of a category tree, added at once by wchmm_add_segment().
+ * Segments are stacked in the order of addition, and the tree can be
+ * truncated at their boundaries to replace the tail grammars.
+ * 
+ */
+typedef struct {
+  WORD_ID word_begin;		///< First word ID of this segment
+  WORD_ID word_end;		///< Last word ID of this segment + 1
+  int cate_begin;		///< Minimum category ID in this segment
+  int node_begin;		///< Number of nodes before this segment
+  int startnum_begin;		///< Number of root nodes before this segment
+} WCHMM_SEGMENT;
+
 /**
  * Whole lexicon tree structure holding all information.
  * 
@@ -266,6 +297,14 @@ typedef struct wchmm_info {
 
   int separated_word_count; ///< Number of words actually separated (linearlized) from the tree
 
+  WCHMM_SEGMENT *seg;		///< Word segments of incrementally built category tree
+  int segnum;			///< Number of @a seg
+  int segmax;			///< Allocated number of @a seg
+  WORD_ID maxwordnum;		///< Allocated number of word-indexed arrays
+  int garbage;			///< Number of nodes discarded by truncation, not freed yet
+  float build_time;		///< Time spent to build this tree in seconds
+  int build_threads;		///< Number of threads used to build this tree
+
   char lccbuf[MAX_HMMNAME_LEN+7]; ///< Work area for HMM name conversion
   char lccbuf2[MAX_HMMNAME_LEN+7]; ///< Work area for HMM name conversion
 
@@ -203,6 +203,10 @@ adin_setup_param(ADIn *adin, Jconf *jconf)
   if (adin->down_sample) {
     adin->io_rate = 3;		/* 48 / 16 (fixed) */
     adin->buffer48 = (SP16 *)mymalloc(sizeof(SP16) * MAXSPEECHLEN * adin->io_rate);
+  } else if (adin->rs) {
+    /* holds input samples before rate conversion */
+    adin->io_rate = (adin->rs->in_rate + adin->rs->out_rate - 1) / adin->rs->out_rate;
+    adin->buffer48 = (SP16 *)mymalloc(sizeof(SP16) * MAXSPEECHLEN * adin->io_rate);
   }
   if (adin->adin_cut_on) {
     init_count_zc_e(&(adin->zc), adin->c_length);
@@ -420,6 +424,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
     a->end_of_stream = FALSE;
     a->nc = 0;
     a->sblen = 0;
+    if (a->rs) resample_reset(a->rs);
     a->need_init = FALSE;		/* for next call */
 #ifdef HAVE_LIBFVAD
     if (a->fvad) {
@@ -470,6 +475,9 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
       if (a->down_sample) {
 	/* get 48kHz samples to temporal buffer */
 	cnt = (*(a->ad_read))(a->buffer48, (a->bpmax - a->bp) * a->io_rate);
+      } else if (a->rs) {
+	/* get samples of input rate to temporal buffer */
+	cnt = (*(a->ad_read))(a->buffer48, resample_max_input(a->rs, a->bpmax - a->bp));
       } else {
 	cnt = (*(a->ad_read))(&(a->buffer[a->bp]), a->bpmax - a->bp);
       }
@@ -494,8 +502,12 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 	   the entire data is processed. */
 	a->end_of_stream = TRUE;		
 	cnt = 0;			/* no new input */
+	if (a->rs && end_status == 0) {
+	  /* output the samples remaining in the resampler */
+	  cnt = resample_flush(&(a->buffer[a->bp]), a->bpmax - a->bp, a->rs);
+	}
 	/* in case the first trial of ad_read() fails, exit this loop */
-	if (a->bp == 0) break;
+	if (a->bp == 0 && cnt == 0) break;
       }
       if (a->down_sample && cnt != 0) {
 	/* convert to 16kHz  */
@@ -508,6 +520,10 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 	  if (a->bp == 0) break;
 	}
       }
+      if (a->rs && cnt != 0 && ! a->end_of_stream) {
+	/* convert to the model sampling rate */
+	cnt = resample(&(a->buffer[a->bp]), a->buffer48, cnt, a->bpmax - a->bp, a->rs);
+      }
       if (cnt > 0 && a->level_coef != 1.0) {
 	/* scale the level of incoming input */
 	for (i = a->bp; i < a->bp + cnt; i++) {
@@ -1496,6 +1512,11 @@ adin_free_param(Recog *recog)
     ds48to16_free(a->ds);
     a->ds = NULL;
   }
+  if (a->rs) {
+    free(a->buffer48);
+    resample_free(a->rs);
+    a->rs = NULL;
+  }
   if (a->adin_cut_on) {
     free_count_zc_e(&(a->zc));
   }
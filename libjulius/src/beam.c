@@ -116,7 +116,7 @@ generate_lattice(int frame, RecogProcess *r)
       /* mark  */
       ta->within_wordgraph = TRUE;
 
-      new = (WordGraph *)mymalloc(sizeof(WordGraph));
+      new = wordgraph_alloc(r);
       new->wid = ta->wid;
       new->lefttime = ta->begintime;
       new->righttime = ta->endtime;
@@ -132,15 +132,6 @@ generate_lattice(int frame, RecogProcess *r)
       new->headphone = winfo->wseq[ta->wid][0];
       new->tailphone = winfo->wseq[ta->wid][winfo->wlen[ta->wid]-1];
 
-      new->leftwordmaxnum = FANOUTSTEP;
-      new->leftword = (WordGraph **)mymalloc(sizeof(WordGraph *) * new->leftwordmaxnum);
-      new->left_lscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * new->leftwordmaxnum);
-      new->leftwordnum = 0;
-      new->rightwordmaxnum = FANOUTSTEP;
-      new->rightword = (WordGraph **)mymalloc(sizeof(WordGraph *) * new->rightwordmaxnum);
-      new->right_lscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * new->rightwordmaxnum);
-      new->rightwordnum = 0;
-
       l = ta->backscore;
       if (ta->last_tre->wid != WORD_INVALID) {
 	l -= ta->last_tre->backscore;
@@ -1886,6 +1877,12 @@ get_back_trellis_init(HTK_Param *param,	RecogProcess *r)
   /* set interval frame for progout */
   r->config->output.progout_interval_frame = (int)((float)r->config->output.progout_interval / ((float)param->header.wshift / 10000.0));
 
+  if (r->config->graph.pass1lattice) {
+    /* 第1パスのラティス生成を初期化 */
+    /* initialize lattice generation on the 1st pass */
+    pass1_lattice_init(r, param->header.wshift);
+  }
+
   if (r->config->successive.enabled) {
     /* ショートポーズセグメンテーション用パラメータの初期化 */
     /* initialize parameter for short pause segmentation */
@@ -2975,6 +2972,12 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
   /*    finalize */
   /***************/
 
+  if (r->config->graph.pass1lattice && t > 0) {
+    /* 前フレームで終端したトレリス単語で第1パスのラティスを拡張 */
+    /* extend the 1st pass lattice by trellis words ending at last frame */
+    pass1_lattice_extend(r, t-1);
+  }
+
 #ifdef SPSEGMENT_NAIST
   if (!r->config->successive.enabled || d->after_trigger) {
 #endif
@@ -3083,6 +3086,9 @@ get_back_trellis_end(HTK_Param *param, RecogProcess *r)
 	save_trellis(r->backtrellis, wchmm, tk, param->samplenum, TRUE);
       }
     }
+    if (r->config->graph.pass1lattice) {
+      pass1_lattice_extend(r, param->samplenum - 1);
+    }
 
   }
 #ifdef SCORE_PRUNING
@@ -3143,6 +3149,13 @@ finalize_1st_pass(RecogProcess *r, int len)
 
   bt_relocate_rw(backtrellis);
   bt_sort_rw(backtrellis);
+
+  if (r->config->graph.pass1lattice) {
+    /* 第1パスのラティスを完成させる */
+    /* finalize the 1st pass lattice */
+    pass1_lattice_finish(r, len);
+  }
+
   if (backtrellis->num == NULL) {
     if (backtrellis->framelen > 0) {
       jlog("WARNING: %02d %s: input processed, but no survived word found\n", r->config->id, r->config->name);
@@ -211,6 +211,7 @@ callback_debug_stdout(int code, Recog *recog)
   case CALLBACK_DEBUG_PASS2_POP: c_out("CALLBACK_DEBUG_PASS2_POP", f); break;
   case CALLBACK_DEBUG_PASS2_PUSH: c_out("CALLBACK_DEBUG_PASS2_PUSH", f); break;
     //case CALLBACK_RESULT_PASS1_DETERMINED: c_out("CALLBACK_RESULT_PASS1_DETERMINED", f); break;
+    //case CALLBACK_RESULT_PASS1_LATTICE: c_out("CALLBACK_RESULT_PASS1_LATTICE", f); break;
   }
 }
 
@@ -62,33 +62,67 @@
 
 
 /** 
- * Determine whether the two words are idential in confusion network
- * generation.
+ * Similarity of a cluster pair.
  * 
- * @param w1 [in] first word
- * @param w2 [in] second word
- * @param winfo [in] word dictionary
+ */
+typedef struct {
+  PROB sim;			///< Similarity
+  int c1;			///< Cluster index, c1 < c2
+  int c2;			///< Cluster index
+  int s1;			///< Update count of c1 at computation
+  int s2;			///< Update count of c2 at computation
+} CN_PAIR;
+
+/**
+ * Computed edit distance of a word pair.
  * 
- * @return TRUE if they are idential, FALSE if not.
  */
-static boolean
-is_same_word(WORD_ID w1, WORD_ID w2, WORD_INFO *winfo)
-{
-  if (w1 == w2
-#ifdef BUNDLE_WORD_WITH_SAME_OUTPUT
-      || strmatch(winfo->woutput[w1], winfo->woutput[w2])
-#endif
-      ) return TRUE;
-  return FALSE;
-}
+typedef struct {
+  int i1;			///< Index of word 1 in the word list, -1 if empty
+  int i2;			///< Index of word 2, i1 <= i2
+  int dist;			///< Edit distance
+} CN_MEMO;
+
+/**
+ * Work area for confusion network generation.
+ *
+ */
+typedef struct {
+  WORD_INFO *winfo;		///< Word dictionary
+  int *key;			///< Word key of each graph word (by id), same key means same word
+  WORD_ID *wids;		///< Sorted list of words in the graph
+  int wnum;			///< Number of @a wids
+  int **phone;			///< Center phone ID sequence of each word in @a wids, built when needed
+  char **pname;			///< Center phone names to assign phone ID
+  int pnum;			///< Number of @a pname
+  int pnum_alloc;		///< Allocated size of @a pname
+  int *dist_buf;		///< Work area for edit distance computation
+  int dist_buf_len;		///< Allocated length of @a dist_buf
+  CN_MEMO *memo;		///< Hash table of computed edit distances
+  int memo_num;			///< Number of entries in @a memo
+  int memo_mask;		///< Size of @a memo minus 1
+  CN_PAIR *heap;		///< Priority queue of cluster pairs to be merged
+  int heapnum;			///< Number of pairs in @a heap
+  int heapalloc;		///< Allocated size of @a heap
+} CN_WORK;
 
 /**************************************************************/
 
 /**
- * Macro to access the order matrix.
+ * Number of bits in a unit of the order matrix.
  * 
  */
-#define m2i(A, B) (B) * r->order_matrix_count + (A)
+#define OM_BITS 32
+
+/**
+ * Macros to access the order matrix.  Each graph word has a bit row,
+ * in which bit j is set when the word precedes word j.
+ *
+ */
+#define om_width(R) (((R)->order_matrix_count + OM_BITS - 1) / OM_BITS)
+#define om_row(R, I) (&((R)->order_matrix[(I) * om_width(R)]))
+#define om_get(R, I, J) ((om_row(R, I)[(J) / OM_BITS] >> ((J) % OM_BITS)) & 1)
+#define om_set(R, I, J) (om_row(R, I)[(J) / OM_BITS] |= (1u << ((J) % OM_BITS)))
 
 /**
  * Judge order between two words by their word graph ID.
@@ -101,43 +135,64 @@ is_same_word(WORD_ID w1, WORD_ID w2, WORD_INFO *winfo)
 static boolean
 graph_ordered(RecogProcess *r, int i, int j) 
 {
-  if (i != j  && r->order_matrix[m2i(i,j)] == 0 && r->order_matrix[m2i(j,i)] == 0) {
+  if (i != j  && om_get(r, i, j) == 0 && om_get(r, j, i) == 0) {
     return FALSE;
   }
   return TRUE;
 }  
 
 /** 
- * Scan the order matrix to update it at initial step and after word
- * (set) marging.
+ * Make the order matrix transitive at initial step, when the graph
+ * has loop.
  * 
  */
 static void
 graph_update_order(RecogProcess *r)
 {
-  int i, j, k;
-  boolean changed;
+  int i, k, n, w;
   int count;
+  unsigned int *ri, *rk;
 
   count = r->order_matrix_count;
+  w = om_width(r);
   
-  do {
-    changed = FALSE;
+  for(k=0;k<count;k++) {
+    rk = om_row(r, k);
     for(i=0;i<count;i++) {
-      for(j=0;j<count;j++) {
-	if (r->order_matrix[m2i(i, j)] == 1) {
-	  for(k=0;k<count;k++) {
-	    if (r->order_matrix[m2i(j, k)] == 1) {
-	      if (r->order_matrix[m2i(i, k)] == 0) {
-		r->order_matrix[m2i(i, k)] = 1;
-		changed = TRUE;
-	      }
-	    }
-	  }
-	}
+      if (om_get(r, i, k)) {
+	ri = om_row(r, i);
+	for(n=0;n<w;n++) ri[n] |= rk[n];
       }
     }
-  } while (changed == TRUE);
+  }
+}
+
+/**
+ * Add an order relation to the order matrix after word (set) merging,
+ * keeping it transitive.
+ *
+ * @param a [in] id of left graph word
+ * @param b [in] id of right graph word
+ */
+static void
+graph_add_order(RecogProcess *r, int a, int b)
+{
+  int x, n, w;
+  unsigned int *rx, *rb;
+
+  if (om_get(r, a, b)) return;	/* already known */
+
+  w = om_width(r);
+  rb = om_row(r, b);
+  /* all words preceding a, and a itself, now precede b and its
+     followers.  Words already preceding b also precede its followers */
+  for(x=0;x<r->order_matrix_count;x++) {
+    if ((x == a || om_get(r, x, a)) && om_get(r, x, b) == 0) {
+      rx = om_row(r, x);
+      for(n=0;n<w;n++) rx[n] |= rb[n];
+      om_set(r, x, b);
+    }
+  }
 }
 
 /** 
@@ -155,7 +210,11 @@ graph_make_order(WordGraph *root, RecogProcess *r)
 {
   int count;
   WordGraph *wg, *right;
-  int i;
+  WordGraph **wlist;
+  int *indeg, *order;
+  int head, tail;
+  unsigned int *ri, *rj;
+  int i, j, k, n, w;
   
   /* make sure total num and id are valid */
   count = 0;
@@ -179,19 +238,54 @@ graph_make_order(WordGraph *root, RecogProcess *r)
   }
 
   /* allocate and clear matrix */
-  r->order_matrix = (char *)mymalloc(count * count);
-  for(i=0;i<count*count;i++) r->order_matrix[i] = 0;
+  w = om_width(r);
+  r->order_matrix = (unsigned int *)mymalloc(sizeof(unsigned int) * w * count);
+  memset(r->order_matrix, 0, sizeof(unsigned int) * w * count);
   
-  /* set initial order info */
+  /* sort words topologically */
+  wlist = (WordGraph **)mymalloc(sizeof(WordGraph *) * count);
+  indeg = (int *)mymalloc(sizeof(int) * count);
+  order = (int *)mymalloc(sizeof(int) * count);
+  for(i=0;i<count;i++) indeg[i] = 0;
   for(wg=root;wg;wg=wg->next) {
+    wlist[wg->id] = wg;
+    for(i=0;i<wg->rightwordnum;i++) indeg[wg->rightword[i]->id]++;
+  }
+  head = tail = 0;
+  for(i=0;i<count;i++) if (indeg[i] == 0) order[tail++] = i;
+  while(head < tail) {
+    wg = wlist[order[head++]];
     for(i=0;i<wg->rightwordnum;i++) {
-      right = wg->rightword[i];
-      r->order_matrix[m2i(wg->id, right->id)] = 1;
+      if (--indeg[wg->rightword[i]->id] == 0) order[tail++] = wg->rightword[i]->id;
+    }
+  }
+
+  if (tail == count) {
+    /* propagate followers from right to left */
+    for(k=count-1;k>=0;k--) {
+      wg = wlist[order[k]];
+      ri = om_row(r, wg->id);
+      for(i=0;i<wg->rightwordnum;i++) {
+	j = wg->rightword[i]->id;
+	om_set(r, wg->id, j);
+	rj = om_row(r, j);
+	for(n=0;n<w;n++) ri[n] |= rj[n];
+      }
     }
+  } else {
+    /* graph has loop: set initial order info and make it transitive */
+    for(wg=root;wg;wg=wg->next) {
+      for(i=0;i<wg->rightwordnum;i++) {
+	right = wg->rightword[i];
+	om_set(r, wg->id, right->id);
+      }
+    }
+    graph_update_order(r);
   }
 
-  /* right propagate loop */
-  graph_update_order(r);
+  free(order);
+  free(indeg);
+  free(wlist);
 }
 
 /**
@@ -301,14 +395,13 @@ cn_merge(RecogProcess *r, CN_CLUSTER *dst, CN_CLUSTER *src)
     wg = src->wg[i];
     for(j=0;j<dst->wgnum;j++) {
       for(n=0;n<wg->leftwordnum;n++) {
-	r->order_matrix[m2i(wg->leftword[n]->id, dst->wg[j]->id)] = 1;
+	graph_add_order(r, wg->leftword[n]->id, dst->wg[j]->id);
       }
       for(n=0;n<wg->rightwordnum;n++) {
-	r->order_matrix[m2i(dst->wg[j]->id, wg->rightword[n]->id)] = 1;
+	graph_add_order(r, dst->wg[j]->id, wg->rightword[n]->id);
       }
     }
   }
-  graph_update_order(r);
   /* add words in the source cluster to target cluster */
   for(i=0;i<src->wgnum;i++) {
     cn_add_wg(dst, src->wg[i]);
@@ -316,56 +409,125 @@ cn_merge(RecogProcess *r, CN_CLUSTER *dst, CN_CLUSTER *src)
 }
 
 /** 
- * Erase a cluster holder and remove it from the list.
+ * Build / update word list from graph words for a cluster holder,
+ * with the sum of confidence scores of each word.
  * 
- * @param target [i/o] a cluster holder to be erased
- * @param root [i/o] pointer to root pointer of cluster holder list
+ * @param c [i/o] cluster holder to process
+ * @param work [in] work area
  */
 static void
-cn_destroy(CN_CLUSTER *target, CN_CLUSTER **root)
+cn_build_wordlist(CN_CLUSTER *c, CN_WORK *work)
 {
-  CN_CLUSTER *c, *cprev;
+  int i, j, k;
+  int *ekey;
 
-  cprev = NULL;
-  for(c = *root; c; c = c->next) {
-    if (c == target) {
-      if (cprev) {
-	cprev->next = c->next;
-      } else {
-	*root = c->next;
-      }
-      cn_free(c);
-      break;
+  if (c->words) free(c->words);
+  if (c->pp) free(c->pp);
+  c->words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * (c->wgnum + 1));
+  c->pp = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (c->wgnum + 1));
+  ekey = (int *)mymalloc(sizeof(int) * c->wgnum);
+  c->wordsnum = 0;
+  for(i=0;i<c->wgnum;i++) {
+    k = work->key[c->wg[i]->id];
+    for(j=0;j<c->wordsnum;j++) {
+      if (ekey[j] == k) break;
+    }
+    if (j >= c->wordsnum) {
+      ekey[j] = k;
+      c->words[j] = c->wg[i]->wid;
+      c->pp[j] = 0.0;
+      c->wordsnum++;
     }
-    cprev = c;
+#ifdef PREFER_GRAPH_CM
+    c->pp[j] += c->wg[i]->graph_cm;
+#else
+    c->pp[j] += c->wg[i]->cmscore;
+#endif
   }
+  free(ekey);
 }
 
 /** 
- * Build / update word list from graph words for a cluster holder.
+ * qsort_reentrant callback to sort graph words by their output strings.
  * 
- * @param c [i/o] cluster holder to process
+ * @param x [in] element 1
+ * @param y [in] element 2
  * @param winfo [in] word dictionary 
+ *
+ * @return order value
  */
-static void
-cn_build_wordlist(CN_CLUSTER *c, WORD_INFO *winfo)
+static int
+compare_wg_word(WordGraph **x, WordGraph **y, WORD_INFO *winfo)
 {
-  int i, j;
+#ifdef BUNDLE_WORD_WITH_SAME_OUTPUT
+  return(strcmp(winfo->woutput[(*x)->wid], winfo->woutput[(*y)->wid]));
+#else
+  if ((*x)->wid < (*y)->wid) return -1;
+  if ((*x)->wid > (*y)->wid) return 1;
+  return 0;
+#endif
+}
 
-  if (c->words) {
-    free(c->words);
-  }
-  c->words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * (c->wgnum + 1));
-  c->wordsnum = 0;
-  for(i=0;i<c->wgnum;i++) {
-    for(j=0;j<c->wordsnum;j++) {
-      if (is_same_word(c->words[j], c->wg[i]->wid, winfo)) break;
-    }
-    if (j>=c->wordsnum) {
-      c->words[c->wordsnum] = c->wg[i]->wid;
-      c->wordsnum++;
-    }
+/**
+ * qsort_reentrant callback to sort graph words by their word keys and
+ * begin frames.
+ *
+ * @param x [in] element 1
+ * @param y [in] element 2
+ * @param work [in] work area
+ *
+ * @return order value
+ */
+static int
+compare_wg_key_time(WordGraph **x, WordGraph **y, CN_WORK *work)
+{
+  int k1, k2;
+
+  k1 = work->key[(*x)->id];
+  k2 = work->key[(*y)->id];
+  if (k1 != k2) return(k1 - k2);
+  return((*x)->lefttime - (*y)->lefttime);
+}
+
+/**
+ * qsort callback to sort word IDs.
+ *
+ * @param a [in] element 1
+ * @param b [in] element 2
+ *
+ * @return order value
+ */
+static int
+compare_wid(WORD_ID *a, WORD_ID *b)
+{
+  if (*a < *b) return -1;
+  if (*a > *b) return 1;
+  return 0;
+}
+
+/**
+ * Assign word keys to graph words: two graph words get the same key
+ * when they are identical in confusion network generation.
+ *
+ * @param work [i/o] work area
+ * @param wlist [in] graph words
+ * @param num [in] number of @a wlist
+ */
+static void
+cn_assign_key(CN_WORK *work, WordGraph **wlist, int num)
+{
+  WordGraph **tmp;
+  int i, k;
+
+  tmp = (WordGraph **)mymalloc(sizeof(WordGraph *) * num);
+  memcpy(tmp, wlist, sizeof(WordGraph *) * num);
+  qsort_reentrant(tmp, num, sizeof(WordGraph *), (int (*)(const void *, const void *, void *))compare_wg_word, work->winfo);
+  k = 0;
+  for(i=0;i<num;i++) {
+    if (i > 0 && compare_wg_word(&(tmp[i-1]), &(tmp[i]), work->winfo) != 0) k++;
+    work->key[tmp[i]->id] = k;
   }
+  free(tmp);
 }
 
 /** 
@@ -399,7 +561,7 @@ compare_cluster(CN_CLUSTER **x, CN_CLUSTER **y, RecogProcess *r)
   for(i=0;i<(*x)->wgnum;i++) {
     for(j=0;j<(*y)->wgnum;j++) {
       //if (graph_ordered((*x)->wg[i]->id, (*y)->wg[j]->id)) dir = 1;
-      if (r->order_matrix[m2i((*x)->wg[i]->id, (*y)->wg[j]->id)] == 1) {
+      if (om_get(r, (*x)->wg[i]->id, (*y)->wg[j]->id)) {
 	return -1;
       }
     }
@@ -469,34 +631,6 @@ get_intraword_similarity(WordGraph *w1, WordGraph *w2)
   return sim;
 }
 
-/** 
- * Compute intra-word similarity of two clusters.
- * 
- * @param c1 [in] cluster 1
- * @param c2 [in] cluster 2
- * @param winfo [in] word dictionary
- * 
- * @return the maximum similarity.
- */
-static PROB
-get_cluster_intraword_similarity(CN_CLUSTER *c1, CN_CLUSTER *c2, WORD_INFO *winfo)
-{
-  int i1, i2;
-  PROB simmax, sim;
-
-  simmax = 0.0;
-  for(i1 = 0; i1 < c1->wgnum; i1++) {
-    for(i2 = 0; i2 < c2->wgnum; i2++) {
-      if (is_same_word(c1->wg[i1]->wid, c2->wg[i2]->wid, winfo)) {
-	//if (graph_ordered(c1->wg[i1]->id, c2->wg[i2]->id)) continue;
-	sim = get_intraword_similarity(c1->wg[i1], c2->wg[i2]);
-	if (simmax < sim) simmax = sim;
-      }
-    }
-  }
-  return(simmax);
-}
-
 #ifdef CDEBUG
 /** 
  * Output a cluster information.
@@ -540,79 +674,213 @@ minimum(int a, int b, int c)
 }
 
 /** 
+ * Expand the hash table of edit distances.
+ *
+ * @param work [i/o] work area
+ */
+static void
+cn_memo_expand(CN_WORK *work)
+{
+  CN_MEMO *old;
+  int oldsize, i, h;
+
+  old = work->memo;
+  oldsize = (old == NULL) ? 0 : work->memo_mask + 1;
+  work->memo_mask = (oldsize == 0) ? 255 : oldsize * 2 - 1;
+  work->memo = (CN_MEMO *)mymalloc(sizeof(CN_MEMO) * (work->memo_mask + 1));
+  for(i=0;i<=work->memo_mask;i++) work->memo[i].i1 = -1;
+  for(i=0;i<oldsize;i++) {
+    if (old[i].i1 == -1) continue;
+    h = ((unsigned int)old[i].i1 * 31 + (unsigned int)old[i].i2) * 2654435761u & work->memo_mask;
+    while (work->memo[h].i1 != -1) h = (h + 1) & work->memo_mask;
+    work->memo[h] = old[i];
+  }
+  if (old) free(old);
+}
+
+/**
+ * Return local index of a word appearing in the graph.
+ *
+ * @param work [in] work area
+ * @param w [in] word ID
+ *
+ * @return the index in @a work->wids.
+ */
+static int
+cn_word_index(CN_WORK *work, WORD_ID w)
+{
+  int left, right, mid;
+
+  left = 0;
+  right = work->wnum - 1;
+  while (left < right) {
+    mid = (left + right) / 2;
+    if (work->wids[mid] < w) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
+
+/**
+ * Get center phone ID sequence of a word, building it at first call.
+ *
+ * @param work [i/o] work area
+ * @param w [in] word ID
+ * @param i [in] local index of @a w
+ *
+ * @return the phone ID sequence.
+ */
+static int *
+cn_word_phone(CN_WORK *work, WORD_ID w, int i)
+{
+  char buf[MAX_HMMNAME_LEN];
+  int *p;
+  int j, k;
+
+  if (work->phone[i] != NULL) return(work->phone[i]);
+  p = (int *)mymalloc(sizeof(int) * (work->winfo->wlen[w] + 1));
+  for(j=0;j<work->winfo->wlen[w];j++) {
+    center_name(work->winfo->wseq[w][j]->name, buf);
+    for(k=0;k<work->pnum;k++) {
+      if (strmatch(work->pname[k], buf)) break;
+    }
+    if (k >= work->pnum) {
+      if (work->pnum >= work->pnum_alloc) {
+	work->pnum_alloc += 64;
+	work->pname = (char **)myrealloc(work->pname, sizeof(char *) * work->pnum_alloc);
+      }
+      work->pname[k] = strcpy((char *)mymalloc(strlen(buf) + 1), buf);
+      work->pnum++;
+    }
+    p[j] = k;
+  }
+  work->phone[i] = p;
+  return(p);
+}
+
+/**
  * Calculate Levenstein distance (edit distance) of two words.
+ * The results are memorized in the work area.
  * 
+ * @param work [i/o] work area
  * @param w1 [in] word ID 1
  * @param w2 [in] word ID 2
- * @param winfo [in] word dictionary
  * 
  * @return the distance.
  */
 static int
-edit_distance(WORD_ID w1, WORD_ID w2, WORD_INFO *winfo, char *b1, char *b2)
+edit_distance(CN_WORK *work, WORD_ID w1, WORD_ID w2)
 {
-  int i1, i2;
-  int *d;
+  int i1, i2, tmp;
   int len1, len2;
-  int j;
+  int *p1, *p2;
+  int *d0, *d1, *dtmp;
+  int i, j, h;
   int cost;
   int distance;
 
-  len1 = winfo->wlen[w1] + 1;
-  len2 = winfo->wlen[w2] + 1;
-  d = (int *)mymalloc(sizeof(int) * len1 * len2);
-  for(j=0;j<len1;j++) d[j] = j;
-  for(j=0;j<len2;j++) d[j*len1] = j;
-
-  for(i1=1;i1<len1;i1++) {
-    center_name(winfo->wseq[w1][i1-1]->name, b1);
-    for(i2=1;i2<len2;i2++) {
-      center_name(winfo->wseq[w2][i2-1]->name, b2);
-      if (strmatch(b1, b2)) {
-	cost = 0;
-      } else {
-	cost = 1;
-      }
-      d[i2 * len1 + i1] = minimum(d[(i2-1) * len1 + i1] + 1, d[i2 * len1 + (i1-1)] + 1, d[(i2-1) * len1 + (i1-1)] + cost);
+  i1 = cn_word_index(work, w1);
+  i2 = cn_word_index(work, w2);
+  if (i1 > i2) {
+    tmp = i1; i1 = i2; i2 = tmp;
+    tmp = w1; w1 = w2; w2 = tmp;
+  }
+
+  /* look up the memory */
+  h = ((unsigned int)i1 * 31 + (unsigned int)i2) * 2654435761u & work->memo_mask;
+  while (work->memo[h].i1 != -1) {
+    if (work->memo[h].i1 == i1 && work->memo[h].i2 == i2) {
+      return(work->memo[h].dist);
     }
+    h = (h + 1) & work->memo_mask;
   }
 
-  distance = d[len1 * len2 - 1];
+  /* compute by dynamic programming, keeping two rows */
+  len1 = work->winfo->wlen[w1];
+  len2 = work->winfo->wlen[w2];
+  p1 = cn_word_phone(work, w1, i1);
+  p2 = cn_word_phone(work, w2, i2);
+  if (work->dist_buf_len < (len2 + 1) * 2) {
+    work->dist_buf_len = (len2 + 1) * 2;
+    work->dist_buf = (int *)myrealloc(work->dist_buf, sizeof(int) * work->dist_buf_len);
+  }
+  d0 = work->dist_buf;
+  d1 = work->dist_buf + len2 + 1;
+  for(j=0;j<=len2;j++) d0[j] = j;
+  for(i=1;i<=len1;i++) {
+    d1[0] = i;
+    for(j=1;j<=len2;j++) {
+      cost = (p1[i-1] == p2[j-1]) ? 0 : 1;
+      d1[j] = minimum(d0[j] + 1, d1[j-1] + 1, d0[j-1] + cost);
+    }
+    dtmp = d0; d0 = d1; d1 = dtmp;
+  }
+  distance = d0[len2];
+
+  /* memorize */
+  work->memo[h].i1 = i1;
+  work->memo[h].i2 = i2;
+  work->memo[h].dist = distance;
+  work->memo_num++;
+  if (work->memo_num * 2 > work->memo_mask) cn_memo_expand(work);
 
-  free(d);
   return(distance);
 }
 
+/**
+ * Check if two clusters are ordered, i.e. any words in them are ordered.
+ *
+ * @param r [in] recognition process instance
+ * @param c1 [in] cluster 1
+ * @param c2 [in] cluster 2
+ *
+ * @return TRUE if ordered, FALSE if not.
+ */
+static boolean
+cn_cluster_ordered(RecogProcess *r, CN_CLUSTER *c1, CN_CLUSTER *c2)
+{
+  int i1, i2;
+
+  for(i1 = 0; i1 < c1->wgnum; i1++) {
+    for(i2 = 0; i2 < c2->wgnum; i2++) {
+      if (graph_ordered(r, c1->wg[i1]->id, c2->wg[i2]->id)) {
+	return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
 /** 
  * Compute inter-word similarity of two clusters.
  * 
  * @param c1 [in] cluster 1
  * @param c2 [in] cluster 2
- * @param winfo [in] word dictionary
+ * @param work [i/o] work area
  * 
  * @return the average similarity.
  */
 static PROB
-get_cluster_interword_similarity(RecogProcess *r, CN_CLUSTER *c1, CN_CLUSTER *c2, WORD_INFO *winfo, char *buf1, char *buf2)
+get_cluster_interword_similarity(RecogProcess *r, CN_CLUSTER *c1, CN_CLUSTER *c2, CN_WORK *work)
 {
-  int i1, i2, j;
+  int i1, i2;
   WORD_ID w1, w2;
   PROB p1, p2;
   PROB sim, simsum;
   int simsum_count;
   int dist;
+  WORD_INFO *winfo = work->winfo;
+#ifdef CDEBUG2
+  int j;
+#endif
 
   /* order check */
-  for(i1 = 0; i1 < c1->wgnum; i1++) {
-    for(i2 = 0; i2 < c2->wgnum; i2++) {
-      if (graph_ordered(r, c1->wg[i1]->id, c2->wg[i2]->id)) {
-	/* ordered clusters should not be merged */
-	//printf("Ordered:\n");
-	//printf("c1:\n"); put_cluster(stdout, c1, winfo);
-	//printf("c2:\n"); put_cluster(stdout, c2, winfo);
-	return 0.0;
-      }
-    }
+  if (cn_cluster_ordered(r, c1, c2)) {
+    /* ordered clusters should not be merged */
+    return 0.0;
   }
 
 #ifdef CDEBUG2
@@ -626,29 +894,11 @@ get_cluster_interword_similarity(RecogProcess *r, CN_CLUSTER *c1, CN_CLUSTER *c2
   simsum_count = 0;
   for(i1 = 0; i1 < c1->wordsnum; i1++) {
     w1 = c1->words[i1];
-    p1 = 0.0;
-    for(j = 0; j < c1->wgnum; j++) {
-      if (is_same_word(c1->wg[j]->wid, w1, winfo)) {
-#ifdef PREFER_GRAPH_CM
-	p1 += c1->wg[j]->graph_cm;
-#else
-	p1 += c1->wg[j]->cmscore;
-#endif
-      }
-    }
+    p1 = c1->pp[i1];
     for(i2 = 0; i2 < c2->wordsnum; i2++) {
       w2 = c2->words[i2];
-      p2 = 0.0;
-      for(j = 0; j < c2->wgnum; j++) {
-	if (is_same_word(c2->wg[j]->wid, w2, winfo)) {
-#ifdef PREFER_GRAPH_CM
-	  p2 += c2->wg[j]->graph_cm;
-#else
-	  p2 += c2->wg[j]->cmscore;
-#endif
-	}
-      }
-      dist = edit_distance(w1, w2, winfo, buf1, buf2);
+      p2 = c2->pp[i2];
+      dist = edit_distance(work, w1, w2);
 #ifdef CDEBUG2
       for(j=0;j<winfo->wlen[w1];j++) {
 	printf("%s ", winfo->wseq[w1][j]->name);
@@ -680,10 +930,190 @@ get_cluster_interword_similarity(RecogProcess *r, CN_CLUSTER *c1, CN_CLUSTER *c2
   return(simsum / simsum_count);
 }
 
+/**
+ * Judge which of the two cluster pairs should be merged first: the one
+ * with higher similarity, or the one appearing first in the cluster list.
+ *
+ * @param a [in] cluster pair 1
+ * @param b [in] cluster pair 2
+ *
+ * @return TRUE if @a a comes first, FALSE if not.
+ */
+static boolean
+cn_pair_higher(CN_PAIR *a, CN_PAIR *b)
+{
+  if (a->sim != b->sim) return(a->sim > b->sim);
+  if (a->c1 != b->c1) return(a->c1 < b->c1);
+  return(a->c2 < b->c2);
+}
+
+/**
+ * qsort callback to sort cluster pairs in merging order.
+ *
+ * @param x [in] element 1
+ * @param y [in] element 2
+ *
+ * @return order value
+ */
+static int
+compare_pair(CN_PAIR *x, CN_PAIR *y)
+{
+  if (cn_pair_higher(x, y)) return -1;
+  if (cn_pair_higher(y, x)) return 1;
+  return 0;
+}
+
+/**
+ * Add a cluster pair to a list.
+ *
+ * @param list [i/o] pointer to the list
+ * @param num [i/o] number of pairs in the list
+ * @param alloc [i/o] allocated size of the list
+ * @param p [in] pair to add
+ */
+static void
+cn_pair_add(CN_PAIR **list, int *num, int *alloc, CN_PAIR *p)
+{
+  if (*num >= *alloc) {
+    *alloc = (*alloc == 0) ? 256 : *alloc * 2;
+    *list = (CN_PAIR *)myrealloc(*list, sizeof(CN_PAIR) * (*alloc));
+  }
+  (*list)[*num] = *p;
+  (*num)++;
+}
+
+/**
+ * Put a cluster pair into the priority queue.
+ *
+ * @param work [i/o] work area holding the queue
+ * @param p [in] pair to put
+ */
+static void
+cn_heap_push(CN_WORK *work, CN_PAIR *p)
+{
+  int i, parent;
+  CN_PAIR *h;
+
+  cn_pair_add(&(work->heap), &(work->heapnum), &(work->heapalloc), p);
+  h = work->heap;
+  i = work->heapnum - 1;
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!cn_pair_higher(p, &(h[parent]))) break;
+    h[i] = h[parent];
+    i = parent;
+  }
+  h[i] = *p;
+}
+
+/**
+ * Take the first cluster pair from the priority queue.
+ *
+ * @param work [i/o] work area holding the queue
+ * @param p [out] the pair taken
+ */
+static void
+cn_heap_pop(CN_WORK *work, CN_PAIR *p)
+{
+  int i, child;
+  CN_PAIR *h;
+  CN_PAIR last;
+
+  h = work->heap;
+  *p = h[0];
+  work->heapnum--;
+  if (work->heapnum == 0) return;
+  last = h[work->heapnum];
+  i = 0;
+  while ((child = i * 2 + 1) < work->heapnum) {
+    if (child + 1 < work->heapnum && cn_pair_higher(&(h[child+1]), &(h[child]))) child++;
+    if (!cn_pair_higher(&(h[child]), &last)) break;
+    h[i] = h[child];
+    i = child;
+  }
+  h[i] = last;
+}
+
+/**
+ * Compute inter-word similarity of two clusters and put them to the
+ * priority queue if they can be merged.
+ *
+ * @param r [in] recognition process instance
+ * @param work [i/o] work area
+ * @param clist [in] clusters
+ * @param stamp [in] update count of each cluster
+ * @param c1 [in] index of cluster 1, @a c1 < @a c2
+ * @param c2 [in] index of cluster 2
+ */
+static void
+cn_push_interword_pair(RecogProcess *r, CN_WORK *work, CN_CLUSTER **clist, int *stamp, int c1, int c2)
+{
+  CN_PAIR p;
+
+  p.sim = get_cluster_interword_similarity(r, clist[c1], clist[c2], work);
+  if (p.sim > 0.0) {
+    p.c1 = c1;
+    p.c2 = c2;
+    p.s1 = stamp[c1];
+    p.s2 = stamp[c2];
+    cn_heap_push(work, &p);
+  }
+}
+
+/**
+ * Find the cluster a graph word currently belongs to.
+ *
+ * @param parent [i/o] parent index of each cluster
+ * @param i [in] initial cluster index of the graph word
+ *
+ * @return the cluster index.
+ */
+static int
+cn_find(int *parent, int i)
+{
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/**
+ * Make cluster list from cluster array, removing the merged ones.
+ *
+ * @param clist [i/o] cluster array, merged ones are NULL
+ * @param num [in] number of @a clist
+ *
+ * @return the number of clusters.
+ */
+static int
+cn_link(CN_CLUSTER **clist, int num)
+{
+  int i, n;
+
+  n = 0;
+  for(i=0;i<num;i++) {
+    if (clist[i] == NULL) continue;
+    if (n > 0) clist[n-1]->next = clist[i];
+    clist[n++] = clist[i];
+  }
+  if (n > 0) clist[n-1]->next = NULL;
+  return n;
+}
 
 /** 
  * @brief  Create a confusion network from word graph.
  *
+ * Graph words are first clustered by intra-word similarity, then the
+ * clusters are further clustered by inter-word similarity.  At each
+ * step the most similar pair is merged.  As the intra-word similarity
+ * of clusters is the maximum of their graph words, the intra-word
+ * clustering merges graph word pairs in descending order of their
+ * similarity.  Only pairs of the same word overlapping in time are
+ * examined.  In the inter-word clustering, the similarities are kept
+ * in a priority queue, and only those of the merged cluster are
+ * re-computed at each step.
+ *
  * @param root [in] root pointer of word graph
  * @param r [in] recognition process instance
  *
@@ -697,54 +1127,137 @@ CN_CLUSTER *
 confnet_create(WordGraph *root, RecogProcess *r)
 {
   CN_CLUSTER *croot;
-  CN_CLUSTER *c, *cc, *cmax1, *cmax2;
+  CN_CLUSTER *c;
+  CN_CLUSTER **clist;
   WordGraph *wg;
-  PROB sim, max_sim;
-  int wg_totalnum, n, i;
-  char *buf1, *buf2;
+  WordGraph **wlist, **tmp;
+  CN_WORK work;
+  CN_PAIR p, *pairs;
+  int pairnum, pairalloc;
+  int *parent, *stamp, *wpos;
+  int wg_totalnum, n, i, j, k;
+  int ge, gn, best, ba, bb, a, b;
 
-  buf1 = (char *)mymalloc(MAX_HMMNAME_LEN);
-  buf2 = (char *)mymalloc(MAX_HMMNAME_LEN);
+  if (r->order_matrix == NULL) return NULL;
 
   /* make initial confnet instances from word graph */
-  croot = NULL;
-  wg_totalnum = 0;
+  wg_totalnum = r->order_matrix_count;
+  clist = (CN_CLUSTER **)mymalloc(sizeof(CN_CLUSTER *) * wg_totalnum);
+  wlist = (WordGraph **)mymalloc(sizeof(WordGraph *) * wg_totalnum);
+  i = wg_totalnum;
   for(wg=root;wg;wg=wg->next) {
     c = cn_new();
     cn_add_wg(c, wg);
-    c->next = croot;
-    croot = c;
-    wg_totalnum++;
+    i--;
+    clist[i] = c;
+    wlist[i] = wg;
   }
 
-  /* intraword clustering iteration */
-  do {
-    /* find most similar pair */
-    max_sim = 0.0;
-    for(c=croot;c;c=c->next) {
-      for(cc=c->next;cc;cc=cc->next) {
-	sim = get_cluster_intraword_similarity(c, cc, r->lm->winfo);
-	if (max_sim < sim) {
-	  max_sim = sim;
-	  cmax1 = c;
-	  cmax2 = cc;
-	}
+  /* set up work area */
+  work.winfo = r->lm->winfo;
+  work.key = (int *)mymalloc(sizeof(int) * wg_totalnum);
+  cn_assign_key(&work, wlist, wg_totalnum);
+  work.wids = (WORD_ID *)mymalloc(sizeof(WORD_ID) * wg_totalnum);
+  for(i=0;i<wg_totalnum;i++) work.wids[i] = wlist[i]->wid;
+  qsort(work.wids, wg_totalnum, sizeof(WORD_ID), (int (*)(const void *, const void *))compare_wid);
+  work.wnum = 0;
+  for(i=0;i<wg_totalnum;i++) {
+    if (i == 0 || work.wids[i] != work.wids[work.wnum - 1]) {
+      work.wids[work.wnum++] = work.wids[i];
+    }
+  }
+  work.phone = (int **)mymalloc(sizeof(int *) * work.wnum);
+  for(i=0;i<work.wnum;i++) work.phone[i] = NULL;
+  work.pname = NULL;
+  work.pnum = work.pnum_alloc = 0;
+  work.dist_buf = NULL;
+  work.dist_buf_len = 0;
+  work.memo = NULL;
+  work.memo_num = 0;
+  cn_memo_expand(&work);
+  work.heap = NULL;
+  work.heapnum = work.heapalloc = 0;
+
+  /* intraword clustering */
+  /* list graph word pairs of the same word overlapping in time */
+  pairs = NULL;
+  pairnum = pairalloc = 0;
+  parent = (int *)mymalloc(sizeof(int) * wg_totalnum);
+  tmp = (WordGraph **)mymalloc(sizeof(WordGraph *) * wg_totalnum);
+  memcpy(tmp, wlist, sizeof(WordGraph *) * wg_totalnum);
+  qsort_reentrant(tmp, wg_totalnum, sizeof(WordGraph *), (int (*)(const void *, const void *, void *))compare_wg_key_time, &work);
+  /* index in clist of each graph word */
+  wpos = (int *)mymalloc(sizeof(int) * wg_totalnum);
+  for(i=0;i<wg_totalnum;i++) wpos[wlist[i]->id] = i;
+  for(i=0;i<wg_totalnum;i++) {
+    for(j=i+1;j<wg_totalnum;j++) {
+      if (work.key[tmp[j]->id] != work.key[tmp[i]->id]) break;
+      if (tmp[j]->lefttime > tmp[i]->righttime) break;
+      a = wpos[tmp[i]->id];
+      b = wpos[tmp[j]->id];
+      if (a > b) {
+	k = a; a = b; b = k;
+      }
+      p.sim = get_intraword_similarity(wlist[a], wlist[b]);
+      if (p.sim > 0.0) {
+	p.c1 = a;
+	p.c2 = b;
+	cn_pair_add(&pairs, &pairnum, &pairalloc, &p);
       }
     }
-    /* merge the maximum one if exist */
-    if (max_sim != 0.0) {
+  }
+  free(tmp);
+  free(wpos);
+  if (pairnum > 0) {
+    qsort(pairs, pairnum, sizeof(CN_PAIR), (int (*)(const void *, const void *))compare_pair);
+  }
+
+  /* merge in descending order of similarity */
+  for(i=0;i<wg_totalnum;i++) parent[i] = i;
+  k = 0;
+  while (k < pairnum) {
+    /* pairs of the same similarity are merged from the first one in list */
+    for(ge=k+1;ge<pairnum && pairs[ge].sim == pairs[k].sim;ge++);
+    gn = ge;
+    for(;;) {
+      best = -1;
+      ba = bb = 0;
+      for(i=k;i<gn;i++) {
+	a = cn_find(parent, pairs[i].c1);
+	b = cn_find(parent, pairs[i].c2);
+	if (a == b) {
+	  /* already in the same cluster */
+	  pairs[i] = pairs[--gn];
+	  i--;
+	  continue;
+	}
+	if (a > b) {
+	  j = a; a = b; b = j;
+	}
+	if (best < 0 || a < ba || (a == ba && b < bb)) {
+	  best = i;
+	  ba = a;
+	  bb = b;
+	}
+      }
+      if (best < 0) break;
 #ifdef CDEBUG
-      printf(">>> max_sim = %f\n", max_sim);
-      put_cluster(stdout, cmax1, r->lm->winfo);
-      put_cluster(stdout, cmax2, r->lm->winfo);
+      printf(">>> max_sim = %f\n", pairs[best].sim);
+      put_cluster(stdout, clist[ba], r->lm->winfo);
+      put_cluster(stdout, clist[bb], r->lm->winfo);
 #endif
-      cn_merge(r, cmax1, cmax2);
-      cn_destroy(cmax2, &croot);
+      cn_merge(r, clist[ba], clist[bb]);
+      cn_free(clist[bb]);
+      clist[bb] = NULL;
+      parent[bb] = ba;
     }
-  } while (max_sim != 0.0); /* loop until no more similar pair exists */
+    k = ge;
+  }
+  if (pairs) free(pairs);
+  free(parent);
 
-  n = 0;
-  for(c=croot;c;c=c->next) n++;
+  n = cn_link(clist, wg_totalnum);
+  croot = (n > 0) ? clist[0] : NULL;
   if (verbose_flag) jlog("STAT: confnet: %d words -> %d clusters by intra-word clustering\n", wg_totalnum, n);
 
 #ifdef CDEBUG
@@ -765,58 +1278,60 @@ confnet_create(WordGraph *root, RecogProcess *r)
 #endif
 
   /* inter-word clustering */
-  do {
-    /* build word list for each cluster */
-    for(c=croot;c;c=c->next) cn_build_wordlist(c, r->lm->winfo);
-    /* find most similar pair */
-    max_sim = 0.0;
-    for(c=croot;c;c=c->next) {
-      for(cc=c->next;cc;cc=cc->next) {
-	sim = get_cluster_interword_similarity(r, c, cc, r->lm->winfo, buf1, buf2);
-	if (max_sim < sim) {
-	  max_sim = sim;
-	  cmax1 = c;
-	  cmax2 = cc;
-	}
-      }
+  /* build word list for each cluster */
+  for(i=0;i<n;i++) cn_build_wordlist(clist[i], &work);
+  /* compute similarity of all pairs */
+  stamp = (int *)mymalloc(sizeof(int) * n);
+  for(i=0;i<n;i++) stamp[i] = 0;
+  for(i=0;i<n;i++) {
+    for(j=i+1;j<n;j++) {
+      cn_push_interword_pair(r, &work, clist, stamp, i, j);
     }
-    /* merge the maximum one if exist */
-    if (max_sim != 0.0) {
+  }
+  /* merge the most similar pair until no more similar pair exists */
+  while (work.heapnum > 0) {
+    cn_heap_pop(&work, &p);
+    a = p.c1;
+    b = p.c2;
+    /* skip pairs already merged or updated */
+    if (clist[a] == NULL || clist[b] == NULL) continue;
+    if (p.s1 != stamp[a] || p.s2 != stamp[b]) continue;
+    /* they may have been ordered by other merges */
+    if (cn_cluster_ordered(r, clist[a], clist[b])) continue;
 #ifdef CDEBUG
-      printf(">>> max_sim = %f\n", max_sim);
-      put_cluster(stdout, cmax1, r->lm->winfo);
-      put_cluster(stdout, cmax2, r->lm->winfo);
+    printf(">>> max_sim = %f\n", p.sim);
+    put_cluster(stdout, clist[a], r->lm->winfo);
+    put_cluster(stdout, clist[b], r->lm->winfo);
 #endif
-      cn_merge(r, cmax1, cmax2);
-      cn_destroy(cmax2, &croot);
+    cn_merge(r, clist[a], clist[b]);
+    cn_free(clist[b]);
+    clist[b] = NULL;
+    stamp[a]++;
+    cn_build_wordlist(clist[a], &work);
+    /* re-compute similarities of the merged cluster */
+    for(i=0;i<n;i++) {
+      if (i == a || clist[i] == NULL) continue;
+      if (i < a) {
+	cn_push_interword_pair(r, &work, clist, stamp, i, a);
+      } else {
+	cn_push_interword_pair(r, &work, clist, stamp, a, i);
+      }
     }
-  } while (max_sim != 0.0); /* loop until no more similar pair exists */
+  }
+  free(stamp);
 
-  n = 0;
-  for(c=croot;c;c=c->next) n++;
+  n = cn_link(clist, n);
+  croot = (n > 0) ? clist[0] : NULL;
   if (verbose_flag) jlog("STAT: confnet: -> %d clusters by inter-word clustering\n", n);
 
-  /* compute posterior probabilities and insert NULL entry */
+  /* insert NULL entry */
   {
-    PROB p, psum;
-    int j;
+    PROB psum;
 
     for(c=croot;c;c=c->next) {
       psum = 0.0;
-      c->pp = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (c->wordsnum + 1));
       for(i=0;i<c->wordsnum;i++) {
-	p = 0.0;
-	for(j = 0; j < c->wgnum; j++) {
-	  if (is_same_word(c->wg[j]->wid, c->words[i], r->lm->winfo)) {
-#ifdef PREFER_GRAPH_CM
-	    p += c->wg[j]->graph_cm;
-#else
-	    p += c->wg[j]->cmscore;
-#endif
-	  }
-	}
-	c->pp[i] = p;
-	psum += p;
+	psum += c->pp[i];
       }
       if (psum < 1.0) {
 	c->words[c->wordsnum] = WORD_INVALID;
@@ -849,14 +1364,9 @@ confnet_create(WordGraph *root, RecogProcess *r)
 
   /* re-order clusters by their beginning frames */
   {
-    CN_CLUSTER **clist;
     int k;
 
     /* sort cluster list by the left frame*/
-    clist = (CN_CLUSTER **)mymalloc(sizeof(CN_CLUSTER *) * n);
-    for(i=0,c=croot;c;c=c->next) {
-      clist[i++] = c;
-    }
     qsort_reentrant(clist, n, sizeof(CN_CLUSTER *), (int (*)(const void *, const void *, void *))compare_cluster, r);
     croot = NULL;
     for(k=0;k<n;k++) {
@@ -864,7 +1374,6 @@ confnet_create(WordGraph *root, RecogProcess *r)
       if (k == n - 1) clist[k]->next = NULL;
       else clist[k]->next = clist[k+1];
     }
-    free(clist);
   }
 
 #if 0
@@ -880,8 +1389,18 @@ confnet_create(WordGraph *root, RecogProcess *r)
   printf("---- end confusion network ---\n");
 #endif
 
-  free(buf2);
-  free(buf1);
+  /* free work area */
+  if (work.heap) free(work.heap);
+  free(work.memo);
+  if (work.dist_buf) free(work.dist_buf);
+  for(i=0;i<work.pnum;i++) free(work.pname[i]);
+  if (work.pname) free(work.pname);
+  for(i=0;i<work.wnum;i++) if (work.phone[i]) free(work.phone[i]);
+  free(work.phone);
+  free(work.wids);
+  free(work.key);
+  free(wlist);
+  free(clist);
 
   return(croot);
 }
@@ -65,6 +65,7 @@ jconf_set_default_values(Jconf *j)
   j->input.framesize			= DEF_FRAMESIZE;
   j->input.frameshift			= DEF_FRAMESHIFT;
   j->input.use_ds48to16			= FALSE;
+  j->input.input_freq			= 0;
   j->input.inputlist_filename		= NULL;
   j->input.adinnet_port			= ADINNET_PORT;
 #ifdef USE_NETAUDIO
@@ -82,6 +83,7 @@ jconf_set_default_values(Jconf *j)
   j->detect.gmm_margin			= DEFAULT_GMM_MARGIN;
   j->detect.gmm_uptrigger_thres		= 0.7;
   j->detect.gmm_downtrigger_thres	= -0.2;
+  j->detect.gmm_vad_prune		= FALSE;
 #endif
 #ifdef HAVE_LIBFVAD
   j->detect.fvad_mode                   = -1;
@@ -155,11 +157,13 @@ jconf_set_default_values_am(JCONF_AM *j)
   j->analysis.cmnsave_filename		= NULL;
   j->analysis.cmn_map_weight		= 100.0;
   j->analysis.cmn_static_cvn_only	= FALSE;
+  j->analysis.cmn_window		= 0;
   j->frontend.ss_alpha			= DEF_SSALPHA;
   j->frontend.ss_floor			= DEF_SSFLOOR;
   j->frontend.sscalc			= FALSE;
   j->frontend.sscalc_len		= 300;
   j->frontend.ssload_filename		= NULL;
+  j->frontend.thread_num		= 1;
   j->dnn.enabled                        = FALSE;
   j->dnn.paramtype			= F_ERR_INVALID;
   j->dnn.optionstring			= NULL;
@@ -220,6 +224,8 @@ jconf_set_default_values_lm(JCONF_LM *j)
 #ifdef SEPARATE_BY_UNIGRAM
   j->separate_wnum			= 150;
 #endif
+  j->wchmm_cache_file			= NULL;
+  j->wchmm_threads			= 1;
   strcpy(j->wordrecog_head_silence_model_name, "silB");
   strcpy(j->wordrecog_tail_silence_model_name, "silE");
   j->wordrecog_silence_context_name[0] = '\0';
@@ -307,6 +313,10 @@ jconf_set_default_values_search(JCONF_SEARCH *j)
 #ifdef   GRAPHOUT_SEARCH_DELAY_TERMINATION
   j->graph.graphout_search_delay	= FALSE;
 #endif
+  j->graph.pass1lattice			= FALSE;
+  j->graph.pass1lattice_beam		= 100.0;
+  j->graph.pass1lattice_maxnum		= 30;
+  j->graph.pass1lattice_interval	= 300;
   j->successive.enabled			= FALSE;
   j->successive.sp_frame_duration	= 10;
   j->successive.pausemodelname		= NULL;
@@ -332,6 +342,7 @@ jconf_set_default_values_search(JCONF_SEARCH *j)
   j->annotate.align_result_word_flag	= FALSE;
   j->annotate.align_result_phoneme_flag	= FALSE;
   j->annotate.align_result_state_flag	= FALSE;
+  j->annotate.align_beam		= 0.0;
 
   j->output.output_hypo_maxnum		= 1;
   j->output.progout_flag		= FALSE;
@@ -164,6 +164,11 @@
  */
 
 #include <julius/julius.h>
+#ifndef UNIGRAM_FACTORING
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#endif
 
 /*----------------------------------------------------------------------*/
 
@@ -192,6 +197,7 @@ make_successor_list(WCHMM_INFO *wchmm)
   int s;
   WORD_ID *scnumlist;
   WORD_ID *sclen;
+  WORD_ID *scbuf;
   int scnum, new_scnum;
   int *scidmap;
   boolean *freemark;
@@ -286,10 +292,15 @@ make_successor_list(WCHMM_INFO *wchmm)
   free(sclen);
 
   /* 5. now index completed, make word list for each list */
+  /* all lists are placed sequentially on a single area */
   wchmm->sclist = (WORD_ID **)mybmalloc2(sizeof(WORD_ID *) * wchmm->scnum, &(wchmm->malloc_root));
   scnumlist = (WORD_ID *)mymalloc(sizeof(WORD_ID) * wchmm->scnum);
+  s = 0;
+  for(i=1;i<wchmm->scnum;i++) s += wchmm->sclen[i];
+  scbuf = (WORD_ID *)mybmalloc2(sizeof(WORD_ID) * s, &(wchmm->malloc_root));
   for(i=1;i<wchmm->scnum;i++) {
-    wchmm->sclist[i] = (WORD_ID *)mybmalloc2(sizeof(WORD_ID) * wchmm->sclen[i], &(wchmm->malloc_root));
+    wchmm->sclist[i] = scbuf;
+    scbuf += wchmm->sclen[i];
     scnumlist[i] = 0;
   }
   {
@@ -564,6 +575,301 @@ adjust_sc_index(WCHMM_INFO *wchmm)
 /* -------------------------------------------------------------------- */
 /* factoring computation */
 
+#ifndef UNIGRAM_FACTORING
+
+/** 
+ * <JA>
+ * 2-gram factoring 用に successor list を N-gram の単語IDで一つの配列に
+ * 詰めて並べ直し，頻出する直前単語に対する密な 2-gram 行の領域を準備する. 
+ * リストは木構造化辞書上の深さ順に並べられる. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * </JA>
+ * <EN>
+ * Pack the successor lists into a single array of N-gram word IDs for
+ * 2-gram factoring, and prepare dense 2-gram rows for frequent contexts.
+ * The lists are placed in the order of node depth on the tree lexicon.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * </EN>
+ */
+static void
+successor_row_init(WCHMM_INFO *wchmm)
+{
+  LM_PROB_CACHE *l;
+  int *depth, *dnum;
+  int scid, node, maxdepth, d, i, j, k;
+  WORD_ID w;
+
+  l = &(wchmm->lmcache);
+
+  /* depth of each successor list on the tree */
+  depth = (int *)mymalloc(sizeof(int) * wchmm->scnum);
+  for (scid = 0; scid < wchmm->scnum; scid++) depth[scid] = -1;
+  maxdepth = 0;
+  for (w = 0; w < wchmm->winfo->num; w++) {
+    for (i = 0; i <= wchmm->winfo->wlen[w]; i++) {
+      node = (i < wchmm->winfo->wlen[w]) ? wchmm->offset[w][i] : wchmm->wordend[w];
+      scid = wchmm->state[node].scid;
+      if (scid <= 0) continue;
+      if (depth[scid] == -1 || depth[scid] > i) depth[scid] = i;
+      if (maxdepth < i) maxdepth = i;
+    }
+  }
+  /* lists not found above (should not happen) are placed last */
+  maxdepth++;
+  for (scid = 1; scid < wchmm->scnum; scid++) {
+    if (depth[scid] == -1) depth[scid] = maxdepth;
+  }
+
+  /* assign offsets in the order of depth */
+  dnum = (int *)mymalloc(sizeof(int) * (maxdepth + 1));
+  for (d = 0; d <= maxdepth; d++) dnum[d] = 0;
+  for (scid = 1; scid < wchmm->scnum; scid++) dnum[depth[scid]] += wchmm->sclen[scid];
+  k = 0;
+  for (d = 0; d <= maxdepth; d++) {
+    j = dnum[d];
+    dnum[d] = k;
+    k += j;
+  }
+  l->sctotal = k;
+  l->scofs = (int *)mymalloc(sizeof(int) * wchmm->scnum);
+  l->scofs[0] = 0;
+  l->scnword = (WORD_ID *)mymalloc(sizeof(WORD_ID) * (l->sctotal + 1));
+#ifdef CLASS_NGRAM
+  l->sccprob = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (l->sctotal + 1));
+#endif
+  for (scid = 1; scid < wchmm->scnum; scid++) {
+    k = dnum[depth[scid]];
+    l->scofs[scid] = k;
+    for (i = 0; i < wchmm->sclen[scid]; i++) {
+      w = wchmm->sclist[scid][i];
+      l->scnword[k + i] = wchmm->ngram ? wchmm->winfo->wton[w] : w;
+#ifdef CLASS_NGRAM
+      l->sccprob[k + i] = wchmm->winfo->cprob[w];
+#endif
+    }
+    dnum[depth[scid]] += wchmm->sclen[scid];
+  }
+  free(dnum);
+  free(depth);
+
+  /* dense rows, not used for user-defined LM */
+  l->row = NULL;
+  if (wchmm->ngram == NULL || wchmm->lmvar == LM_NGRAM_USER) return;
+  l->row = (LOGPROB **)mymalloc(sizeof(LOGPROB *) * FACTOR2_ROW_NUM);
+  l->rowword = (WORD_ID *)mymalloc(sizeof(WORD_ID) * FACTOR2_ROW_NUM);
+  l->rowtime = (unsigned int *)mymalloc(sizeof(unsigned int) * FACTOR2_ROW_NUM);
+  for (i = 0; i < FACTOR2_ROW_NUM; i++) {
+    l->row[i] = NULL;		/* allocated when used */
+    l->rowword[i] = WORD_INVALID;
+    l->rowtime[i] = 0;
+  }
+  l->rowclock = 0;
+  l->ctxrow = (int *)mymalloc(sizeof(int) * wchmm->ngram->max_word_num);
+  l->ctxcost = (int *)mymalloc(sizeof(int) * wchmm->ngram->max_word_num);
+  for (i = 0; i < wchmm->ngram->max_word_num; i++) {
+    l->ctxrow[i] = -1;
+    l->ctxcost[i] = 0;
+  }
+  /* a row costs a pass over the vocabulary and the lists, which is
+     about a quarter of the cost to look up as many 2-grams */
+  l->rowthres = (wchmm->ngram->max_word_num + l->sctotal) / 4;
+  l->vocrow = (LOGPROB *)mymalloc(sizeof(LOGPROB) * wchmm->ngram->max_word_num);
+}
+
+/** 
+ * <JA>
+ * successor_row_init() で確保した領域を解放する. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * </JA>
+ * <EN>
+ * Free the work area allocated by successor_row_init().
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * </EN>
+ */
+static void
+successor_row_free(WCHMM_INFO *wchmm)
+{
+  LM_PROB_CACHE *l;
+  int i;
+
+  l = &(wchmm->lmcache);
+  free(l->scofs);
+  free(l->scnword);
+#ifdef CLASS_NGRAM
+  free(l->sccprob);
+#endif
+  if (l->row == NULL) return;
+  for (i = 0; i < FACTOR2_ROW_NUM; i++) {
+    if (l->row[i] != NULL) free(l->row[i]);
+  }
+  free(l->row);
+  free(l->rowword);
+  free(l->rowtime);
+  free(l->ctxrow);
+  free(l->ctxcost);
+  free(l->vocrow);
+  l->row = NULL;
+}
+
+/** 
+ * <JA>
+ * 直前単語に対する密な 2-gram 行を返す. 行が無い場合，その直前単語の
+ * 参照回数が閾値を超えたときに最も長く使われていない行を置き換えて作成する. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param last_nword [in] 直前単語の N-gram 単語ID
+ * @param cost [in] 行が無い場合に必要な 2-gram 参照回数
+ * 
+ * @return 行，まだ作らない場合は NULL
+ * </JA>
+ * <EN>
+ * Return the dense 2-gram row for a context word.  If the context has
+ * no row, a new one is made in place of the least recently used row when
+ * the number of lookups for the context exceeds the threshold.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param last_nword [in] N-gram word ID of the context word
+ * @param cost [in] number of 2-gram lookups needed without row
+ * 
+ * @return the row, or NULL if not made yet.
+ * </EN>
+ */
+static LOGPROB *
+successor_row(WCHMM_INFO *wchmm, WORD_ID last_nword, int cost)
+{
+  LM_PROB_CACHE *l;
+  LOGPROB *row;
+  int r, i;
+
+  l = &(wchmm->lmcache);
+
+  r = l->ctxrow[last_nword];
+  if (r >= 0) {
+    l->rowtime[r] = ++(l->rowclock);
+    return(l->row[r]);
+  }
+  l->ctxcost[last_nword] += cost;
+  if (l->ctxcost[last_nword] < l->rowthres) return NULL;
+
+  /* replace the least recently used row */
+  r = 0;
+  for (i = 1; i < FACTOR2_ROW_NUM; i++) {
+    if (l->rowtime[r] > l->rowtime[i]) r = i;
+  }
+  if (l->rowword[r] != WORD_INVALID) {
+    l->ctxrow[l->rowword[r]] = -1;
+    l->ctxcost[l->rowword[r]] = 0;
+  }
+  if (l->row[r] == NULL) {
+    l->row[r] = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (l->sctotal + 1));
+  }
+  row = l->row[r];
+  bi_prob_row(wchmm->ngram, last_nword, l->vocrow);
+  for (i = 0; i < l->sctotal; i++) {
+    row[i] = l->vocrow[l->scnword[i]]
+#ifdef CLASS_NGRAM
+      + l->sccprob[i]
+#endif
+      ;
+  }
+  l->rowword[r] = last_nword;
+  l->rowtime[r] = ++(l->rowclock);
+  l->ctxrow[last_nword] = r;
+  l->ctxcost[last_nword] = 0;
+
+  return(row);
+}
+
+/** 
+ * <JA>
+ * 配列の最大値を返す. 
+ * 
+ * @param a [in] 配列
+ * @param len [in] 長さ
+ * 
+ * @return 最大値，ただし LOG_ZERO 以上
+ * </JA>
+ * <EN>
+ * Return the maximum value in an array.
+ * 
+ * @param a [in] array
+ * @param len [in] length
+ * 
+ * @return the maximum value, not less than LOG_ZERO.
+ * </EN>
+ */
+static LOGPROB
+row_max(LOGPROB *a, int len)
+{
+  LOGPROB m;
+  int i;
+#ifdef __SSE__
+  __m128 m0, m1;
+  float x[4];
+#endif
+
+  m = LOG_ZERO;
+  i = 0;
+#ifdef __SSE__
+  if (len >= 8) {
+    m0 = m1 = _mm_set1_ps(LOG_ZERO);
+    for (; i + 8 <= len; i += 8) {
+      m0 = _mm_max_ps(m0, _mm_loadu_ps(&(a[i])));
+      m1 = _mm_max_ps(m1, _mm_loadu_ps(&(a[i + 4])));
+    }
+    m0 = _mm_max_ps(m0, m1);
+    _mm_storeu_ps(x, m0);
+    m = x[0];
+    if (m < x[1]) m = x[1];
+    if (m < x[2]) m = x[2];
+    if (m < x[3]) m = x[3];
+  }
+#endif
+  for (; i < len; i++) {
+    if (m < a[i]) m = a[i];
+  }
+  return(m);
+}
+
+#endif /* ~UNIGRAM_FACTORING */
+
+/** 
+ * <JA>
+ * 単語内 factoring キャッシュに値を格納する. 最も古い値が捨てられる. 
+ * 
+ * @param l [i/o] キャッシュ
+ * @param scid [in] successor list ID
+ * @param last_nword [in] 直前単語の N-gram 単語ID
+ * @param prob [in] 格納する値
+ * </JA>
+ * <EN>
+ * Store a value to the word-internal factoring cache, dropping the
+ * oldest one.
+ * 
+ * @param l [i/o] cache
+ * @param scid [in] successor list ID
+ * @param last_nword [in] N-gram word ID of the context word
+ * @param prob [in] value to store
+ * </EN>
+ */
+static void
+successor_cache_store(LM_PROB_CACHE *l, int scid, WORD_ID last_nword, LOGPROB prob)
+{
+  int c, k;
+
+  c = scid * FACTOR_CACHE_WAYS;
+  for (k = FACTOR_CACHE_WAYS - 1; k > 0; k--) {
+    l->lastwcache[c + k] = l->lastwcache[c + k - 1];
+    l->probcache[c + k] = l->probcache[c + k - 1];
+  }
+  l->lastwcache[c] = last_nword;
+  l->probcache[c] = prob;
+}
+
 /** 
  * <JA>
  * 木構造化辞書用の factoring キャッシュをメモリ割り付けして初期化する. 
@@ -592,11 +898,14 @@ max_successor_cache_init(WCHMM_INFO *wchmm)
   /* for word-internal */
   l = &(wchmm->lmcache);
 
-  l->probcache = (LOGPROB *) mymalloc(sizeof(LOGPROB) * wchmm->scnum);
-  l->lastwcache = (WORD_ID *) mymalloc(sizeof(WORD_ID) * wchmm->scnum);
-  for (i=0;i<wchmm->scnum;i++) {
+  l->probcache = (LOGPROB *) mymalloc(sizeof(LOGPROB) * wchmm->scnum * FACTOR_CACHE_WAYS);
+  l->lastwcache = (WORD_ID *) mymalloc(sizeof(WORD_ID) * wchmm->scnum * FACTOR_CACHE_WAYS);
+  for (i=0;i<wchmm->scnum * FACTOR_CACHE_WAYS;i++) {
     l->lastwcache[i] = WORD_INVALID;
   }
+#ifndef UNIGRAM_FACTORING
+  successor_row_init(wchmm);
+#endif
   /* for cross-word */
   if (wchmm->ngram) {
     wnum = wchmm->ngram->max_word_num;
@@ -666,6 +975,9 @@ max_successor_cache_free(WCHMM_INFO *wchmm)
 {
   free(wchmm->lmcache.probcache);
   free(wchmm->lmcache.lastwcache);
+#ifndef UNIGRAM_FACTORING
+  successor_row_free(wchmm);
+#endif
   max_successor_prob_iw_free(wchmm);
   free(wchmm->lmcache.iw_sc_cache);
 #ifdef HASH_CACHE_IW
@@ -864,8 +1176,10 @@ calc_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
 {
   LOGPROB tmpprob, maxprob;
   WORD_ID lw, w;
-  int i;
+  int i, len;
   int scid;
+  LM_PROB_CACHE *l;
+  LOGPROB *row;
 
   maxprob = LOG_ZERO;
   if (wchmm->ngram) {
@@ -874,6 +1188,26 @@ calc_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
 
   scid = wchmm->state[node].scid;
 
+  l = &(wchmm->lmcache);
+  if (wchmm->ngram && l->row != NULL) {
+    /* take maximum on the dense row if the context is frequent */
+    len = wchmm->sclen[scid];
+    row = successor_row(wchmm, lw, len);
+    if (row != NULL) {
+      return(row_max(&(row[l->scofs[scid]]), len));
+    }
+    /* else look up on the compact list */
+    for (i = l->scofs[scid]; i < l->scofs[scid] + len; i++) {
+      tmpprob = (*(wchmm->ngram->bigram_prob))(wchmm->ngram, lw, l->scnword[i])
+#ifdef CLASS_NGRAM
+	+ l->sccprob[i]
+#endif
+	;
+      if (maxprob < tmpprob) maxprob = tmpprob;
+    }
+    return(maxprob);
+  }
+
   for (i = 0; i < wchmm->sclen[scid]; i++) {
     w = wchmm->sclist[scid][i];
     if (wchmm->ngram) {
@@ -905,8 +1239,8 @@ calc_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
  * 計算される. 
  *
  * 単語内 factoring キャッシュが考慮される. すなわち各ノードについて
- * 直前単語が前回アクセスされたときと同じであれば，
- * 前回の値が返され，そうでなければ値を計算し，キャッシュが更新される. 
+ * 直前単語が最近の FACTOR_CACHE_WAYS 回のアクセスのいずれかと同じであれば，
+ * その値が返され，そうでなければ値を計算し，最も古い値を置き換える. 
  * 
  * @param wchmm [in] 木構造化辞書
  * @param lastword [in] 直前単語のID
@@ -923,9 +1257,9 @@ calc_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
  * of corresponding successor words are computed.
  *
  * The word-internal factoring cache is consulted within this function.
- * If the given last word is the same as the last call on that node,
- * the last computed value will be returned, else the maximum value
- * will be computed update the cache with the last word and value.
+ * If the given last word is one of the last FACTOR_CACHE_WAYS words on
+ * that node, the cached value will be returned, else the maximum value
+ * will be computed and replace the oldest one in the cache.
  * 
  * @param wchmm [in] tree lexicon
  * @param lastword [in] word ID of last context word
@@ -944,6 +1278,7 @@ max_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
   LOGPROB maxprob;
   WORD_ID last_nword, w;
   int scid;
+  int c, k;
   LM_PROB_CACHE *l;
 
   l = &(wchmm->lmcache);
@@ -962,40 +1297,42 @@ max_successor_prob(WCHMM_INFO *wchmm, WORD_ID lastword, int node)
     } else {
       /* this node has only one successor */
       /* return precise 2-gram score */
-      if (last_nword != l->lastwcache[scid]) {
-	/* calc and cache */
-	w = wchmm->scword[scid];
-	if (wchmm->ngram) {
-	  maxprob = (*(wchmm->ngram->bigram_prob))(wchmm->ngram, last_nword, wchmm->winfo->wton[w])
+      c = scid * FACTOR_CACHE_WAYS;
+      for (k = 0; k < FACTOR_CACHE_WAYS; k++) {
+	if (l->lastwcache[c + k] == last_nword) {
+	  /* return cached */
+	  return(l->probcache[c + k]);
+	}
+      }
+      /* calc and cache */
+      w = wchmm->scword[scid];
+      if (wchmm->ngram) {
+	maxprob = (*(wchmm->ngram->bigram_prob))(wchmm->ngram, last_nword, wchmm->winfo->wton[w])
 #ifdef CLASS_NGRAM
-	    + wchmm->winfo->cprob[w]
+	  + wchmm->winfo->cprob[w]
 #endif
-	    ;
-	} else {
-	  maxprob = LOG_ZERO;
-	}
-	if (wchmm->lmvar == LM_NGRAM_USER) {
-	  maxprob = (*(wchmm->bi_prob_user))(wchmm->winfo, lastword, w, maxprob);
-	}
-	l->lastwcache[scid] = last_nword;
-	l->probcache[scid] = maxprob;
-	return(maxprob);
+	  ;
       } else {
-	/* return cached */
-	return (l->probcache[scid]);
+	maxprob = LOG_ZERO;
+      }
+      if (wchmm->lmvar == LM_NGRAM_USER) {
+	maxprob = (*(wchmm->bi_prob_user))(wchmm->winfo, lastword, w, maxprob);
       }
+      successor_cache_store(l, scid, last_nword, maxprob);
+      return(maxprob);
     }
 #else  /* UNIGRAM_FACTORING */
     /* 2-gram */
-    if (last_nword != l->lastwcache[scid]) {
-      maxprob = calc_successor_prob(wchmm, lastword, node);
-      /* store to cache */
-      l->lastwcache[scid] = last_nword;
-      l->probcache[scid] = maxprob;
-      return(maxprob);
-    } else {
-      return (l->probcache[scid]);
+    c = scid * FACTOR_CACHE_WAYS;
+    for (k = 0; k < FACTOR_CACHE_WAYS; k++) {
+      if (l->lastwcache[c + k] == last_nword) {
+	return(l->probcache[c + k]);
+      }
     }
+    maxprob = calc_successor_prob(wchmm, lastword, node);
+    /* store to cache */
+    successor_cache_store(l, scid, last_nword, maxprob);
+    return(maxprob);
 #endif /* UNIGRAM_FACTORING */
   } else {
     return(0.0);
@@ -1130,9 +1467,30 @@ max_successor_prob_iw(WCHMM_INFO *wchmm, WORD_ID lastword)
     }
   }
 #else  /* ~UNIGRAM_FACTORING */
-  for (i=0;i<wchmm->startnum;i++) {
-    node = wchmm->startnode[i];
-    l->iw_sc_cache[x][i] = calc_successor_prob(wchmm, lastword, node);
+  if (l->row != NULL && l->ctxrow[last_nword] < 0) {
+    /* successors of all word heads cover the whole vocabulary, so
+       compute 2-gram of all words at once and take maximum on it */
+    int scid;
+    LOGPROB tmpprob;
+    bi_prob_row(wchmm->ngram, last_nword, l->vocrow);
+    for (i=0;i<wchmm->startnum;i++) {
+      scid = wchmm->state[wchmm->startnode[i]].scid;
+      p = LOG_ZERO;
+      for (j = l->scofs[scid]; j < l->scofs[scid] + wchmm->sclen[scid]; j++) {
+	tmpprob = l->vocrow[l->scnword[j]]
+#ifdef CLASS_NGRAM
+	  + l->sccprob[j]
+#endif
+	  ;
+	if (p < tmpprob) p = tmpprob;
+      }
+      l->iw_sc_cache[x][i] = p;
+    }
+  } else {
+    for (i=0;i<wchmm->startnum;i++) {
+      node = wchmm->startnode[i];
+      l->iw_sc_cache[x][i] = calc_successor_prob(wchmm, lastword, node);
+    }
   }
 #endif
 #ifdef HASH_CACHE_IW
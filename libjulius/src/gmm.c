@@ -229,11 +229,23 @@ gmm_compute_g_safe(GMMCalc *gc, HTK_HMM_Dens *binfo, LOGPROB thres)
   mean = binfo->mean;
   var = binfo->var->vec;
   tmp = binfo->gconst;
-  for (; veclen > 0; veclen--) {
+  /* the sum only increases, so the threshold is tested per 4 dimensions */
+  for (; veclen >= 4; veclen -= 4) {
+    x = *(vec++) - *(mean++);
+    tmp += x * x * *(var++);
+    x = *(vec++) - *(mean++);
+    tmp += x * x * *(var++);
+    x = *(vec++) - *(mean++);
+    tmp += x * x * *(var++);
     x = *(vec++) - *(mean++);
     tmp += x * x * *(var++);
     if (tmp > fthres)  return LOG_ZERO;
   }
+  for (; veclen > 0; veclen--) {
+    x = *(vec++) - *(mean++);
+    tmp += x * x * *(var++);
+  }
+  if (tmp > fthres)  return LOG_ZERO;
   return(tmp * -0.5);
 }
 
@@ -405,6 +417,56 @@ outprob_state_nocache(GMMCalc *gc, int t, HTK_HMM_State *stateinfo, HTK_Param *p
   return(gmm_calc_mix(gc, stateinfo));
 }
 
+#ifdef GMM_VAD
+/** 
+ * <JA>
+ * 単一ストリームのGMM状態のスコアが与えられた値を越えないかどうかを調べる. 
+ * 重み付きの全ガウス分布が safe pruning で枝刈りされればスコアは上限値以下である. 
+ * 
+ * @param gc [i/o] GMM計算用ワークエリア
+ * @param t [in] 計算するフレーム
+ * @param stateinfo [in] GMM状態
+ * @param m [in] GMM の番号
+ * @param param [in] 入力ベクトル系列
+ * @param bound [in] 上限値
+ * 
+ * @return スコアが @a bound を越えないことが確定したら TRUE, それ以外は FALSE
+ * </JA>
+ * <EN>
+ * Check whether the score of a single-stream GMM state cannot exceed
+ * the given value.  When all the weighted Gaussians are pruned by safe
+ * pruning with the threshold derived from the value, the score is below it.
+ * 
+ * @param gc [i/o] work area for GMM calculation
+ * @param t [in] time frame on which the output probability should be computed
+ * @param stateinfo [in] GMM state
+ * @param m [in] index of the GMM
+ * @param param [in] input vector sequence
+ * @param bound [in] the value
+ * 
+ * @return TRUE if the score is assured not to exceed @a bound, or FALSE
+ * if the GMM should be computed.
+ * </EN>
+ */
+static boolean
+gmm_vad_outscored(GMMCalc *gc, int t, HTK_HMM_State *stateinfo, int m, HTK_Param *param, LOGPROB bound)
+{
+  HTK_HMM_PDF *pdf;
+  int i;
+  LOGPROB thres;
+
+  gc->OP_vec = param->parvec[t];
+  gc->OP_veclen = gc->OP_veclen_stream[0];
+  pdf = stateinfo->pdf[0];
+  /* log10 score bound to the threshold of weighted Gaussian scores */
+  thres = bound * LOG_TEN - gc->prune_offset[m];
+  for (i = 0; i < pdf->mix_num; i++) {
+    if (gmm_compute_g_safe(gc, pdf->b[i], thres - pdf->bweight[i]) > LOG_ZERO) return FALSE;
+  }
+  return TRUE;
+}
+#endif
+
 /************************************************************************/
 /* global functions */
 
@@ -492,6 +554,22 @@ gmm_init(Recog *recog)
   }
   gmm_gprune_safe_init(gc, gmm, recog->jconf->reject.gmm_gprune_num);
 
+#ifdef GMM_VAD
+  /* upper bound of GMM score minus maximum weighted Gaussian score,
+     for -gmmvadprune */
+  gc->prune_offset = NULL;
+  if (recog->jconf->detect.gmm_vad_prune && gc->OP_nstream == 1) {
+    gc->prune_offset = (LOGPROB *)mymalloc(sizeof(LOGPROB) * gmm->totalhmmnum);
+    i = 0;
+    for(d=gmm->start;d;d=d->next) {
+      int k = d->s[1]->pdf[0]->mix_num;
+      if (k > gc->OP_gprune_num) k = gc->OP_gprune_num;
+      gc->prune_offset[i] = log((double)k) + GMM_VAD_PRUNE_MARGIN;
+      i++;
+    }
+  }
+#endif
+
   /* check if variances are inversed */
   if (!gmm->variance_inversed) {
     /* here, inverse all variance values for faster computation */
@@ -532,6 +610,7 @@ gmm_prepare(Recog *recog)
   }
 #ifdef GMM_VAD
   for(i=0;i<recog->gc->nframe;i++) recog->gc->rates[i] = 0.0;
+  recog->gc->best_v = recog->gc->best_n = -1;
   recog->gc->framep = 0;
   recog->gc->filled = FALSE;
   recog->gc->in_voice = FALSE;
@@ -581,6 +660,9 @@ gmm_proceed(Recog *recog)
 #ifdef GMM_VAD
   LOGPROB max_n;
   LOGPROB max_v;
+  int best_v, best_n;
+  boolean prune;
+  int pass;
 #endif
 
   mfcc = recog->gmmmfcc;
@@ -592,17 +674,46 @@ gmm_proceed(Recog *recog)
 
 #ifdef GMM_VAD
   max_n = max_v = LOG_ZERO;
+  best_v = best_n = -1;
+  /* before speech trigger only the maximum scores are needed for VAD,
+     so GMMs that cannot exceed them are skipped.  The best GMMs of the
+     last frame are computed at first pass to get the bounds. */
+  prune = (gc->prune_offset != NULL && !gc->after_trigger);
+  for(pass=0;pass<2;pass++) {
+    if (pass == 1 && !prune) break;
 #endif
 
   i = 0;
   for(d=recog->gmm->start;d;d=d->next) {
+#ifdef GMM_VAD
+    if (prune) {
+      if ((pass == 0) != (i == gc->best_v || i == gc->best_n)) {
+	i++;
+	continue;
+      }
+      if (gc->is_voice[i]) score = max_v;
+      else score = max_n;
+      if (score > LOG_ZERO && gmm_vad_outscored(gc, mfcc->f, d->s[1], i, mfcc->param, score)) {
+	/* the bound is accumulated instead */
+	gc->gmm_score[i] += score;
+	i++;
+	continue;
+      }
+    }
+#endif
     score = outprob_state_nocache(gc, mfcc->f, d->s[1], mfcc->param);
     gc->gmm_score[i] += score;
 #ifdef GMM_VAD
     if (gc->is_voice[i]) {
-      if (max_v < score) max_v = score;
+      if (max_v < score) {
+	max_v = score;
+	best_v = i;
+      }
     } else {
-      if (max_n < score) max_n = score;
+      if (max_n < score) {
+	max_n = score;
+	best_n = i;
+      }
     }
 #endif
 #ifdef MES
@@ -610,6 +721,11 @@ gmm_proceed(Recog *recog)
 #endif
     i++;
   }
+#ifdef GMM_VAD
+  }
+  gc->best_v = best_v;
+  gc->best_n = best_n;
+#endif
 #ifdef GMM_VAD
 #ifdef GMM_VAD_DEBUG
   //printf("GMM_VAD: max_v = %f, max_n = %f, rate = %f\n", max_v, max_n, max_v - max_n, gc->framep);
@@ -763,6 +879,7 @@ gmm_free(Recog *recog)
     free(recog->gc->is_voice);
 #ifdef GMM_VAD
     free(recog->gc->rates);
+    if (recog->gc->prune_offset) free(recog->gc->prune_offset);
 #endif
     free(recog->gc->gmm_score);
     free(recog->gc);
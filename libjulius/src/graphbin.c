@@ -0,0 +1,648 @@
+/**
+ * @file   graphbin.c
+ *
+ * <JA>
+ * @brief  単語グラフのバイナリ形式での書き出しと読み込み
+ *
+ * 単語グラフを，テキストへの整形を行わずにバイナリ形式で書き出し，
+ * また読み込みます．1つの単語グラフは長さ付きの1レコードとして
+ * 書き出されるため，複数の単語グラフを1つのファイルやパイプに
+ * 続けて書き出すことができます．読み込んだ単語グラフは
+ * put_wordgraph() や wordgraph_dump() でそのままテキスト出力できます．
+ *
+ * レコードの形式は以下の通りです．数値は全てビッグエンディアンの
+ * 32bit 整数または 32bit 浮動小数点数です．
+ *
+ * - ヘッダ: "JGRF"，形式のバージョン，本体のバイト長
+ * - 本体:
+ *   - パス (1 or 2)，認識処理インスタンスのID，フレーム長，
+ *     単語グラフの単語数，単語表の長さ，音素表の長さ，接続数，
+ *     文字列表のバイト長
+ *   - 単語表: 単語ID，出力文字列と単語名の文字列表上の位置
+ *   - 音素表: 音素名の文字列表上の位置
+ *   - 単語グラフの単語表 (ID順): 単語表上の番号，開始・終了フレーム，
+ *     先頭・末尾音素の音素表上の番号，左・右コンテキスト数，
+ *     各スコア (lscore_tmp, fscore_head, fscore_tail, gscore_head,
+ *     gscore_tail, forward_score, backward_score, amavg, cmscore, graph_cm)
+ *   - 接続表: 単語グラフの単語ごとに左コンテキスト，右コンテキストの順で，
+ *     接続先の単語のIDと言語スコア
+ *   - 文字列表: NULL 終端された文字列の並び
+ * </JA>
+ *
+ * <EN>
+ * @brief  Write and read word graphs in binary format
+ *
+ * Word graphs can be written and read in a binary format, without
+ * text formatting.  Each word graph is written as a length-prefixed
+ * record, so successive word graphs can be streamed to one file or
+ * pipe.  A word graph read back can be output as text by
+ * put_wordgraph() or wordgraph_dump() as is.
+ *
+ * A record is formatted as below.  All numbers are 32-bit integers or
+ * 32-bit floats in big endian.
+ *
+ * - Header: "JGRF", format version, length of the body in bytes
+ * - Body:
+ *   - pass (1 or 2), recognition process ID, input length in frames,
+ *     number of graph words, length of word table, length of phone
+ *     table, number of links, length of string table in bytes
+ *   - Word table: word ID, offsets of output string and word name in
+ *     the string table
+ *   - Phone table: offset of phone name in the string table
+ *   - Graph word table (in the order of ID): index in word table,
+ *     begin and end frame, indices in phone table of head and tail
+ *     phone, number of left and right contexts, scores (lscore_tmp,
+ *     fscore_head, fscore_tail, gscore_head, gscore_tail,
+ *     forward_score, backward_score, amavg, cmscore, graph_cm)
+ *   - Link table: for each graph word, its left contexts and then right
+ *     contexts, as pairs of graph word ID and LM score
+ *   - String table: sequence of NULL-terminated strings
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/julius.h>
+
+/// Identifier at the head of a record
+#define GRAPHBIN_MAGIC "JGRF"
+/// Format version, should be increased at format change
+#define GRAPHBIN_VERSION 1
+/// Number of integers in the body header
+#define GRAPHBIN_HEADER_INTS 8
+/// Number of integers at the head of a graph word entry
+#define GRAPHBIN_NODE_INTS 7
+/// Number of scores in a graph word entry
+#define GRAPHBIN_NODE_FLOATS 10
+/// Size of the output buffer in bytes
+#define GRAPHBIN_BUFSIZE 8192
+
+/// Buffered writer
+typedef struct {
+  FILE *fp;			///< File pointer to write
+  unsigned char buf[GRAPHBIN_BUFSIZE]; ///< Output buffer
+  int len;			///< Current length of @a buf
+  boolean ok;			///< FALSE if write failed
+} GRAPHBIN_WRITER;
+
+/**
+ * Flush the buffer of a writer.
+ *
+ * @param w [i/o] writer
+ */
+static void
+gb_flush(GRAPHBIN_WRITER *w)
+{
+  if (w->len > 0 && w->ok) {
+    if (fwrite(w->buf, 1, w->len, w->fp) < (size_t)w->len) w->ok = FALSE;
+  }
+  w->len = 0;
+}
+
+/**
+ * Write a 32-bit integer in big endian.
+ *
+ * @param w [i/o] writer
+ * @param val [in] value
+ */
+static void
+gb_int(GRAPHBIN_WRITER *w, unsigned int val)
+{
+  unsigned char *p;
+
+  if (w->len + 4 > GRAPHBIN_BUFSIZE) gb_flush(w);
+  p = &(w->buf[w->len]);
+  p[0] = (val >> 24) & 0xff;
+  p[1] = (val >> 16) & 0xff;
+  p[2] = (val >> 8) & 0xff;
+  p[3] = val & 0xff;
+  w->len += 4;
+}
+
+/**
+ * Write a 32-bit float in big endian.
+ *
+ * @param w [i/o] writer
+ * @param val [in] value
+ */
+static void
+gb_float(GRAPHBIN_WRITER *w, float val)
+{
+  unsigned int u;
+
+  memcpy(&u, &val, 4);
+  gb_int(w, u);
+}
+
+/**
+ * Write a string including its terminator.
+ *
+ * @param w [i/o] writer
+ * @param str [in] string
+ */
+static void
+gb_str(GRAPHBIN_WRITER *w, char *str)
+{
+  int len, n;
+
+  len = strlen(str) + 1;
+  while (len > 0) {
+    if (w->len == GRAPHBIN_BUFSIZE) gb_flush(w);
+    n = GRAPHBIN_BUFSIZE - w->len;
+    if (n > len) n = len;
+    memcpy(&(w->buf[w->len]), str, n);
+    w->len += n;
+    str += n;
+    len -= n;
+  }
+}
+
+/**
+ * Read a 32-bit integer in big endian.
+ *
+ * @param p [in] pointer to the data
+ *
+ * @return the value.
+ */
+static unsigned int
+gb_get_int(unsigned char *p)
+{
+  return(((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3]);
+}
+
+/**
+ * Read a 32-bit float in big endian.
+ *
+ * @param p [in] pointer to the data
+ *
+ * @return the value.
+ */
+static float
+gb_get_float(unsigned char *p)
+{
+  unsigned int u;
+  float f;
+
+  u = gb_get_int(p);
+  memcpy(&f, &u, 4);
+  return f;
+}
+
+/**
+ * qsort callback to sort word IDs.
+ *
+ * @param a [in] word ID
+ * @param b [in] word ID
+ *
+ * @return the order of the two IDs.
+ */
+static int
+compare_wid(WORD_ID *a, WORD_ID *b)
+{
+  if (*a < *b) return -1;
+  if (*a > *b) return 1;
+  return 0;
+}
+
+/**
+ * qsort callback to sort phone pointers by address.
+ *
+ * @param a [in] phone
+ * @param b [in] phone
+ *
+ * @return the order of the two addresses.
+ */
+static int
+compare_phone(HMM_Logical **a, HMM_Logical **b)
+{
+  if (*a < *b) return -1;
+  if (*a > *b) return 1;
+  return 0;
+}
+
+/**
+ * Sort a list and remove duplicates.
+ *
+ * @param list [i/o] list
+ * @param num [in] number of elements in @a list
+ * @param size [in] size of an element in bytes
+ * @param compare [in] comparison function
+ *
+ * @return the number of unique elements.
+ */
+static int
+gb_uniq(void *list, int num, size_t size, int (*compare)(const void *, const void *))
+{
+  char *p;
+  int i, n;
+
+  if (num == 0) return 0;
+  p = (char *)list;
+  qsort(p, num, size, compare);
+  n = 1;
+  for (i = 1; i < num; i++) {
+    if ((*compare)(p + (n - 1) * size, p + i * size) != 0) {
+      if (n != i) memcpy(p + n * size, p + i * size, size);
+      n++;
+    }
+  }
+  return n;
+}
+
+/**
+ * <JA>
+ * 単語グラフをバイナリ形式の1レコードとして書き出す.
+ * 単語グラフは wordgraph_sort_and_annotate_id() により ID が
+ * 振られている必要がある.
+ *
+ * @param fp [in] 出力先のファイルポインタ
+ * @param root [in] 単語グラフの先頭要素へのポインタ
+ * @param winfo [in] 単語辞書
+ * @param pass [in] 第1パスの単語グラフなら 1，第2パスなら 2
+ * @param id [in] 認識処理インスタンスのID
+ * @param framenum [in] 入力のフレーム長
+ *
+ * @return 成功時 TRUE，失敗時 FALSE を返す.
+ * </JA>
+ * <EN>
+ * Write a word graph as a record of the binary format.  The graph words
+ * should be annotated with ID by wordgraph_sort_and_annotate_id().
+ *
+ * @param fp [in] file pointer to write
+ * @param root [in] pointer to the first element of graph words
+ * @param winfo [in] word dictionary
+ * @param pass [in] 1 for a word graph of the 1st pass, 2 for the 2nd pass
+ * @param id [in] ID of the recognition process
+ * @param framenum [in] input length in frames
+ *
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ */
+boolean
+wordgraph_write_binary(FILE *fp, WordGraph *root, WORD_INFO *winfo, int pass, int id, int framenum)
+{
+  GRAPHBIN_WRITER *w;
+  WordGraph *wg;
+  WORD_ID *words;
+  HMM_Logical **phones, **pp;
+  WORD_ID *wp;
+  int num, wordnum, phonenum, linknum, strbytes, len;
+  int i, j;
+  boolean ok;
+
+  /* list words and phones used in the graph */
+  num = 0;
+  linknum = 0;
+  for (wg = root; wg; wg = wg->next) {
+    if (wg->id != num) {
+      jlog("Error: graphbin: graph words are not annotated with ID\n");
+      return FALSE;
+    }
+    num++;
+    linknum += wg->leftwordnum + wg->rightwordnum;
+  }
+  words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * (num + 1));
+  phones = (HMM_Logical **)mymalloc(sizeof(HMM_Logical *) * (num * 2 + 1));
+  i = 0;
+  for (wg = root; wg; wg = wg->next) {
+    words[i] = wg->wid;
+    phones[i * 2] = wg->headphone;
+    phones[i * 2 + 1] = wg->tailphone;
+    i++;
+  }
+  wordnum = gb_uniq(words, num, sizeof(WORD_ID), (int (*)(const void *, const void *))compare_wid);
+  phonenum = gb_uniq(phones, num * 2, sizeof(HMM_Logical *), (int (*)(const void *, const void *))compare_phone);
+  strbytes = 0;
+  for (i = 0; i < wordnum; i++) {
+    strbytes += strlen(winfo->woutput[words[i]]) + 1;
+    strbytes += strlen(winfo->wname[words[i]]) + 1;
+  }
+  for (i = 0; i < phonenum; i++) {
+    strbytes += strlen(phones[i]->name) + 1;
+  }
+  len = 4 * GRAPHBIN_HEADER_INTS + wordnum * 4 * 3 + phonenum * 4
+    + num * 4 * (GRAPHBIN_NODE_INTS + GRAPHBIN_NODE_FLOATS)
+    + linknum * 4 * 2 + strbytes;
+
+  w = (GRAPHBIN_WRITER *)mymalloc(sizeof(GRAPHBIN_WRITER));
+  w->fp = fp;
+  w->len = 0;
+  w->ok = TRUE;
+
+  /* header */
+  memcpy(w->buf, GRAPHBIN_MAGIC, 4);
+  w->len = 4;
+  gb_int(w, GRAPHBIN_VERSION);
+  gb_int(w, len);
+  gb_int(w, pass);
+  gb_int(w, id);
+  gb_int(w, framenum);
+  gb_int(w, num);
+  gb_int(w, wordnum);
+  gb_int(w, phonenum);
+  gb_int(w, linknum);
+  gb_int(w, strbytes);
+
+  /* word table and phone table */
+  strbytes = 0;
+  for (i = 0; i < wordnum; i++) {
+    gb_int(w, words[i]);
+    gb_int(w, strbytes);
+    strbytes += strlen(winfo->woutput[words[i]]) + 1;
+    gb_int(w, strbytes);
+    strbytes += strlen(winfo->wname[words[i]]) + 1;
+  }
+  for (i = 0; i < phonenum; i++) {
+    gb_int(w, strbytes);
+    strbytes += strlen(phones[i]->name) + 1;
+  }
+
+  /* graph words */
+  for (wg = root; wg; wg = wg->next) {
+    wp = (WORD_ID *)bsearch(&(wg->wid), words, wordnum, sizeof(WORD_ID), (int (*)(const void *, const void *))compare_wid);
+    gb_int(w, wp - words);
+    gb_int(w, wg->lefttime);
+    gb_int(w, wg->righttime);
+    pp = (HMM_Logical **)bsearch(&(wg->headphone), phones, phonenum, sizeof(HMM_Logical *), (int (*)(const void *, const void *))compare_phone);
+    gb_int(w, pp - phones);
+    pp = (HMM_Logical **)bsearch(&(wg->tailphone), phones, phonenum, sizeof(HMM_Logical *), (int (*)(const void *, const void *))compare_phone);
+    gb_int(w, pp - phones);
+    gb_int(w, wg->leftwordnum);
+    gb_int(w, wg->rightwordnum);
+    gb_float(w, wg->lscore_tmp);
+    gb_float(w, wg->fscore_head);
+    gb_float(w, wg->fscore_tail);
+    gb_float(w, wg->gscore_head);
+    gb_float(w, wg->gscore_tail);
+    gb_float(w, wg->forward_score);
+    gb_float(w, wg->backward_score);
+    gb_float(w, wg->amavg);
+#ifdef CM_SEARCH
+    gb_float(w, wg->cmscore);
+#else
+    gb_float(w, 0.0);
+#endif
+    gb_float(w, wg->graph_cm);
+  }
+
+  /* links */
+  for (wg = root; wg; wg = wg->next) {
+    for (j = 0; j < wg->leftwordnum; j++) {
+      gb_int(w, wg->leftword[j]->id);
+      gb_float(w, wg->left_lscore[j]);
+    }
+    for (j = 0; j < wg->rightwordnum; j++) {
+      gb_int(w, wg->rightword[j]->id);
+      gb_float(w, wg->right_lscore[j]);
+    }
+  }
+
+  /* strings */
+  for (i = 0; i < wordnum; i++) {
+    gb_str(w, winfo->woutput[words[i]]);
+    gb_str(w, winfo->wname[words[i]]);
+  }
+  for (i = 0; i < phonenum; i++) {
+    gb_str(w, phones[i]->name);
+  }
+
+  gb_flush(w);
+  if (w->ok && fflush(fp) != 0) w->ok = FALSE;
+  ok = w->ok;
+  if (! ok) {
+    jlog("Error: graphbin: failed to write word graph\n");
+  }
+
+  free(w);
+  free(phones);
+  free(words);
+
+  return ok;
+}
+
+/**
+ * <JA>
+ * バイナリ形式の単語グラフを1レコード読み込む.
+ * 読み込んだ単語グラフは wordgraph_binary_free() で解放する.
+ *
+ * @param fp [in] 入力元のファイルポインタ
+ *
+ * @return 読み込んだ単語グラフ，ファイル終端やエラーの場合は NULL を返す.
+ * </JA>
+ * <EN>
+ * Read a record of word graph in binary format.  The returned word
+ * graph should be released by wordgraph_binary_free().
+ *
+ * @param fp [in] file pointer to read
+ *
+ * @return the word graph, or NULL at end of file or on error.
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ */
+WordGraphBin *
+wordgraph_read_binary(FILE *fp)
+{
+  WordGraphBin *g;
+  WordGraph *wg;
+  unsigned char head[12], *p, *body;
+  char *str;
+  unsigned int len, expect;
+  int num, wordnum, phonenum, linknum, strbytes;
+  int i, j, k, n, wid, maxwid;
+  int *wordtable;
+  size_t r;
+
+  r = fread(head, 1, 12, fp);
+  if (r == 0 && feof(fp)) return NULL;
+  if (r < 12) {
+    jlog("Error: graphbin: unexpected end of file\n");
+    return NULL;
+  }
+  if (memcmp(head, GRAPHBIN_MAGIC, 4) != 0) {
+    jlog("Error: graphbin: not a binary word graph\n");
+    return NULL;
+  }
+  if (gb_get_int(&(head[4])) != GRAPHBIN_VERSION) {
+    jlog("Error: graphbin: unsupported format version %d\n", gb_get_int(&(head[4])));
+    return NULL;
+  }
+  len = gb_get_int(&(head[8]));
+  if (len < 4 * GRAPHBIN_HEADER_INTS || len > 0x7fffffff) {
+    jlog("Error: graphbin: invalid record length %u\n", len);
+    return NULL;
+  }
+  body = (unsigned char *)mymalloc(len);
+  if (fread(body, 1, len, fp) < len) {
+    jlog("Error: graphbin: unexpected end of file\n");
+    free(body);
+    return NULL;
+  }
+
+  /* check sizes */
+  num = gb_get_int(&(body[12]));
+  wordnum = gb_get_int(&(body[16]));
+  phonenum = gb_get_int(&(body[20]));
+  linknum = gb_get_int(&(body[24]));
+  strbytes = gb_get_int(&(body[28]));
+  if (num < 0 || wordnum < 0 || phonenum < 0 || linknum < 0 || strbytes < 0
+      || wordnum > num || phonenum > num * 2
+      || linknum > (len - 4 * GRAPHBIN_HEADER_INTS) / 8
+      || (unsigned int)strbytes > len
+      || (double)num * 4 * (GRAPHBIN_NODE_INTS + GRAPHBIN_NODE_FLOATS) > len) {
+    jlog("Error: graphbin: broken record\n");
+    free(body);
+    return NULL;
+  }
+  expect = 4 * GRAPHBIN_HEADER_INTS + wordnum * 4 * 3 + phonenum * 4
+    + num * 4 * (GRAPHBIN_NODE_INTS + GRAPHBIN_NODE_FLOATS)
+    + linknum * 4 * 2 + strbytes;
+  if (expect != len || (strbytes > 0 && body[len - 1] != '\0')) {
+    jlog("Error: graphbin: broken record\n");
+    free(body);
+    return NULL;
+  }
+  str = (char *)&(body[len - strbytes]);
+
+  g = (WordGraphBin *)mymalloc(sizeof(WordGraphBin));
+  g->pass = gb_get_int(&(body[0]));
+  g->id = gb_get_int(&(body[4]));
+  g->framenum = gb_get_int(&(body[8]));
+  g->num = num;
+  g->phonenum = phonenum;
+  g->buf = body;
+  g->winfo = word_info_new();
+  g->winfo->wname = NULL;
+  g->winfo->woutput = NULL;
+  g->phone = (HMM_Logical *)mymalloc(sizeof(HMM_Logical) * (phonenum + 1));
+  g->wlist = (WordGraph *)mymalloc(sizeof(WordGraph) * (num + 1));
+  g->context = (WordGraph **)mymalloc(sizeof(WordGraph *) * (linknum + 1));
+  g->lscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (linknum + 1));
+  wordtable = (int *)mymalloc(sizeof(int) * (wordnum + 1));
+
+  /* word table */
+  p = &(body[4 * GRAPHBIN_HEADER_INTS]);
+  maxwid = -1;
+  for (i = 0; i < wordnum; i++) {
+    wid = gb_get_int(&(p[i * 12]));
+    if (wid < 0 || wid >= MAX_WORD_NUM || gb_get_int(&(p[i * 12 + 4])) >= (unsigned int)strbytes || gb_get_int(&(p[i * 12 + 8])) >= (unsigned int)strbytes) goto broken;
+    if (maxwid < wid) maxwid = wid;
+  }
+  g->winfo->num = g->winfo->maxnum = maxwid + 1;
+  g->winfo->woutput = (char **)mymalloc(sizeof(char *) * (maxwid + 2));
+  g->winfo->wname = (char **)mymalloc(sizeof(char *) * (maxwid + 2));
+  for (i = 0; i <= maxwid; i++) {
+    g->winfo->woutput[i] = g->winfo->wname[i] = NULL;
+  }
+  for (i = 0; i < wordnum; i++) {
+    wid = gb_get_int(p);
+    g->winfo->woutput[wid] = str + gb_get_int(&(p[4]));
+    g->winfo->wname[wid] = str + gb_get_int(&(p[8]));
+    wordtable[i] = wid;
+    p += 12;
+  }
+
+  /* phone table */
+  for (i = 0; i < phonenum; i++) {
+    if (gb_get_int(p) >= (unsigned int)strbytes) goto broken;
+    memset(&(g->phone[i]), 0, sizeof(HMM_Logical));
+    g->phone[i].name = str + gb_get_int(p);
+    p += 4;
+  }
+
+  /* graph words */
+  memset(g->wlist, 0, sizeof(WordGraph) * num);
+  k = 0;
+  for (i = 0; i < num; i++) {
+    wg = &(g->wlist[i]);
+    if (gb_get_int(p) >= (unsigned int)wordnum
+	|| gb_get_int(&(p[12])) >= (unsigned int)phonenum
+	|| gb_get_int(&(p[16])) >= (unsigned int)phonenum) goto broken;
+    wg->wid = wordtable[gb_get_int(p)];
+    wg->lefttime = gb_get_int(&(p[4]));
+    wg->righttime = gb_get_int(&(p[8]));
+    wg->headphone = &(g->phone[gb_get_int(&(p[12]))]);
+    wg->tailphone = &(g->phone[gb_get_int(&(p[16]))]);
+    wg->leftwordnum = wg->leftwordmaxnum = gb_get_int(&(p[20]));
+    wg->rightwordnum = wg->rightwordmaxnum = gb_get_int(&(p[24]));
+    if (wg->leftwordnum < 0 || wg->rightwordnum < 0 || wg->leftwordnum + wg->rightwordnum > linknum - k) goto broken;
+    wg->leftword = &(g->context[k]);
+    wg->left_lscore = &(g->lscore[k]);
+    k += wg->leftwordnum;
+    wg->rightword = &(g->context[k]);
+    wg->right_lscore = &(g->lscore[k]);
+    k += wg->rightwordnum;
+    p += 4 * GRAPHBIN_NODE_INTS;
+    wg->lscore_tmp = gb_get_float(p);
+    wg->fscore_head = gb_get_float(&(p[4]));
+    wg->fscore_tail = gb_get_float(&(p[8]));
+    wg->gscore_head = gb_get_float(&(p[12]));
+    wg->gscore_tail = gb_get_float(&(p[16]));
+    wg->forward_score = gb_get_float(&(p[20]));
+    wg->backward_score = gb_get_float(&(p[24]));
+    wg->amavg = gb_get_float(&(p[28]));
+#ifdef CM_SEARCH
+    wg->cmscore = gb_get_float(&(p[32]));
+#endif
+    wg->graph_cm = gb_get_float(&(p[36]));
+    p += 4 * GRAPHBIN_NODE_FLOATS;
+    wg->id = i;
+    wg->next = (i + 1 < num) ? &(g->wlist[i + 1]) : NULL;
+  }
+  if (k != linknum) goto broken;
+
+  /* links */
+  for (j = 0; j < linknum; j++) {
+    n = gb_get_int(p);
+    if (n < 0 || n >= num) goto broken;
+    g->context[j] = &(g->wlist[n]);
+    g->lscore[j] = gb_get_float(&(p[4]));
+    p += 8;
+  }
+
+  g->root = (num > 0) ? &(g->wlist[0]) : NULL;
+  free(wordtable);
+
+  return g;
+
+ broken:
+  jlog("Error: graphbin: broken record\n");
+  free(wordtable);
+  wordgraph_binary_free(g);
+  return NULL;
+}
+
+/**
+ * <JA>
+ * wordgraph_read_binary() で読み込んだ単語グラフを解放する.
+ *
+ * @param g [i/o] 単語グラフ
+ * </JA>
+ * <EN>
+ * Release a word graph read by wordgraph_read_binary().
+ *
+ * @param g [i/o] word graph
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ */
+void
+wordgraph_binary_free(WordGraphBin *g)
+{
+  word_info_free(g->winfo);
+  free(g->phone);
+  free(g->wlist);
+  free(g->context);
+  free(g->lscore);
+  free(g->buf);
+  free(g);
+}
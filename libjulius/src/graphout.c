@@ -34,16 +34,64 @@
 static WCHMM_INFO *wchmm_local;	///< Local copy, just for debug
 #endif
 
+/// Initial size of the hash table of graph words, should be power of 2
+#define GRAPH_HASH_INITIAL_SIZE 1024
+
+/// Context lists will be looked up by hash when comparisons exceed square of this
+#define CONTEXT_HASH_THRESHOLD 16
+
+/** 
+ * Work area to look up graph words in a context list by hash.
+ * 
+ */
+typedef struct {
+  WordGraph **key;		///< Graph words, NULL for empty slot
+  int *idx;			///< Index of each word in the context list
+  int mask;			///< Size of the table minus 1
+} CONTEXT_HASH;
+
+/** 
+ * <JA>
+ * 単語IDと境界時刻からハッシュ値を求める. 
+ * 
+ * @param wid [in] 単語ID
+ * @param lefttime [in] 始端フレーム
+ * @param righttime [in] 終端フレーム
+ * 
+ * @return ハッシュ値
+ * </JA>
+ * <EN>
+ * Compute hash value from word ID and boundaries.
+ * 
+ * @param wid [in] word ID
+ * @param lefttime [in] beginning frame
+ * @param righttime [in] end frame
+ * 
+ * @return the hash value.
+ * </EN>
+ */
+static unsigned int
+graph_hashval(WORD_ID wid, int lefttime, int righttime)
+{
+  unsigned int h;
+
+  h = (unsigned int)wid * 2654435761u + (unsigned int)lefttime;
+  h = h * 2654435761u + (unsigned int)righttime;
+  return(h ^ (h >> 16));
+}
+
 /** 
  * <JA>
- * グラフ出力を初期化する. 現在はデバッグ用処理のみ. 
+ * グラフ出力を初期化する. 探索中の同一単語の検索に用いるハッシュ表を
+ * 空にする. 
  * 
- * @param wchmm [in] 木構造化辞書
+ * @param r [i/o] 認識処理インスタンス
  * </JA>
  * <EN>
- * Initialize data for graphout.
+ * Initialize data for graphout.  The hash table to find the same
+ * words while search will be emptied.
  * 
- * @param wchmm [in] tree lexicon
+ * @param r [i/o] recognition process instance
  * </EN>
  *
  * @callgraph
@@ -51,10 +99,18 @@ static WCHMM_INFO *wchmm_local;	///< Local copy, just for debug
  * 
  */
 void
-wordgraph_init(WCHMM_INFO *wchmm)
+wordgraph_init(RecogProcess *r)
 {
 #if defined(GDEBUG) || defined(GDEBUG2)
-  wchmm_local = wchmm;
+  wchmm_local = r->wchmm;
+#endif
+#ifdef GRAPHOUT_DYNAMIC
+  if (r->graph_hash == NULL) {
+    r->graph_hash_mask = GRAPH_HASH_INITIAL_SIZE - 1;
+    r->graph_hash = (WordGraph **)mymalloc(sizeof(WordGraph *) * GRAPH_HASH_INITIAL_SIZE);
+  }
+  memset(r->graph_hash, 0, sizeof(WordGraph *) * (r->graph_hash_mask + 1));
+  r->graph_hash_num = 0;
 #endif
 }
 
@@ -62,6 +118,95 @@ wordgraph_init(WCHMM_INFO *wchmm)
 /**************************************************************/
 /* allocation and free of a WordGraph instance */
 
+/** 
+ * <JA>
+ * 空のグラフ単語を割り付ける. 領域は認識処理インスタンスのメモリブロック
+ * から取られ，入力ごとに wordgraph_release_all() で一括して解放される. 
+ * 探索中に解放されたグラフ単語があればそれを再利用する. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * 
+ * @return 割り付けられたグラフ単語へのポインタ
+ * </JA>
+ * <EN>
+ * Allocate an empty graph word.  The area will be taken from memory
+ * blocks of the recognition process instance, and will be released at
+ * once for each input by wordgraph_release_all().  Graph words released
+ * while search will be recycled.
+ * 
+ * @param r [i/o] recognition process instance
+ * 
+ * @return pointer to the allocated graph word.
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
+ */
+WordGraph *
+wordgraph_alloc(RecogProcess *r)
+{
+  WordGraph *new;
+
+  if (r->graph_stocker != NULL) {
+    /* recycle, with its context lists */
+    new = r->graph_stocker;
+    r->graph_stocker = new->next;
+  } else {
+    new = (WordGraph *)mybmalloc2(sizeof(WordGraph), &(r->graph_mroot));
+    new->leftwordmaxnum = FANOUTSTEP;
+    new->leftword = (WordGraph **)mybmalloc2(sizeof(WordGraph *) * new->leftwordmaxnum, &(r->graph_mroot));
+    new->left_lscore = (LOGPROB *)mybmalloc2(sizeof(LOGPROB) * new->leftwordmaxnum, &(r->graph_mroot));
+    new->rightwordmaxnum = FANOUTSTEP;
+    new->rightword = (WordGraph **)mybmalloc2(sizeof(WordGraph *) * new->rightwordmaxnum, &(r->graph_mroot));
+    new->right_lscore = (LOGPROB *)mybmalloc2(sizeof(LOGPROB) * new->rightwordmaxnum, &(r->graph_mroot));
+  }
+  new->leftwordnum = 0;
+  new->rightwordnum = 0;
+  new->next = NULL;
+  new->hashnext = NULL;
+  new->region = r;
+
+  return(new);
+}
+
+/** 
+ * <JA>
+ * コンテキストリストの領域を倍に拡張する. 古い領域は入力の終わりまで
+ * 解放されない. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * @param list [i/o] グラフ単語のリスト
+ * @param lscore [i/o] 接続言語スコアのリスト
+ * @param num [in] リスト中の要素数
+ * @param maxnum [i/o] 割り付け済みの長さ
+ * </JA>
+ * <EN>
+ * Double the area of a context list.  The old area will not be
+ * released until the end of input.
+ * 
+ * @param r [i/o] recognition process instance
+ * @param list [i/o] list of graph words
+ * @param lscore [i/o] list of word connection scores
+ * @param num [in] number of elements in the list
+ * @param maxnum [i/o] allocated length
+ * </EN>
+ */
+static void
+expand_context(RecogProcess *r, WordGraph ***list, LOGPROB **lscore, int num, int *maxnum)
+{
+  WordGraph **newlist;
+  LOGPROB *newlscore;
+
+  *maxnum *= 2;
+  newlist = (WordGraph **)mybmalloc2(sizeof(WordGraph *) * (*maxnum), &(r->graph_mroot));
+  newlscore = (LOGPROB *)mybmalloc2(sizeof(LOGPROB) * (*maxnum), &(r->graph_mroot));
+  memcpy(newlist, *list, sizeof(WordGraph *) * num);
+  memcpy(newlscore, *lscore, sizeof(LOGPROB) * num);
+  *list = newlist;
+  *lscore = newlscore;
+}
+
 /** 
  * <JA>
  * グラフ単語を新たに生成し，そのポインタを返す. 
@@ -77,6 +222,7 @@ wordgraph_init(WCHMM_INFO *wchmm)
  * @param gscore_tail [in] 末尾での入力末端からのViterbiスコア (g)
  * @param lscore [in] 単語の言語スコア (Julian では値に意味なし)
  * @param cm [in] 単語の信頼度スコア (探索時に動的に計算されたもの)
+ * @param r [i/o] 認識処理インスタンス
  * 
  * @return 新たに生成されたグラフ単語へのポインタ
  * </JA>
@@ -94,16 +240,17 @@ wordgraph_init(WCHMM_INFO *wchmm)
  * @param gscore_tail [in] Viterbi score accumulated from input end at word tail (g)
  * @param lscore [in] language score of the word (bogus in Julian)
  * @param cm [in] word confidence score (computed on search time)
+ * @param r [i/o] recognition process instance
  * 
  * @return pointer to the newly created graph word.
  * </EN>
  */
 static WordGraph *
-wordgraph_new(WORD_ID wid, HMM_Logical *headphone, HMM_Logical *tailphone, int leftframe, int rightframe, LOGPROB fscore_head, LOGPROB fscore_tail, LOGPROB gscore_head, LOGPROB gscore_tail, LOGPROB lscore, LOGPROB cm)
+wordgraph_new(WORD_ID wid, HMM_Logical *headphone, HMM_Logical *tailphone, int leftframe, int rightframe, LOGPROB fscore_head, LOGPROB fscore_tail, LOGPROB gscore_head, LOGPROB gscore_tail, LOGPROB lscore, LOGPROB cm, RecogProcess *r)
 {
   WordGraph *new;
 
-  new = (WordGraph *)mymalloc(sizeof(WordGraph));
+  new = wordgraph_alloc(r);
   new->wid = wid;
   new->lefttime = leftframe;
   new->righttime = rightframe;
@@ -122,20 +269,11 @@ wordgraph_new(WORD_ID wid, HMM_Logical *headphone, HMM_Logical *tailphone, int l
   }
   new->headphone = headphone;
   new->tailphone = tailphone;
-  new->leftwordmaxnum = FANOUTSTEP;
-  new->leftword = (WordGraph **)mymalloc(sizeof(WordGraph *) * new->leftwordmaxnum);
-  new->left_lscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * new->leftwordmaxnum);
-  new->leftwordnum = 0;
-  new->rightwordmaxnum = FANOUTSTEP;
-  new->rightword = (WordGraph **)mymalloc(sizeof(WordGraph *) * new->rightwordmaxnum);
-  new->right_lscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * new->rightwordmaxnum);
-  new->rightwordnum = 0;
 
   new->mark = FALSE;
 #ifdef GRAPHOUT_DYNAMIC
   new->purged = FALSE;
 #endif
-  new->next = NULL;
   new->saved = FALSE;
 
   new->graph_cm = 0.0;
@@ -163,12 +301,12 @@ wordgraph_new(WORD_ID wid, HMM_Logical *headphone, HMM_Logical *tailphone, int l
 
 /** 
  * <JA>
- * あるグラフ単語のメモリ領域を解放する. 
+ * あるグラフ単語を解放する. 領域は再利用のために保存される. 
  * 
  * @param wg [in] グラフ単語
  * </JA>
  * <EN>
- * Free a graph word.
+ * Free a graph word.  The area will be kept for recycle.
  * 
  * @param wg [in] graph word to be freed.
  * </EN>
@@ -180,11 +318,60 @@ wordgraph_new(WORD_ID wid, HMM_Logical *headphone, HMM_Logical *tailphone, int l
 void
 wordgraph_free(WordGraph *wg)
 {
-  free(wg->rightword);
-  free(wg->right_lscore);
-  free(wg->leftword);
-  free(wg->left_lscore);
-  free(wg);
+  wg->next = wg->region->graph_stocker;
+  wg->region->graph_stocker = wg;
+}
+
+/** 
+ * <JA>
+ * 認識処理インスタンスで割り付けられたグラフ単語を全て一括して解放する. 
+ * 解放後はそれらのグラフ単語を参照してはならない. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * </JA>
+ * <EN>
+ * Release all the graph words allocated in a recognition process
+ * instance at once.  They should not be referred after this call.
+ * 
+ * @param r [i/o] recognition process instance
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
+ */
+void
+wordgraph_release_all(RecogProcess *r)
+{
+  if (r->graph_mroot != NULL) mybfree2(&(r->graph_mroot));
+  r->graph_mroot = NULL;
+  r->graph_stocker = NULL;
+}
+
+/** 
+ * <JA>
+ * グラフ出力の作業領域を全て解放する. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * </JA>
+ * <EN>
+ * Free all the work area for graph output.
+ * 
+ * @param r [i/o] recognition process instance
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
+ */
+void
+wordgraph_work_free(RecogProcess *r)
+{
+  wordgraph_release_all(r);
+  if (r->graph_hash != NULL) {
+    free(r->graph_hash);
+    r->graph_hash = NULL;
+  }
 }
 
 /**************************************************************/
@@ -205,17 +392,19 @@ wordgraph_free(WordGraph *wg)
  * @param left [in] word graph which will be added to the @a wg as left context.
  * @param lscore [in] word connection score
  * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
  */
-static void
+void
 wordgraph_add_leftword(WordGraph *wg, WordGraph *left, LOGPROB lscore)
 {
   if (wg == NULL) return;
   if (left == NULL) return;
   if (wg->leftwordnum >= wg->leftwordmaxnum) {
     /* expand */
-    wg->leftwordmaxnum += FANOUTSTEP;
-    wg->leftword = (WordGraph **)myrealloc(wg->leftword, sizeof(WordGraph *) * wg->leftwordmaxnum);
-    wg->left_lscore = (LOGPROB *)myrealloc(wg->left_lscore, sizeof(LOGPROB) * wg->leftwordmaxnum);
+    expand_context(wg->region, &(wg->leftword), &(wg->left_lscore), wg->leftwordnum, &(wg->leftwordmaxnum));
   }
   wg->leftword[wg->leftwordnum] = left;
   wg->left_lscore[wg->leftwordnum] = lscore;
@@ -242,17 +431,19 @@ wordgraph_add_leftword(WordGraph *wg, WordGraph *left, LOGPROB lscore)
  * context.
  * @param lscore [in] word connection score
  * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
  */
-static void
+void
 wordgraph_add_rightword(WordGraph *wg, WordGraph *right, LOGPROB lscore)
 {
   if (wg == NULL) return;
   if (right == NULL) return;
   if (wg->rightwordnum >= wg->rightwordmaxnum) {
     /* expand */
-    wg->rightwordmaxnum += FANOUTSTEP;
-    wg->rightword = (WordGraph **)myrealloc(wg->rightword, sizeof(WordGraph *) * wg->rightwordmaxnum);
-    wg->right_lscore = (LOGPROB *)myrealloc(wg->right_lscore, sizeof(LOGPROB) * wg->rightwordmaxnum);
+    expand_context(wg->region, &(wg->rightword), &(wg->right_lscore), wg->rightwordnum, &(wg->rightwordmaxnum));
   }
   wg->rightword[wg->rightwordnum] = right;
   wg->right_lscore[wg->rightwordnum] = lscore;
@@ -366,6 +557,87 @@ wordgraph_check_and_add_rightword(WordGraph *wg, WordGraph *right, LOGPROB lscor
   return FALSE;
 }
 
+/** 
+ * <JA>
+ * コンテキストリスト検索用のハッシュ表を準備する. 
+ * 
+ * @param h [out] ハッシュ表
+ * @param num [in] 登録する単語数の上限
+ * </JA>
+ * <EN>
+ * Prepare hash table to look up context list.
+ * 
+ * @param h [out] hash table
+ * @param num [in] maximum number of words to be registered
+ * </EN>
+ */
+static void
+context_hash_init(CONTEXT_HASH *h, int num)
+{
+  int size;
+
+  for(size = 1; size < num * 2; size <<= 1);
+  h->mask = size - 1;
+  h->key = (WordGraph **)mymalloc(sizeof(WordGraph *) * size);
+  h->idx = (int *)mymalloc(sizeof(int) * size);
+  memset(h->key, 0, sizeof(WordGraph *) * size);
+}
+
+/** 
+ * <JA>
+ * コンテキストリスト検索用のハッシュ表を解放する. 
+ * 
+ * @param h [i/o] ハッシュ表
+ * </JA>
+ * <EN>
+ * Free hash table to look up context list.
+ * 
+ * @param h [i/o] hash table
+ * </EN>
+ */
+static void
+context_hash_free(CONTEXT_HASH *h)
+{
+  free(h->idx);
+  free(h->key);
+}
+
+/** 
+ * <JA>
+ * ハッシュ表からグラフ単語を探す. 無ければ与えられた位置で登録する. 
+ * 
+ * @param h [i/o] ハッシュ表
+ * @param w [in] 探すグラフ単語
+ * @param i [in] 無かった場合に登録するリスト上の位置
+ * 
+ * @return 既に登録されていればそのリスト上の位置，無ければ -1 を返す. 
+ * </JA>
+ * <EN>
+ * Look up a graph word in the hash table, and register it with the
+ * given index if not found.
+ * 
+ * @param h [i/o] hash table
+ * @param w [in] graph word to look for
+ * @param i [in] index on the list to register when not found
+ * 
+ * @return the index of the already registered one, or -1 if not found.
+ * </EN>
+ */
+static int
+context_hash_lookup(CONTEXT_HASH *h, WordGraph *w, int i)
+{
+  unsigned int k;
+
+  k = ((unsigned int)((size_t)w / sizeof(WordGraph *)) * 2654435761u) & h->mask;
+  while (h->key[k] != NULL) {
+    if (h->key[k] == w) return(h->idx[k]);
+    k = (k + 1) & h->mask;
+  }
+  h->key[k] = w;
+  h->idx[k] = i;
+  return -1;
+}
+
 /** 
  * <JA>
  * 同一グラフ単語のマージ時に,単語グラフのコンテキストを全て別の単語グラフに
@@ -392,6 +664,8 @@ merge_contexts(WordGraph *dst, WordGraph *src)
   int s, d;
   WordGraph *adding;
   boolean ret;
+  boolean hashed;
+  CONTEXT_HASH h;
 
 #ifdef GDEBUG
   jlog("DEBUG: merge_contexts: merging context of \"%s\"[%d..%d] to \"%s\"[%d..%d]...\n",
@@ -402,6 +676,14 @@ merge_contexts(WordGraph *dst, WordGraph *src)
   ret = FALSE;
   
   /* left context */
+  hashed = (src->leftwordnum * dst->leftwordnum > CONTEXT_HASH_THRESHOLD * CONTEXT_HASH_THRESHOLD);
+  if (hashed) {
+    context_hash_init(&h, dst->leftwordnum + src->leftwordnum);
+    for(d=0;d<dst->leftwordnum;d++) {
+      if (dst->leftword[d]->mark) continue;
+      context_hash_lookup(&h, dst->leftword[d], d);
+    }
+  }
   for(s=0;s<src->leftwordnum;s++) {
     adding = src->leftword[s];
     if (adding->mark) continue;
@@ -412,10 +694,16 @@ merge_contexts(WordGraph *dst, WordGraph *src)
 #endif
       continue;
     }
-    for(d=0;d<dst->leftwordnum;d++) {
-      if (dst->leftword[d]->mark) continue;
-      if (dst->leftword[d] == adding) {
-	break;
+    if (hashed) {
+      /* registered here as it will be added at the tail if not found */
+      d = context_hash_lookup(&h, adding, dst->leftwordnum);
+      if (d < 0) d = dst->leftwordnum;
+    } else {
+      for(d=0;d<dst->leftwordnum;d++) {
+	if (dst->leftword[d]->mark) continue;
+	if (dst->leftword[d] == adding) {
+	  break;
+	}
       }
     }
     if (d >= dst->leftwordnum) { /* no leftword matched */
@@ -436,8 +724,17 @@ merge_contexts(WordGraph *dst, WordGraph *src)
     }
 #endif
   }
+  if (hashed) context_hash_free(&h);
 
   /* right context */
+  hashed = (src->rightwordnum * dst->rightwordnum > CONTEXT_HASH_THRESHOLD * CONTEXT_HASH_THRESHOLD);
+  if (hashed) {
+    context_hash_init(&h, dst->rightwordnum + src->rightwordnum);
+    for(d=0;d<dst->rightwordnum;d++) {
+      if (dst->rightword[d]->mark) continue;
+      context_hash_lookup(&h, dst->rightword[d], d);
+    }
+  }
   for(s=0;s<src->rightwordnum;s++) {
     adding = src->rightword[s];
     if (adding->mark) continue;
@@ -448,10 +745,16 @@ merge_contexts(WordGraph *dst, WordGraph *src)
 #endif
       continue;
     }
-    for(d=0;d<dst->rightwordnum;d++) {
-      if (dst->rightword[d]->mark) continue;
-      if (dst->rightword[d] == adding) {
-	break;
+    if (hashed) {
+      /* registered here as it will be added at the tail if not found */
+      d = context_hash_lookup(&h, adding, dst->rightwordnum);
+      if (d < 0) d = dst->rightwordnum;
+    } else {
+      for(d=0;d<dst->rightwordnum;d++) {
+	if (dst->rightword[d]->mark) continue;
+	if (dst->rightword[d] == adding) {
+	  break;
+	}
       }
     }
     if (d >= dst->rightwordnum) { /* no rightword matched */
@@ -472,6 +775,7 @@ merge_contexts(WordGraph *dst, WordGraph *src)
     }
 #endif
   }
+  if (hashed) context_hash_free(&h);
   
   return(ret);
 }
@@ -554,38 +858,77 @@ swap_rightword(WordGraph *wg, WordGraph *from, WordGraph *to, LOGPROB lscore)
 
 /** 
  * <JA>
- * 左コンテキストリスト中の重複を除去する
+ * コンテキストリスト中の重複を除去する. 最初に現れたものが残る. 
  * 
- * @param wg [i/o] 操作対象のグラフ単語
+ * @param list [i/o] グラフ単語のリスト
+ * @param lscore [i/o] 接続言語スコアのリスト
+ * @param num [in] リスト中の要素数
+ * 
+ * @return 除去後の要素数
  * </JA>
  * <EN>
- * Delete duplicate entries in left context list of a graph word.
+ * Delete duplicate entries in a context list.  The first one remains.
  * 
- * @param wg [i/o] target graph word
+ * @param list [i/o] list of graph words
+ * @param lscore [i/o] list of word connection scores
+ * @param num [in] number of elements in the list
+ * 
+ * @return the number of elements after deletion.
  * </EN>
  */
-static void
-uniq_leftword(WordGraph *wg)
+static int
+uniq_context(WordGraph **list, LOGPROB *lscore, int num)
 {
   int i, j, dst;
   boolean ok;
+  CONTEXT_HASH h;
 
   dst = 0;
-  for(i=0;i<wg->leftwordnum;i++) {
+  if (num > CONTEXT_HASH_THRESHOLD) {
+    context_hash_init(&h, num);
+    for(i=0;i<num;i++) {
+      if (context_hash_lookup(&h, list[i], dst) == -1) {
+	list[dst] = list[i];
+	lscore[dst] = lscore[i];
+	dst++;
+      }
+    }
+    context_hash_free(&h);
+    return(dst);
+  }
+  for(i=0;i<num;i++) {
     ok = TRUE;
     for(j=0;j<dst;j++) {
-      if (wg->leftword[i] == wg->leftword[j]) {
+      if (list[i] == list[j]) {
 	ok = FALSE;
 	break;
       }
     }
     if (ok == TRUE) {
-      wg->leftword[dst] = wg->leftword[i];
-      wg->left_lscore[dst] = wg->left_lscore[i];
+      list[dst] = list[i];
+      lscore[dst] = lscore[i];
       dst++;
     }
   }
-  wg->leftwordnum = dst;
+  return(dst);
+}
+
+/** 
+ * <JA>
+ * 左コンテキストリスト中の重複を除去する
+ * 
+ * @param wg [i/o] 操作対象のグラフ単語
+ * </JA>
+ * <EN>
+ * Delete duplicate entries in left context list of a graph word.
+ * 
+ * @param wg [i/o] target graph word
+ * </EN>
+ */
+static void
+uniq_leftword(WordGraph *wg)
+{
+  wg->leftwordnum = uniq_context(wg->leftword, wg->left_lscore, wg->leftwordnum);
 }
 
 /** 
@@ -603,25 +946,7 @@ uniq_leftword(WordGraph *wg)
 static void
 uniq_rightword(WordGraph *wg)
 {
-  int i, j, dst;
-  boolean ok;
-
-  dst = 0;
-  for(i=0;i<wg->rightwordnum;i++) {
-    ok = TRUE;
-    for(j=0;j<dst;j++) {
-      if (wg->rightword[i] == wg->rightword[j]) {
-	ok = FALSE;
-	break;
-      }
-    }
-    if (ok == TRUE) {
-      wg->rightword[dst] = wg->rightword[i];
-      wg->right_lscore[dst] = wg->right_lscore[i];
-      dst++;
-    }
-  }
-  wg->rightwordnum = dst;
+  wg->rightwordnum = uniq_context(wg->rightword, wg->right_lscore, wg->rightwordnum);
 }
 
 /** 
@@ -1427,7 +1752,7 @@ wordgraph_adjust_boundary_sub(WordGraph **rootp, int *mov_num_ret, int *dup_num_
 #else
 			      , LOG_ZERO
 #endif
-			      );
+			      , wg->region);
 	  /* copy corresponding link */
 	  for(i=0;i<wg->leftwordnum;i++) {
 	    if ((wg->leftword[i])->mark) continue;
@@ -1482,6 +1807,182 @@ wordgraph_adjust_boundary_sub(WordGraph **rootp, int *mov_num_ret, int *dup_num_
   return (changed);
 }
 
+/** 
+ * <JA>
+ * 削除マークの付いていないグラフ単語をリスト順に配列に集める. 
+ * 
+ * @param root [in] グラフ単語リストのルートポインタ
+ * @param count_ret [out] マークされたものも含むグラフ単語の数
+ * @param num_ret [out] 配列中の単語数
+ * 
+ * @return 新たに割り付けられた配列
+ * </JA>
+ * <EN>
+ * Gather graph words without delete mark into an array in list order.
+ * 
+ * @param root [in] root pointer to the list of graph words
+ * @param count_ret [out] number of graph words including marked ones
+ * @param num_ret [out] number of words in the array
+ * 
+ * @return the newly allocated array.
+ * </EN>
+ */
+static WordGraph **
+wordgraph_unmarked_list(WordGraph *root, int *count_ret, int *num_ret)
+{
+  WordGraph *wg;
+  WordGraph **wlist;
+  int count, num;
+
+  count = 0;
+  for(wg=root;wg;wg=wg->next) count++;
+  wlist = (WordGraph **)mymalloc(sizeof(WordGraph *) * (count + 1));
+  num = 0;
+  for(wg=root;wg;wg=wg->next) {
+    if (wg->mark == TRUE) continue;
+    wlist[num++] = wg;
+  }
+  *count_ret = count;
+  *num_ret = num;
+  return(wlist);
+}
+
+/** 
+ * <JA>
+ * 境界時刻と部分文スコアが完全に一致する同じ単語かどうか調べる. 
+ * 
+ * @param x [in] グラフ単語１
+ * @param y [in] グラフ単語２
+ * 
+ * @return 一致すれば TRUE, そうでなければ FALSE
+ * </JA>
+ * <EN>
+ * Check if two graph words are the same word with exactly the same
+ * time and score.
+ * 
+ * @param x [in] graph word 1
+ * @param y [in] graph word 2
+ * 
+ * @return TRUE if the same, or FALSE if not.
+ * </EN>
+ */
+static boolean
+is_same_word_score(WordGraph *x, WordGraph *y)
+{
+  return(x->wid == y->wid &&
+	 x->headphone == y->headphone &&
+	 x->tailphone == y->tailphone &&
+	 x->lefttime == y->lefttime &&
+	 x->righttime == y->righttime &&
+	 x->fscore_head == y->fscore_head &&
+	 x->fscore_tail == y->fscore_tail);
+}
+
+/** 
+ * <JA>
+ * 境界時刻が一致する同じ単語かどうか調べる. 
+ * 
+ * @param x [in] グラフ単語１
+ * @param y [in] グラフ単語２
+ * 
+ * @return 一致すれば TRUE, そうでなければ FALSE
+ * </JA>
+ * <EN>
+ * Check if two graph words are the same word at the same position.
+ * 
+ * @param x [in] graph word 1
+ * @param y [in] graph word 2
+ * 
+ * @return TRUE if the same, or FALSE if not.
+ * </EN>
+ */
+static boolean
+is_same_word_position(WordGraph *x, WordGraph *y)
+{
+  return(x->wid == y->wid &&
+	 x->lefttime == y->lefttime &&
+	 x->righttime == y->righttime);
+}
+
+/** 
+ * <JA>
+ * 同一とみなされるグラフ単語をハッシュでまとめる. 各グループの
+ * 配列上で最初の単語から，残りの単語が配列順に @a member でつながれる. 
+ * 
+ * @param wlist [in] グラフ単語の配列
+ * @param num [in] @a wlist の長さ
+ * @param member [out] 各単語について同じグループの次の単語の位置 (無ければ -1)
+ * @param same [in] 同一かどうかを判定する関数
+ * </JA>
+ * <EN>
+ * Group graph words to be regarded as the same, using hash.  In each
+ * group, the rest words are linked by @a member in array order from
+ * the first word.
+ * 
+ * @param wlist [in] array of graph words
+ * @param num [in] length of @a wlist
+ * @param member [out] index of next word in the same group for each word, or -1 if none
+ * @param same [in] function to judge if two words are the same
+ * </EN>
+ */
+static void
+group_same_words(WordGraph **wlist, int num, int *member, boolean (*same)(WordGraph *, WordGraph *))
+{
+  int *bucket, *chain, *tail;
+  int size, i, j;
+  unsigned int h;
+
+  for(size = 1; size < num * 2; size <<= 1);
+  bucket = (int *)mymalloc(sizeof(int) * size);
+  chain = (int *)mymalloc(sizeof(int) * (num + 1));
+  tail = (int *)mymalloc(sizeof(int) * (num + 1));
+  for(i=0;i<size;i++) bucket[i] = -1;
+  for(i=0;i<num;i++) {
+    member[i] = -1;
+    h = graph_hashval(wlist[i]->wid, wlist[i]->lefttime, wlist[i]->righttime) & (size - 1);
+    for(j=bucket[h];j!=-1;j=chain[j]) {
+      if ((*same)(wlist[j], wlist[i])) break;
+    }
+    if (j != -1) {
+      /* append to the group */
+      member[tail[j]] = i;
+      tail[j] = i;
+    } else {
+      /* first word of a new group */
+      chain[i] = bucket[h];
+      bucket[h] = i;
+      tail[i] = i;
+    }
+  }
+  free(tail);
+  free(chain);
+  free(bucket);
+}
+
+/** 
+ * <JA>
+ * 配列上の位置をソートするための qsort コールバック
+ * 
+ * @param x [in] 要素１
+ * @param y [in] 要素２
+ * 
+ * @return qsort に準じた返り値
+ * </JA>
+ * <EN>
+ * qsort callback to sort indices on array.
+ * 
+ * @param x [in] element 1
+ * @param y [in] element 2
+ * 
+ * @return values for qsort
+ * </EN>
+ */
+static int
+compare_index(int *x, int *y)
+{
+  return(*x - *y);
+}
+
 /** 
  * <JA>
  * グラフ内に境界情報やスコアが全く同一の単語がある場合それらをマージする. 
@@ -1502,41 +2003,40 @@ static void
 wordgraph_compaction_thesame_sub(WordGraph **rootp, int *rest_ret, int *merged_ret)
 {
   WordGraph *wg, *we;
-  int i, count, erased, merged;
+  WordGraph **wlist;
+  int *member;
+  int i, n, m, num, count, erased, merged;
 
-  count = 0;
   merged = 0;
-  for(wg=*rootp;wg;wg=wg->next) {
-    count++;
+  wlist = wordgraph_unmarked_list(*rootp, &count, &num);
+  member = (int *)mymalloc(sizeof(int) * (num + 1));
+  /* find the words with exactly the same time and score */
+  group_same_words(wlist, num, member, is_same_word_score);
+  for(n=0;n<num;n++) {
+    wg = wlist[n];
     if (wg->mark == TRUE) continue;
-    for(we=wg->next;we;we=we->next) {
+    for(m=member[n];m!=-1;m=member[m]) {
+      we = wlist[m];
       if (we->mark == TRUE) continue;
-      /* find the word with exactly the same time and score */
-      if (wg->wid == we->wid &&
-	  wg->headphone == we->headphone &&
-	  wg->tailphone == we->tailphone &&
-	  wg->lefttime == we->lefttime &&
-	  wg->righttime == we->righttime &&
-	  wg->fscore_head == we->fscore_head &&
-	  wg->fscore_tail == we->fscore_tail) {
-	/* merge contexts */
-	merge_contexts(wg, we);
-	/* swap contexts of left / right contexts */
-	for(i=0;i<we->leftwordnum;i++) {
-	  if (we->leftword[i]->mark) continue;
-	  //if (we->leftword[i] == wg) continue;
-	  swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
-	}
-	for(i=0;i<we->rightwordnum;i++) {
-	  if (we->rightword[i]->mark) continue;
-	  //if (we->rightword[i] == wg) continue;
-	  swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
-	}
-	we->mark = TRUE;
-	merged++;
+      /* merge contexts */
+      merge_contexts(wg, we);
+      /* swap contexts of left / right contexts */
+      for(i=0;i<we->leftwordnum;i++) {
+	if (we->leftword[i]->mark) continue;
+	//if (we->leftword[i] == wg) continue;
+	swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
+      }
+      for(i=0;i<we->rightwordnum;i++) {
+	if (we->rightword[i]->mark) continue;
+	//if (we->rightword[i] == wg) continue;
+	swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
       }
+      we->mark = TRUE;
+      merged++;
     }
   }
+  free(member);
+  free(wlist);
 
   erased = wordgraph_exec_erase(rootp);
 
@@ -1709,7 +2209,9 @@ void
 wordgraph_compaction_exacttime(WordGraph **rootp, RecogProcess *r)
 {
   WordGraph *wg, *we;
-  int i, count, erased;
+  WordGraph **wlist;
+  int *member;
+  int i, n, m, num, count, erased;
 
   if (r->config->graph.graph_merge_neighbor_range < 0) {
     if (verbose_flag) jlog("STAT: graphout: step 4: SKIP (merge the same words with same boundary to the most likely one\n");
@@ -1718,43 +2220,44 @@ wordgraph_compaction_exacttime(WordGraph **rootp, RecogProcess *r)
 
   if (verbose_flag) jlog("STAT: graphout: step 4: merge same words with same boundary to the most likely one\n");
 
-  count = 0;
-  for(wg=*rootp;wg;wg=wg->next) {
-    count++;
+  wlist = wordgraph_unmarked_list(*rootp, &count, &num);
+  member = (int *)mymalloc(sizeof(int) * (num + 1));
+  /* find same words at same position */
+  group_same_words(wlist, num, member, is_same_word_position);
+  for(n=0;n<num;n++) {
+    wg = wlist[n];
     if (wg->mark == TRUE) continue;
-    for(we=wg->next;we;we=we->next) {
+    for(m=member[n];m!=-1;m=member[m]) {
+      we = wlist[m];
       if (we->mark == TRUE) continue;
-      /* find same words at same position */
-      if (wg->wid == we->wid &&
-	  wg->lefttime == we->lefttime &&
-	  wg->righttime == we->righttime) {
-	/* merge contexts */
-	merge_contexts(wg, we);
-	/* swap contexts of left / right contexts */
-	for(i=0;i<we->leftwordnum;i++) {
-	  swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
-	}
-	for(i=0;i<we->rightwordnum;i++) {
-	  swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
-	}
-	/* keep the max score */
-	if (wg->fscore_head < we->fscore_head) {
-	  wg->headphone = we->headphone;
-	  wg->tailphone = we->tailphone;
-	  wg->fscore_head = we->fscore_head;
-	  wg->fscore_tail = we->fscore_tail;
-	  wg->gscore_head = we->gscore_head;
-	  wg->gscore_tail = we->gscore_tail;
-	  wg->lscore_tmp = we->lscore_tmp;
+      /* merge contexts */
+      merge_contexts(wg, we);
+      /* swap contexts of left / right contexts */
+      for(i=0;i<we->leftwordnum;i++) {
+	swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
+      }
+      for(i=0;i<we->rightwordnum;i++) {
+	swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
+      }
+      /* keep the max score */
+      if (wg->fscore_head < we->fscore_head) {
+	wg->headphone = we->headphone;
+	wg->tailphone = we->tailphone;
+	wg->fscore_head = we->fscore_head;
+	wg->fscore_tail = we->fscore_tail;
+	wg->gscore_head = we->gscore_head;
+	wg->gscore_tail = we->gscore_tail;
+	wg->lscore_tmp = we->lscore_tmp;
 #ifdef CM_SEARCH
-	  wg->cmscore = we->cmscore;
+	wg->cmscore = we->cmscore;
 #endif
-	  wg->amavg = we->amavg;
-	}
-	we->mark = TRUE;
+	wg->amavg = we->amavg;
       }
+      we->mark = TRUE;
     }
   }
+  free(member);
+  free(wlist);
   erased = wordgraph_exec_erase(rootp);
   if (verbose_flag) jlog("STAT: graphout: %d words merged, %d words left in lattice\n", erased, count-erased);
 
@@ -1795,7 +2298,10 @@ void
 wordgraph_compaction_neighbor(WordGraph **rootp, RecogProcess *r)
 {
   WordGraph *wg, *we;
-  int i, count, erased;
+  WordGraph **wlist;
+  int *bucket, *chain, *cand;
+  int i, n, m, k, t, num, cnum, size, range, count, erased;
+  unsigned int h;
 
   if (r->config->graph.graph_merge_neighbor_range <= 0) {
     if (verbose_flag) jlog("STAT: graphout: step 5: SKIP (merge the same words around)\n");
@@ -1804,42 +2310,73 @@ wordgraph_compaction_neighbor(WordGraph **rootp, RecogProcess *r)
 
   if (verbose_flag) jlog("STAT: graphout: step 5: merge same words around, with %d frame margin\n", r->config->graph.graph_merge_neighbor_range);
 
-  count = 0;
-  for(wg=*rootp;wg;wg=wg->next) {
-    count++;
+  range = r->config->graph.graph_merge_neighbor_range;
+  wlist = wordgraph_unmarked_list(*rootp, &count, &num);
+
+  /* hash words by word ID and begin frame, each chain in list order */
+  for(size = 1; size < num * 2; size <<= 1);
+  bucket = (int *)mymalloc(sizeof(int) * size);
+  chain = (int *)mymalloc(sizeof(int) * (num + 1));
+  cand = (int *)mymalloc(sizeof(int) * (num + 1));
+  for(i=0;i<size;i++) bucket[i] = -1;
+  for(n=num-1;n>=0;n--) {
+    h = graph_hashval(wlist[n]->wid, wlist[n]->lefttime, 0) & (size - 1);
+    chain[n] = bucket[h];
+    bucket[h] = n;
+  }
+
+  for(n=0;n<num;n++) {
+    wg = wlist[n];
     if (wg->mark == TRUE) continue;
-    for(we=wg->next;we;we=we->next) {
-      if (we->mark == TRUE) continue;
-      if (wg->wid == we->wid &&
-	  abs(wg->lefttime - we->lefttime) <= r->config->graph.graph_merge_neighbor_range &&
-	  abs(wg->righttime - we->righttime) <= r->config->graph.graph_merge_neighbor_range) {
-	/* merge contexts */
-	merge_contexts(wg, we);
-	/* swap contexts of left / right contexts */
-	for(i=0;i<we->leftwordnum;i++) {
-	  swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
-	}
-	for(i=0;i<we->rightwordnum;i++) {
-	  swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
+    /* gather same words around, which follows in list */
+    cnum = 0;
+    for(t=wg->lefttime-range;t<=wg->lefttime+range;t++) {
+      h = graph_hashval(wg->wid, t, 0) & (size - 1);
+      for(m=bucket[h];m!=-1;m=chain[m]) {
+	if (m <= n) continue;
+	we = wlist[m];
+	if (we->mark == TRUE) continue;
+	if (wg->wid == we->wid &&
+	    we->lefttime == t &&
+	    abs(wg->righttime - we->righttime) <= range) {
+	  cand[cnum++] = m;
 	}
-	/* keep the max score */
-	if (wg->fscore_head < we->fscore_head) {
-	  wg->headphone = we->headphone;
-	  wg->tailphone = we->tailphone;
-	  wg->fscore_head = we->fscore_head;
-	  wg->fscore_tail = we->fscore_tail;
-	  wg->gscore_head = we->gscore_head;
-	  wg->gscore_tail = we->gscore_tail;
-	  wg->lscore_tmp = we->lscore_tmp;
+      }
+    }
+    /* merge them in list order */
+    if (cnum > 1) qsort(cand, cnum, sizeof(int), (int (*)(const void *, const void *))compare_index);
+    for(k=0;k<cnum;k++) {
+      we = wlist[cand[k]];
+      /* merge contexts */
+      merge_contexts(wg, we);
+      /* swap contexts of left / right contexts */
+      for(i=0;i<we->leftwordnum;i++) {
+	swap_rightword(we->leftword[i], we, wg, we->left_lscore[i]);
+      }
+      for(i=0;i<we->rightwordnum;i++) {
+	swap_leftword(we->rightword[i], we, wg, we->right_lscore[i]);
+      }
+      /* keep the max score */
+      if (wg->fscore_head < we->fscore_head) {
+	wg->headphone = we->headphone;
+	wg->tailphone = we->tailphone;
+	wg->fscore_head = we->fscore_head;
+	wg->fscore_tail = we->fscore_tail;
+	wg->gscore_head = we->gscore_head;
+	wg->gscore_tail = we->gscore_tail;
+	wg->lscore_tmp = we->lscore_tmp;
 #ifdef CM_SEARCH
-	  wg->cmscore = we->cmscore;
+	wg->cmscore = we->cmscore;
 #endif
-	  wg->amavg = we->amavg;
-	}
-	we->mark = TRUE;
+	wg->amavg = we->amavg;
       }
+      we->mark = TRUE;
     }
   }
+  free(cand);
+  free(chain);
+  free(bucket);
+  free(wlist);
   erased = wordgraph_exec_erase(rootp);
   if (verbose_flag) jlog("STAT: graphout: %d words merged, %d words left in lattice\n", erased, count-erased);
 
@@ -1926,11 +2463,86 @@ wordgraph_assign(WORD_ID wid, WORD_ID wid_left, WORD_ID wid_right, int leftframe
   }
 
   /* generate a new graph word hypothesis */
-  newarc = wordgraph_new(wid, head, tail, leftframe, rightframe, fscore_head, fscore_tail, gscore_head, gscore_tail, lscore, cm);
+  newarc = wordgraph_new(wid, head, tail, leftframe, rightframe, fscore_head, fscore_tail, gscore_head, gscore_tail, lscore, cm, r);
   //jlog("DEBUG:     [%d..%d] %d\n", leftframe, rightframe, wid);
   return newarc;
 }
 
+#ifdef GRAPHOUT_DYNAMIC
+/** 
+ * <JA>
+ * 確定済みグラフ単語のハッシュ表を倍に拡張する. 同じバケツ内の順序は
+ * 保存される. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * </JA>
+ * <EN>
+ * Double the hash table of registered graph words.  The order of words
+ * in a bucket will be kept.
+ * 
+ * @param r [i/o] recognition process instance
+ * </EN>
+ */
+static void
+wordgraph_hash_expand(RecogProcess *r)
+{
+  WordGraph **old, **tail;
+  WordGraph *wg, *wnext;
+  int oldsize, i;
+  unsigned int h;
+
+  old = r->graph_hash;
+  oldsize = r->graph_hash_mask + 1;
+  r->graph_hash_mask = oldsize * 2 - 1;
+  r->graph_hash = (WordGraph **)mymalloc(sizeof(WordGraph *) * oldsize * 2);
+  tail = (WordGraph **)mymalloc(sizeof(WordGraph *) * oldsize * 2);
+  memset(r->graph_hash, 0, sizeof(WordGraph *) * oldsize * 2);
+  for(i=0;i<oldsize;i++) {
+    for(wg=old[i];wg;wg=wnext) {
+      wnext = wg->hashnext;
+      wg->hashnext = NULL;
+      h = graph_hashval(wg->wid, wg->lefttime, wg->righttime) & r->graph_hash_mask;
+      if (r->graph_hash[h] == NULL) {
+	r->graph_hash[h] = wg;
+      } else {
+	tail[h]->hashnext = wg;
+      }
+      tail[h] = wg;
+    }
+  }
+  free(tail);
+  free(old);
+}
+
+/** 
+ * <JA>
+ * 確定したグラフ単語をハッシュ表に登録する. 同じバケツ内では
+ * 単語グラフのリストと同じく新しいものが先に来る. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * @param wg [in] 確定したグラフ単語
+ * </JA>
+ * <EN>
+ * Register a saved graph word to the hash table.  In a bucket, newer
+ * words come first as in the list of word graph.
+ * 
+ * @param r [i/o] recognition process instance
+ * @param wg [in] saved graph word
+ * </EN>
+ */
+static void
+wordgraph_hash_add(RecogProcess *r, WordGraph *wg)
+{
+  unsigned int h;
+
+  if (r->graph_hash_num >= r->graph_hash_mask) wordgraph_hash_expand(r);
+  h = graph_hashval(wg->wid, wg->lefttime, wg->righttime) & r->graph_hash_mask;
+  wg->hashnext = r->graph_hash[h];
+  r->graph_hash[h] = wg;
+  r->graph_hash_num++;
+}
+#endif /* GRAPHOUT_DYNAMIC */
+
 /** 
  * <JA>
  * グラフ単語候補を単語グラフの一部として確定する. 確定されたグラフ単語には
@@ -1960,6 +2572,9 @@ wordgraph_save(WordGraph *wg, WordGraph *right, WordGraph **root)
     wg->next = *root;
     *root = wg;
     wg->saved = TRUE;
+#ifdef GRAPHOUT_DYNAMIC
+    wordgraph_hash_add(wg->region, wg);
+#endif
     wordgraph_add_leftword(right, wg, wg->lscore_tmp);
     wordgraph_add_rightword(wg, right, wg->lscore_tmp);
   }
@@ -2043,7 +2658,8 @@ wordgraph_check_merge(WordGraph *now, WordGraph **root, WORD_ID next_wid, boolea
   }
 #endif
 
-  for(wg=*root;wg;wg=wg->next) {
+  /* look up the hash, which holds the same words as *root in the same order */
+  for(wg=now->region->graph_hash[graph_hashval(now->wid, now->lefttime, now->righttime) & now->region->graph_hash_mask];wg;wg=wg->hashnext) {
     if (wg == now) continue;
 #ifdef GRAPHOUT_DYNAMIC
     /* skip already merged word */
@@ -2335,72 +2951,82 @@ wordgraph_check_coherence(WordGraph *rootp, RecogProcess *r)
 /* lattice-based posterior probability computation by forward-backward
    algorithm */
 /** 
- * <EN>
- * qsort callback function to order words from right to left.
- * </EN>
  * <JA>
- * 単語を右から左へ並べるための qsort コールバック関数
+ * 常用対数で表現された確率の総和を計算する. 
  * </JA>
- * 
- * @param x [in] 1st element
- * @param y [in] 2nd element
- * 
- * @return value required by qsort
- * 
- */
-static int
-compare_forward(WordGraph **x, WordGraph **y)
-{
-  if ((*x)->righttime < (*y)->righttime) return 1;
-  else if ((*x)->righttime > (*y)->righttime) return -1;
-  else return 0;
-}
-
-/** 
  * <EN>
- * qsort callback function to order words from left to right.
+ * Compute sum of probabilities in log10 form.
  * </EN>
- * <JA>
- * 単語を左から右へ並べるための qsort コールバック関数
- * </JA>
  * 
- * @param x [in] 1st element
- * @param y [in] 2nd element
+ * @param v [in] list of values
+ * @param n [in] number of values in @a v (> 0)
  * 
- * @return value required by qsort
+ * @return value of log10(10^v[0] + ... + 10^v[n-1])
  * 
  */
-static int
-compare_backward(WordGraph **x, WordGraph **y)
+static LOGPROB
+logsum10(double *v, int n)
 {
-  if ((*x)->lefttime < (*y)->lefttime) return -1;
-  else if ((*x)->lefttime > (*y)->lefttime) return 1;
-  else return 0;
+  double m, sum;
+  int i;
+
+  m = v[0];
+  for(i=1;i<n;i++) if (m < v[i]) m = v[i];
+  sum = 0.0;
+  for(i=0;i<n;i++) sum += exp((v[i] - m) * LOG_TEN);
+  return(m + log(sum) * INV_LOG_TEN);
 }
 
 /** 
- * <EN>
- * 常用対数で表現されている確率の和を計算する. 
- * </EN>
  * <JA>
- * compute addition of two probabilities in log10 form.
+ * 単語間の接続を，接続先ごとにまとめた配列に変換する. 
+ * 端のフレーム @a edge に達している単語からの接続は除かれる. 
  * </JA>
+ * <EN>
+ * Convert links between words to arrays grouped by their destination.
+ * Links from words that already reach the edge frame @a edge are skipped.
+ * </EN>
  * 
- * @param x [in] first value
- * @param y [in] second value
- * 
- * @return value of log(10^x + 10^y)
+ * @param wlist [in] list of graph words indexed by ID
+ * @param count [in] number of graph words
+ * @param left [in] TRUE to gather links from right words to left ones, FALSE for the reverse
+ * @param edge [in] edge frame: left time for @a left = TRUE, right time for FALSE
+ * @param cm_alpha [in] scaling value for LM scores
+ * @param bgn [out] index of first link for each destination, length @a count + 1
+ * @param src [out] source word ID of each link
+ * @param lscore [out] scaled LM score of each link
  * 
  */
-static LOGPROB 
-addlog10(LOGPROB x, LOGPROB y)
+static void
+graph_gather_links(WordGraph **wlist, int count, boolean left, int edge, LOGPROB cm_alpha, int *bgn, int *src, LOGPROB *lscore)
 {
-  if (x < y) {
-    //return(y + log10(1 + pow(10, x-y)));
-    return(y + log(1 + pow(10, x-y)) * INV_LOG_TEN);
-  } else {
-    return(x + log(1 + pow(10, y-x)) * INV_LOG_TEN);
+  WordGraph *wg;
+  int i, j, d, num;
+
+  for(i=0;i<=count;i++) bgn[i] = 0;
+  for(i=0;i<count;i++) {
+    wg = wlist[i];
+    if ((left ? wg->lefttime : wg->righttime) == edge) continue;
+    num = left ? wg->leftwordnum : wg->rightwordnum;
+    for(j=0;j<num;j++) {
+      d = left ? wg->leftword[j]->id : wg->rightword[j]->id;
+      bgn[d + 1]++;
+    }
+  }
+  for(i=0;i<count;i++) bgn[i + 1] += bgn[i];
+  for(i=0;i<count;i++) {
+    wg = wlist[i];
+    if ((left ? wg->lefttime : wg->righttime) == edge) continue;
+    num = left ? wg->leftwordnum : wg->rightwordnum;
+    for(j=0;j<num;j++) {
+      d = left ? wg->leftword[j]->id : wg->rightword[j]->id;
+      src[bgn[d]] = i;
+      lscore[bgn[d]] = (left ? wg->left_lscore[j] : wg->right_lscore[j]) * cm_alpha;
+      bgn[d]++;
+    }
   }
+  for(i=count;i>0;i--) bgn[i] = bgn[i - 1];
+  bgn[0] = 0;
 }
 
 /**
@@ -2409,13 +3035,16 @@ addlog10(LOGPROB x, LOGPROB y)
  * 信頼度を計算する. 計算された値は各グラフ単語の graph_cm に格納される. 
  * 事後確率の計算では，探索中の信頼度計算と同じ
  * α値（r->config->annotate.cm_alpha）が用いられる. 
+ * グラフは wordgraph_sort_and_annotate_id() により開始時間順に
+ * 並べられ，ID が振られている必要がある. 
  * </JA>
  * <EN>
  * Compute graph-based confidence scores by forward-backward parsing on
  * the generated lattice.  The computed scores are stored in graph_cm of
  * each graph words.  The same alpha value of search-time confidence scoring
  * (r->config->annotate.cm_alpha) will be used to compute the posterior
- * probabilities.
+ * probabilities.  The graph should be sorted by left time and annotated
+ * with ID by wordgraph_sort_and_annotate_id().
  * </EN>
  * 
  * @param root [in] root graph node
@@ -2429,111 +3058,145 @@ addlog10(LOGPROB x, LOGPROB y)
 void
 graph_forward_backward(WordGraph *root, RecogProcess *r)
 {
-  WordGraph *wg, *left, *right;
-  int i, j;
-  LOGPROB s;
+  WordGraph *wg;
+  int i, j, k;
   LOGPROB sum1, sum2;
-  int count;
+  int count, linknum, maxtime;
   WordGraph **wlist;
   LOGPROB cm_alpha;
+  LOGPROB *ac;			/* scaled acoustic score of each word */
+  LOGPROB *fscore, *bscore;	/* forward and backward score of each word */
+  int *order;			/* word IDs in descending order of right time */
+  int *lbgn, *lsrc, *rbgn, *rsrc; /* links gathered by destination */
+  LOGPROB *llscore, *rlscore;
+  double *v;			/* work area for summation */
+  int vnum;
 
   cm_alpha = r->config->annotate.cm_alpha;
 
-  /* make a wordgraph list for frame-sorted access */
+  /* the list is already sorted by left time, and the IDs are the order */
   count = 0;
-  for(wg=root;wg;wg=wg->next) count++;
+  maxtime = 0;
+  for(wg=root;wg;wg=wg->next) {
+    if (wg->id != count) {
+      j_internal_error("graph_forward_backward: graph words are not sorted\n");
+    }
+    count++;
+    if (maxtime < wg->righttime) maxtime = wg->righttime;
+  }
   if (count == 0) return;
   wlist = (WordGraph **)mymalloc(sizeof(WordGraph *) * count);
+  ac = (LOGPROB *)mymalloc(sizeof(LOGPROB) * count);
+  linknum = 0;
   i = 0;
   for(wg=root;wg;wg=wg->next) {
-    wlist[i++] = wg;
+    wlist[i] = wg;
+    ac[i] = wg->amavg * (wg->righttime - wg->lefttime + 1) * cm_alpha;
+    linknum += wg->leftwordnum + wg->rightwordnum;
+    i++;
   }
-
-  /* sort wordgraph list downward by the right frame*/
-  qsort(wlist, count, sizeof(WordGraph *), (int (*)(const void *, const void *))compare_forward);
-  /* clear forward scores */
-  for(wg=root;wg;wg=wg->next) {
-    wg->forward_score = LOG_ZERO;
+  fscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * count);
+  bscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * count);
+  order = (int *)mymalloc(sizeof(int) * (count + maxtime + 2));
+  lbgn = (int *)mymalloc(sizeof(int) * (count + 1));
+  rbgn = (int *)mymalloc(sizeof(int) * (count + 1));
+  lsrc = (int *)mymalloc(sizeof(int) * (linknum + 1));
+  rsrc = (int *)mymalloc(sizeof(int) * (linknum + 1));
+  llscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (linknum + 1));
+  rlscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * (linknum + 1));
+  v = (double *)mymalloc(sizeof(double) * (linknum + count + 1));
+
+  /* gather links by destination, so that the scores of each word are
+     summed at once from its sources */
+  graph_gather_links(wlist, count, TRUE, 0, cm_alpha, lbgn, lsrc, llscore);
+  graph_gather_links(wlist, count, FALSE, r->peseqlen - 1, cm_alpha, rbgn, rsrc, rlscore);
+
+  /* order words downward by the right frame (counting sort) */
+  {
+    int *cnt = &(order[count]);	/* maxtime + 2 */
+    for(i=0;i<=maxtime+1;i++) cnt[i] = 0;
+    for(i=0;i<count;i++) cnt[maxtime - wlist[i]->righttime + 1]++;
+    for(i=0;i<=maxtime;i++) cnt[i + 1] += cnt[i];
+    for(i=0;i<count;i++) {
+      k = cnt[maxtime - wlist[i]->righttime]++;
+      order[k] = i;
+    }
   }
+
   /* forward procedure */
-  sum1 = LOG_ZERO;
-  for(i=0;i<count;i++) {
+  vnum = 0;
+  for(k=0;k<count;k++) {
+    i = order[k];
     wg = wlist[i];
     if (wg->righttime == r->peseqlen - 1) {
       /* set initial score */
-      wg->forward_score = 0.0;
-      //wg->forward_score += wg->lscore * cm_alpha;
+      fscore[i] = 0.0;
     } else {
       /* (just a bogus check...) */
-      if (wg->forward_score == LOG_ZERO) {
+      if (lbgn[i] == lbgn[i + 1]) {
 	wordgraph_dump(stdout, root, r->lm->winfo);
 	put_wordgraph(stdout, wg, r->lm->winfo);
 	j_internal_error("NO CONTEXT?\n");
       }
-    }
-    /* propagate scores */
-    s = wg->amavg * (wg->righttime - wg->lefttime + 1);
-    s *= cm_alpha;
-    s += wg->forward_score;
-    if (wg->lefttime == 0) {
-      /* add for sum */
-      sum1 = addlog10(sum1, s);
-    } else {
-      /* propagate to left words */
-      for(j=0;j<wg->leftwordnum;j++) {
-	left = wg->leftword[j];
-	left->forward_score = addlog10(left->forward_score, s + wg->left_lscore[j] * cm_alpha);
+      /* sum up scores propagated from right words */
+      for(j=lbgn[i];j<lbgn[i + 1];j++) {
+	v[j - lbgn[i]] = fscore[lsrc[j]] + ac[lsrc[j]] + llscore[j];
       }
+      fscore[i] = logsum10(v, lbgn[i + 1] - lbgn[i]);
     }
+    wg->forward_score = fscore[i];
   }
-
-  /* sort wordgraph list downward by the right score */
-  qsort(wlist, count, sizeof(WordGraph *), (int (*)(const void *, const void *))compare_backward);
-  /* clear backward scores */
-  for(wg=root;wg;wg=wg->next) {
-    wg->backward_score = LOG_ZERO;
+  /* add for sum */
+  for(i=0;i<count;i++) {
+    if (wlist[i]->lefttime == 0) v[vnum++] = fscore[i] + ac[i];
   }
-  /* backward procedure */
-  sum2 = LOG_ZERO;
+  sum1 = (vnum > 0) ? logsum10(v, vnum) : LOG_ZERO;
+
+  /* backward procedure: the list is already in upward order by the left frame */
+  vnum = 0;
   for(i=0;i<count;i++) {
     wg = wlist[i];
     if (wg->lefttime == 0) {
       /* set initial score */
-      wg->backward_score = 0.0;
+      bscore[i] = 0.0;
     } else {
       /* (just a bogus check...) */
-      if (wg->backward_score == LOG_ZERO) {
+      if (rbgn[i] == rbgn[i + 1]) {
 	put_wordgraph(stdout, wg, r->lm->winfo);
 	j_internal_error("NO CONTEXT?\n");
       }
-    }
-    /* propagate scores */
-    s = wg->amavg * (wg->righttime - wg->lefttime + 1);
-    s *= cm_alpha;
-    s += wg->backward_score;
-    if (wg->righttime == r->peseqlen - 1) {
-      /* add for sum */
-      //sum2 = addlog10(sum2, s + wg->lscore * cm_alpha);
-      sum2 = addlog10(sum2, s);
-    } else {
-      for(j=0;j<wg->rightwordnum;j++) {
-	right = wg->rightword[j];
-	right->backward_score = addlog10(right->backward_score, s + wg->right_lscore[j] * cm_alpha);
+      /* sum up scores propagated from left words */
+      for(j=rbgn[i];j<rbgn[i + 1];j++) {
+	v[j - rbgn[i]] = bscore[rsrc[j]] + ac[rsrc[j]] + rlscore[j];
       }
+      bscore[i] = logsum10(v, rbgn[i + 1] - rbgn[i]);
     }
+    wg->backward_score = bscore[i];
   }
+  /* add for sum */
+  for(i=0;i<count;i++) {
+    if (wlist[i]->righttime == r->peseqlen - 1) v[vnum++] = bscore[i] + ac[i];
+  }
+  sum2 = (vnum > 0) ? logsum10(v, vnum) : LOG_ZERO;
 
   if (verbose_flag) jlog("STAT: graph_cm: forward score = %f, backward score = %f\n", sum1, sum2);
 
   /* compute CM */
-  for(wg=root;wg;wg=wg->next) {
-    s = wg->amavg * (wg->righttime - wg->lefttime + 1);
-    s *= cm_alpha;
-    s = wg->backward_score + s + wg->forward_score;
-    wg->graph_cm = pow(10, s - sum1);
-    //wg->graph_cm = s - sum1;
+  for(i=0;i<count;i++) {
+    wlist[i]->graph_cm = pow(10, bscore[i] + ac[i] + fscore[i] - sum1);
   }
 
+  free(v);
+  free(rlscore);
+  free(llscore);
+  free(rsrc);
+  free(lsrc);
+  free(rbgn);
+  free(lbgn);
+  free(order);
+  free(bscore);
+  free(fscore);
+  free(ac);
   free(wlist);
 
 }
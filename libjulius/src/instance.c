@@ -66,11 +66,17 @@ j_mfcccalc_new(JCONF_AM *amconf)
       jlog("ERROR: j_mfcccalc_new: failed to initialize feature computation\n");
       return NULL;
     }
+    mfcc->frontend.thread_num = amconf->frontend.thread_num;
+    if (WMP_work_set_threads(mfcc->wrk, mfcc->para, mfcc->frontend.thread_num) == FALSE) {
+      jlog("ERROR: j_mfcccalc_new: failed to initialize threads for feature computation\n");
+      return NULL;
+    }
     mfcc->cmn.load_filename = amconf->analysis.cmnload_filename;
     mfcc->cmn.map_cmn = amconf->analysis.map_cmn;
     mfcc->cmn.update = amconf->analysis.cmn_update;
     mfcc->cmn.save_filename = amconf->analysis.cmnsave_filename;
     mfcc->cmn.map_weight = amconf->analysis.cmn_map_weight;
+    mfcc->cmn.window = amconf->analysis.cmn_window;
     mfcc->cmn.static_cvn_only = amconf->analysis.cmn_static_cvn_only;
     mfcc->frontend.ss_alpha = amconf->frontend.ss_alpha;
     mfcc->frontend.ss_floor = amconf->frontend.ss_floor;
@@ -210,6 +216,7 @@ j_process_lm_new(Recog *recog, JCONF_LM *lmconf)
   new->lmvar = lmconf->lmvar;
   new->gram_maxid = 0;
   new->global_modified = FALSE;
+  new->global_kept_wnum = 0;
 
   /* append to last */
   new->next = NULL;
@@ -320,6 +327,10 @@ j_recogprocess_free(RecogProcess *process)
   if (process->backtrellis) bt_free(process->backtrellis);
   /* free pass1 work area */
   fsbeam_free(&(process->pass1));
+  /* free graph words and graph output work area */
+  wordgraph_work_free(process);
+  /* free work area for 1st pass lattice */
+  pass1_lattice_free(process);
   free(process);
 }
 
@@ -207,11 +207,16 @@ static boolean
 adin_setup_all(ADIn *adin, Jconf *jconf, void *arg)
 {
 
+  adin->rs = NULL;
   if (jconf->input.use_ds48to16) {
     if (jconf->input.use_ds48to16 && jconf->input.sfreq != 16000) {
       jlog("ERROR: m_adin: in 48kHz input mode, target sampling rate should be 16k!\n");
       return FALSE;
     }
+    if (jconf->input.input_freq != 0 && jconf->input.input_freq != 48000) {
+      jlog("ERROR: m_adin: \"-48\" and \"-inrate\" cannot be used together\n");
+      return FALSE;
+    }
     /* setup for 1/3 down sampling */
     adin->ds = ds48to16_new();
     adin->down_sample = TRUE;
@@ -220,6 +225,19 @@ adin_setup_all(ADIn *adin, Jconf *jconf, void *arg)
       jlog("ERROR: m_adin: failed to ready input device\n");
       return FALSE;
     }
+  } else if (jconf->input.input_freq != 0 && jconf->input.input_freq != jconf->input.sfreq) {
+    adin->ds = NULL;
+    adin->down_sample = FALSE;
+    /* setup for sampling rate conversion */
+    if ((adin->rs = resample_new(jconf->input.input_freq, jconf->input.sfreq)) == NULL) {
+      jlog("ERROR: m_adin: failed to set up resampler\n");
+      return FALSE;
+    }
+    /* set device sampling rate to the input rate */
+    if (adin_standby(adin, jconf->input.input_freq, arg) == FALSE) { /* fail */
+      jlog("ERROR: m_adin: failed to ready input device\n");
+      return FALSE;
+    }
   } else {
     adin->ds = NULL;
     adin->down_sample = FALSE;
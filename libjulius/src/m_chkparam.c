@@ -133,6 +133,11 @@ j_jconf_finalize(Jconf *jconf)
   if (jconf->reject.gmm_filename) {
     jconf->decodeopt.segment = TRUE;
   }
+  /* GMM scores should be exact for rejection */
+  if (jconf->detect.gmm_vad_prune && jconf->reject.gmm_reject_cmn_string != NULL) {
+    jlog("WARNING: m_chkparam: \"-gmmvadprune\" not available with \"-gmmreject\", disabled\n");
+    jconf->detect.gmm_vad_prune = FALSE;
+  }
 #endif
 
   for(lm = jconf->lm_root; lm; lm = lm->next) {
@@ -274,6 +279,11 @@ j_jconf_finalize(Jconf *jconf)
       s->force_ccd_handling = TRUE;
       /* force 1pass ("-1pass") */
       s->compute_only_1pass = TRUE;
+      /* no word lattice on word recognition */
+      if (s->graph.pass1lattice) {
+	jlog("WARNING: m_chkparam: \"-pass1lattice\" not available on isolated word recognition, ignored\n");
+	s->graph.pass1lattice = FALSE;
+      }
     }
 
     /* set default iwcd1 method from lm */
@@ -295,6 +305,16 @@ j_jconf_finalize(Jconf *jconf)
   for(s=jconf->search_root;s;s=s->next) {
     lm = s->lmconf;
     am = s->amconf;
+    if (lm->wchmm_threads < 1) {
+      jlog("WARNING: m_chkparam: invalid \"-wchmmthreads\" value: %d, set to 1\n", lm->wchmm_threads);
+      lm->wchmm_threads = 1;
+    }
+#ifndef _OPENMP
+    if (lm->wchmm_threads > 1) {
+      jlog("WARNING: m_chkparam: compiled without OpenMP, \"-wchmmthreads\" ignored\n");
+      lm->wchmm_threads = 1;
+    }
+#endif
     if (lm->lmtype != LM_PROB) {
       /* in case not a probabilistic model */
       if (s->lmp.lmp_specified) {
@@ -328,6 +348,9 @@ j_jconf_finalize(Jconf *jconf)
 	jlog("WARNING: m_chkparam: \"-sepnum\" only for N-gram, ignored\n");
       }
 #endif
+      if (lm->wchmm_cache_file != NULL) {
+	jlog("WARNING: m_chkparam: \"-wchmmcache\" only for N-gram, ignored\n");
+      }
     }  
     if (lm->lmtype != LM_DFA) {
       /* in case not a deterministic model */
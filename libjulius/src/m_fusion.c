@@ -881,11 +881,13 @@ mfcc_config_is_same(JCONF_AM *amconf, MFCCCalc *mfcc)
 	if (amconf->analysis.cmn_update == mfcc->cmn.update
 	    && amconf->analysis.map_cmn == mfcc->cmn.map_cmn
 	    && amconf->analysis.cmn_static_cvn_only == mfcc->cmn.static_cvn_only
-	    && amconf->analysis.cmn_map_weight == mfcc->cmn.map_weight) {
+	    && amconf->analysis.cmn_map_weight == mfcc->cmn.map_weight
+	    && amconf->analysis.cmn_window == mfcc->cmn.window) {
 	  if (amconf->frontend.ss_alpha == mfcc->frontend.ss_alpha
 	      && amconf->frontend.ss_floor == mfcc->frontend.ss_floor
 	      && amconf->frontend.sscalc == mfcc->frontend.sscalc
-	      && amconf->frontend.sscalc_len == mfcc->frontend.sscalc_len) {
+	      && amconf->frontend.sscalc_len == mfcc->frontend.sscalc_len
+	      && amconf->frontend.thread_num == mfcc->frontend.thread_num) {
 	    s1 = amconf->frontend.ssload_filename;
 	    s2 = mfcc->frontend.ssload_filename;
 	    if (s1 == s2 || (s1 && s2 && strmatch(s1, s2))) {
@@ -1201,11 +1203,17 @@ j_launch_recognition_instance(Recog *recog, JCONF_SEARCH *sconf)
 	  return FALSE;
 	}
       }
-    } else {
+    } else if (p->lm->config->wchmm_cache_file == NULL
+	       || wchmm_cache_load(p->wchmm, p->lm->config, p->lm->config->wchmm_cache_file) == FALSE) {
       if (build_wchmm2(p->wchmm, p->lm->config) == FALSE) {
 	jlog("ERROR: m_fusion: error in bulding wchmm\n");
 	return FALSE;
       }
+      if (p->lm->config->wchmm_cache_file != NULL) {
+	if (wchmm_cache_save(p->wchmm, p->lm->config, p->lm->config->wchmm_cache_file) == FALSE) {
+	  jlog("WARNING: m_fusion: failed to save lexicon tree cache, ignored\n");
+	}
+      }
     }
 
     /* 起動時 -check でチェックモードへ */
@@ -1441,6 +1449,11 @@ j_final_fusion(Recog *recog)
 	    jlog("WARNING: m_fusion: CMN load file specified but AM not require it, ignored\n");
 	  }
 	}
+	if (mfcc->cmn.window > 0 && (mfcc->para->cmn || mfcc->para->cvn)) {
+	  /* sliding window CMN/CVN, the same as on-line processing */
+	  if (mfcc->cmn.wrk == NULL) mfcc->cmn.wrk = CMN_realtime_new(mfcc->para, mfcc->cmn.map_weight, mfcc->cmn.map_cmn);
+	  CMN_realtime_set_window(mfcc->cmn.wrk, mfcc->cmn.window);
+	}
       }
     }
   }
@@ -161,12 +161,23 @@ print_mfcc_info(FILE *fp, MFCCCalc *mfcc, Jconf *jconf)
     } else {
       jlog("off\n");
     }
+    if (jconf->decodeopt.realtime_flag == FALSE) {
+      jlog("      extraction threads = %d\n", mfcc->wrk->thread_num);
+    }
   }
   jlog("\n");
   jlog(" cep. mean normalization = ");
   if (mfcc->para->cmn) {
     jlog("yes, ");
-    if (jconf->decodeopt.realtime_flag) {
+    if (mfcc->cmn.window > 0) {
+      jlog("sliding window of %d frames\n", mfcc->cmn.window);
+      jlog("  initial mean from file = ");
+      if (mfcc->cmn.loaded) {
+	jlog("%s\n", mfcc->cmn.load_filename);
+      } else {
+	jlog("N/A\n");
+      }
+    } else if (jconf->decodeopt.realtime_flag) {
       if (mfcc->cmn.update == TRUE) {
 	jlog("real-time MAP-CMN, updating initial mean with last %d input frames\n", CPMAX);
 	jlog("  initial mean from file = ");
@@ -201,7 +212,9 @@ print_mfcc_info(FILE *fp, MFCCCalc *mfcc, Jconf *jconf)
   jlog(" cep. var. normalization = ");
   if (mfcc->para->cvn) {
     jlog("yes, ");
-    if (mfcc->cmn.loaded) {
+    if (mfcc->cmn.window > 0) {
+      jlog("sliding window of %d frames\n", mfcc->cmn.window);
+    } else if (mfcc->cmn.loaded) {
       jlog("with a static variance\n");
       jlog("static variance from file = %s\n", mfcc->cmn.load_filename);
     } else {
@@ -324,6 +337,7 @@ print_engine_info(Recog *recog)
     jlog("       backstep on trigger = %d frames\n", jconf->detect.gmm_margin);
     jlog("    up-trigger thres score = %.1f\n", jconf->detect.gmm_uptrigger_thres);
     jlog("  down-trigger thres score = %.1f\n", jconf->detect.gmm_downtrigger_thres);
+    jlog(" skip non-competitive GMMs = %s\n", jconf->detect.gmm_vad_prune ? "yes" : "no");
 #endif
     jlog("\n GMM");
     print_hmmdef_info(fp, recog->gmm);
@@ -706,6 +720,9 @@ print_engine_info(Recog *recog)
     if (r->config->annotate.align_result_state_flag) {
       jlog("\t output state alignments\n");
     }
+    if (r->config->annotate.align_beam > 0.0) {
+      jlog("\t alignment beam width = %.1f\n", r->config->annotate.align_beam);
+    }
     if (r->lmtype == LM_DFA && r->lmvar == LM_DFA_GRAMMAR) {
       if (r->config->pass2.looktrellis_flag) {
 	jlog("\t only words in backtrellis will be expanded in 2nd pass\n");
@@ -735,6 +752,9 @@ print_engine_info(Recog *recog)
     if (r->config->compute_only_1pass) {
       jlog("\tCompute only 1-pass\n");
     }
+    if (r->config->graph.pass1lattice) {
+      jlog("\tword lattice on 1st pass (beam = %.1f, max = %d words/frame, interval = %d msec)\n", r->config->graph.pass1lattice_beam, r->config->graph.pass1lattice_maxnum, r->config->graph.pass1lattice_interval);
+    }
     
     if (r->config->graph.enabled) {
       jlog("\n");
@@ -916,12 +936,16 @@ print_engine_info(Recog *recog)
     if (jconf->input.speech_input == SP_RAWFILE || jconf->input.speech_input == SP_STDIN || jconf->input.speech_input == SP_ADINNET) {
       if (jconf->input.use_ds48to16) {
 	jlog("\t          sampling freq. = assume 48000Hz, then down to %dHz\n", jconf->input.sfreq);
+      } else if (jconf->input.input_freq != 0 && jconf->input.input_freq != jconf->input.sfreq) {
+	jlog("\t          sampling freq. = assume %d Hz, then convert to %d Hz\n", jconf->input.input_freq, jconf->input.sfreq);
       } else {
 	jlog("\t          sampling freq. = %d Hz required\n", jconf->input.sfreq);
       }
     } else {
       if (jconf->input.use_ds48to16) {
 	jlog("\t          sampling freq. = 48000Hz, then down to %d Hz\n", jconf->input.sfreq);
+      } else if (jconf->input.input_freq != 0 && jconf->input.input_freq != jconf->input.sfreq) {
+	jlog("\t          sampling freq. = %d Hz, then convert to %d Hz\n", jconf->input.input_freq, jconf->input.sfreq);
       } else {
  	jlog("\t          sampling freq. = %d Hz\n", jconf->input.sfreq);
       }
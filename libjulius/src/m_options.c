@@ -558,6 +558,29 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       jconf->searchnow->graph.graphout_search_delay = FALSE;
       continue;
 #endif
+    } else if (strmatch(argv[i],"-pass1lattice")) { /* build lattice on the 1st pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      jconf->searchnow->graph.pass1lattice = TRUE;
+      continue;
+    } else if (strmatch(argv[i],"-nopass1lattice")) { /* disable it */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      jconf->searchnow->graph.pass1lattice = FALSE;
+      continue;
+    } else if (strmatch(argv[i],"-pass1latbeam")) { /* score beam for 1st pass lattice */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+      jconf->searchnow->graph.pass1lattice_beam = (LOGPROB)atof(tmparg);
+      continue;
+    } else if (strmatch(argv[i],"-pass1latmax")) { /* max words per frame for 1st pass lattice */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+      jconf->searchnow->graph.pass1lattice_maxnum = atoi(tmparg);
+      continue;
+    } else if (strmatch(argv[i],"-pass1latinterval")) { /* interval for partial 1st pass lattice */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+      jconf->searchnow->graph.pass1lattice_interval = atoi(tmparg);
+      continue;
     } else if (strmatch(argv[i],"-looktrellis")) { /* activate loopuprange */
       if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
       jconf->searchnow->pass2.looktrellis_flag = TRUE;
@@ -752,6 +775,11 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
       jconf->input.use_ds48to16 = TRUE;
       continue;
+    } else if (strmatch(argv[i],"-inrate")) { /* input sampling rate to be converted */
+      if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
+      GET_TMPARG;
+      jconf->input.input_freq = atoi(tmparg);
+      continue;
     } else if (strmatch(argv[i],"-version") || strmatch(argv[i], "--version") || strmatch(argv[i], "-setting") || strmatch(argv[i], "--setting")) { /* print version and exit */
       j_put_header(stderr);
       j_put_compile_defs(stderr);
@@ -792,6 +820,11 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
       jconf->searchnow->annotate.align_result_state_flag = TRUE;
       continue;
+    } else if (strmatch(argv[i],"-alignbeam")) { /* beam width for forced alignment */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+      jconf->searchnow->annotate.align_beam = atof(tmparg);
+      continue;
     } else if (strmatch(argv[i],"-output")) { /* output up to N candidate */
       if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
       GET_TMPARG;
@@ -968,6 +1001,17 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       i++;
 #endif
       continue;
+    } else if (strmatch(argv[i],"-wchmmcache")) { /* lexicon tree cache file */
+      if (!check_section(jconf, argv[i], JCONF_OPT_LM)) return FALSE; 
+      FREE_MEMORY(jconf->lmnow->wchmm_cache_file);
+      GET_TMPARG;
+      jconf->lmnow->wchmm_cache_file = filepath(tmparg, cwd);
+      continue;
+    } else if (strmatch(argv[i],"-wchmmthreads")) { /* number of threads to build lexicon tree */
+      if (!check_section(jconf, argv[i], JCONF_OPT_LM)) return FALSE; 
+      GET_TMPARG;
+      jconf->lmnow->wchmm_threads = atoi(tmparg);
+      continue;
 #ifdef USE_NETAUDIO
     } else if (strmatch(argv[i],"-NA")) { /* netautio device name */
       if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
@@ -1163,6 +1207,11 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       GET_TMPARG;
       jconf->amnow->analysis.cmn_map_weight = (float)atof(tmparg);
       continue;
+    } else if (strmatch(argv[i],"-cmnwindow")) { /* sliding window CMN/CVN */
+      if (!check_section(jconf, argv[i], JCONF_OPT_AM)) return FALSE; 
+      GET_TMPARG;
+      jconf->amnow->analysis.cmn_window = atoi(tmparg);
+      continue;
     } else if (strmatch(argv[i],"-sscalc")) { /* do spectral subtraction (SS) for raw file input */
       if (!check_section(jconf, argv[i], JCONF_OPT_AM)) return FALSE; 
       jconf->amnow->frontend.sscalc = TRUE;
@@ -1180,6 +1229,11 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       jconf->amnow->frontend.ssload_filename = filepath(tmparg, cwd);
       jconf->amnow->frontend.sscalc = FALSE;
       continue;
+    } else if (strmatch(argv[i],"-fethreads")) { /* number of threads for feature extraction of buffered input */
+      if (!check_section(jconf, argv[i], JCONF_OPT_AM)) return FALSE; 
+      GET_TMPARG;
+      jconf->amnow->frontend.thread_num = atoi(tmparg);
+      continue;
 #ifdef CONFIDENCE_MEASURE
     } else if (strmatch(argv[i],"-cmalpha")) { /* CM log score scaling factor */
       if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
@@ -1248,6 +1302,10 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       GET_TMPARG;
       jconf->detect.gmm_downtrigger_thres = atof(tmparg);
       continue;
+    } else if (strmatch(argv[i],"-gmmvadprune")) { /* skip non-competitive GMMs */
+      if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
+      jconf->detect.gmm_vad_prune = TRUE;
+      continue;
 #endif
     } else if (strmatch(argv[i],"-htkconf")) {
       if (!check_section(jconf, argv[i], JCONF_OPT_AM)) return FALSE; 
@@ -1554,6 +1612,7 @@ opt_release(Jconf *jconf)
     FREE_MEMORY(lm->tail_silname);
     FREE_MEMORY(lm->iwspentry);
     FREE_MEMORY(lm->dictfilename);
+    FREE_MEMORY(lm->wchmm_cache_file);
     multigram_remove_gramlist(lm);
   }
   for(s=jconf->search_root;s;s=s->next) {
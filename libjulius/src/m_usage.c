@@ -120,6 +120,7 @@ j_output_argument_help(FILE *fp)
 #endif
   fprintf(fp, "    [-adport portnum]   adinnet port number to listen         (%d)\n", jconf->input.adinnet_port);
   fprintf(fp, "    [-48]               enable 48kHz sampling with internal down sampler (OFF)\n");
+  fprintf(fp, "    [-inrate freq]      input sampling rate, converted to model rate (same)\n");
   fprintf(fp, "    [-zmean/-nozmean]   enable/disable DC offset removal      (OFF)\n");
   fprintf(fp, "    [-lvscale]          input level scaling factor (1.0: OFF) (%.1f)\n", jconf->preprocess.level_coef);
   fprintf(fp, "    [-nostrip]          disable stripping off zero samples\n");
@@ -154,6 +155,7 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    -gmmmargin frames   backstep margin on speech trigger     (%d)\n", jconf->detect.gmm_margin);
   fprintf(fp, "    -gmmup score        up-trigger threshold                  (%.1f)\n", jconf->detect.gmm_uptrigger_thres);
   fprintf(fp, "    -gmmdown score      down-trigger threshold                (%.1f)\n", jconf->detect.gmm_downtrigger_thres);
+  fprintf(fp, "    -gmmvadprune        skip non-competitive GMMs before trigger\n");
 #endif
 
   fprintf(fp, "\n On-the-fly Decoding: (default: on=mic/net off=files)\n");
@@ -204,6 +206,7 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-ssload filename]  load constant noise spectrum from file for SS\n");
   fprintf(fp, "    [-ssalpha value]    alpha coef. for SS                    (%f)\n", jconf->am_root->frontend.ss_alpha);
   fprintf(fp, "    [-ssfloor value]    spectral floor for SS                 (%f)\n", jconf->am_root->frontend.ss_floor);
+  fprintf(fp, "    [-fethreads num]    threads for feature extraction (file input) (%d)\n", jconf->am_root->frontend.thread_num);
   fprintf(fp, "    [-zmeanframe/-nozmeanframe] frame-wise DC removal like HTK(OFF)\n");
   fprintf(fp, "    [-usepower/-nousepower] use power in fbank analysis       (OFF)\n");
   fprintf(fp, "    [-cmnload file]     load initial CMN/CVN param from file on startup\n");
@@ -212,6 +215,7 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-cvnstatic]        use static CVN only (use with -cmnload)\n");
   fprintf(fp, "    [-cmnnoupdate]      not update initial param while recog. (use with -cmnload)\n");
   fprintf(fp, "    [-cmnmapweight]     weight value of initial cm for MAP-CMN (%6.2f)\n", jconf->am_root->analysis.cmn_map_weight);
+  fprintf(fp, "    [-cmnwindow frames] sliding-window CMN/CVN length, 0 to disable (%d)\n", jconf->am_root->analysis.cmn_window);
   fprintf(fp, "    [-cvn]              cepstral variance normalisation       (%s)\n", jconf->amnow->analysis.para.cvn ? "on" : "off");
   fprintf(fp, "    [-vtln alpha lowcut hicut] enable VTLN (1.0 to disable)   (%f)\n", jconf->am_root->analysis.para_default.vtln_alpha);
 
@@ -287,6 +291,8 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-forcedict]        ignore error entry and keep running\n");
   fprintf(fp, "    [-iwspword]         (n-gram) add short-pause word for inter-word CD sp\n");
   fprintf(fp, "    [-iwspentry entry]  (n-gram) word entry for \"-iwspword\" (%s)\n", IWSPENTRY_DEFAULT);
+  fprintf(fp, "    [-wchmmcache file]  (n-gram) load/save lexicon tree cache file\n");
+  fprintf(fp, "    [-wchmmthreads num] threads to build lexicon tree         (%d)\n", jconf->lm_root->wchmm_threads);
   fprintf(fp, "    [-adddict dictfile] (n-gram) load extra dictionary\n");
   fprintf(fp, "    [-addentry entry]   (n-gram) load extra word entry\n");
   
@@ -374,11 +380,17 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-graphsearchdelay] inhibit search termination until 1st sent. found\n");
   fprintf(fp, "    [-nographsearchdelay] disable it (default)\n");
 #endif
+  fprintf(fp, "    [-pass1lattice]     build word lattice incrementally on 1st pass\n");
+  fprintf(fp, "    [-nopass1lattice]   disable it (default)\n");
+  fprintf(fp, "    [-pass1latbeam width] score beam of 1st pass lattice      (%.1f)\n", jconf->search_root->graph.pass1lattice_beam);
+  fprintf(fp, "    [-pass1latmax num]  max. words per frame in 1st pass lattice (%d)\n", jconf->search_root->graph.pass1lattice_maxnum);
+  fprintf(fp, "    [-pass1latinterval msec] interval of partial lattice output (%d)\n", jconf->search_root->graph.pass1lattice_interval);
 
   fprintf(fp, "\n Forced Alignment:\n");
   fprintf(fp, "    [-walign]           optionally output word alignments\n");
   fprintf(fp, "    [-palign]           optionally output phoneme alignments\n");
   fprintf(fp, "    [-salign]           optionally output state alignments\n");
+  fprintf(fp, "    [-alignbeam width]  score beam of alignment (0.0: OFF)    (%.1f)\n", jconf->searchnow->annotate.align_beam);
 
 #ifdef USE_MBR
   fprintf(fp, "\n Minimum Bayes Risk Decoding:\n");
@@ -26,6 +26,29 @@
 
 #ifdef USE_MBR
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/// Bit vector for bit-parallel Levenstein distance
+typedef unsigned long long MBR_BITS;
+/// Number of words handled by a bit vector
+#define MBR_BITS_LEN 64
+/// Maximum number of bit vectors to hold a word sequence
+#define MBR_BLOCK_MAX ((MAXSEQNUM + MBR_BITS_LEN - 1) / MBR_BITS_LEN)
+
+/// Word output string and its word ID, to assign symbol IDs
+typedef struct {
+  char *str;			///< Output string
+  WORD_ID w;			///< Word ID
+} MBR_SYMBOL;
+
+/// Work area for distance calculation, one for each thread
+typedef struct {
+  DP *d;			///< DP table
+  MBR_BITS *peq;		///< Match bit vectors for each symbol
+} MBR_WORK;
+
 /** 
  * <JA>
  * MBRスコアでソートするための qsort コールバック関数. 
@@ -46,6 +69,22 @@ mbr_cmp(NODE **a, NODE **b)
 }
 
 
+/** 
+ * <JA>
+ * 記号IDを振るためのソート用関数. 
+ * </JA>
+ * <EN>
+ * qsort callback to sort words by output string.
+ * </EN>
+ */
+
+static int
+symbol_cmp(MBR_SYMBOL *a, MBR_SYMBOL *b)
+{
+  return(strcmp(a->str, b->str));
+}
+
+
 /** 
  * <JA>
  * DPマッチングの結果を出力するデバッグ関数．
@@ -133,30 +172,37 @@ dppath(int a, int b, int c, int cost)
 /** 
  * <JA>
  * 
- * DPマッチングを行う．
+ * DPマッチングを行う．単語は出力文字列ごとに振られた記号IDで比較する．
  * 
- * @param a [in] 要素1
- * @param b [in] 要素2
- * @param w [in] 言語モデル
+ * @param s1 [in] 要素1の記号ID列
+ * @param len1 [in] 要素1の要素数+1
+ * @param s2 [in] 要素2の記号ID列
+ * @param len2 [in] 要素2の要素数+1
+ * @param d [out] DPマッチングの結果を格納する領域
  * 
  * @return DPマッチングの結果．
  * </JA>
+ * <EN>
+ * Perform DP matching of two word sequences.  Words are compared by
+ * the symbol IDs given per output string.
+ * 
+ * @param s1 [in] symbol ID sequence of element 1
+ * @param len1 [in] length of element 1 plus 1
+ * @param s2 [in] symbol ID sequence of element 2
+ * @param len2 [in] length of element 2 plus 1
+ * @param d [out] work area to store the DP table
+ * 
+ * @return the DP table.
+ * </EN>
  */
 
 static DP*
-dpmatch(NODE *a, NODE *b, WORD_INFO *winfo)
+dpmatch(int *s1, int len1, int *s2, int len2, DP *d)
 {
-  int len1, len2;
-  DP *d;
   int i, j;
   int cost;
 
-  char *c1, *c2;
-
-  len1 = a->seqnum + 1;
-  len2 = b->seqnum + 1;
-
-  d = (DP *)mymalloc(sizeof(DP) * len1 * len2);
+  int c1;
 
   d[0].d = 0;
   d[0].r = 0;
@@ -178,13 +224,11 @@ dpmatch(NODE *a, NODE *b, WORD_INFO *winfo)
 
   for(i = 1; i < len1; i++){
 
-    c1 = winfo->woutput[a->seq[i - 1]];
+    c1 = s1[i - 1];
 
     for(j = 1; j < len2; j++){
 
-      c2 = winfo->woutput[b->seq[j - 1]];
-
-      if (strmatch(c1, c2)) {
+      if (c1 == s2[j - 1]) {
 
 	cost = 0;
       }
@@ -228,29 +272,32 @@ get_weight(WORD_INFO *winfo, WORD_ID id)
  * Weighed Levenstein distanceを計算する．
  * 
  * @param a [in] 要素1
+ * @param s1 [in] 要素1の記号ID列
  * @param b [in] 要素2
+ * @param s2 [in] 要素2の記号ID列
  * @param w [in] 言語モデル
+ * @param work [i/o] ワークエリア
  * 
  * @return Weighed Levenstein distanceの値を返す．
  * </JA>
  */
 
 static float
-calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
+calc_wld(NODE *a, int *s1, NODE *b, int *s2, WORD_INFO *winfo, MBR_WORK *work)
 {
   float weight, error1, error2;
   DP *d;
   int i, j, now;
 
   /* DPマッチングのパスを求める */
-  d = dpmatch(a, b, winfo);
+  d = dpmatch(s1, a->seqnum + 1, s2, b->seqnum + 1, work->d);
 
   weight = 0.0;
   i = a->seqnum;
   j = b->seqnum;
 
   /* バックトレースしつつ重みを確定 */
-  if(d[i * j - 1].d > 0){
+  if(d[(i + 1) * (j + 1) - 1].d > 0){
 
     error1 = 0.0;
     error2 = 0.0;
@@ -298,41 +345,174 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
     weight += error1 > error2 ? error1 : error2;
   }
 
-  free(d);
-
   return weight;
 }
 
 
 /** 
  * <JA>
- * Levenstein distanceを計算する．
+ * Levenstein distanceを計算する．短い方の系列をパタンとし，MBR_BITS_LEN
+ * 語ごとのブロックに分けたビット並列法 (Myers) で求める．
  * 
- * @param a [in] 要素1
- * @param b [in] 要素2
- * @param w [in] 言語モデル
+ * @param s1 [in] 要素1の記号ID列
+ * @param len1 [in] 要素1の要素数
+ * @param s2 [in] 要素2の記号ID列
+ * @param len2 [in] 要素2の要素数
+ * @param work [i/o] ワークエリア
  * 
  * @return Levenstein distanceの値を返す．
  * </JA>
+ * <EN>
+ * Compute Levenstein distance by the bit-parallel algorithm of Myers.
+ * The shorter sequence is taken as the pattern and divided into blocks
+ * of MBR_BITS_LEN words.
+ * 
+ * @param s1 [in] symbol ID sequence of element 1
+ * @param len1 [in] length of element 1
+ * @param s2 [in] symbol ID sequence of element 2
+ * @param len2 [in] length of element 2
+ * @param work [i/o] work area
+ * 
+ * @return the Levenstein distance.
+ * </EN>
  */
 
 static int
-calc_ld(NODE *a, NODE *b, WORD_INFO *winfo)
+calc_ld(int *s1, int len1, int *s2, int len2, MBR_WORK *work)
 {
-  int distance;
-  DP *d;
-
-  /* DPマッチングのパスを求める */
-  d = dpmatch(a, b, winfo);
+  int *tmp;
+  int i, k, bnum, hin, hout, distance;
+  MBR_BITS pv[MBR_BLOCK_MAX], mv[MBR_BLOCK_MAX];
+  MBR_BITS ph, mh, xv, xh, eq, high, lasthigh, *peq;
+
+  if (debug2_flag) {
+    /* DPマッチングのパスを求める */
+    dpmatch(s1, len1 + 1, s2, len2 + 1, work->d);
+    return(work->d[(len1 + 1) * (len2 + 1) - 1].d);
+  }
 
-  distance = d[(a->seqnum + 1) * (b->seqnum + 1) - 1].d;
+  /* use the shorter one as the pattern */
+  if (len1 > len2) {
+    tmp = s1; s1 = s2; s2 = tmp;
+    i = len1; len1 = len2; len2 = i;
+  }
+  if (len1 == 0) return(len2);
 
-  free(d);
+  bnum = (len1 + MBR_BITS_LEN - 1) / MBR_BITS_LEN;
+  for(i = 0; i < len1; i++) {
+    work->peq[s1[i] * MBR_BLOCK_MAX + i / MBR_BITS_LEN] |= (MBR_BITS)1 << (i % MBR_BITS_LEN);
+  }
+  for(k = 0; k < bnum; k++) {
+    pv[k] = ~(MBR_BITS)0;
+    mv[k] = 0;
+  }
+  lasthigh = (MBR_BITS)1 << ((len1 - 1) % MBR_BITS_LEN);
+  distance = len1;
+  for(i = 0; i < len2; i++) {
+    peq = &(work->peq[s2[i] * MBR_BLOCK_MAX]);
+    /* the top boundary row increases by one at each column */
+    hin = 1;
+    for(k = 0; k < bnum; k++) {
+      eq = peq[k];
+      xv = eq | mv[k];
+      if (hin < 0) eq |= 1;
+      xh = (((eq & pv[k]) + pv[k]) ^ pv[k]) | eq;
+      ph = mv[k] | ~(xh | pv[k]);
+      mh = pv[k] & xh;
+      high = (k < bnum - 1) ? (MBR_BITS)1 << (MBR_BITS_LEN - 1) : lasthigh;
+      hout = (ph & high) ? 1 : ((mh & high) ? -1 : 0);
+      ph <<= 1;
+      mh <<= 1;
+      if (hin < 0) mh |= 1;
+      else if (hin > 0) ph |= 1;
+      pv[k] = mh | ~(xv | ph);
+      mv[k] = ph & xv;
+      hin = hout;
+    }
+    distance += hin;
+  }
+  for(i = 0; i < len1; i++) {
+    work->peq[s1[i] * MBR_BLOCK_MAX + i / MBR_BITS_LEN] = 0;
+  }
 
   return distance;
 }
 
 
+/** 
+ * <JA>
+ * 候補文の単語を出力文字列ごとの記号IDに変換する．
+ * 
+ * @param table [in] スタックテーブル
+ * @param r_stacknum [in] スタックのデータ数
+ * @param winfo [in] 単語辞書
+ * @param sym [out] 各候補文の記号ID列
+ * 
+ * @return 記号の種類数を返す．
+ * </JA>
+ * <EN>
+ * Convert words in the candidates to symbol IDs.  Words of the same
+ * output string are given the same ID.
+ * 
+ * @param table [in] stack table
+ * @param r_stacknum [in] number of candidates
+ * @param winfo [in] word dictionary
+ * @param sym [out] symbol ID sequence of each candidate
+ * 
+ * @return the number of symbols.
+ * </EN>
+ */
+
+static int
+assign_symbol(NODE **table, int r_stacknum, WORD_INFO *winfo, int **sym)
+{
+  int *id;
+  MBR_SYMBOL *wlist;
+  int i, k, wnum, snum;
+  WORD_ID w;
+
+  id = (int *)mymalloc(sizeof(int) * winfo->num);
+  for(i = 0; i < winfo->num; i++) id[i] = -1;
+  wlist = NULL;
+  wnum = 0;
+  for(i = 0; i < r_stacknum; i++) {
+    for(k = 0; k < table[i]->seqnum; k++) {
+      w = table[i]->seq[k];
+      if (id[w] == -1) {
+	if (wnum % 256 == 0) wlist = (MBR_SYMBOL *)myrealloc(wlist, sizeof(MBR_SYMBOL) * (wnum + 256));
+	wlist[wnum].str = winfo->woutput[w];
+	wlist[wnum].w = w;
+	wnum++;
+	id[w] = 0;
+      }
+    }
+  }
+
+  /* words of the same output string share a symbol */
+  if (wnum > 1) {
+    qsort(wlist, wnum, sizeof(MBR_SYMBOL),
+	  (int (*)(const void *, const void *))symbol_cmp);
+  }
+  snum = 0;
+  for(i = 0; i < wnum; i++) {
+    if (i > 0 && !strmatch(wlist[i].str, wlist[i - 1].str)) snum++;
+    id[wlist[i].w] = snum;
+  }
+  if (wnum > 0) snum++;
+
+  for(i = 0; i < r_stacknum; i++) {
+    for(k = 0; k < table[i]->seqnum; k++) {
+      sym[i][k] = id[table[i]->seq[k]];
+    }
+  }
+
+  if (wlist) free(wlist);
+  free(id);
+
+  return snum;
+}
+
+
 /** 
  * <JA>
  * 音声認識スコアを正規化する．
@@ -400,14 +580,19 @@ void
 candidate_mbr(NODE **r_start, NODE **r_bottom, int r_stacknum, RecogProcess *r)
 {
   JCONF_SEARCH *jconf = r->config;
+  WORD_INFO *winfo = r->lm->winfo;
   NODE **table;
   NODE *now;
 
   int i, j;
-  int dist;
+  int maxlen, snum, nthread, dnum;
 
   float *n_score;
   float error;
+  float *errtab;
+  float *powtab;
+  int **sym;
+  MBR_WORK *work;
 
   /* リストのままでは扱いにくいので配列に変換 */
   table = (NODE **)mymalloc(sizeof(NODE *) * r_stacknum);
@@ -420,31 +605,84 @@ candidate_mbr(NODE **r_start, NODE **r_bottom, int r_stacknum, RecogProcess *r)
   /* 認識スコア（ゆう度）を正規化 */
   n_score = normalization_score(table, r_stacknum, r);
 
-  /* MBRスコアを計算 */
+  /* 単語を記号IDに変換 */
+  maxlen = 0;
+  dnum = 0;
+  for(i = 0; i < r_stacknum; i++){
+    if (maxlen < table[i]->seqnum) maxlen = table[i]->seqnum;
+    dnum += table[i]->seqnum;
+  }
+  sym = (int **)mymalloc(sizeof(int *) * r_stacknum);
+  sym[0] = (int *)mymalloc(sizeof(int) * (dnum + 1));
+  for(i = 1; i < r_stacknum; i++){
+    sym[i] = sym[i - 1] + table[i - 1]->seqnum;
+  }
+  snum = assign_symbol(table, r_stacknum, winfo, sym);
+
+  /* 損失の値を先に求めておく */
+  powtab = (float *)mymalloc(sizeof(float) * (maxlen + 1));
+  for(i = 0; i <= maxlen; i++){
+    powtab[i] = pow(i, jconf->mbr.loss_weight);
+  }
+
+  /* スレッドごとのワークエリア */
+  nthread = 1;
+#ifdef _OPENMP
+  if (!debug2_flag) nthread = omp_get_max_threads();
+#endif
+  work = (MBR_WORK *)mymalloc(sizeof(MBR_WORK) * nthread);
+  for(i = 0; i < nthread; i++){
+    work[i].d = (DP *)mymalloc(sizeof(DP) * (maxlen + 1) * (maxlen + 1));
+    work[i].peq = (MBR_BITS *)mycalloc((snum + 1) * MBR_BLOCK_MAX, sizeof(MBR_BITS));
+  }
+
+  /* 全候補対の損失を求める */
+  errtab = (float *)mymalloc(sizeof(float) * r_stacknum * r_stacknum);
+#ifdef _OPENMP
+#pragma omp parallel for private(j) schedule(dynamic) num_threads(nthread)
+#endif
   for(i = 0; i < r_stacknum - 1; i++){
+    MBR_WORK *w;
+    float e;
+#ifdef _OPENMP
+    w = &(work[omp_get_thread_num()]);
+#else
+    w = &(work[0]);
+#endif
     for(j = i + 1; j < r_stacknum; j++){
-
       if(jconf->mbr.use_word_weight){
 	/* 損失関数はWeighted Levenstein distance */
-	if((error = calc_wld(table[i], table[j], r->lm->winfo)) < 0.0){
-	  jlog("Error: candidate_mbr: cannot calculation Weighted Levenstein distance\n");
-	  free(n_score);
-	  free(table);
-	  return;
-	}
-
-	error = pow(error, jconf->mbr.loss_weight);
+	e = calc_wld(table[i], sym[i], table[j], sym[j], winfo, w);
+	if (e >= 0.0) e = pow(e, jconf->mbr.loss_weight);
       }
       else{
 	/* 損失関数はLevenstein distance */
-	if((dist = calc_ld(table[i], table[j], r->lm->winfo)) < 0){
-	  jlog("Error: candidate_mbr: cannot calculation Levenstein distance\n");
-	  free(n_score);
-	  free(table);
-	  return;
-	}
+	e = powtab[calc_ld(sym[i], table[i]->seqnum, sym[j], table[j]->seqnum, w)];
+      }
+      errtab[i * r_stacknum + j] = e;
+    }
+  }
+
+  for(i = 0; i < nthread; i++){
+    free(work[i].peq);
+    free(work[i].d);
+  }
+  free(work);
+  free(powtab);
+  free(sym[0]);
+  free(sym);
+
+  /* MBRスコアを計算 */
+  for(i = 0; i < r_stacknum - 1; i++){
+    for(j = i + 1; j < r_stacknum; j++){
 
-	error = pow(dist, jconf->mbr.loss_weight);
+      error = errtab[i * r_stacknum + j];
+      if (error < 0.0) {
+	jlog("Error: candidate_mbr: cannot calculation Weighted Levenstein distance\n");
+	free(errtab);
+	free(n_score);
+	free(table);
+	return;
       }
 
       table[i]->score_mbr += n_score[j] * error;
@@ -460,6 +698,7 @@ candidate_mbr(NODE **r_start, NODE **r_bottom, int r_stacknum, RecogProcess *r)
       }
     }
   }
+  free(errtab);
 
   /* 結果をリスコア */
   qsort(table, r_stacknum, sizeof(NODE *),
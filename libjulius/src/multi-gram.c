@@ -63,12 +63,122 @@
 /// For debug: define to enable grammar update messages to stdout
 #define MDEBUG
 
+/** 
+ * <JA>
+ * @brief  グローバル文法の指定単語以降を文法ごとに木構造化辞書に追加する. 
+ *
+ * グローバル文法の単語 @a wbgn 以降について，各文法の単語を一つの
+ * 区間として順に木構造化辞書へ追加する. 木は @a wbgn 単語まで構築
+ * 済みであること. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * @param wbgn [in] 追加する最初の単語ID
+ * 
+ * @return 成功時 TRUE，失敗時 FALSE を返す. 
+ * </JA>
+ * <EN>
+ * @brief  Add grammars after the given word to the tree lexicon.
+ *
+ * The words of the global grammar after @a wbgn are added to the tree
+ * lexicon, one segment per grammar.  The tree should already hold the
+ * first @a wbgn words.
+ * 
+ * @param r [i/o] recognition process instance
+ * @param wbgn [in] first word ID to add
+ * 
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ */
+static boolean
+multigram_add_segments(RecogProcess *r, WORD_ID wbgn)
+{
+  MULTIGRAM *m;
+  WORD_ID w;
+  boolean ok_p;
+
+  ok_p = TRUE;
+  if (r->lm->winfo->num == 0) {
+    /* no word: just initialize the tree */
+    return(wchmm_add_segment(r->wchmm, r->lm->config, 0, 0));
+  }
+  w = wbgn;
+  while (w < r->lm->winfo->num) {
+    for(m=r->lm->grammars;m;m=m->next) {
+      if (m->word_begin == w && m->winfo->num > 0) break;
+    }
+    if (m == NULL) {
+      jlog("ERROR: multi-gram: no grammar found at word #%d in global grammar\n", w);
+      return FALSE;
+    }
+    if (wchmm_add_segment(r->wchmm, r->lm->config, w, w + m->winfo->num) == FALSE) {
+      jlog("ERROR: multi-gram: failed to add grammar #%d to lexicon tree\n", m->id);
+      ok_p = FALSE;
+    }
+    w += m->winfo->num;
+  }
+  /* check wchmm coherence (internal debug) */
+  check_wchmm(r->wchmm);
+
+  return ok_p;
+}
+
+/** 
+ * <JA>
+ * @brief  木構造化辞書を更新部分のみ再構築する. 
+ *
+ * グローバル文法の先頭で変更のなかった単語について，その部分の木を
+ * そのまま残し，以降の文法の部分のみを作り直す. 木の削除された部分の
+ * 領域が木の大きさを超えた場合は，全体を再構築して領域を回収するため
+ * FALSE を返す. 
+ * 
+ * @param r [i/o] 認識処理インスタンス
+ * 
+ * @return 更新した場合 TRUE，全体の再構築が必要な場合 FALSE を返す. 
+ * </JA>
+ * <EN>
+ * @brief  Rebuild only the updated part of the tree lexicon.
+ *
+ * The part of the tree for the leading words in the global grammar that
+ * have not been changed is kept, and only the following grammars are
+ * rebuilt.  When the area discarded from the tree exceeds the tree size,
+ * FALSE is returned to compact it by rebuilding the whole tree.
+ * 
+ * @param r [i/o] recognition process instance
+ * 
+ * @return TRUE if updated, or FALSE if the whole tree should be rebuilt.
+ * </EN>
+ */
+static boolean
+multigram_update_wchmm(RecogProcess *r)
+{
+  WORD_ID kept;
+
+  if (r->wchmm == NULL || r->wchmm->segnum == 0) return FALSE;
+  if (r->lmvar != LM_DFA_GRAMMAR || r->config->pass1.old_tree_function_flag) return FALSE;
+  if (r->wchmm->garbage > r->wchmm->n) return FALSE;
+
+  kept = wchmm_truncate_segment(r->wchmm, r->lm->global_kept_wnum);
+  if (kept == 0) return FALSE;
+
+  /* assign the new global grammar */
+  r->wchmm->dfa = r->lm->dfa;
+  r->wchmm->dfa_forward = r->lm->dfa_forward;
+  r->wchmm->winfo = r->lm->winfo;
+  if (multigram_add_segments(r, kept) == FALSE) {
+    return FALSE;
+  }
+  jlog("STAT: multi-gram: lexicon tree updated: %d words kept, %d words added, %d nodes\n", kept, r->lm->winfo->num - kept, r->wchmm->n);
+
+  return TRUE;
+}
+
 /** 
  * <JA>
  * @brief  グローバル文法から木構造化辞書を構築する. 
  *
  * 与えられた文法で認識を行うために，認識処理インスタンスが現在持つ
- * グローバル文法から木構造化辞書を（再）構築します. また， 
+ * グローバル文法から木構造化辞書を（再）構築します. 変更のなかった
+ * 先頭の文法の部分は可能であればそのまま再利用します. また， 
  * 起動時にビーム幅が明示的に指示されていない場合やフルサーチの場合，
  * ビーム幅の再設定も行います.
  * 
@@ -78,7 +188,8 @@
  * @brief  Build tree lexicon from global grammar.
  *
  * This function will re-construct the tree lexicon using the global grammar
- * in the recognition process instance.  If the beam width was not explicitly
+ * in the recognition process instance.  The part of leading grammars that
+ * have not been changed is reused if possible.  If the beam width was not explicitly
  * specified on startup, the the beam width will be guessed
  * according to the size of the new lexicon.
  * 
@@ -90,29 +201,38 @@ multigram_rebuild_wchmm(RecogProcess *r)
 {
   boolean ret;
 
-  /* re-build wchmm */
-  if (r->wchmm != NULL) {
-    wchmm_free(r->wchmm);
-  }
-  r->wchmm = wchmm_new();
-  r->wchmm->lmtype = r->lmtype;
-  r->wchmm->lmvar  = r->lmvar;
-  r->wchmm->ccd_flag = r->ccd_flag;
-  r->wchmm->category_tree = TRUE;
-  r->wchmm->hmmwrk = &(r->am->hmmwrk);
-  /* assign models */
-  r->wchmm->dfa = r->lm->dfa;
-  r->wchmm->dfa_forward = r->lm->dfa_forward;
-  r->wchmm->winfo = r->lm->winfo;
-  r->wchmm->hmminfo = r->am->hmminfo;
-  if (r->wchmm->category_tree) {
-    if (r->config->pass1.old_tree_function_flag) {
-      ret = build_wchmm(r->wchmm, r->lm->config);
+  if (multigram_update_wchmm(r) == TRUE) {
+    ret = TRUE;
+  } else {
+    /* re-build wchmm */
+    if (r->wchmm != NULL) {
+      wchmm_free(r->wchmm);
+    }
+    r->wchmm = wchmm_new();
+    r->wchmm->lmtype = r->lmtype;
+    r->wchmm->lmvar  = r->lmvar;
+    r->wchmm->ccd_flag = r->ccd_flag;
+    r->wchmm->category_tree = TRUE;
+    r->wchmm->hmmwrk = &(r->am->hmmwrk);
+    /* assign models */
+    r->wchmm->dfa = r->lm->dfa;
+    r->wchmm->dfa_forward = r->lm->dfa_forward;
+    r->wchmm->winfo = r->lm->winfo;
+    r->wchmm->hmminfo = r->am->hmminfo;
+    if (r->wchmm->category_tree) {
+      if (r->config->pass1.old_tree_function_flag) {
+	ret = build_wchmm(r->wchmm, r->lm->config);
+      } else if (r->lmvar == LM_DFA_GRAMMAR) {
+	/* build per grammar for later partial update */
+	jlog("STAT: Building HMM lexicon tree\n");
+	ret = multigram_add_segments(r, 0);
+	jlog("STAT: lexicon size: %d nodes\n", r->wchmm->n);
+      } else {
+	ret = build_wchmm2(r->wchmm, r->lm->config);
+      }
     } else {
       ret = build_wchmm2(r->wchmm, r->lm->config);
     }
-  } else {
-    ret = build_wchmm2(r->wchmm, r->lm->config);
   }
 
   /* 起動時 -check でチェックモードへ */
@@ -407,7 +527,11 @@ multigram_exec_delete(PROCESS_LM *lm)
     if (m->hook & MULTIGRAM_DELETE) {
       /* if any grammar is deleted, we need to rebuild lexicons etc. */
       /* so tell it to the caller */
-      if (! m->newbie) ret_flag = TRUE;
+      if (! m->newbie) {
+	ret_flag = TRUE;
+	/* words after this grammar will be shifted */
+	if (lm->global_kept_wnum > m->word_begin) lm->global_kept_wnum = m->word_begin;
+      }
       if (m->dfa_forward) dfa_info_free(m->dfa_forward);
       if (m->dfa) dfa_info_free(m->dfa);
       word_info_free(m->winfo);
@@ -627,9 +751,16 @@ boolean				/* return FALSE if no gram */
 multigram_update(PROCESS_LM *lm)
 {
   MULTIGRAM *m;
+  MULTIGRAM **mlist;
+  int i, j, num;
   boolean active_changed = FALSE;
   boolean rebuild_flag;
 
+  /* words of the global grammar that have been used for the last build */
+  if (! lm->global_modified) {
+    lm->global_kept_wnum = (lm->winfo != NULL) ? lm->winfo->num : 0;
+  }
+
   if (lm->lmvar == LM_DFA_GRAMMAR) {
     /* setup additional grammar info of new ones */
     for(m=lm->grammars;m;m=m->next) {
@@ -665,6 +796,9 @@ multigram_update(PROCESS_LM *lm)
     if (m->hook & MULTIGRAM_MODIFIED) {
       rebuild_flag = TRUE;	/* needs rebuilding global grammar */
       m->hook &= ~(MULTIGRAM_MODIFIED);
+      if (! m->newbie && lm->global_kept_wnum > m->word_begin) {
+	lm->global_kept_wnum = m->word_begin;
+      }
     }
   }
 
@@ -692,8 +826,22 @@ multigram_update(PROCESS_LM *lm)
       lm->dfa = dfa_info_new();
       dfa_state_init(lm->dfa);
     }
+    /* list grammars in the current order in global grammar, and new ones
+       at last, so that the leading unchanged grammars keep their IDs */
+    for(num=0,m=lm->grammars;m;m=m->next) num++;
+    mlist = (MULTIGRAM **)mymalloc(sizeof(MULTIGRAM *) * (num + 1));
+    for(num=0,m=lm->grammars;m;m=m->next) {
+      for(j=num;j>0;j--) {
+	if (m->newbie) break;
+	if (! mlist[j-1]->newbie && mlist[j-1]->word_begin <= m->word_begin) break;
+	mlist[j] = mlist[j-1];
+      }
+      mlist[j] = m;
+      num++;
+    }
     /* concatinate all existing grammars to global */
-    for(m=lm->grammars;m;m=m->next) {
+    for(i=0;i<num;i++) {
+      m = mlist[i];
       if (lm->lmvar == LM_DFA_GRAMMAR && lm->dfa_forward == NULL && m->dfa_forward != NULL) {
 	lm->dfa_forward = dfa_info_new();
 	dfa_state_init(lm->dfa_forward);
@@ -719,6 +867,7 @@ multigram_update(PROCESS_LM *lm)
 	}
       }
     }
+    free(mlist);
     /* delete the error grammars if exist */
     if (multigram_exec_delete(lm)) {
       jlog("ERROR: errorous grammar deleted\n");
@@ -102,10 +102,15 @@ outprob_style_cache_init(WCHMM_INFO *wchmm)
   int n;
   for(n=0;n<wchmm->n;n++) {
     if (wchmm->state[n].out.state == NULL) continue;
+    /* write only when set, not to copy pages shared with forked processes */
     if (wchmm->outstyle[n] == AS_RSET) {
-      (wchmm->state[n].out.rset)->cache.state = NULL;
+      if ((wchmm->state[n].out.rset)->cache.state != NULL) {
+	(wchmm->state[n].out.rset)->cache.state = NULL;
+      }
     } else if (wchmm->outstyle[n] == AS_LRSET) {
-      (wchmm->state[n].out.lrset)->cache.state = NULL;
+      if ((wchmm->state[n].out.lrset)->cache.state != NULL) {
+	(wchmm->state[n].out.lrset)->cache.state = NULL;
+      }
     }
   }
 }
@@ -248,23 +253,26 @@ lcdset_register_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID categ
 
 /** 
  * <JA>
- * 全ての単語末用カテゴリ付き pseudo phone set を生成する. 
- * 辞書上のすべての単語について，その末尾に登場しうるカテゴリ付き pseudo phone
+ * 指定範囲の単語について，その末尾に登場しうるカテゴリ付き pseudo phone
  * set を生成する（文法認識用）. 
  * 
  * @param wchmm [i/o] 木構造化辞書情報
+ * @param bgn [in] 対象とする最初の単語ID
+ * @param end [in] 対象とする最後の単語ID + 1
  * </JA>
  * <EN>
- * Generate all possible category-indexed pseudo phone sets for
- * grammar recognition.
+ * Generate category-indexed pseudo phone sets needed by the words in
+ * the given range, for grammar recognition.
  * 
  * @param wchmm [i/o] tree lexicon
+ * @param bgn [in] first word ID
+ * @param end [in] last word ID + 1
  * </EN>
  * @callgraph
  * @callergraph
  */
 void
-lcdset_register_with_category_all(WCHMM_INFO *wchmm)
+lcdset_register_with_category_words(WCHMM_INFO *wchmm, WORD_ID bgn, WORD_ID end)
 {
   WORD_INFO *winfo;
   WORD_ID c1, w, w_prev;
@@ -275,13 +283,13 @@ lcdset_register_with_category_all(WCHMM_INFO *wchmm)
 
   /* (1) 単語終端の音素について */
   /*     word end phone */
-  for(w=0;w<winfo->num;w++) {
+  for(w=bgn;w<end;w++) {
     ltmp = winfo->wseq[w][winfo->wlen[w]-1];
     lcdset_register_with_category(wchmm, ltmp, winfo->wton[w]);
   }
   /* (2)１音素単語の場合, 先行しうる単語の終端音素を考慮 */
   /*    for one-phoneme word, possible left context should be also considered */
-  for(w=0;w<winfo->num;w++) {
+  for(w=bgn;w<end;w++) {
     if (winfo->wlen[w] > 1) continue;
     for(c1=0;c1<wchmm->dfa->term_num;c1++) {
       if (! dfa_cp(wchmm->dfa, c1, winfo->wton[w])) continue;
@@ -296,6 +304,29 @@ lcdset_register_with_category_all(WCHMM_INFO *wchmm)
   }
 }
 
+/** 
+ * <JA>
+ * 全ての単語末用カテゴリ付き pseudo phone set を生成する. 
+ * 辞書上のすべての単語について，その末尾に登場しうるカテゴリ付き pseudo phone
+ * set を生成する（文法認識用）. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書情報
+ * </JA>
+ * <EN>
+ * Generate all possible category-indexed pseudo phone sets for
+ * grammar recognition.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+lcdset_register_with_category_all(WCHMM_INFO *wchmm)
+{
+  lcdset_register_with_category_words(wchmm, 0, wchmm->winfo->num);
+}
+
 /** 
  * <JA>
  * カテゴリ付き pseudo phone set をすべて消去する. この関数は Julian で文法が
@@ -319,6 +350,86 @@ lcdset_remove_with_category_all(WCHMM_INFO *wchmm)
   free_cdset(&(wchmm->lcdset_category_root), &(wchmm->lcdset_mroot));
 }
 
+/// Work area to collect category-indexed sets to be removed
+static CD_Set **lcdset_rmlist = NULL;
+static int lcdset_rmnum, lcdset_rmmax;
+/// Category ID from which sets should be removed
+static int lcdset_rmcate;
+
+/** 
+ * Callback for aptree function to collect the category-indexed pseudo
+ * phone sets of category ID not less than @a lcdset_rmcate.
+ * 
+ * @param arg [in] pointer to the pseudo phone set
+ */
+static void
+callback_collect_lcdset(void *arg)
+{
+  CD_Set *cd;
+  char *p;
+
+  cd = arg;
+  p = strrchr(cd->name, ':');
+  if (p == NULL || atoi(p + 1) < lcdset_rmcate) return;
+  if (lcdset_rmnum >= lcdset_rmmax) {
+    lcdset_rmmax += 256;
+    lcdset_rmlist = (CD_Set **)myrealloc(lcdset_rmlist, sizeof(CD_Set *) * lcdset_rmmax);
+  }
+  lcdset_rmlist[lcdset_rmnum++] = cd;
+}
+
+/** 
+ * <JA>
+ * 指定カテゴリ番号以降のカテゴリ付き pseudo phone set を消去する. 
+ * 木構造化辞書の末尾の文法を入れ替える際に用いられる. 索引ノードの
+ * 領域は次回の全消去時に解放される. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param cate_begin [in] 消去する最初のカテゴリ番号
+ * </JA>
+ * <EN>
+ * Remove the category-indexed pseudo state sets of categories not less
+ * than @a cate_begin.  This is used when tail grammars of the tree
+ * lexicon are replaced.  The index nodes will be freed at the next
+ * removal of all sets.
+ * 
+ * @param wchmm [i/o] lexicon tree information
+ * @param cate_begin [in] first category ID to remove
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+lcdset_remove_with_category_from(WCHMM_INFO *wchmm, int cate_begin)
+{
+  CD_Set *cd;
+  int i, j;
+
+  if (wchmm->lcdset_category_root == NULL) return;
+  lcdset_rmnum = 0;
+  lcdset_rmcate = cate_begin;
+  aptree_traverse_and_do(wchmm->lcdset_category_root, callback_collect_lcdset);
+  for(i=0;i<lcdset_rmnum;i++) {
+    cd = lcdset_rmlist[i];
+    aptree_remove_entry(cd->name, &(wchmm->lcdset_category_root));
+    for(j=0;j<cd->state_num;j++) {
+      if (cd->stateset[j].s != NULL) free(cd->stateset[j].s);
+    }
+    free(cd->stateset);
+    free(cd->name);
+    free(cd);
+  }
+  if (wchmm->lcdset_category_root == NULL) {
+    /* all removed */
+    mybfree2(&(wchmm->lcdset_mroot));
+  }
+  if (lcdset_rmlist != NULL) {
+    free(lcdset_rmlist);
+    lcdset_rmlist = NULL;
+    lcdset_rmmax = 0;
+  }
+}
+
 #endif /* PASS1_IWCD */
 
 /** 
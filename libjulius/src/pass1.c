@@ -128,6 +128,7 @@ decode_proceed(Recog *recog)
     p->have_determine = FALSE;
 #endif
     p->have_interim = FALSE;
+    p->have_lattice = FALSE;
   }
   for (mfcc = recog->mfcclist; mfcc; mfcc = mfcc->next) {
     mfcc->segmented = FALSE;
@@ -312,6 +313,14 @@ decode_proceed(Recog *recog)
     }
   }
   if (ok_p) callback_exec(CALLBACK_RESULT_PASS1_INTERIM, recog);
+  ok_p = FALSE;
+  for(p=recog->process_list;p;p=p->next) {
+    if (!p->live) continue;
+    if (p->have_lattice) {
+      ok_p = TRUE;
+    }
+  }
+  if (ok_p) callback_exec(CALLBACK_RESULT_PASS1_LATTICE, recog);
   
   return 0;
 }
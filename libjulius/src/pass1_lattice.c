@@ -0,0 +1,480 @@
+/**
+ * @file   pass1_lattice.c
+ *
+ * <JA>
+ * @brief  第1パスでの単語ラティスの逐次生成
+ *
+ * "-pass1lattice" 指定時，第1パスの各フレームで，そのフレームで終端した
+ * トレリス単語 (save_trellis() で格納されたもの) から単語ラティスを
+ * 時間同期に拡張する．各フレームで最大スコアのトレリス単語から
+ * "-pass1latbeam" の幅に入るものを，スコアの高い順に1フレームあたり
+ * "-pass1latmax" 個までラティスに加える．同一単語・同一区間のものは
+ * 1つにまとめる．新たな単語は，その始端の直前のフレームで終端する
+ * ラティス中の全ての単語と接続される．左コンテキストを持たない単語は
+ * 加えない．
+ *
+ * 生成中のラティスは "-pass1latinterval" ごとに
+ * CALLBACK_RESULT_PASS1_LATTICE で result.lat1 として出力される．
+ * このときの単語IDは追加順 (終端フレーム順) であり，前回の出力以降に
+ * 追加された単語は result.lat1_newid 以降のIDを持つ．第1パス終了時には，
+ * 入力末端に到達しない単語を削除して始端時刻順に整列し，事後確率を
+ * 計算した最終的なラティスを出力する．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Incremental word lattice generation on the 1st pass
+ *
+ * With "-pass1lattice", a word lattice is extended time-synchronously
+ * at each frame of the 1st pass from the trellis words which end at the
+ * frame (the ones stored by save_trellis()).  Only the trellis words
+ * within "-pass1latbeam" from the best one at the frame are added to
+ * the lattice in descending order of score, up to "-pass1latmax" words
+ * per frame, and those of the same word on the same segment are
+ * merged.  A new word is connected to all the lattice words that end
+ * just before its beginning frame.  Words that have no left context
+ * are not added.
+ *
+ * The lattice under construction is output as result.lat1 by
+ * CALLBACK_RESULT_PASS1_LATTICE at every "-pass1latinterval".  The
+ * word IDs are in the order of addition (= order of end frame), and
+ * the words added since the last output have IDs from
+ * result.lat1_newid.  At the end of the 1st pass, words which do not
+ * reach the end of input are removed, and the final lattice sorted by
+ * beginning frame, with posteriors computed, will be output.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/julius.h>
+
+/**
+ * Step size to expand the work area.
+ *
+ */
+#define LAT1_EXPAND_STEP 4096
+
+/**
+ * <JA>
+ * 入力ごとに第1パスラティスの生成を初期化する.
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * @param wshift [in] フレームシフト (100ns 単位)
+ * </JA>
+ * <EN>
+ * Initialize the 1st pass lattice generation for an input.
+ *
+ * @param r [i/o] recognition process instance
+ * @param wshift [in] frame shift in 100ns unit
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ *
+ */
+void
+pass1_lattice_init(RecogProcess *r, int wshift)
+{
+  JCONF_SEARCH *jconf;
+  int i;
+
+  jconf = r->config;
+
+  /* set interval frame for partial lattice output */
+  if (jconf->graph.pass1lattice_interval > 0) {
+    jconf->graph.pass1lattice_interval_frame = (int)((float)jconf->graph.pass1lattice_interval / ((float)wshift / 10000.0));
+    if (jconf->graph.pass1lattice_interval_frame < 1) jconf->graph.pass1lattice_interval_frame = 1;
+  } else {
+    jconf->graph.pass1lattice_interval_frame = 0;
+  }
+
+  /* words of the previous input are released at clear_result() */
+  r->result.lat1 = NULL;
+  r->result.lat1_num = 0;
+  r->result.lat1_frame = -1;
+  r->result.lat1_newid = 0;
+  r->result.lat1_final = FALSE;
+  r->lat1work.lastnum = 0;
+
+  if (r->lat1work.wmarklen < r->lm->winfo->num) {
+    if (r->lat1work.wmark) free(r->lat1work.wmark);
+    r->lat1work.wmarklen = r->lm->winfo->num;
+    r->lat1work.wmark = (int *)mymalloc(sizeof(int) * r->lat1work.wmarklen);
+  }
+  for(i=0;i<r->lat1work.wmarklen;i++) r->lat1work.wmark[i] = -1;
+}
+
+/**
+ * <JA>
+ * フレームごとの単語開始IDの表を，指定フレームまで格納できるよう拡張する.
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * @param len [in] 必要な長さ
+ * </JA>
+ * <EN>
+ * Expand the per-frame table of first word IDs to hold the given length.
+ *
+ * @param r [i/o] recognition process instance
+ * @param len [in] required length
+ * </EN>
+ */
+static void
+lat1_expand_frame(RecogProcess *r, int len)
+{
+  if (r->lat1work.fbgnlen >= len) return;
+  r->lat1work.fbgnlen = len + LAT1_EXPAND_STEP;
+  if (r->lat1work.fbgn == NULL) {
+    r->lat1work.fbgn = (int *)mymalloc(sizeof(int) * r->lat1work.fbgnlen);
+  } else {
+    r->lat1work.fbgn = (int *)myrealloc(r->lat1work.fbgn, sizeof(int) * r->lat1work.fbgnlen);
+  }
+}
+
+/**
+ * <JA>
+ * ラティスの最後に新たな単語を追加する.
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * @param ta [in] 元となるトレリス単語
+ *
+ * @return 追加された単語
+ * </JA>
+ * <EN>
+ * Append a new word to the lattice.
+ *
+ * @param r [i/o] recognition process instance
+ * @param ta [in] source trellis word
+ *
+ * @return the appended word.
+ * </EN>
+ */
+static WordGraph *
+lat1_append(RecogProcess *r, TRELLIS_ATOM *ta)
+{
+  WORD_INFO *winfo;
+  WordGraph *new;
+  LOGPROB l;
+
+  winfo = r->lm->winfo;
+
+  new = wordgraph_alloc(r);
+  new->wid = ta->wid;
+  new->lefttime = ta->begintime;
+  new->righttime = ta->endtime;
+  new->fscore_head = ta->backscore;
+  new->fscore_tail = 0.0;
+  new->gscore_head = 0.0;
+  new->gscore_tail = 0.0;
+  new->lscore_tmp = ta->lscore;
+#ifdef CM_SEARCH
+  new->cmscore = 0.0;
+#endif
+  new->forward_score = new->backward_score = 0.0;
+  new->headphone = winfo->wseq[ta->wid][0];
+  new->tailphone = winfo->wseq[ta->wid][winfo->wlen[ta->wid]-1];
+  l = ta->backscore;
+  if (ta->last_tre->wid != WORD_INVALID) {
+    l -= ta->last_tre->backscore;
+  }
+  l -= ta->lscore;
+  new->amavg = l / (float)(ta->endtime - ta->begintime + 1);
+#ifdef GRAPHOUT_DYNAMIC
+  new->purged = FALSE;
+#endif
+  new->saved = FALSE;
+  new->graph_cm = 0.0;
+  new->mark = FALSE;
+
+  if (r->lat1work.wlistlen <= r->result.lat1_num) {
+    r->lat1work.wlistlen += LAT1_EXPAND_STEP;
+    if (r->lat1work.wlist == NULL) {
+      r->lat1work.wlist = (WordGraph **)mymalloc(sizeof(WordGraph *) * r->lat1work.wlistlen);
+    } else {
+      r->lat1work.wlist = (WordGraph **)myrealloc(r->lat1work.wlist, sizeof(WordGraph *) * r->lat1work.wlistlen);
+    }
+  }
+  new->id = r->result.lat1_num;
+  if (r->result.lat1_num == 0) {
+    r->result.lat1 = new;
+  } else {
+    r->lat1work.wlist[r->result.lat1_num - 1]->next = new;
+  }
+  r->lat1work.wlist[r->result.lat1_num] = new;
+  r->result.lat1_num++;
+
+  return new;
+}
+
+/**
+ * <JA>
+ * トレリス単語をスコアの降順に並べる qsort 関数.
+ *
+ * @param x1 [in] 要素1へのポインタ
+ * @param x2 [in] 要素2へのポインタ
+ *
+ * @return qsort の値
+ * </JA>
+ * <EN>
+ * qsort function to sort trellis words by descending order of score.
+ *
+ * @param x1 [in] pointer to element #1
+ * @param x2 [in] pointer to element #2
+ *
+ * @return value required for qsort.
+ * </EN>
+ */
+static int
+compare_atom_score(TRELLIS_ATOM **x1, TRELLIS_ATOM **x2)
+{
+  if ((*x1)->backscore < (*x2)->backscore) return 1;
+  if ((*x1)->backscore > (*x2)->backscore) return -1;
+  return 0;
+}
+
+/**
+ * <JA>
+ * @brief  第1パスのラティスを1フレーム分拡張する.
+ *
+ * フレーム @a t で終端したトレリス単語のうち，そのフレームの最大スコアから
+ * ビーム幅内にあり，かつ入力始端から始まるか直前のフレームで終わる
+ * ラティス単語を持つものを，スコアの高い順に最大 -pass1latmax 個まで
+ * ラティスに追加して接続する. 同一単語・同一区間のものはスコアの
+ * 最も高いものだけを残す. get_back_trellis_proceed() で，
+ * フレーム @a t で終端するトレリス単語が全て格納された直後に呼ばれる. 
+ * 出力間隔に達した場合は have_lattice を TRUE にする. 
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * @param t [in] 終端フレーム
+ * </JA>
+ * <EN>
+ * @brief  Extend the 1st pass lattice by a frame.
+ *
+ * Trellis words that end at frame @a t, within the beam from the best
+ * score of the frame, and either begin at the start of input or have
+ * lattice words ending just before them, are added to the lattice and
+ * linked, up to -pass1latmax words in descending order of score.  Of
+ * the same word on the same segment only the best one is kept.  This
+ * will be called from get_back_trellis_proceed() just after all
+ * trellis words ending at frame @a t are stored.  When the output
+ * interval is reached, have_lattice will be set to TRUE.
+ *
+ * @param r [i/o] recognition process instance
+ * @param t [in] end frame
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ *
+ */
+void
+pass1_lattice_extend(RecogProcess *r, int t)
+{
+  TRELLIS_ATOM *tre;
+  LOGPROB maxscore, thres;
+  WordGraph *wg, *left;
+  WORD_INFO *winfo;
+  int *fbgn, *wmark;
+  int f, start, maxnum, num, i, j;
+  LOGPROB lscore;
+
+  if (t <= r->result.lat1_frame) return;
+  winfo = r->lm->winfo;
+
+  /* frames with no trellis word have no lattice word */
+  lat1_expand_frame(r, t + 2);
+  fbgn = r->lat1work.fbgn;
+  for(f=r->result.lat1_frame+1;f<=t;f++) fbgn[f] = r->result.lat1_num;
+  start = r->result.lat1_num;
+  wmark = r->lat1work.wmark;
+
+  /* bt->list is ordered by time frame, newest first */
+  maxscore = LOG_ZERO;
+  for(tre=r->backtrellis->list;tre != NULL && tre->endtime == t;tre=tre->next) {
+    if (maxscore < tre->backscore) maxscore = tre->backscore;
+  }
+  thres = maxscore - r->config->graph.pass1lattice_beam;
+
+  /* gather trellis words within the beam that follow a lattice word */
+  num = 0;
+  for(tre=r->backtrellis->list;tre != NULL && tre->endtime == t;tre=tre->next) {
+    if (tre->backscore < thres) continue;
+    if (tre->begintime > 0 && fbgn[tre->begintime - 1] == fbgn[tre->begintime]) continue;
+    if (num >= r->lat1work.candlen) {
+      r->lat1work.candlen += LAT1_EXPAND_STEP;
+      if (r->lat1work.cand == NULL) {
+	r->lat1work.cand = (TRELLIS_ATOM **)mymalloc(sizeof(TRELLIS_ATOM *) * r->lat1work.candlen);
+      } else {
+	r->lat1work.cand = (TRELLIS_ATOM **)myrealloc(r->lat1work.cand, sizeof(TRELLIS_ATOM *) * r->lat1work.candlen);
+      }
+    }
+    r->lat1work.cand[num++] = tre;
+  }
+  qsort(r->lat1work.cand, num, sizeof(TRELLIS_ATOM *), (int (*)(const void *, const void *))compare_atom_score);
+
+  /* add them from the best, merging the same word on the same segment */
+  maxnum = r->config->graph.pass1lattice_maxnum;
+  for(i=0;i<num;i++) {
+    if (maxnum > 0 && r->result.lat1_num - start >= maxnum) break;
+    tre = r->lat1work.cand[i];
+    wg = NULL;
+    if (wmark[tre->wid] >= start) {
+      for(wg=r->lat1work.wlist[wmark[tre->wid]];wg;wg=wg->hashnext) {
+	if (wg->lefttime == tre->begintime) break;
+      }
+    }
+    if (wg != NULL) continue;
+    wg = lat1_append(r, tre);
+    /* chain words of the same word ID at this frame by hashnext */
+    if (wmark[tre->wid] >= start) {
+      wg->hashnext = r->lat1work.wlist[wmark[tre->wid]];
+    }
+    wmark[tre->wid] = wg->id;
+  }
+  fbgn[t + 1] = r->result.lat1_num;
+
+  /* link the new words to the words ending just before them */
+  for(i=start;i<r->result.lat1_num;i++) {
+    wg = r->lat1work.wlist[i];
+    wg->hashnext = NULL;
+    if (wg->lefttime == 0) continue;
+    for(j=fbgn[wg->lefttime - 1];j<fbgn[wg->lefttime];j++) {
+      left = r->lat1work.wlist[j];
+      if (r->lmtype == LM_PROB) {
+	lscore = (*(r->wchmm->ngram->bigram_prob))(r->wchmm->ngram, winfo->wton[left->wid], winfo->wton[wg->wid]);
+      } else {
+	lscore = wg->lscore_tmp;
+      }
+      wordgraph_add_leftword(wg, left, lscore);
+      wordgraph_add_rightword(left, wg, lscore);
+    }
+  }
+  r->result.lat1_frame = t;
+
+  /* check output interval */
+  if (r->config->graph.pass1lattice_interval_frame > 0
+      && (t + 1) % r->config->graph.pass1lattice_interval_frame == 0) {
+    r->have_lattice = TRUE;
+    r->result.lat1_newid = r->lat1work.lastnum;
+    r->lat1work.lastnum = r->result.lat1_num;
+  }
+}
+
+/**
+ * <JA>
+ * @brief  第1パスのラティスを完成させる.
+ *
+ * 入力末端に到達しない単語をラティスから削除し，残った単語を始端時刻順に
+ * 整列してIDを振り直す. さらにラティス上の事後確率を計算する. 
+ * 第1パスの終了時に呼ばれる. 
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * @param framelen [in] 第1パスで処理されたフレーム長
+ * </JA>
+ * <EN>
+ * @brief  Finalize the 1st pass lattice.
+ *
+ * Words that do not reach the end of input are removed from the
+ * lattice, and the rest are sorted by beginning frame and their IDs
+ * are re-assigned.  Then the posteriors on the lattice are computed.
+ * This will be called at the end of the 1st pass.
+ *
+ * @param r [i/o] recognition process instance
+ * @param framelen [in] number of frames processed on the 1st pass
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ *
+ */
+void
+pass1_lattice_finish(RecogProcess *r, int framelen)
+{
+  WordGraph *wg, *prev;
+  int i, j, n, endframe, erased;
+
+  /* the last frame where any lattice word ends */
+  endframe = r->result.lat1_frame;
+  while (endframe >= 0 && r->lat1work.fbgn[endframe] == r->lat1work.fbgn[endframe + 1]) endframe--;
+
+  /* words are ordered by end frame, so the right contexts of a word
+     have been checked before it */
+  for(i=r->result.lat1_num-1;i>=0;i--) {
+    wg = r->lat1work.wlist[i];
+    if (wg->righttime == endframe) {
+      wg->mark = FALSE;
+      continue;
+    }
+    n = 0;
+    for(j=0;j<wg->rightwordnum;j++) {
+      if (! wg->rightword[j]->mark) {
+	wg->rightword[n] = wg->rightword[j];
+	wg->right_lscore[n] = wg->right_lscore[j];
+	n++;
+      }
+    }
+    wg->rightwordnum = n;
+    wg->mark = (n == 0) ? TRUE : FALSE;
+  }
+
+  /* erase the marked words from the list */
+  erased = 0;
+  prev = NULL;
+  for(i=0;i<r->result.lat1_num;i++) {
+    wg = r->lat1work.wlist[i];
+    if (wg->mark) {
+      wordgraph_free(wg);
+      erased++;
+      continue;
+    }
+    if (prev == NULL) r->result.lat1 = wg;
+    else prev->next = wg;
+    prev = wg;
+  }
+  if (prev == NULL) r->result.lat1 = NULL;
+  else prev->next = NULL;
+  if (verbose_flag) jlog("STAT: pass1_lattice: %d words purged, %d words left in lattice\n", erased, r->result.lat1_num - erased);
+
+  r->result.lat1_num = wordgraph_sort_and_annotate_id(&(r->result.lat1), r);
+  r->result.lat1_newid = 0;
+  r->result.lat1_final = TRUE;
+
+  /* compute graph CM by forward-backward processing */
+  r->peseqlen = framelen;
+  if (r->result.lat1 != NULL && endframe == framelen - 1) {
+    graph_forward_backward(r->result.lat1, r);
+  }
+}
+
+/**
+ * <JA>
+ * 第1パスラティスの作業領域を解放する.
+ *
+ * @param r [i/o] 認識処理インスタンス
+ * </JA>
+ * <EN>
+ * Free the work area for the 1st pass lattice.
+ *
+ * @param r [i/o] recognition process instance
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ *
+ */
+void
+pass1_lattice_free(RecogProcess *r)
+{
+  if (r->lat1work.wlist) free(r->lat1work.wlist);
+  if (r->lat1work.fbgn) free(r->lat1work.fbgn);
+  if (r->lat1work.wmark) free(r->lat1work.wmark);
+  if (r->lat1work.cand) free(r->lat1work.cand);
+  r->lat1work.wlist = NULL;
+  r->lat1work.fbgn = NULL;
+  r->lat1work.wmark = NULL;
+  r->lat1work.cand = NULL;
+  r->lat1work.wlistlen = r->lat1work.fbgnlen = r->lat1work.wmarklen = r->lat1work.candlen = 0;
+}
@@ -123,6 +123,9 @@
 
 #include <julius/julius.h>
 
+/// Number of frame shifts the sample buffer can hold beyond a window
+#define REALTIME_RING_FRAMES 64
+
 #undef RDEBUG			///< Define if you want local debug message
 
 /** 
@@ -270,7 +273,11 @@ RealTimeInit(Recog *recog)
     }
     /* MAP-CMN 用の初期ケプストラム平均を読み込んで初期化する */
     /* Initialize the initial cepstral mean data from file for MAP-CMN */
-    if (para->cmn || para->cvn) mfcc->cmn.wrk = CMN_realtime_new(para, mfcc->cmn.map_weight, mfcc->cmn.map_cmn);
+    if (para->cmn || para->cvn) {
+      mfcc->cmn.wrk = CMN_realtime_new(para, mfcc->cmn.map_weight, mfcc->cmn.map_cmn);
+      /* sliding window CMN/CVN */
+      if (mfcc->cmn.window > 0) CMN_realtime_set_window(mfcc->cmn.wrk, mfcc->cmn.window);
+    }
     /* -cmnload 指定時, CMN用のケプストラム平均の初期値をファイルから読み込む */
     /* if "-cmnload", load initial cepstral mean data from file for CMN */
     if (mfcc->cmn.load_filename) {
@@ -288,9 +295,15 @@ RealTimeInit(Recog *recog)
   /* 窓長をセット */
   /* set window length */
   r->windowlen = recog->jconf->input.framesize + 1;
-  /* 窓かけ用バッファを確保 */
-  /* set window buffer */
-  r->window = mymalloc(sizeof(SP16) * r->windowlen);
+  /* 窓かけ用バッファを確保. 窓はバッファ上をシフトしていき，
+     バッファ末尾に達したときのみ先頭へ移動する */
+  /* set sample buffer.  Windows are shifted on the buffer, and moved
+     to the head only when reached the end of buffer */
+  /* (allocated at RealTimePipeLinePrepare(), since user function
+     for parameter calculation may be registered after this) */
+  r->ringlen = r->windowlen + recog->jconf->input.frameshift * REALTIME_RING_FRAMES;
+  r->window = NULL;
+  r->fwindow = NULL;
 
   return TRUE;
 }
@@ -384,6 +397,16 @@ RealTimePipeLinePrepare(Recog *recog)
   /* 計算用の変数を初期化 */
   /* initialize variables for computation */
   r->windownum = 0;
+  r->windowhead = 0;
+  if (recog->jconf->input.type == INPUT_WAVEFORM) {
+    if (recog->calc_vector == RealTimeMFCC) {
+      /* samples are converted to float at once */
+      if (r->fwindow == NULL) r->fwindow = (float *)mymalloc(sizeof(float) * r->ringlen);
+    } else {
+      /* user function takes SP16 samples */
+      if (r->window == NULL) r->window = (SP16 *)mymalloc(sizeof(SP16) * r->ringlen);
+    }
+  }
   /* parameter check */
   for(mfcc = recog->mfcclist; mfcc; mfcc = mfcc->next) {
     /* パラメータ初期化 */
@@ -462,54 +485,41 @@ splice_mfcc(MFCCCalc *mfcc)
 
 /** 
  * <JA>
- * @brief  音声波形からパラメータベクトルを計算する.
+ * @brief  計算された base MFCC から特徴ベクトルを完成させる.
  * 
- * 窓単位で取り出された音声波形からMFCCベクトルを計算する.
- * 計算結果は mfcc->tmpmfcc に保存される. 
+ * mfcc->tmpmfcc に計算された base MFCC に対して，エネルギー正規化，
+ * デルタ・加速度係数の計算，CMN などを行う. 
  * 
  * @param mfcc [i/o] MFCC計算インスタンス
- * @param window [in] 窓単位で取り出された音声波形データ
- * @param windowlen [in] @a window の長さ
  * 
  * @return 計算成功時，TRUE を返す. デルタ計算において入力フレームが
  * 少ないなど，まだ得られていない場合は FALSE を返す. 
  * </JA>
  * <EN>
- * @brief  Compute a parameter vector from a speech window.
+ * @brief  Make a parameter vector from the base MFCC.
  *
- * This function calculates an MFCC vector from speech data windowed from
- * input speech.  The obtained MFCC vector will be stored to mfcc->tmpmfcc.
+ * Apply energy normalization, delta and acceleration computation, CMN
+ * and so on to the base MFCC in mfcc->tmpmfcc.
  * 
  * @param mfcc [i/o] MFCC calculation instance
- * @param window [in] speech input (windowed from input stream)
- * @param windowlen [in] length of @a window
  * 
  * @return TRUE on success (an vector obtained).  Returns FALSE if no
  * parameter vector obtained yet (due to delta delay).
  * </EN>
- *
- * @callgraph
- * @callergraph
- * 
  */
-boolean
-RealTimeMFCC(MFCCCalc *mfcc, SP16 *window, int windowlen)
+static boolean
+realtime_mfcc_proceed(MFCCCalc *mfcc)
 {
-  int i;
   boolean ret;
   VECT *tmpmfcc;
   Value *para;
+#ifdef RDEBUG
+  int i;
+#endif
 
   tmpmfcc = mfcc->tmpmfcc;
   para = mfcc->para;
 
-  /* 音声波形から base MFCC を計算 (recog->mfccwrk を利用) */
-  /* calculate base MFCC from waveform (use recog->mfccwrk) */
-  for (i=0; i < windowlen; i++) {
-    mfcc->wrk->bf[i+1] = (float) window[i];
-  }
-  WMP_calc(mfcc->wrk, tmpmfcc, para);
-
   if (para->energy && para->enormal) {
     /* 対数エネルギー項を正規化する */
     /* normalize log energy */
@@ -601,6 +611,85 @@ RealTimeMFCC(MFCCCalc *mfcc, SP16 *window, int windowlen)
   return TRUE;
 }
 
+/** 
+ * <JA>
+ * @brief  音声波形からパラメータベクトルを計算する.
+ * 
+ * 窓単位で取り出された音声波形からMFCCベクトルを計算する.
+ * 計算結果は mfcc->tmpmfcc に保存される. 
+ * 
+ * @param mfcc [i/o] MFCC計算インスタンス
+ * @param window [in] 窓単位で取り出された音声波形データ
+ * @param windowlen [in] @a window の長さ
+ * 
+ * @return 計算成功時，TRUE を返す. デルタ計算において入力フレームが
+ * 少ないなど，まだ得られていない場合は FALSE を返す. 
+ * </JA>
+ * <EN>
+ * @brief  Compute a parameter vector from a speech window.
+ *
+ * This function calculates an MFCC vector from speech data windowed from
+ * input speech.  The obtained MFCC vector will be stored to mfcc->tmpmfcc.
+ * 
+ * @param mfcc [i/o] MFCC calculation instance
+ * @param window [in] speech input (windowed from input stream)
+ * @param windowlen [in] length of @a window
+ * 
+ * @return TRUE on success (an vector obtained).  Returns FALSE if no
+ * parameter vector obtained yet (due to delta delay).
+ * </EN>
+ *
+ * @callgraph
+ * @callergraph
+ * 
+ */
+boolean
+RealTimeMFCC(MFCCCalc *mfcc, SP16 *window, int windowlen)
+{
+  int i;
+
+  /* 音声波形から base MFCC を計算 (recog->mfccwrk を利用) */
+  /* calculate base MFCC from waveform (use recog->mfccwrk) */
+  for (i=0; i < windowlen; i++) {
+    mfcc->wrk->bf[i+1] = (float) window[i];
+  }
+  WMP_calc(mfcc->wrk, mfcc->tmpmfcc, mfcc->para);
+
+  return(realtime_mfcc_proceed(mfcc));
+}
+
+/** 
+ * <JA>
+ * @brief  サンプルバッファ上の窓からパラメータベクトルを計算する.
+ * 
+ * RealTimeMFCC() と同じ処理を，float に変換済みのサンプルバッファ上の
+ * 窓から直接行う. 窓のコピーは行わない. 
+ * 
+ * @param mfcc [i/o] MFCC計算インスタンス
+ * @param frame [in] サンプルバッファ上の窓の先頭
+ * 
+ * @return RealTimeMFCC() と同じ. 
+ * </JA>
+ * <EN>
+ * @brief  Compute a parameter vector from a window on the sample buffer.
+ *
+ * Same as RealTimeMFCC(), but reads the window directly from the sample
+ * buffer already converted to float, without copying it.
+ * 
+ * @param mfcc [i/o] MFCC calculation instance
+ * @param frame [in] start of the window on the sample buffer
+ * 
+ * @return the same as RealTimeMFCC().
+ * </EN>
+ */
+static boolean
+realtime_mfcc_frame(MFCCCalc *mfcc, float *frame)
+{
+  WMP_calc_frame(mfcc->wrk, frame, mfcc->tmpmfcc, mfcc->para);
+
+  return(realtime_mfcc_proceed(mfcc));
+}
+
 static int
 proceed_one_frame(Recog *recog)
 {
@@ -848,10 +937,25 @@ RealTimePipeLine(SP16 *Speech, int nowlen, Recog *recog) /* Speech[0...nowlen] =
 	return(1);
       }
     }
+    /* 窓がバッファ末尾を越える場合は残りのサンプルを先頭へ移動 */
+    /* move the rest samples to the head if the window exceeds the buffer */
+    if (r->windowhead + r->windowlen > r->ringlen) {
+      if (recog->calc_vector == RealTimeMFCC) {
+	memmove(r->fwindow, &(r->fwindow[r->windowhead]), sizeof(float) * r->windownum);
+      } else {
+	memmove(r->window, &(r->window[r->windowhead]), sizeof(SP16) * r->windownum);
+      }
+      r->windowhead = 0;
+    }
     /* 窓バッファを埋められるだけ埋める */
     /* fill window buffer as many as possible */
-    for(i = min(r->windowlen - r->windownum, nowlen - now); i > 0 ; i--)
-      r->window[r->windownum++] = (float) Speech[now++];
+    if (recog->calc_vector == RealTimeMFCC) {
+      for(i = min(r->windowlen - r->windownum, nowlen - now); i > 0 ; i--)
+	r->fwindow[r->windowhead + r->windownum++] = (float) Speech[now++];
+    } else {
+      for(i = min(r->windowlen - r->windownum, nowlen - now); i > 0 ; i--)
+	r->window[r->windowhead + r->windownum++] = Speech[now++];
+    }
     /* もし窓バッファが埋まらなければ, このセグメントの処理はここで終わる. 
        処理されなかったサンプル (window[0..windownum-1]) は次回に持ち越し. */
     /* if window buffer was not filled, end processing here, keeping the
@@ -868,7 +972,12 @@ RealTimePipeLine(SP16 *Speech, int nowlen, Recog *recog) /* Speech[0...nowlen] =
       /* 窓内の音声波形から特徴量を計算して r->tmpmfcc に格納  */
       /* calculate a parameter vector from current waveform windows
 	 and store to r->tmpmfcc */
-      if ((*(recog->calc_vector))(mfcc, r->window, r->windowlen)) {
+      if (recog->calc_vector == RealTimeMFCC) {
+	mfcc->valid = realtime_mfcc_frame(mfcc, &(r->fwindow[r->windowhead]));
+      } else {
+	mfcc->valid = (*(recog->calc_vector))(mfcc, &(r->window[r->windowhead]), r->windowlen);
+      }
+      if (mfcc->valid) {
 	if (mfcc->splice > 1) {
 	  mfccvec = mfcc->splicedmfcc;
 	} else {
@@ -925,7 +1034,7 @@ RealTimePipeLine(SP16 *Speech, int nowlen, Recog *recog) /* Speech[0...nowlen] =
 
     /* 窓バッファを処理が終わった分シフト */
     /* shift window */
-    memmove(r->window, &(r->window[recog->jconf->input.frameshift]), sizeof(SP16) * (r->windowlen - recog->jconf->input.frameshift));
+    r->windowhead += recog->jconf->input.frameshift;
     r->windownum -= recog->jconf->input.frameshift;
   }
 
@@ -1085,7 +1194,7 @@ RealTimeResume(Recog *recog)
   /* 前回のセグメント時に入力をシフトしていない分をシフトする */
   /* do the last shift here */
   if (recog->jconf->input.type == INPUT_WAVEFORM) {
-    memmove(r->window, &(r->window[recog->jconf->input.frameshift]), sizeof(SP16) * (r->windowlen - recog->jconf->input.frameshift));
+    r->windowhead += recog->jconf->input.frameshift;
     r->windownum -= recog->jconf->input.frameshift;
     /* これで再開の準備が整ったので,まずは前回の処理で残っていた音声データから
        処理する */
@@ -1493,6 +1602,10 @@ realbeam_free(Recog *recog)
     free(recog->real.window);
     recog->real.window = NULL;
   }
+  if (recog->real.fwindow) {
+    free(recog->real.fwindow);
+    recog->real.fwindow = NULL;
+  }
   if (recog->real.rest_Speech) {
     free(recog->real.rest_Speech);
     recog->real.rest_Speech = NULL;
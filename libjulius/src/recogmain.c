@@ -345,6 +345,14 @@ clear_result(RecogProcess *r)
     }
     result_sentence_free(r);
   }
+
+  /* clear 1st pass lattice, its words are released below */
+  r->result.lat1 = NULL;
+  r->result.lat1_num = 0;
+  r->result.lat1_final = FALSE;
+
+  /* release memory of all graph words at once */
+  wordgraph_release_all(r);
 }
 
 /* --------------------- speech buffering ------------------ */
@@ -1012,6 +1020,13 @@ j_recognize_stream_core(Recog *recog)
       /* result.wg1 == NULL should be skipped inside callback */
       callback_exec(CALLBACK_RESULT_PASS1_GRAPH, recog);
 #endif
+      /* output the final lattice of the 1st pass */
+      ok_p = FALSE;
+      for(r=recog->process_list;r;r=r->next) {
+	if (!r->live) continue;
+	if (r->result.lat1_final) ok_p = TRUE;
+      }
+      if (ok_p) callback_exec(CALLBACK_RESULT_PASS1_LATTICE, recog);
       /* execute callback at end of pass1 */
       callback_exec(CALLBACK_EVENT_PASS1_END, recog);
       /* output frame length */
@@ -1182,6 +1197,13 @@ j_recognize_stream_core(Recog *recog)
       /* result.wg1 == NULL should be skipped inside callback */
       callback_exec(CALLBACK_RESULT_PASS1_GRAPH, recog);
 #endif
+      /* output the final lattice of the 1st pass */
+      ok_p = FALSE;
+      for(r=recog->process_list;r;r=r->next) {
+	if (!r->live) continue;
+	if (r->result.lat1_final) ok_p = TRUE;
+      }
+      if (ok_p) callback_exec(CALLBACK_RESULT_PASS1_LATTICE, recog);
       
       /* execute callback at end of pass1 */
       if (recog->triggered) {
@@ -423,6 +423,47 @@ free_all_nodes(NODE *start)
 /********** Confidence scoring ****************************************/
 /**********************************************************************/
 
+#ifdef CM_MULTIPLE_ALPHA
+/** 
+ * <JA>
+ * スコア差 @a d に対する 10^(alpha * d) を全ての alpha について求める. 
+ * alpha は等差数列なので，alpha ごとに pow() を呼ぶ代わりに，
+ * 先頭の値から公比を順に掛けて求める. 
+ * 
+ * @param d [in] 最尤仮説とのスコア差 (<= 0)
+ * @param bgn [in] alpha の開始値
+ * @param step [in] alpha の刻み幅
+ * @param num [in] alpha の数
+ * @param p [out] 結果を格納するバッファ (長さ @a num)
+ * </JA>
+ * <EN>
+ * Compute 10^(alpha * d) of a score difference @a d for all alpha
+ * values.  Since the alpha values are in arithmetic progression, the
+ * values are obtained by successive multiplication from the first one,
+ * instead of calling pow() for each alpha.
+ * 
+ * @param d [in] score difference from the best hypothesis (<= 0)
+ * @param bgn [in] first alpha value
+ * @param step [in] step of alpha values
+ * @param num [in] number of alpha values
+ * @param p [out] buffer to store the results, of length @a num
+ * </EN>
+ */
+static void
+cm_alpha_pow(LOGPROB d, LOGPROB bgn, LOGPROB step, int num, double *p)
+{
+  double v, r;
+  int j;
+
+  v = pow(10, bgn * d);
+  r = pow(10, step * d);
+  for (j = 0; j < num; j++) {
+    p[j] = v;
+    v *= r;
+  }
+}
+#endif /* CM_MULTIPLE_ALPHA */
+
 #ifdef CM_SEARCH
 /**************************************************************/
 /**** CM computation method 1(default):                  ******/
@@ -451,7 +492,7 @@ free_all_nodes(NODE *start)
 static void
 cm_init(StackDecode *sd, int wnum, LOGPROB cm_alpha
 #ifdef CM_MULTIPLE_ALPHA
-	, cm_alpha_num
+	, int cm_alpha_num
 #endif
 	)
 {
@@ -512,28 +553,30 @@ cm_store(StackDecode *sd, NODE *new)
 static void
 cm_sum_score(StackDecode *sd
 #ifdef CM_MULTIPLE_ALPHA
-	     , bgn, end, step
+	     , LOGPROB bgn, LOGPROB step, int num
 #endif
 )
 {
   NODE *node;
-  LOGPROB sum;
 #ifdef CM_MULTIPLE_ALPHA
-  LOGPROB a;
+  double p[100], sumlist[100];	/* num is limited to 100 */
   int j;
+#else
+  LOGPROB sum;
 #endif
 
   if (sd->l_start == NULL) return;	/* no hypo */
   sd->cm_tmpbestscore = sd->l_start->score; /* best hypo is at the top of the stack */
 
 #ifdef CM_MULTIPLE_ALPHA
-  for (j = 0, a = bgn; a <= end; a += step) {
-    sum = 0.0;
-    for(node = sd->l_start; node; node = node->next) {
-      sum += pow(10, a * (node->score - sd->cm_tmpbestscore));
-    }
-    sd->cmsumlist[j++] = sum;	/* store sums for each alpha coef. */
+  /* sum up for all alpha coef. at once per hypothesis */
+  for (j = 0; j < num; j++) sumlist[j] = 0.0;
+  for(node = sd->l_start; node; node = node->next) {
+    cm_alpha_pow(node->score - sd->cm_tmpbestscore, bgn, step, num, p);
+    for (j = 0; j < num; j++) sumlist[j] += p[j];
   }
+  /* store sums for each alpha coef. */
+  for (j = 0; j < num; j++) sd->cmsumlist[j] = sumlist[j];
 #else
   sum = 0.0;
   for(node = sd->l_start; node; node = node->next) {
@@ -563,19 +606,19 @@ cm_sum_score(StackDecode *sd
 static void
 cm_set_score(StackDecode *sd, NODE *node
 #ifdef CM_MULTIPLE_ALPHA
-	     , bgn, end, step
+	     , LOGPROB bgn, LOGPROB step, int num
 #endif
 	     )
 {
 #ifdef CM_MULTIPLE_ALPHA
+  double p[100];		/* num is limited to 100 */
   int j;
-  LOGPROB a;
 #endif
 
 #ifdef CM_MULTIPLE_ALPHA
-  for (j = 0, a = bgn; a <= end; a += step) {
-    node->cmscore[node->seqnum-1][j] = pow(10, a * (node->score - sd->cm_tmpbestscore)) / sd->cmsumlist[j];
-    j++;
+  cm_alpha_pow(node->score - sd->cm_tmpbestscore, bgn, step, num, p);
+  for (j = 0; j < num; j++) {
+    node->cmscore[node->seqnum-1][j] = p[j] / sd->cmsumlist[j];
   }
 #else
   node->cmscore[node->seqnum-1] = pow(10, sd->cm_alpha * (node->score - sd->cm_tmpbestscore)) / sd->cm_tmpsum;
@@ -620,6 +663,7 @@ cm_get_node(StackDecode *sd)
  * @param start [in] スタックの先頭ノード
  * @param stacknum [in] スタックサイズ
  * @param jconf [in] SEARCH用設定パラメータ
+ * @param winfo [in] 単語辞書
  * </JA>
  * <EN>
  * Compute confidence scores from N-best sentence candidates in the
@@ -629,56 +673,82 @@ cm_get_node(StackDecode *sd)
  * @param start [in] stack top node 
  * @param stacknum [in] current stack size
  * @param jconf [in] SEARCH configuration parameters
+ * @param winfo [in] word dictionary
  * </EN>
  */
 static void
-cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *jconf)
+cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *jconf, WORD_INFO *winfo)
 {
   NODE *node;
-  LOGPROB bestscore, sum, s;
+  LOGPROB bestscore;
+  LOGPROB *sentcm;
   WORD_ID w;
-  int i;
-  LOGPROB cm_alpha;
-  int j;
+  int i, len;
+#ifdef CM_MULTIPLE_ALPHA
+  double p[100], sumlist[100];	/* cm_alpha_num is limited to 100 */
+  int j, num, hyponum;
+#else
+  LOGPROB cm_alpha, sum;
+#endif
 
   /* prepare buffer */
 #ifdef CM_MULTIPLE_ALPHA
+  num = jconf->annotate.cm_alpha_num;
   if (sd->cmsumlist) {
-    if (sd->cmsumlistlen < jconf->annotate.cm_alpha_num) {
+    if (sd->cmsumlistlen < num) {
       free(sd->cmsumlist);
       sd->cmsumlist = NULL;
     }
   }
   if (sd->cmsumlist == NULL) {
-    sd->cmsumlist = (LOGPROB *)mymalloc(sizeof(LOGPROB) * jconf->annotate.cm_alpha_num);
-    sd->cmsumlistlen = cm_alpha_num;
+    sd->cmsumlist = (LOGPROB *)mymalloc(sizeof(LOGPROB) * num);
+    sd->cmsumlistlen = num;
   }
+  /* sentence scores for each alpha: [alpha][sentence] */
+  len = stacknum * num;
+#else
+  len = stacknum;
 #endif    
   if (sd->sentcm == NULL) {		/* not allocated yet */
-    sd->sentcm = (LOGPROB *)mymalloc(sizeof(LOGPROB)*stacknum);
-    sd->sentnum = stacknum;
-  } else if (sd->sentnum < stacknum) { /* need expanded */
-    sd->sentcm = (LOGPROB *)myrealloc(sd->sentcm, sizeof(LOGPROB)*stacknum);
-    sd->sentnum = stacknum;
+    sd->sentcm = (LOGPROB *)mymalloc(sizeof(LOGPROB)*len);
+    sd->sentnum = len;
+  } else if (sd->sentnum < len) { /* need expanded */
+    sd->sentcm = (LOGPROB *)myrealloc(sd->sentcm, sizeof(LOGPROB)*len);
+    sd->sentnum = len;
   }
+  /* word cm buffer is kept cleared, only words in the hypotheses are touched */
   if (sd->wordcm == NULL) {
     sd->wordcm = (LOGPROB *)mymalloc(sizeof(LOGPROB) * winfo->num);
+    for(w=0;w<winfo->num;w++) sd->wordcm[w] = 0.0;
     sd->wordnum = winfo->num;
   } else if (sd->wordnum < winfo->num) {
-    sd->wordcm = (LOGPROB *)myremalloc(sd->wordcm, sizeof(LOGPROB) * winfo->num);
+    sd->wordcm = (LOGPROB *)myrealloc(sd->wordcm, sizeof(LOGPROB) * winfo->num);
+    for(w=sd->wordnum;w<winfo->num;w++) sd->wordcm[w] = 0.0;
     sd->wordnum = winfo->num;
   }
   
-  cm_alpha = jconf->annotate.cm_alpha;
+  /* get best score */
+  bestscore = start->score;
 #ifdef CM_MULTIPLE_ALPHA
-  for (j = 0, cm_alpha = jconf->annotate.cm_alpha_bgn; cm_alpha <= jconf->annotate.cm_alpha_end; cm_alpha += jconf->annotate.cm_alpha_step) {
-#endif
-    /* clear whole word cm buffer */
-    for(w=0;w<sd->wordnum;w++) {
-      sd->wordcm[w] = 0.0;
+  /* compute sentence scores and their sums for all alpha at once */
+  for (j = 0; j < num; j++) sumlist[j] = 0.0;
+  i = 0;
+  for (node = start; node != NULL; node = node->next) {
+    cm_alpha_pow(node->score - bestscore, jconf->annotate.cm_alpha_bgn, jconf->annotate.cm_alpha_step, num, p);
+    for (j = 0; j < num; j++) {
+      sd->sentcm[j * stacknum + i] = p[j];
+      sumlist[j] += p[j];
     }
-    /* get best score */
-    bestscore = start->score;
+    i++;
+  }
+  hyponum = i;
+  for (j = 0; j < num; j++) {
+    sentcm = &(sd->sentcm[j * stacknum]);
+    /* compute sentence posteriori probabilities */
+    for (i = 0; i < hyponum; i++) sentcm[i] /= sumlist[j];
+#else
+    cm_alpha = jconf->annotate.cm_alpha;
+    sentcm = sd->sentcm;
     /* compute sum score of all hypothesis */
     sum = 0.0;
     for (node = start; node != NULL; node = node->next) {
@@ -687,14 +757,15 @@ cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *
     /* compute sentence posteriori probabilities */
     i = 0;
     for (node = start; node != NULL; node = node->next) {
-      sd->sentcm[i] = pow(10, cm_alpha * (node->score - bestscore)) / sum;
+      sentcm[i] = pow(10, cm_alpha * (node->score - bestscore)) / sum;
       i++;
     }
+#endif
     /* compute word posteriori probabilities */
     i = 0;
     for (node = start; node != NULL; node = node->next) {
       for (w=0;w<node->seqnum;w++) {
-	sd->wordcm[node->seq[w]] += sd->sentcm[i];
+	sd->wordcm[node->seq[w]] += sentcm[i];
       }
       i++;
     }
@@ -708,8 +779,13 @@ cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *
 #endif
       }
     }
+    /* clear the touched words */
+    for (node = start; node != NULL; node = node->next) {
+      for (w=0;w<node->seqnum;w++) {
+	sd->wordcm[node->seq[w]] = 0.0;
+      }
+    }
 #ifdef CM_MULTIPLE_ALPHA
-    j++;
   }
 #endif
 }
@@ -1015,9 +1091,16 @@ store_result_pass2(NODE *hypo, RecogProcess *r)
     s->word[i] = hypo->seq[hypo->seqnum - 1 - i];
   }
 #ifdef CONFIDENCE_MEASURE
+#ifdef CM_MULTIPLE_ALPHA
+  for (i = 0; i < hypo->seqnum; i++) {
+    memcpy(s->confidence_alpha[i], hypo->cmscore[hypo->seqnum - 1 - i], sizeof(LOGPROB) * r->config->annotate.cm_alpha_num);
+    s->confidence[i] = hypo->cmscore[hypo->seqnum - 1 - i][0];
+  }
+#else
   for (i = 0; i < hypo->seqnum; i++) {
     s->confidence[i] = hypo->cmscore[hypo->seqnum - 1 - i];
   }
+#endif
 #endif
 
   s->score = hypo->score;
@@ -1097,7 +1180,7 @@ result_reorder_and_output(NODE **r_start, NODE **r_bottom, int *r_stacknum, int
 
 #ifdef CM_NBEST 
   /* compute CM from the N-best sentence candidates */
-  cm_compute_from_nbest(&(r->pass2), *r_start, *r_stacknum, r->config);
+  cm_compute_from_nbest(&(r->pass2), *r_start, *r_stacknum, r->config, r->lm->winfo);
 #endif
   num = 0;
   while ((now = get_best_from_stack(r_start,r_stacknum)) != NULL && num < ncan) {
@@ -1170,7 +1253,7 @@ pass2_finalize_on_no_result(RecogProcess *r, boolean use_1pass_as_final)
 #ifdef CONFIDENCE_MEASURE
   /* fill in null values */
 #ifdef CM_MULTIPLE_ALPHA
-  for(j=0;j<jconf->annotate.cm_alpha_num;j++) {
+  for(j=0;j<r->config->annotate.cm_alpha_num;j++) {
     for(i=0;i<now->seqnum;i++) now->cmscore[i][j] = 0.0;
   }
 #else
@@ -1353,7 +1436,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
   if (jconf->pass2.enveloped_bestfirst_width >= 0) wb_init(dwrk);
 
   if (jconf->graph.enabled) {
-    wordgraph_init(r->wchmm);
+    wordgraph_init(r);
   }
 
   /* 
@@ -1418,8 +1501,8 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
   cm_sum_score(dwrk
 #ifdef CM_MULTIPLE_ALPHA
 	       , jconf->annotate.cm_alpha_bgn
-	       , jconf->annotate.cm_alpha_end
 	       , jconf->annotate.cm_alpha_step
+	       , jconf->annotate.cm_alpha_num
 #endif
 	       );
 
@@ -1428,8 +1511,8 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
     cm_set_score(dwrk, new
 #ifdef CM_MULTIPLE_ALPHA
 		 , jconf->annotate.cm_alpha_bgn
-		 , jconf->annotate.cm_alpha_end
 		 , jconf->annotate.cm_alpha_step
+		 , jconf->annotate.cm_alpha_num
 #endif
 		 );
 #ifdef CM_SEARCH_LIMIT
@@ -1778,7 +1861,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					      now->lscore,
 #ifdef CM_SEARCH
+#ifdef CM_MULTIPLE_ALPHA
+					      new->cmscore[new->seqnum-1][0],
+#else
 					      new->cmscore[new->seqnum-1],
+#endif
 #else
 					      LOG_ZERO,
 #endif
@@ -2014,7 +2101,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					  now->lscore,
 #ifdef CM_SEARCH
+#ifdef CM_MULTIPLE_ALPHA
+					  new->cmscore[new->seqnum-2][0],
+#else
 					  new->cmscore[new->seqnum-2],
+#endif
 #else
 					  LOG_ZERO,
 #endif
@@ -2037,8 +2128,8 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
     cm_sum_score(dwrk
 #ifdef CM_MULTIPLE_ALPHA
 		 , jconf->annotate.cm_alpha_bgn 
-		 , jconf->annotate.cm_alpha_end
 		 , jconf->annotate.cm_alpha_step
+		 , jconf->annotate.cm_alpha_num
 #endif
 		 );
     /* compute CM and put the generated hypotheses to global stack */
@@ -2046,8 +2137,8 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
       cm_set_score(dwrk, new
 #ifdef CM_MULTIPLE_ALPHA
 		   , jconf->annotate.cm_alpha_bgn
-		   , jconf->annotate.cm_alpha_end
 		   , jconf->annotate.cm_alpha_step
+		   , jconf->annotate.cm_alpha_num
 #endif
 		   );
 #ifdef CM_SEARCH_LIMIT
@@ -2103,7 +2194,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					  now->lscore,
 #ifdef CM_SEARCH
+#ifdef CM_MULTIPLE_ALPHA
+					  new->cmscore[new->seqnum-2][0],
+#else
 					  new->cmscore[new->seqnum-2],
+#endif
 #else
 					  LOG_ZERO,
 #endif
@@ -44,6 +44,9 @@
 /* wchmm = word conjunction HMM = lexicon tree */
 
 #include <julius/julius.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 #define WCHMM_SIZE_CHECK		///< If defined, do wchmm size estimation (for debug only)
@@ -83,6 +86,12 @@ wchmm_new()
   w->lcdset_mroot = NULL;
 #endif /* PASS1_IWCD */
   w->wrk.out_from_len = 0;
+  w->seg = NULL;
+  w->segnum = w->segmax = 0;
+  w->maxwordnum = 0;
+  w->garbage = 0;
+  w->build_time = 0.0;
+  w->build_threads = 1;
   /* reset user function entry point */
   w->uni_prob_user = NULL;
   w->bi_prob_user = NULL;
@@ -104,6 +113,8 @@ wchmm_new()
 static void
 wchmm_init(WCHMM_INFO *wchmm)
 {
+  int i;
+
   /* the resulting tree size is typically half of total state num */
   wchmm->maxwcn = wchmm->winfo->totalstatenum / 2;
   wchmm->state = (WCHMM_STATE *)mymalloc(sizeof(WCHMM_STATE)*wchmm->maxwcn);
@@ -112,6 +123,7 @@ wchmm_init(WCHMM_INFO *wchmm)
   wchmm->ac = (A_CELL2 **)mymalloc(sizeof(A_CELL2 *)*wchmm->maxwcn);
   wchmm->stend = (WORD_ID *)mymalloc(sizeof(WORD_ID)*wchmm->maxwcn);
   wchmm->offset = (int **)mymalloc(sizeof(int *)*wchmm->winfo->num);
+  for(i=0;i<wchmm->winfo->num;i++) wchmm->offset[i] = NULL;
   wchmm->wordend = (int *)mymalloc(sizeof(int)*wchmm->winfo->num);
   wchmm->maxstartnum = STARTNODE_STEP;
   wchmm->startnode = (int *)mymalloc(sizeof(int)*STARTNODE_STEP);
@@ -148,6 +160,47 @@ wchmm_init(WCHMM_INFO *wchmm)
   wchmm->n = 0;
 }
 
+/** 
+ * <JA>
+ * 木構造化辞書のノード格納領域と単語先頭ノード格納領域を，それぞれ
+ * 指定数以上になるよう伸長する. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param nodenum [in] 必要なノード数
+ * @param startnum [in] 必要な単語先頭ノード数
+ * </JA>
+ * <EN>
+ * Expand state-related area and word-start nodes area in a tree lexicon
+ * to hold at least the given number of elements.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param nodenum [in] required number of nodes
+ * @param startnum [in] required number of word-start nodes
+ * </EN>
+ */
+static void
+wchmm_reserve(WCHMM_INFO *wchmm, int nodenum, int startnum)
+{
+  if (nodenum > wchmm->maxwcn) {
+    wchmm->maxwcn = nodenum;
+    wchmm->state = (WCHMM_STATE *)myrealloc(wchmm->state, sizeof(WCHMM_STATE)*wchmm->maxwcn);
+    wchmm->self_a = (LOGPROB *)myrealloc(wchmm->self_a, sizeof(LOGPROB)*wchmm->maxwcn);
+    wchmm->next_a = (LOGPROB *)myrealloc(wchmm->next_a, sizeof(LOGPROB)*wchmm->maxwcn);
+    wchmm->ac = (A_CELL2 **)myrealloc(wchmm->ac, sizeof(A_CELL2 *)*wchmm->maxwcn);
+    wchmm->stend = (WORD_ID *)myrealloc(wchmm->stend, sizeof(WORD_ID)*wchmm->maxwcn);
+#ifdef PASS1_IWCD
+    wchmm->outstyle = (unsigned char *)myrealloc(wchmm->outstyle, sizeof(unsigned char)*wchmm->maxwcn);
+#endif
+  }
+  if (startnum > wchmm->maxstartnum) {
+    wchmm->maxstartnum = startnum;
+    wchmm->startnode = (int *)myrealloc(wchmm->startnode, sizeof(int) * wchmm->maxstartnum);
+    if (wchmm->category_tree) {
+      wchmm->start2wid = (WORD_ID *)myrealloc(wchmm->start2wid, sizeof(WORD_ID) * wchmm->maxstartnum);
+    }
+  }
+}
+
 /** 
  * <JA>
  * 木構造化辞書の状態格納領域を MAXWCNSTEP 分だけ伸長する. 
@@ -164,15 +217,7 @@ static void
 wchmm_extend(WCHMM_INFO *wchmm)
 {
   /* practical value! */
-  wchmm->maxwcn += wchmm->winfo->totalstatenum / 6;
-  wchmm->state = (WCHMM_STATE *)myrealloc(wchmm->state, sizeof(WCHMM_STATE)*wchmm->maxwcn);
-  wchmm->self_a = (LOGPROB *)myrealloc(wchmm->self_a, sizeof(LOGPROB)*wchmm->maxwcn);
-  wchmm->next_a = (LOGPROB *)myrealloc(wchmm->next_a, sizeof(LOGPROB)*wchmm->maxwcn);
-  wchmm->ac = (A_CELL2 **)myrealloc(wchmm->ac, sizeof(A_CELL2 *)*wchmm->maxwcn);
-  wchmm->stend = (WORD_ID *)myrealloc(wchmm->stend, sizeof(WORD_ID)*wchmm->maxwcn);
-#ifdef PASS1_IWCD
-  wchmm->outstyle = (unsigned char *)myrealloc(wchmm->outstyle, sizeof(unsigned char)*wchmm->maxwcn);
-#endif
+  wchmm_reserve(wchmm, wchmm->maxwcn + wchmm->winfo->totalstatenum / 6, 0);
 }
 
 /** 
@@ -190,11 +235,7 @@ wchmm_extend(WCHMM_INFO *wchmm)
 static void
 wchmm_extend_startnode(WCHMM_INFO *wchmm)
 {
-  wchmm->maxstartnum += STARTNODE_STEP;
-  wchmm->startnode = (int *)myrealloc(wchmm->startnode, sizeof(int) * wchmm->maxstartnum);
-  if (wchmm->category_tree) {
-    wchmm->start2wid = (WORD_ID *)myrealloc(wchmm->start2wid, sizeof(WORD_ID) * wchmm->maxstartnum);
-  }
+  wchmm_reserve(wchmm, 0, wchmm->maxstartnum + STARTNODE_STEP);
 }
 
 /** 
@@ -257,6 +298,7 @@ wchmm_free(WCHMM_INFO *w)
     free(w->wrk.out_a_next);
     w->wrk.out_from_len = 0;
   }
+  if (w->seg != NULL) free(w->seg);
   free(w);
 }
 
@@ -265,126 +307,238 @@ wchmm_free(WCHMM_INFO *w)
 /*********** Word sort functions for tree construction ********/
 /**************************************************************/
 
-/** 
- * <JA>
- * 単語を音素のならびでソートするqsort_reentrant関数
- * 
- * @param widx1 [in] 単語ID 1 へのポインタ
- * @param widx2 [in] 単語ID 2 へのポインタ
- * 
- * @return 単語widx2が単語widx1の一部か昇順であれば 1, 単語widx1が単語widx2の一部か昇順であれば -1, 全く同じ音素並びであれば 0 を返す. 
- * </JA>
- * <EN>
- * qsort_reentrant function to sort words by their phoneme sequence.
+/**
+ * Rank of a logical %HMM in the order of the names, to compare phones
+ * by integer instead of name string.  Looked up by the address of the
+ * logical %HMM.
  * 
- * @param widx1 [in] pointer to word id #1
- * @param widx2 [in] pointer to wrod id #2
+ */
+typedef struct {
+  HMM_Logical *hmm;		///< Logical %HMM
+  int rank;			///< Rank of the name (same for the same name)
+} WCHMM_PHONE_RANK;
+
+/**
+ * A word to be sorted by its phone sequence for tree construction.
  * 
- * @return 1 if word[widx2] is part of word[widx1], -1 if word[widx1] is part of word[widx2], or 0 if the two words are equal.
- * </EN>
  */
-static int
-compare_wseq(WORD_ID *widx1, WORD_ID *widx2, WORD_INFO *winfo)
-{
-  int len1, len2, n;
-  int p=0;
-  
-  len1 = winfo->wlen[*widx1];
-  len2 = winfo->wlen[*widx2];
-
-  n=0;
-  /*  while (n < len1 && n < len2 && (p = (int)winfo->wseq[*widx1][n] - (int)winfo->wseq[*widx2][n]) == 0 ) n++;*/
-  while (n < len1 && n < len2 && (p = strcmp((winfo->wseq[*widx1][n])->name, (winfo->wseq[*widx2][n])->name)) == 0 ) n++;
-  if (n < len1) {
-    if (n < len2) {
-      /* differ */
-      return(p);
-    } else {
-      /* 2 is part of 1 */
-      return(1);
-    }
-  } else {
-    if (n < len2) {
-      /* 1 is part of 2 */
-      return(-1);
-    } else {
-      /* same */
-      return(0);
-    }
-  }
-}
+typedef struct {
+  WORD_ID w;			///< Word ID
+  int cate;			///< Category ID, or 0 when not sorted by category
+  int len;			///< Number of phones
+  int *rank;			///< Phone sequence as the ranks [0..len-1]
+} WCHMM_SORT_ITEM;
+
+/// Hash of a logical %HMM address for the rank table of size @a s (power of 2)
+#define PHONE_RANK_HASH(p, s) ((int)(((size_t)(p) >> 3) & ((s) - 1)))
+
+/// First phone of a sort item as a counting sort key, 0 for an empty word
+#define SORT_ITEM_HEAD(x) ((x)->len > 0 ? (x)->rank[0] + 1 : 0)
 
 /** 
  * <JA>
- * 単語IDの集合 windex[bgn..bgn+len-1] を単語の音素ならびでソートする. 
+ * 論理HMMを名前でソートするqsort関数
  * 
- * @param winfo [in] 単語辞書
- * @param windex [i/o] 単語IDのインデックス列（内部でソートされる）
- * @param bgn [in] @a windex のソート開始点
- * @param len [in] @a windex の @a bgn からのソートする要素数
+ * @param a [in] 要素1へのポインタ
+ * @param b [in] 要素2へのポインタ
+ * 
+ * @return 名前の strcmp の結果
  * </JA>
  * <EN>
- * Sort word IDs in windex[bgn..bgn+len-1] by their phoneme sequence order.
+ * qsort function to sort logical HMMs by their names.
  * 
- * @param winfo [in] word lexicon
- * @param windex [i/o] index sequence of word IDs, (will be sorted in this function)
- * @param bgn [in] start point to sort in @a windex
- * @param len [in] length of indexes to be sorted from @a bgn
+ * @param a [in] pointer to element #1
+ * @param b [in] pointer to element #2
+ * 
+ * @return the result of strcmp of the names.
  * </EN>
  */
-static void
-wchmm_sort_idx_by_wseq(WORD_INFO *winfo, WORD_ID *windex, WORD_ID bgn, WORD_ID len)
+static int
+compare_phone_name(WCHMM_PHONE_RANK *a, WCHMM_PHONE_RANK *b)
 {
-  qsort_reentrant(&(windex[bgn]), len, sizeof(WORD_ID), (int (*)(const void *, const void *, void *))compare_wseq, winfo);
+  return(strcmp(a->hmm->name, b->hmm->name));
 }
 
 /** 
  * <JA>
- * 単語をカテゴリIDでソートするqsort関数. 
+ * 単語をカテゴリおよび音素のならびでソートするqsort関数. 同じ音素並びの
+ * 単語は単語ID順とする. 
  * 
- * @param widx1 [in] 要素1へのポインタ
- * @param widx2 [in] 要素2へのポインタ
+ * @param a [in] 要素1へのポインタ
+ * @param b [in] 要素2へのポインタ
  * 
- * @return 
+ * @return 単語bが単語aの一部か昇順であれば 1, 単語aが単語bの一部か昇順で
+ * あれば -1 を返す. 
  * </JA>
  * <EN>
- * qsort function to sort words by their category ID.
+ * qsort function to sort words by their category and phoneme sequence.
+ * Words of the same phoneme sequence are ordered by their word IDs.
  * 
- * @param widx1 [in] pointer to element #1
- * @param widx2 [in] pointer to element #2
+ * @param a [in] pointer to element #1
+ * @param b [in] pointer to element #2
  * 
- * @return 
+ * @return 1 if word b is part of word a or precedes it, -1 if word a is
+ * part of word b or precedes it.
  * </EN>
  */
 static int
-compare_category(WORD_ID *widx1, WORD_ID *widx2, WORD_INFO *winfo)
+compare_sort_item(WCHMM_SORT_ITEM *a, WCHMM_SORT_ITEM *b)
 {
-  int c1,c2;
-  c1 = winfo->wton[*widx1];
-  c2 = winfo->wton[*widx2];
-  return(c1 - c2);
+  int k, len;
+
+  if (a->cate != b->cate) return(a->cate - b->cate);
+  len = (a->len < b->len) ? a->len : b->len;
+  for(k=0;k<len;k++) {
+    if (a->rank[k] != b->rank[k]) return(a->rank[k] - b->rank[k]);
+  }
+  if (a->len != b->len) return(a->len - b->len);
+  return((int)a->w - (int)b->w);
 }
 
 /** 
  * <JA>
- * 単語ID集合 windex[0..len-1] をカテゴリIDでソートする. 
+ * @brief  単語 [bgn..end-1] を音素のならびでソートする. 
+ *
+ * 各音素を論理HMM名の順位に置き換えてから，先頭音素（カテゴリ木の
+ * 場合はカテゴリと先頭音素）で計数ソートを行い，同じ先頭音素を持つ
+ * グループごとに並列にソートする. 
  * 
- * @param winfo [in] 単語辞書
- * @param windex [i/o] 単語IDのインデックス列（内部でソートされる）
- * @param len [in] @a windex の要素数
+ * @param wchmm [in] 木構造化辞書
+ * @param bgn [in] 最初の単語ID
+ * @param end [in] 最後の単語ID + 1
+ * @param threads [in] スレッド数
+ * @param rbuf_ret [out] 順位列の格納領域（使用後 free すること）
+ * 
+ * @return ソートされた単語の配列（使用後 free すること）
  * </JA>
  * <EN>
- * Sort word IDs in windex[0..len-1] by their category ID.
+ * @brief  Sort words [bgn..end-1] by their phoneme sequence order.
+ *
+ * Each phone is replaced by the rank of its logical HMM name.  Then
+ * the words are grouped by their first phone (and category for category
+ * tree) by counting sort, and each group is sorted in parallel.
  * 
- * @param winfo [in] tree lexicon
- * @param windex [i/o] index sequence of word IDs, (will be sorted in this function)
- * @param len [in] number of elements in @a windex
+ * @param wchmm [in] tree lexicon
+ * @param bgn [in] first word ID
+ * @param end [in] last word ID + 1
+ * @param threads [in] number of threads
+ * @param rbuf_ret [out] area of the rank sequences (should be freed after use)
+ * 
+ * @return the sorted words (should be freed after use).
  * </EN>
  */
-static void
-wchmm_sort_idx_by_category(WORD_INFO *winfo, WORD_ID *windex, WORD_ID len)
+static WCHMM_SORT_ITEM *
+wchmm_sort_words(WCHMM_INFO *wchmm, WORD_ID bgn, WORD_ID end, int threads, int **rbuf_ret)
 {
-  qsort_reentrant(windex, len, sizeof(WORD_ID), (int (*)(const void *, const void *, void *))compare_category, winfo);
+  WORD_INFO *winfo;
+  HMM_Logical *l;
+  WCHMM_PHONE_RANK *pr, *htab;
+  WCHMM_SORT_ITEM *items, *tmp;
+  int *rbuf, *count, *bstart;
+  int pnum, rnum, cnum, hsize, h, len, total, i, j, b, bnum;
+
+  winfo = wchmm->winfo;
+  len = end - bgn;
+
+  /* give each logical HMM the rank of its name */
+  pnum = 0;
+  for(l=wchmm->hmminfo->lgstart;l;l=l->next) pnum++;
+  pr = (WCHMM_PHONE_RANK *)mymalloc(sizeof(WCHMM_PHONE_RANK) * (pnum + 1));
+  i = 0;
+  for(l=wchmm->hmminfo->lgstart;l;l=l->next) pr[i++].hmm = l;
+  qsort(pr, pnum, sizeof(WCHMM_PHONE_RANK), (int (*)(const void *, const void *))compare_phone_name);
+  rnum = 0;
+  for(i=0;i<pnum;i++) {
+    if (i > 0 && !strmatch(pr[i].hmm->name, pr[i-1].hmm->name)) rnum++;
+    pr[i].rank = rnum;
+  }
+  rnum++;
+  /* index the ranks by address with open addressing */
+  hsize = 1;
+  while (hsize < pnum * 2) hsize <<= 1;
+  htab = (WCHMM_PHONE_RANK *)mymalloc(sizeof(WCHMM_PHONE_RANK) * hsize);
+  for(i=0;i<hsize;i++) htab[i].hmm = NULL;
+  for(i=0;i<pnum;i++) {
+    for(h=PHONE_RANK_HASH(pr[i].hmm, hsize);htab[h].hmm!=NULL;h=(h+1)&(hsize-1));
+    htab[h] = pr[i];
+  }
+  free(pr);
+
+  /* convert phone sequences to rank sequences */
+  total = 0;
+  for(i=bgn;i<end;i++) total += winfo->wlen[i];
+  rbuf = (int *)mymalloc(sizeof(int) * (total + 1));
+  items = (WCHMM_SORT_ITEM *)mymalloc(sizeof(WCHMM_SORT_ITEM) * (len + 1));
+  cnum = 1;
+  total = 0;
+  for(j=0;j<len;j++) {
+    items[j].w = bgn + j;
+    items[j].len = winfo->wlen[bgn + j];
+    items[j].rank = &(rbuf[total]);
+    total += items[j].len;
+    if (wchmm->category_tree && wchmm->lmtype == LM_DFA) {
+      items[j].cate = winfo->wton[bgn + j];
+      if (cnum <= items[j].cate) cnum = items[j].cate + 1;
+    } else {
+      items[j].cate = 0;
+    }
+  }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(threads) private(i)
+#endif
+  for(j=0;j<len;j++) {
+    HMM_Logical *key;
+    int k;
+    for(i=0;i<items[j].len;i++) {
+      key = winfo->wseq[items[j].w][i];
+      for(k=PHONE_RANK_HASH(key, hsize);htab[k].hmm!=key;k=(k+1)&(hsize-1)) {
+	if (htab[k].hmm == NULL) {
+	  j_internal_error("wchmm_sort_words: phone \"%s\" not in logical HMM list\n", key->name);
+	}
+      }
+      items[j].rank[i] = htab[k].rank;
+    }
+  }
+  free(htab);
+
+  /* stable counting sort by first phone, and then by category */
+  tmp = (WCHMM_SORT_ITEM *)mymalloc(sizeof(WCHMM_SORT_ITEM) * (len + 1));
+  i = (rnum + 1 > cnum) ? rnum + 1 : cnum;
+  count = (int *)mymalloc(sizeof(int) * (i + 1));
+  for(i=0;i<=rnum+1;i++) count[i] = 0;
+  for(j=0;j<len;j++) count[SORT_ITEM_HEAD(&(items[j])) + 1]++;
+  for(i=1;i<=rnum+1;i++) count[i] += count[i-1];
+  for(j=0;j<len;j++) tmp[count[SORT_ITEM_HEAD(&(items[j]))]++] = items[j];
+  if (cnum > 1) {
+    for(i=0;i<=cnum;i++) count[i] = 0;
+    for(j=0;j<len;j++) count[tmp[j].cate + 1]++;
+    for(i=1;i<=cnum;i++) count[i] += count[i-1];
+    for(j=0;j<len;j++) items[count[tmp[j].cate]++] = tmp[j];
+  } else {
+    memcpy(items, tmp, sizeof(WCHMM_SORT_ITEM) * len);
+  }
+  free(count);
+  free(tmp);
+
+  /* sort each group of the same first phone */
+  bstart = (int *)mymalloc(sizeof(int) * (len + 1));
+  bnum = 0;
+  for(j=0;j<len;j++) {
+    if (j == 0 || items[j].cate != items[j-1].cate || SORT_ITEM_HEAD(&(items[j])) != SORT_ITEM_HEAD(&(items[j-1]))) {
+      bstart[bnum++] = j;
+    }
+  }
+  bstart[bnum] = len;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+  for(b=0;b<bnum;b++) {
+    qsort(&(items[bstart[b]]), bstart[b+1] - bstart[b], sizeof(WCHMM_SORT_ITEM), (int (*)(const void *, const void *))compare_sort_item);
+  }
+  free(bstart);
+
+  *rbuf_ret = rbuf;
+  return(items);
 }
   
 
@@ -855,20 +1009,29 @@ wchmm_duplicate_state(WCHMM_INFO *wchmm, int node, int word) /* source node, new
 
 /** 
  * <JA>
- * 木構造化辞書全体を走査して，すべての同音語について単語終端状態の独立化
- * を行う. 
+ * 木構造化辞書を走査して，指定範囲の単語のすべての同音語について
+ * 単語終端状態の独立化を行う. 範囲の単語の終端ノードは @a nbgn 以降に
+ * あること. 
  * 
  * @param wchmm [i/o] 木構造化辞書
+ * @param bgn [in] 対象とする最初の単語ID
+ * @param end [in] 対象とする最後の単語ID + 1
+ * @param nbgn [in] 範囲の単語の最初のノード番号
  * </JA>
  * <EN>
- * Scan the whole lexicon tree to find already registered homophones, and
- * make word-end nodes of the found homophones isolated from others.
+ * Scan the lexicon tree to find already registered homophones in the
+ * given word range, and make word-end nodes of the found homophones
+ * isolated from others.  Word-end nodes of the words should be located
+ * at or after @a nbgn.
  * 
  * @param wchmm [i/o] tree lexicon
+ * @param bgn [in] first word ID
+ * @param end [in] last word ID + 1
+ * @param nbgn [in] first node ID of the words
  * </EN>
  */
 static int
-wchmm_duplicate_leafnode(WCHMM_INFO *wchmm)
+wchmm_duplicate_leafnode(WCHMM_INFO *wchmm, WORD_ID bgn, WORD_ID end, int nbgn)
 {
   int w, nlast, n, narc, narc_model;
   boolean *dupw;		/* node marker */
@@ -878,12 +1041,13 @@ wchmm_duplicate_leafnode(WCHMM_INFO *wchmm)
   dupcount = 0;
 
   nlast = wchmm->n;
-  dupw = (boolean *)mymalloc(sizeof(boolean) * nlast);
-  for(n=0;n<nlast;n++) dupw[n] = FALSE;	/* initialize all marker */
+  if (nlast <= nbgn) return 0;
+  dupw = (boolean *)mymalloc(sizeof(boolean) * (nlast - nbgn));
+  for(n=0;n<nlast-nbgn;n++) dupw[n] = FALSE;	/* initialize all marker */
 
-  for (w=0;w<wchmm->winfo->num;w++) {
+  for (w=bgn;w<end;w++) {
     n = wchmm->wordend[w];
-    if (dupw[n]) {		/* if already marked (2nd time or later */
+    if (dupw[n-nbgn]) {		/* if already marked (2nd time or later */
       wchmm_duplicate_state(wchmm, n, w); dupcount++; /* duplicate */
     } else {			/* if not marked yet (1st time) */
       /* try to find an arc outside the word */
@@ -919,7 +1083,7 @@ wchmm_duplicate_leafnode(WCHMM_INFO *wchmm)
 	wchmm->stend[n] = w;
       }
       /* mark node 'n' */
-      dupw[n] = TRUE;
+      dupw[n-nbgn] = TRUE;
     }
   }
   free(dupw);
@@ -1002,8 +1166,10 @@ wchmm_add_word(WCHMM_INFO *wchmm, int word, int matchlen, int matchword, boolean
   word_len      = wchmm->winfo->wlen[word];
   matchword_len = wchmm->winfo->wlen[matchword];
 
-  /* malloc phone offset area */
-  wchmm->offset[word] = (int *)mybmalloc2(sizeof(int)*word_len, &(wchmm->malloc_root));
+  /* malloc phone offset area if not assigned yet */
+  if (wchmm->offset[word] == NULL) {
+    wchmm->offset[word] = (int *)mybmalloc2(sizeof(int)*word_len, &(wchmm->malloc_root));
+  }
 
   /* allocate unshared (new) part */
   add_head = matchlen;
@@ -1394,22 +1560,26 @@ wchmm_add_word(WCHMM_INFO *wchmm, int word, int matchlen, int matchword, boolean
  * (non multipath)
  * 
  * @param wchmm [i/o] 木構造化辞書
+ * @param bgn [in] 対象とする最初の単語ID
+ * @param end [in] 対象とする最後の単語ID + 1
  * </JA>
  * <EN>
  * Scan the lexicon tree to make list of emission probability from the word end
  * state. (non multipath)
  * 
  * @param wchmm [i/o] tree lexicon
+ * @param bgn [in] first word ID
+ * @param end [in] last word ID + 1
  * </EN>
  */
 static void
-wchmm_calc_wordend_arc(WCHMM_INFO *wchmm)
+wchmm_calc_wordend_arc(WCHMM_INFO *wchmm, WORD_ID bgn, WORD_ID end)
 {
   WORD_ID w;
   HTK_HMM_Trans *tr;
   LOGPROB a;
 
-  for (w=0;w<wchmm->winfo->num;w++) {
+  for (w=bgn;w<end;w++) {
     tr = hmm_logical_trans(wchmm->winfo->wseq[w][wchmm->winfo->wlen[w]-1]);
     a = tr->a[tr->statenum-2][tr->statenum-1];
     wchmm->wordend_a[w] = a;
@@ -1676,11 +1846,11 @@ build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 
   if (! wchmm->hmminfo->multipath) {
     /* 同一音素系列を持つ単語同士の leaf node を2重化して区別する */
-    num_duplicated = wchmm_duplicate_leafnode(wchmm);
+    num_duplicated = wchmm_duplicate_leafnode(wchmm, 0, wchmm->winfo->num, 0);
     jlog("STAT:  %d leaf nodes are made unshared\n", num_duplicated);
     
     /* 単語の終端から外への遷移確率を求めておく */
-    wchmm_calc_wordend_arc(wchmm);
+    wchmm_calc_wordend_arc(wchmm, 0, wchmm->winfo->num);
   }
 
   /* wchmmの整合性をチェックする */
@@ -1720,6 +1890,346 @@ build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
   return ok_p;
 }
 
+/** 
+ * <JA>
+ * 計時用の現在時刻（秒）を返す. 
+ * 
+ * @return 現在時刻（秒）
+ * </JA>
+ * <EN>
+ * Return current time in seconds for timing.
+ * 
+ * @return the current time in seconds.
+ * </EN>
+ */
+static double
+wchmm_timer()
+{
+#ifdef _OPENMP
+  return(omp_get_wtime());
+#else
+  return((double)clock() / CLOCKS_PER_SEC);
+#endif
+}
+
+/** 
+ * <JA>
+ * 単語を木構造化辞書に追加したときに作られるノード数を返す. 
+ * 
+ * @param wchmm [in] 木構造化辞書
+ * @param w [in] 単語ID
+ * @param matchlen [in] 既存の木と共有される先頭からの音素数
+ * @param enable_iwsp [in] 単語間ショートポーズ機能使用時TRUE
+ * 
+ * @return 新たに作られるノード数
+ * </JA>
+ * <EN>
+ * Return the number of nodes that will be created by wchmm_add_word().
+ * 
+ * @param wchmm [in] tree lexicon
+ * @param w [in] word ID
+ * @param matchlen [in] number of leading phones shared with the tree
+ * @param enable_iwsp [in] TRUE when using inter-word short pause option
+ * 
+ * @return the number of new nodes.
+ * </EN>
+ */
+static int
+wchmm_word_nodenum(WCHMM_INFO *wchmm, WORD_ID w, int matchlen, boolean enable_iwsp)
+{
+  WORD_INFO *winfo;
+  int k, num;
+
+  winfo = wchmm->winfo;
+  num = 0;
+  for(k=matchlen;k<winfo->wlen[w];k++) {
+    num += hmm_logical_state_num(winfo->wseq[w][k]) - 2;
+  }
+  if (wchmm->hmminfo->multipath) {
+    if (matchlen == 0) num++;	/* word-beginning node */
+    if (enable_iwsp && matchlen < winfo->wlen[w]) {
+      num += hmm_logical_state_num(wchmm->hmminfo->sp) - 2;
+    }
+    num++;			/* word-end node */
+  }
+  return(num);
+}
+
+/** 
+ * <JA>
+ * ソート済みの単語列の一部を順に木構造化辞書に追加する. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param items [in] ソートされた単語
+ * @param matchlen [in] 各単語の共有音素数
+ * @param matchword [in] 各単語の共有先単語
+ * @param bgn [in] 追加する最初の位置
+ * @param end [in] 追加する最後の位置 + 1
+ * @param enable_iwsp [in] 単語間ショートポーズ機能使用時TRUE
+ * 
+ * @return 成功時 TRUE, 失敗時 FALSE
+ * </JA>
+ * <EN>
+ * Add a part of sorted words to the tree lexicon in order.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param items [in] sorted words
+ * @param matchlen [in] number of shared phones of each word
+ * @param matchword [in] word to share with for each word
+ * @param bgn [in] first position to add
+ * @param end [in] last position to add + 1
+ * @param enable_iwsp [in] TRUE when using inter-word short pause option
+ * 
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ */
+static boolean
+wchmm_add_word_list(WCHMM_INFO *wchmm, WCHMM_SORT_ITEM *items, int *matchlen, WORD_ID *matchword, int bgn, int end, boolean enable_iwsp)
+{
+  int j;
+  boolean ok_p;
+
+  ok_p = TRUE;
+  for(j=bgn;j<end;j++) {
+    if (wchmm_add_word(wchmm, items[j].w, matchlen[j], matchword[j], enable_iwsp) == FALSE) {
+      jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n", items[j].w);
+      ok_p = FALSE;
+    }
+  }
+  return(ok_p);
+}
+
+/** 
+ * <JA>
+ * @brief  単語 [bgn..end-1] を木構造化辞書に追加する. 
+ *
+ * 単語を音素並びでソートし，各単語を共有する単語と音素数，および
+ * 作られるノード数を先に求めて，必要な領域を確保する. 木は先頭音素
+ * ごとの部分木に分かれるので，部分木のまとまりを複数のスレッドで
+ * 並列に構築する. 各スレッドは確保済みの領域の自分の部分に直接
+ * ノードを作るため，結果の木はスレッド数によらず同じになる. 
+ * 同音語の終端ノードの独立化などの後処理は呼び出し側で行う. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param lmconf [in] 言語モデル(LM)設定パラメータ
+ * @param bgn [in] 追加する最初の単語ID
+ * @param end [in] 追加する最後の単語ID + 1
+ * 
+ * @return 成功時 TRUE, 失敗時 FALSE
+ * </JA>
+ * <EN>
+ * @brief  Add words [bgn..end-1] to the tree lexicon.
+ *
+ * The words are sorted by their phoneme sequence, and the word to share
+ * with, the number of shared phones and the number of nodes to be
+ * created are computed for each word beforehand, to allocate the
+ * required area at once.  Since the tree is divided into subtrees by
+ * the first phone, groups of subtrees are built in parallel by threads.
+ * Each thread creates the nodes directly in its own part of the
+ * allocated area, so the resulting tree is the same for any number of
+ * threads.  Post processing such as isolating homophone word-end nodes
+ * should be done by the caller.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param lmconf [in] language model (LM) configuration parameters
+ * @param bgn [in] first word ID to add
+ * @param end [in] last word ID to add + 1
+ * 
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ */
+static boolean
+wchmm_add_words(WCHMM_INFO *wchmm, JCONF_LM *lmconf, WORD_ID bgn, WORD_ID end)
+{
+  WORD_INFO *winfo;
+  WCHMM_SORT_ITEM *items;
+  int *rbuf, *obuf;
+  int *matchlen, *nodeidx, *startidx, *chunk;
+  WORD_ID *matchword;
+  boolean *separated, *chunk_ok;
+  BMALLOC_BASE **chunk_root;
+  int len, i, j, k, c, last_j;
+  int total, dupnum, chunknum, maxchunk, target;
+  int node0, start0;
+  int threads;
+  boolean ok_p;
+#ifdef SEPARATE_BY_UNIGRAM
+  LOGPROB separate_thres;
+  LOGPROB p;
+#endif
+
+  winfo = wchmm->winfo;
+  len = end - bgn;
+  if (len <= 0) return TRUE;
+  threads = (lmconf->wchmm_threads > 1) ? lmconf->wchmm_threads : 1;
+
+#ifdef SEPARATE_BY_UNIGRAM
+  if (wchmm->lmtype == LM_PROB) {
+    /* compute score threshold beforehand to separate words from tree */
+    /* here we will separate best [separate_wnum] words from tree */
+    separate_thres = get_nbest_uniprob(wchmm, lmconf->separate_wnum);
+  }
+#endif
+
+  /* make sorted word index ordered by phone sequence */
+  items = wchmm_sort_words(wchmm, bgn, end, threads, &rbuf);
+
+  /* determine where to add each word in the sorted order */
+  /* the previous word (last_j) is always the most matched one */
+  matchlen = (int *)mymalloc(sizeof(int) * len);
+  matchword = (WORD_ID *)mymalloc(sizeof(WORD_ID) * len);
+  separated = (boolean *)mymalloc(sizeof(boolean) * len);
+  nodeidx = (int *)mymalloc(sizeof(int) * (len + 1));
+  startidx = (int *)mymalloc(sizeof(int) * (len + 1));
+  nodeidx[0] = startidx[0] = 0;
+  dupnum = 0;
+  last_j = -1;
+  for(j=0;j<len;j++) {
+    i = items[j].w;
+    separated[j] = FALSE;
+    if (wchmm->lmtype == LM_PROB) {
+      /* start/end silence word should not be shared */
+      if (i == winfo->head_silwid || i == winfo->tail_silwid) {
+	separated[j] = TRUE;
+      }
+#ifndef NO_SEPARATE_SHORT_WORD
+      /* separate short words from tree */
+      if (!separated[j] && winfo->wlen[i] <= SHORT_WORD_LEN) {
+	separated[j] = TRUE;
+	wchmm->separated_word_count++;
+      }
+#endif
+#ifdef SEPARATE_BY_UNIGRAM
+      if (!separated[j]) {
+	if (wchmm->ngram) {
+	  p = uni_prob(wchmm->ngram, winfo->wton[i])
+#ifdef CLASS_NGRAM
+	    + winfo->cprob[i]
+#endif
+	    ;
+	} else {
+	  p = LOG_ZERO;
+	}
+	if (wchmm->lmvar == LM_NGRAM_USER) {
+	  p = (*(wchmm->uni_prob_user))(winfo, i, p);
+	}
+	/* separate high-frequent words from tree (threshold = separate_thres) */
+	if (p >= separate_thres && wchmm->separated_word_count < lmconf->separate_wnum) {
+	  separated[j] = TRUE;
+	  wchmm->separated_word_count++;
+	}
+      }
+#endif
+    }
+    if (separated[j] || last_j < 0 || items[j].cate != items[last_j].cate) {
+      /* add whole word as new (sharelen=0) */
+      matchlen[j] = 0;
+      matchword[j] = 0;
+    } else {
+      for(k=0;k<items[j].len && k<items[last_j].len;k++) {
+	if (items[j].rank[k] != items[last_j].rank[k]) break;
+      }
+      matchlen[j] = k;
+      matchword[j] = items[last_j].w;
+      /* homophone or embedded word will need a duplicated word-end node */
+      if (k == items[j].len) dupnum++;
+      if (k == items[last_j].len) dupnum++;
+    }
+    if (!separated[j]) last_j = j;
+    nodeidx[j+1] = nodeidx[j] + wchmm_word_nodenum(wchmm, i, matchlen[j], lmconf->enable_iwsp);
+    startidx[j+1] = startidx[j];
+    if (matchlen[j] == 0) {
+      if (wchmm->hmminfo->multipath || wchmm->lmtype != LM_PROB || i != winfo->head_silwid) startidx[j+1]++;
+    }
+  }
+
+  /* allocate all the area at once */
+  node0 = wchmm->n;
+  start0 = wchmm->startnum;
+  wchmm_reserve(wchmm, node0 + nodeidx[len] + dupnum + 1, start0 + startidx[len] + dupnum + 1);
+  total = 0;
+  for(i=bgn;i<end;i++) total += winfo->wlen[i];
+  obuf = (int *)mybmalloc2(sizeof(int) * (total + 1), &(wchmm->malloc_root));
+  total = 0;
+  for(i=bgn;i<end;i++) {
+    wchmm->offset[i] = &(obuf[total]);
+    total += winfo->wlen[i];
+  }
+
+  /* divide into chunks at the head of subtrees */
+  maxchunk = (threads > 1) ? threads * 4 : 1;
+  chunk = (int *)mymalloc(sizeof(int) * (maxchunk + 1));
+  chunknum = 0;
+  chunk[chunknum++] = 0;
+  target = nodeidx[len] / maxchunk + 1;
+  for(j=1;j<len && chunknum<maxchunk;j++) {
+    if (!separated[j] && matchlen[j] == 0 && nodeidx[j] - nodeidx[chunk[chunknum-1]] >= target) {
+      chunk[chunknum++] = j;
+    }
+  }
+  chunk[chunknum] = len;
+
+  /* incrementaly add words to lexicon tree */
+  ok_p = TRUE;
+  if (chunknum == 1) {
+    ok_p = wchmm_add_word_list(wchmm, items, matchlen, matchword, 0, len, lmconf->enable_iwsp);
+  } else {
+    chunk_ok = (boolean *)mymalloc(sizeof(boolean) * chunknum);
+    chunk_root = (BMALLOC_BASE **)mymalloc(sizeof(BMALLOC_BASE *) * chunknum);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for(c=0;c<chunknum;c++) {
+      WCHMM_INFO tw;
+      /* each chunk uses its own copy of the tree info, with its own
+	 node and start node index, block memory and work area */
+      memcpy(&tw, wchmm, sizeof(WCHMM_INFO));
+      tw.n = node0 + nodeidx[chunk[c]];
+      tw.startnum = start0 + startidx[chunk[c]];
+      tw.malloc_root = NULL;
+      if (wchmm->hmminfo->multipath) {
+	tw.wrk.out_from = (int *)mymalloc(sizeof(int) * winfo->maxwn);
+	tw.wrk.out_from_next = (int *)mymalloc(sizeof(int) * winfo->maxwn);
+	tw.wrk.out_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * winfo->maxwn);
+	tw.wrk.out_a_next = (LOGPROB *)mymalloc(sizeof(LOGPROB) * winfo->maxwn);
+      }
+      chunk_ok[c] = wchmm_add_word_list(&tw, items, matchlen, matchword, chunk[c], chunk[c+1], lmconf->enable_iwsp);
+      if (tw.n != node0 + nodeidx[chunk[c+1]] || tw.startnum != start0 + startidx[chunk[c+1]]) {
+	j_internal_error("wchmm_add_words: node num mismatch in chunk #%d\n", c);
+      }
+      if (wchmm->hmminfo->multipath) {
+	free(tw.wrk.out_from);
+	free(tw.wrk.out_from_next);
+	free(tw.wrk.out_a);
+	free(tw.wrk.out_a_next);
+      }
+      chunk_root[c] = tw.malloc_root;
+    }
+    for(c=0;c<chunknum;c++) {
+      mybmerge2(&(wchmm->malloc_root), &(chunk_root[c]));
+      if (chunk_ok[c] == FALSE) ok_p = FALSE;
+    }
+    wchmm->n = node0 + nodeidx[len];
+    wchmm->startnum = start0 + startidx[len];
+    free(chunk_root);
+    free(chunk_ok);
+  }
+  if (wchmm->n != node0 + nodeidx[len] || wchmm->startnum != start0 + startidx[len]) {
+    j_internal_error("wchmm_add_words: node num mismatch\n");
+  }
+
+  free(chunk);
+  free(startidx);
+  free(nodeidx);
+  free(separated);
+  free(matchword);
+  free(matchlen);
+  free(items);
+  free(rbuf);
+
+  return(ok_p);
+}
+
 /** 
  * <JA>
  * 与えられた単語辞書と言語モデルから木構造化辞書を構築する. 
@@ -1748,15 +2258,10 @@ build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 boolean
 build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 {
-  int i,j, last_i;
+  int i;
   int num_duplicated;
-  WORD_ID *windex;
-#ifdef SEPARATE_BY_UNIGRAM
-  LOGPROB separate_thres;
-  LOGPROB p;
-#endif
   boolean ok_p;
-  boolean ret;
+  double start_time;
 
   /* lingustic infos must be set before build_wchmm() is called */
   /* check if necessary lingustic info is already assigned (for debug) */
@@ -1773,15 +2278,8 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
   wchmm->separated_word_count = 0;
   
   jlog("STAT: Building HMM lexicon tree\n");
+  start_time = wchmm_timer();
   
-  if (wchmm->lmtype == LM_PROB) {
-#ifdef SEPARATE_BY_UNIGRAM
-    /* compute score threshold beforehand to separate words from tree */
-    /* here we will separate best [separate_wnum] words from tree */
-    separate_thres = get_nbest_uniprob(wchmm, lmconf->separate_wnum);
-#endif
-  }
-
 #ifdef PASS1_IWCD
 #ifndef USE_OLD_IWCD
   if (wchmm->category_tree) {
@@ -1798,137 +2296,23 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
  /* initialize wchmm */
   wchmm_init(wchmm);
 
-  /* make sorted word index ordered by phone sequence */
-  windex = (WORD_ID *)mymalloc(sizeof(WORD_ID) * wchmm->winfo->num);
-  for(i=0;i<wchmm->winfo->num;i++) windex[i] = i;
-
-  if (wchmm->category_tree && wchmm->lmtype == LM_DFA) {
-
-    /* sort by category -> sort by word ID in each category */
-    wchmm_sort_idx_by_category(wchmm->winfo, windex, wchmm->winfo->num);
-    {
-      int last_cate;
-      last_i = 0;
-      last_cate = wchmm->winfo->wton[windex[0]];
-      for(i = 1;i<wchmm->winfo->num;i++) {
-	if (wchmm->winfo->wton[windex[i]] != last_cate) {
-	  wchmm_sort_idx_by_wseq(wchmm->winfo, windex, last_i, i - last_i);
-	  last_cate = wchmm->winfo->wton[windex[i]];
-	  last_i = i;
-	}
-      }
-      wchmm_sort_idx_by_wseq(wchmm->winfo, windex, last_i, wchmm->winfo->num - last_i);
-    }
-
-  } else {
-
-    /* sort by word ID for whole vocabulary */
-    wchmm_sort_idx_by_wseq(wchmm->winfo, windex, 0, wchmm->winfo->num);
-
+  /* sort words by phone sequence and add them to lexicon tree */
+  if (wchmm_add_words(wchmm, lmconf, 0, wchmm->winfo->num) == FALSE) {
+    ok_p = FALSE;
   }
 
-/* 
- *   {
- *     int i,w;
- *     for(i=0;i<wchmm->winfo->num;i++) {
- *	 w = windex[i];
- *	 printf("%d: cate=%4d wid=%4d %s\n",i, wchmm->winfo->wton[w], w, wchmm->winfo->woutput[w]);
- *     }
- *   }
- */
-
-  /* incrementaly add words to lexicon tree */
-  /* now for each word, the previous word (last_i) is always the most matched one */
-  last_i = WORD_INVALID;
-  for (j=0;j<wchmm->winfo->num;j++) {
-    i = windex[j];
-
-    if (wchmm->lmtype == LM_PROB) {
-
-      /* start/end silence word should not be shared */
-      if (i == wchmm->winfo->head_silwid || i == wchmm->winfo->tail_silwid) {
-	/* add whole word as new (sharelen=0) */
-	if (wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp) == FALSE) {
-	  jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n");
-	  ok_p = FALSE;
-	}
-	continue;
-      }
-#ifndef NO_SEPARATE_SHORT_WORD
-      /* separate short words from tree */
-      if (wchmm->winfo->wlen[i] <= SHORT_WORD_LEN) {
-	if (wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp) == FALSE) {
-	  jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n");
-	  ok_p = FALSE;
-	}
-	wchmm->separated_word_count++;
-	continue;
-      }
-#endif
-#ifdef SEPARATE_BY_UNIGRAM
-      if (wchmm->ngram) {
-	p = uni_prob(wchmm->ngram, wchmm->winfo->wton[i])
-#ifdef CLASS_NGRAM
-	  + wchmm->winfo->cprob[i]
-#endif
-	  ;
-      } else {
-	p = LOG_ZERO;
-      }
-      if (wchmm->lmvar == LM_NGRAM_USER) {
-	p = (*(wchmm->uni_prob_user))(wchmm->winfo, i, p);
-      }
-      /* separate high-frequent words from tree (threshold = separate_thres) */
-      if (p >= separate_thres && wchmm->separated_word_count < lmconf->separate_wnum) {
-	if (wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp) == FALSE) {
-	  jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n");
-	  ok_p = FALSE;
-	}
-	wchmm->separated_word_count++;
-	continue;
-      }
-#endif
-    }
-
-    if (last_i == WORD_INVALID) { /* first word */
-      ret = wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp);
-    } else {
-      /* the previous word (last_i) is always the most matched one */
-      if (wchmm->category_tree && wchmm->lmtype == LM_DFA) {
-	if (wchmm->winfo->wton[i] != wchmm->winfo->wton[last_i]) {
-	  ret = wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp);
-	} else {
-	  ret = wchmm_add_word(wchmm, i, wchmm_check_match(wchmm->winfo, i, last_i), last_i, lmconf->enable_iwsp);
-	}
-      } else {
-	ret = wchmm_add_word(wchmm, i, wchmm_check_match(wchmm->winfo, i, last_i), last_i, lmconf->enable_iwsp);
-      }
-    }
-    if (ret == FALSE) {
-      jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n");
-      ok_p = FALSE;
-    }
-    last_i = i;
-    
-  } /* end of add word loop */
-  
-  /*j_printerr("\r %5d words ended     (%6d nodes)\n",j,wchmm->n);*/
-
-  /* free work area */
-  free(windex);
-
   if (wchmm->hmminfo->multipath) {
     jlog("STAT: lexicon size: %d nodes\n", wchmm->n);
   } else {
     /* duplicate leaf nodes of homophone/embedded words */
     jlog("STAT: lexicon size: %d", wchmm->n);
-    num_duplicated = wchmm_duplicate_leafnode(wchmm);
+    num_duplicated = wchmm_duplicate_leafnode(wchmm, 0, wchmm->winfo->num, 0);
     jlog("+%d=%d\n", num_duplicated, wchmm->n);
   }
 
   if (! wchmm->hmminfo->multipath) {
     /* calculate transition probability of word end node to outside */
-    wchmm_calc_wordend_arc(wchmm);
+    wchmm_calc_wordend_arc(wchmm, 0, wchmm->winfo->num);
   }
 
   /* check wchmm coherence (internal debug) */
@@ -1961,6 +2345,9 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 
   }
 
+  wchmm->build_time = wchmm_timer() - start_time;
+  wchmm->build_threads = lmconf->wchmm_threads;
+
   //jlog("STAT: done\n");
 
 #ifdef WCHMM_SIZE_CHECK
@@ -2064,6 +2451,202 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 }
 
 
+/** 
+ * <JA>
+ * @brief  カテゴリ木に単語の区間を追加する. 
+ *
+ * 文法認識用の木構造化辞書に，辞書上の単語 [bgn..end-1] を一つの区間
+ * として追加する. カテゴリ間で木は共有されないため，既存の部分は変更
+ * されない. 区間は追加された順に保持され，wchmm_truncate_segment() で
+ * 末尾から削除できる. 空の木に対して bgn = 0 で呼ぶと木を初期化する. 
+ * 区間内の単語のカテゴリは既存の区間のカテゴリより大きいこと. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param lmconf [in] 言語モデル(dfa, winfo)設定パラメータ
+ * @param bgn [in] 追加する最初の単語ID
+ * @param end [in] 追加する最後の単語ID + 1
+ * 
+ * @return 成功時 TRUE，失敗時 FALSE を返す. 
+ * </JA>
+ * <EN>
+ * @brief  Add a range of words to a category tree.
+ *
+ * Words [bgn..end-1] in the dictionary are added to the tree lexicon for
+ * grammar recognition as a segment.  The existing part of the tree is not
+ * modified, since the tree is not shared among categories.  Segments are
+ * kept in the order of addition, and can be removed from the tail by
+ * wchmm_truncate_segment().  Calling with bgn = 0 for an empty tree
+ * initializes it.  The categories of the new words should be larger than
+ * those of the existing segments.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param lmconf [in] language model (dfa, winfo) configuration parameters
+ * @param bgn [in] first word ID to add
+ * @param end [in] last word ID to add + 1
+ * 
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+boolean
+wchmm_add_segment(WCHMM_INFO *wchmm, JCONF_LM *lmconf, WORD_ID bgn, WORD_ID end)
+{
+  int i;
+  WORD_INFO *winfo;
+  WCHMM_SEGMENT *sg;
+  boolean ok_p;
+  double start_time;
+
+  winfo = wchmm->winfo;
+  if (winfo == NULL || !wchmm->category_tree || wchmm->lmtype != LM_DFA
+      || (wchmm->lmvar == LM_DFA_GRAMMAR && wchmm->dfa == NULL)) {
+    jlog("ERROR: wchmm: segment can be added only to category tree\n");
+    return FALSE;
+  }
+  if (end > winfo->num || bgn != (wchmm->segnum == 0 ? 0 : wchmm->seg[wchmm->segnum-1].word_end)) {
+    jlog("ERROR: wchmm: word segment [%d..%d] does not follow the tree\n", bgn, end - 1);
+    return FALSE;
+  }
+
+  start_time = wchmm_timer();
+
+  if (wchmm->segnum == 0) {
+    /* initialize wchmm */
+    wchmm_init(wchmm);
+    wchmm->maxwordnum = winfo->num;
+    wchmm->separated_word_count = 0;
+  } else {
+    /* expand word-indexed area for the current dictionary */
+    if (winfo->num > wchmm->maxwordnum) {
+      wchmm->maxwordnum = winfo->num;
+      wchmm->offset = (int **)myrealloc(wchmm->offset, sizeof(int *) * wchmm->maxwordnum);
+      wchmm->wordend = (int *)myrealloc(wchmm->wordend, sizeof(int) * wchmm->maxwordnum);
+      if (wchmm->hmminfo->multipath) {
+	wchmm->wordbegin = (int *)myrealloc(wchmm->wordbegin, sizeof(int) * wchmm->maxwordnum);
+      } else {
+	wchmm->wordend_a = (LOGPROB *)myrealloc(wchmm->wordend_a, sizeof(LOGPROB) * wchmm->maxwordnum);
+      }
+    }
+    if (wchmm->hmminfo->multipath && winfo->maxwn > wchmm->wrk.out_from_len) {
+      wchmm->wrk.out_from_len = winfo->maxwn;
+      wchmm->wrk.out_from = (int *)myrealloc(wchmm->wrk.out_from, sizeof(int) * wchmm->wrk.out_from_len);
+      wchmm->wrk.out_from_next = (int *)myrealloc(wchmm->wrk.out_from_next, sizeof(int) * wchmm->wrk.out_from_len);
+      wchmm->wrk.out_a = (LOGPROB *)myrealloc(wchmm->wrk.out_a, sizeof(LOGPROB) * wchmm->wrk.out_from_len);
+      wchmm->wrk.out_a_next = (LOGPROB *)myrealloc(wchmm->wrk.out_a_next, sizeof(LOGPROB) * wchmm->wrk.out_from_len);
+    }
+  }
+
+  /* record the segment */
+  if (wchmm->segnum >= wchmm->segmax) {
+    wchmm->segmax += 16;
+    wchmm->seg = (WCHMM_SEGMENT *)myrealloc(wchmm->seg, sizeof(WCHMM_SEGMENT) * wchmm->segmax);
+  }
+  sg = &(wchmm->seg[wchmm->segnum]);
+  sg->word_begin = bgn;
+  sg->word_end = end;
+  sg->node_begin = wchmm->n;
+  sg->startnum_begin = wchmm->startnum;
+  if (end > bgn) {
+    sg->cate_begin = winfo->wton[bgn];
+    for(i=bgn;i<end;i++) {
+      if (sg->cate_begin > winfo->wton[i]) sg->cate_begin = winfo->wton[i];
+    }
+  } else {
+    /* empty segment: later categories will follow */
+    sg->cate_begin = (wchmm->dfa != NULL) ? wchmm->dfa->term_num : 0;
+  }
+  wchmm->segnum++;
+  if (end <= bgn) return TRUE;
+
+  ok_p = TRUE;
+
+#ifdef PASS1_IWCD
+#ifndef USE_OLD_IWCD
+  if (wchmm->ccd_flag) {
+    /* make category-indexed cdset of the new words */
+    lcdset_register_with_category_words(wchmm, bgn, end);
+  }
+#endif
+#endif /* PASS1_IWCD */
+
+  /* sort words by category and phone sequence and add them to the tree */
+  if (wchmm_add_words(wchmm, lmconf, bgn, end) == FALSE) {
+    ok_p = FALSE;
+  }
+
+  if (! wchmm->hmminfo->multipath) {
+    /* duplicate leaf nodes of homophone/embedded words */
+    wchmm_duplicate_leafnode(wchmm, bgn, end, sg->node_begin);
+    /* calculate transition probability of word end node to outside */
+    wchmm_calc_wordend_arc(wchmm, bgn, end);
+  }
+
+  /* accumulate build time of this tree */
+  wchmm->build_time += wchmm_timer() - start_time;
+  wchmm->build_threads = lmconf->wchmm_threads;
+
+  return ok_p;
+}
+
+/** 
+ * <JA>
+ * @brief  カテゴリ木を区間の境界で切り詰める. 
+ *
+ * wchmm_add_segment() で追加された区間のうち，単語ID が @a wnum 以上の
+ * 単語を含む区間をすべて木から削除する. 削除されたノードの領域は再利用
+ * されるが，それらが割り付けたブロック領域は木の解放時まで残り，その量は
+ * wchmm->garbage に加算される. 先頭の区間も削除対象となる場合は
+ * 何もせず 0 を返すので，木を再構築すること. 
+ * 
+ * @param wchmm [i/o] 木構造化辞書
+ * @param wnum [in] 残したい先頭からの単語数
+ * 
+ * @return 木に残った先頭からの単語数を返す. 
+ * </JA>
+ * <EN>
+ * @brief  Truncate a category tree at a segment boundary.
+ *
+ * Segments added by wchmm_add_segment() that contain a word whose ID is
+ * @a wnum or larger are removed from the tree.  The removed node area
+ * will be reused, but block memory allocated for them remains until the
+ * tree is freed, and its amount is added to wchmm->garbage.  If the
+ * first segment would be removed, nothing is done and 0 is returned: the
+ * tree should be rebuilt.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param wnum [in] number of leading words to keep
+ * 
+ * @return the number of leading words that remain in the tree.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+WORD_ID
+wchmm_truncate_segment(WCHMM_INFO *wchmm, WORD_ID wnum)
+{
+  int s;
+
+  for(s=0;s<wchmm->segnum;s++) {
+    if (wchmm->seg[s].word_end > wnum) break;
+  }
+  if (s == 0) return 0;
+  if (s < wchmm->segnum) {
+    wchmm->garbage += wchmm->n - wchmm->seg[s].node_begin;
+    wchmm->n = wchmm->seg[s].node_begin;
+    wchmm->startnum = wchmm->seg[s].startnum_begin;
+#ifdef PASS1_IWCD
+#ifndef USE_OLD_IWCD
+    if (wchmm->ccd_flag) {
+      lcdset_remove_with_category_from(wchmm, wchmm->seg[s].cate_begin);
+    }
+#endif
+#endif /* PASS1_IWCD */
+    wchmm->segnum = s;
+  }
+  return(wchmm->seg[s-1].word_end);
+}
+
 /** 
  * <JA>
  * 木構造化辞書のサイズなどの情報を標準出力に出力する. 
@@ -2117,6 +2700,9 @@ print_wchmm_info(WCHMM_INFO *wchmm)
   if (!wchmm->category_tree) {
     jlog("\t fact. node num = %6d\n", wchmm->scnum - 1);
   }
+  if (wchmm->build_time > 0.0) {
+    jlog("\t     build time = %6.3f sec (%d thread%s)\n", wchmm->build_time, wchmm->build_threads, (wchmm->build_threads > 1) ? "s" : "");
+  }
 }
 
 /* end of file */
@@ -0,0 +1,1046 @@
+/**
+ * @file   wchmm_cache.c
+ *
+ * <JA>
+ * @brief  木構造化辞書のキャッシュファイルへの保存と読み込み
+ *
+ * N-gram 用に構築した木構造化辞書を，バイナリ形式でファイルに保存し，
+ * 次回の起動時にそのまま読み込みます．辞書の構築処理（ノードの共有化，
+ * successor list の作成，1-gram factoring 値の計算）を省略できるため，
+ * 大語彙での起動時間が短縮されます．
+ *
+ * ファイルには，音響モデル・単語辞書・N-gram の1-gram確率および
+ * 木構造化に関わる設定から計算したハッシュ値が書き込まれ，読み込み時に
+ * 一致しない場合はキャッシュは使用されず，通常通り辞書が構築されます．
+ * 各ノードの出力確率への参照は，状態IDや論理%HMMの番号として保存されます．
+ * 文法用の木構造化辞書はキャッシュされません．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Save and load the tree lexicon to / from a cache file
+ *
+ * The tree lexicon built for N-gram can be dumped to a binary cache file
+ * and directly loaded at the next startup, skipping the whole lexicon
+ * construction (node sharing, successor list generation and 1-gram
+ * factoring value computation), which takes time for a large vocabulary.
+ *
+ * The cache file holds a hash key computed from the acoustic model, the
+ * word dictionary, the 1-gram probabilities of the N-gram and the
+ * configurations that affect the tree construction.  When the key does
+ * not match at loading, the cache is not used and the lexicon is built
+ * as usual.  References to the output probabilities in the tree nodes are
+ * stored as state IDs and indices of logical %HMMs.  Tree lexicons for
+ * grammars are not cached.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/julius.h>
+
+/// Identifier string at the head of a cache file
+#define WCHMM_CACHE_MAGIC "JULIUS-WCHMM-CACHE\n"
+/// Format version of the cache file, should be increased at format change
+#define WCHMM_CACHE_VERSION 1
+/// Value to detect byte order of the cache file
+#define WCHMM_CACHE_BYTEORDER 0x01020304
+
+/// Pointer-to-index entry for encoding model references
+typedef struct {
+  void *ptr;			///< Address of the data
+  int id;			///< Index of the data
+} WCHMM_CACHE_PTRID;
+
+/// Work area for listing context-dependent phone sets by tree traversal
+static WCHMM_CACHE_PTRID *cdlist;
+/// Number of elements in @a cdlist
+static int cdnum;
+/// Hash key to be updated by the traversal, or NULL
+static unsigned int *cdkey;
+
+/**
+ * Update a hash key by a byte sequence.  Two independent 32-bit hashes
+ * (FNV-1a and sdbm) are computed at once to make a 64-bit key.
+ *
+ * @param key [i/o] hash key
+ * @param data [in] data
+ * @param len [in] length of @a data in bytes
+ */
+static void
+key_update(unsigned int *key, void *data, int len)
+{
+  unsigned char *p;
+  int i;
+
+  p = (unsigned char *)data;
+  for (i = 0; i < len; i++) {
+    key[0] = (key[0] ^ p[i]) * 16777619U;
+    key[1] = p[i] + (key[1] << 6) + (key[1] << 16) - key[1];
+  }
+}
+
+/**
+ * Update a hash key by an integer.
+ *
+ * @param key [i/o] hash key
+ * @param val [in] value
+ */
+static void
+key_int(unsigned int *key, int val)
+{
+  key_update(key, &val, sizeof(int));
+}
+
+/**
+ * Update a hash key by a string, including its terminator.
+ *
+ * @param key [i/o] hash key
+ * @param str [in] string
+ */
+static void
+key_str(unsigned int *key, char *str)
+{
+  key_update(key, str, strlen(str) + 1);
+}
+
+/**
+ * Callback for tree traversal to list context-dependent phone sets.
+ *
+ * @param data [in] CD_Set
+ */
+static void
+cdset_collect(void *data)
+{
+  CD_Set *cd;
+
+  cd = (CD_Set *)data;
+  if (cdlist != NULL) {
+    cdlist[cdnum].ptr = cd;
+  }
+  if (cdkey != NULL) {
+    key_str(cdkey, cd->name);
+    key_int(cdkey, cd->state_num);
+  }
+  cdnum++;
+}
+
+/**
+ * qsort callback to sort pointer-to-index entries by address.
+ *
+ * @param a [in] entry
+ * @param b [in] entry
+ *
+ * @return the order of the two addresses.
+ */
+static int
+compare_ptrid(WCHMM_CACHE_PTRID *a, WCHMM_CACHE_PTRID *b)
+{
+  if ((char *)a->ptr < (char *)b->ptr) return -1;
+  if ((char *)a->ptr > (char *)b->ptr) return 1;
+  return 0;
+}
+
+/**
+ * Find the entry whose address is the largest one not above the given
+ * address, in the list sorted by address.
+ *
+ * @param list [in] sorted list
+ * @param num [in] number of elements in @a list
+ * @param ptr [in] address to search for
+ *
+ * @return the index of the found entry in @a list, or -1 if not found.
+ */
+static int
+ptrid_lookup(WCHMM_CACHE_PTRID *list, int num, void *ptr)
+{
+  int left, right, mid;
+
+  left = 0;
+  right = num - 1;
+  if (num == 0 || (char *)ptr < (char *)list[0].ptr) return -1;
+  while (left < right) {
+    mid = (left + right + 1) / 2;
+    if ((char *)list[mid].ptr <= (char *)ptr) {
+      left = mid;
+    } else {
+      right = mid - 1;
+    }
+  }
+  return left;
+}
+
+/**
+ * Return a bit mask of compile-time options that affect the lexicon
+ * structure.
+ *
+ * @return the bit mask.
+ */
+static int
+wchmm_cache_flags()
+{
+  int flags = 0;
+
+#ifdef PASS1_IWCD
+  flags |= 0x01;
+#endif
+#ifdef UNIGRAM_FACTORING
+  flags |= 0x02;
+#endif
+#ifdef SEPARATE_BY_UNIGRAM
+  flags |= 0x04;
+#endif
+#ifdef NO_SEPARATE_SHORT_WORD
+  flags |= 0x08;
+#endif
+#ifdef CLASS_NGRAM
+  flags |= 0x10;
+#endif
+  flags |= (sizeof(WORD_ID) << 8);
+  flags |= (sizeof(LOGPROB) << 16);
+
+  return flags;
+}
+
+/**
+ * <JA>
+ * 木構造化辞書の構築に関わるモデルと設定からハッシュ値を計算する．
+ *
+ * @param wchmm [in] 木構造化辞書（モデルの割り当て済みのもの）
+ * @param lmconf [in] 言語モデル設定
+ * @param key [out] ハッシュ値 (2要素)
+ * </JA>
+ * <EN>
+ * Compute a hash key from all the models and configurations that
+ * affect the lexicon construction.
+ *
+ * @param wchmm [in] tree lexicon, to which models are already assigned
+ * @param lmconf [in] LM configuration
+ * @param key [out] hash key (2 elements)
+ * </EN>
+ */
+static void
+wchmm_cache_key(WCHMM_INFO *wchmm, JCONF_LM *lmconf, unsigned int *key)
+{
+  HTK_HMM_INFO *hmminfo;
+  WORD_INFO *winfo;
+  HMM_Logical *lg;
+  HTK_HMM_Trans *tr;
+  LOGPROB p;
+  int w, i, j;
+
+  hmminfo = wchmm->hmminfo;
+  winfo = wchmm->winfo;
+
+  key[0] = 2166136261U;
+  key[1] = 0;
+
+  /* lexicon construction parameters */
+  key_int(key, wchmm->lmtype);
+  key_int(key, wchmm->lmvar);
+  key_int(key, wchmm->ccd_flag);
+  key_int(key, hmminfo->multipath);
+  key_int(key, lmconf->enable_iwsp);
+#ifdef SEPARATE_BY_UNIGRAM
+  key_int(key, lmconf->separate_wnum);
+#endif
+#ifndef NO_SEPARATE_SHORT_WORD
+  key_int(key, SHORT_WORD_LEN);
+#endif
+
+  /* acoustic model: logical HMMs, their states and transitions */
+  key_int(key, hmminfo->totalstatenum);
+  key_int(key, hmminfo->totallogicalnum);
+  key_int(key, hmminfo->totalpseudonum);
+  for (lg = hmminfo->lgstart; lg; lg = lg->next) {
+    key_str(key, lg->name);
+    key_int(key, lg->is_pseudo);
+    if (lg->is_pseudo) {
+      key_str(key, lg->body.pseudo->name);
+      tr = lg->body.pseudo->tr;
+    } else {
+      for (i = 0; i < lg->body.defined->state_num; i++) {
+	key_int(key, lg->body.defined->s[i] ? lg->body.defined->s[i]->id : -1);
+      }
+      tr = lg->body.defined->tr;
+    }
+    if (tr != NULL) {
+      key_int(key, tr->statenum);
+      for (i = 0; i < tr->statenum; i++) {
+	key_update(key, tr->a[i], sizeof(PROB) * tr->statenum);
+      }
+    }
+  }
+  key_str(key, hmminfo->sp ? hmminfo->sp->name : "");
+  if (hmminfo->cdset_info.cdtree != NULL) {
+    cdlist = NULL;
+    cdnum = 0;
+    cdkey = key;
+    aptree_traverse_and_do(hmminfo->cdset_info.cdtree, cdset_collect);
+    cdkey = NULL;
+  }
+
+  /* word dictionary */
+  key_int(key, winfo->num);
+  key_int(key, winfo->head_silwid);
+  key_int(key, winfo->tail_silwid);
+  for (w = 0; w < winfo->num; w++) {
+    key_int(key, winfo->wlen[w]);
+    key_int(key, winfo->wton[w]);
+    for (j = 0; j < winfo->wlen[w]; j++) {
+      key_str(key, winfo->wseq[w][j]->name);
+    }
+#ifdef CLASS_NGRAM
+    if (winfo->cprob != NULL) {
+      key_update(key, &(winfo->cprob[w]), sizeof(LOGPROB));
+    }
+#endif
+  }
+
+  /* 1-gram probabilities used for separation and factoring */
+  if (wchmm->ngram) {
+    for (w = 0; w < winfo->num; w++) {
+      p = uni_prob(wchmm->ngram, winfo->wton[w]);
+      key_update(key, &p, sizeof(LOGPROB));
+    }
+  }
+}
+
+/**
+ * Build lists to encode / decode references to the %HMM data.
+ *
+ * @param hmminfo [in] %HMM definition
+ * @param lglist [out] logical %HMMs in list order
+ * @param lgnum [out] number of logical %HMMs
+ * @param cds [out] context-dependent phone sets in tree order
+ * @param cdsnum [out] number of context-dependent phone sets
+ * @param states [out] %HMM states indexed by state ID
+ *
+ * @return TRUE on success, FALSE if state IDs are broken.
+ */
+static boolean
+wchmm_cache_make_index(HTK_HMM_INFO *hmminfo, WCHMM_CACHE_PTRID **lglist, int *lgnum, WCHMM_CACHE_PTRID **cds, int *cdsnum, HTK_HMM_State ***states)
+{
+  HMM_Logical *lg;
+  HTK_HMM_State *st;
+  int n;
+
+  n = 0;
+  for (lg = hmminfo->lgstart; lg; lg = lg->next) n++;
+  *lglist = (WCHMM_CACHE_PTRID *)mymalloc(sizeof(WCHMM_CACHE_PTRID) * (n + 1));
+  n = 0;
+  for (lg = hmminfo->lgstart; lg; lg = lg->next) {
+    (*lglist)[n].ptr = lg;
+    (*lglist)[n].id = n;
+    n++;
+  }
+  *lgnum = n;
+
+  cdlist = NULL;
+  cdnum = 0;
+  cdkey = NULL;
+  if (hmminfo->cdset_info.cdtree != NULL) {
+    aptree_traverse_and_do(hmminfo->cdset_info.cdtree, cdset_collect);
+  }
+  cdlist = (WCHMM_CACHE_PTRID *)mymalloc(sizeof(WCHMM_CACHE_PTRID) * (cdnum + 1));
+  cdnum = 0;
+  if (hmminfo->cdset_info.cdtree != NULL) {
+    aptree_traverse_and_do(hmminfo->cdset_info.cdtree, cdset_collect);
+  }
+  for (n = 0; n < cdnum; n++) cdlist[n].id = n;
+  *cds = cdlist;
+  *cdsnum = cdnum;
+  cdlist = NULL;
+
+  *states = (HTK_HMM_State **)mymalloc(sizeof(HTK_HMM_State *) * (hmminfo->totalstatenum + 1));
+  for (n = 0; n < hmminfo->totalstatenum; n++) (*states)[n] = NULL;
+  for (st = hmminfo->ststart; st; st = st->next) {
+    if (st->id < 0 || st->id >= hmminfo->totalstatenum) {
+      jlog("ERROR: wchmm_cache: state id out of range: %d\n", st->id);
+      free(*states);
+      free(*cds);
+      free(*lglist);
+      return FALSE;
+    }
+    (*states)[st->id] = st;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Write data to a cache file.
+ *
+ * @param ptr [in] data
+ * @param size [in] size of an element
+ * @param n [in] number of elements
+ * @param fp [in] file pointer
+ * @param ok_p [i/o] set to FALSE on error
+ */
+static void
+wrt(void *ptr, size_t size, size_t n, FILE *fp, boolean *ok_p)
+{
+  if (*ok_p == FALSE || n == 0) return;
+  if (fwrite(ptr, size, n, fp) < n) *ok_p = FALSE;
+}
+
+/**
+ * Read data from a cache file.
+ *
+ * @param ptr [out] data
+ * @param size [in] size of an element
+ * @param n [in] number of elements
+ * @param fp [in] file pointer
+ * @param ok_p [i/o] set to FALSE on error
+ */
+static void
+rdn(void *ptr, size_t size, size_t n, FILE *fp, boolean *ok_p)
+{
+  if (*ok_p == FALSE || n == 0) return;
+  if (fread(ptr, size, n, fp) < n) *ok_p = FALSE;
+}
+
+/**
+ * <JA>
+ * 構築済みの木構造化辞書をキャッシュファイルに保存する．
+ *
+ * @param wchmm [in] 木構造化辞書
+ * @param lmconf [in] 言語モデル設定
+ * @param filename [in] 保存するファイル名
+ *
+ * @return 成功時 TRUE，失敗時 FALSE を返す．
+ * </JA>
+ * <EN>
+ * Save a built tree lexicon to a cache file.
+ *
+ * @param wchmm [in] tree lexicon
+ * @param lmconf [in] LM configuration
+ * @param filename [in] file name to save
+ *
+ * @return TRUE on success, or FALSE on failure.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+boolean
+wchmm_cache_save(WCHMM_INFO *wchmm, JCONF_LM *lmconf, char *filename)
+{
+  FILE *fp;
+  WCHMM_CACHE_PTRID *lglist, *cds;
+  HTK_HMM_State **states;
+  int lgnum, cdsnum;
+  unsigned int key[2];
+  int head[4];
+  int *code, *buf;
+#ifdef PASS1_IWCD
+  unsigned char *style;
+#endif
+  A_CELL2 *ac;
+  int i, j, n, c, total;
+  boolean ok_p;
+
+  if (wchmm->category_tree || wchmm->lmtype != LM_PROB || wchmm->lmvar == LM_NGRAM_USER) {
+    jlog("WARNING: wchmm_cache: lexicon cache is only for N-gram, not saved\n");
+    return FALSE;
+  }
+
+  if (wchmm_cache_make_index(wchmm->hmminfo, &lglist, &lgnum, &cds, &cdsnum, &states) == FALSE) {
+    return FALSE;
+  }
+  free(states);
+  qsort(lglist, lgnum, sizeof(WCHMM_CACHE_PTRID), (int (*)(const void *, const void *))compare_ptrid);
+  for (i = 0; i < cdsnum; i++) {
+    /* search by the address of the state set array */
+    cds[i].ptr = ((CD_Set *)cds[i].ptr)->stateset;
+  }
+  qsort(cds, cdsnum, sizeof(WCHMM_CACHE_PTRID), (int (*)(const void *, const void *))compare_ptrid);
+
+  /* encode state output references into pairs of integers */
+  n = wchmm->n;
+  code = (int *)mymalloc(sizeof(int) * n * 2);
+#ifdef PASS1_IWCD
+  style = (unsigned char *)mymalloc(sizeof(unsigned char) * n);
+  memcpy(style, wchmm->outstyle, sizeof(unsigned char) * n);
+  if (wchmm->hmminfo->multipath) {
+    /* word-edge nodes in multipath mode have no output and no style */
+    for (i = 0; i < wchmm->startnum; i++) style[wchmm->startnode[i]] = AS_STATE;
+    for (i = 0; i < wchmm->winfo->num; i++) style[wchmm->wordend[i]] = AS_STATE;
+  }
+#endif
+  ok_p = TRUE;
+  for (i = 0; i < n; i++) {
+#ifdef PASS1_IWCD
+    switch(style[i]) {
+    case AS_STATE:
+      code[i*2] = wchmm->state[i].out.state ? wchmm->state[i].out.state->id : -1;
+      code[i*2+1] = 0;
+      break;
+    case AS_LSET:
+      j = ptrid_lookup(cds, cdsnum, wchmm->state[i].out.lset);
+      if (j < 0) {
+	ok_p = FALSE;
+	break;
+      }
+      code[i*2] = cds[j].id;
+      code[i*2+1] = wchmm->state[i].out.lset - (CD_State_Set *)cds[j].ptr;
+      break;
+    case AS_RSET:
+      j = ptrid_lookup(lglist, lgnum, wchmm->state[i].out.rset->hmm);
+      if (j < 0 || lglist[j].ptr != wchmm->state[i].out.rset->hmm) {
+	ok_p = FALSE;
+	break;
+      }
+      code[i*2] = lglist[j].id;
+      code[i*2+1] = wchmm->state[i].out.rset->state_loc;
+      break;
+    case AS_LRSET:
+      j = ptrid_lookup(lglist, lgnum, wchmm->state[i].out.lrset->hmm);
+      if (j < 0 || lglist[j].ptr != wchmm->state[i].out.lrset->hmm) {
+	ok_p = FALSE;
+	break;
+      }
+      code[i*2] = lglist[j].id;
+      code[i*2+1] = wchmm->state[i].out.lrset->state_loc;
+      break;
+    }
+#else
+    code[i*2] = wchmm->state[i].out ? wchmm->state[i].out->id : -1;
+    code[i*2+1] = 0;
+#endif
+    if (ok_p == FALSE) break;
+  }
+  free(cds);
+  free(lglist);
+  if (ok_p == FALSE) {
+    jlog("ERROR: wchmm_cache: failed to encode output of node %d\n", i);
+#ifdef PASS1_IWCD
+    free(style);
+#endif
+    free(code);
+    return FALSE;
+  }
+
+  if ((fp = fopen(filename, "wb")) == NULL) {
+    jlog("ERROR: wchmm_cache: failed to open \"%s\" for writing\n", filename);
+#ifdef PASS1_IWCD
+    free(style);
+#endif
+    free(code);
+    return FALSE;
+  }
+
+  /* header */
+  wchmm_cache_key(wchmm, lmconf, key);
+  head[0] = WCHMM_CACHE_VERSION;
+  head[1] = WCHMM_CACHE_BYTEORDER;
+  head[2] = wchmm_cache_flags();
+  head[3] = 0;
+  wrt(WCHMM_CACHE_MAGIC, 1, strlen(WCHMM_CACHE_MAGIC), fp, &ok_p);
+  wrt(head, sizeof(int), 4, fp, &ok_p);
+  wrt(key, sizeof(unsigned int), 2, fp, &ok_p);
+
+  /* sizes */
+  wrt(&(wchmm->n), sizeof(int), 1, fp, &ok_p);
+  wrt(&(wchmm->startnum), sizeof(int), 1, fp, &ok_p);
+  wrt(&(wchmm->separated_word_count), sizeof(int), 1, fp, &ok_p);
+  wrt(&(wchmm->scnum), sizeof(int), 1, fp, &ok_p);
+
+  /* nodes */
+#ifdef PASS1_IWCD
+  wrt(style, sizeof(unsigned char), n, fp, &ok_p);
+  free(style);
+#endif
+  wrt(code, sizeof(int), n * 2, fp, &ok_p);
+  free(code);
+  buf = (int *)mymalloc(sizeof(int) * n);
+  for (i = 0; i < n; i++) buf[i] = wchmm->state[i].scid;
+  wrt(buf, sizeof(int), n, fp, &ok_p);
+  wrt(wchmm->self_a, sizeof(LOGPROB), n, fp, &ok_p);
+  wrt(wchmm->next_a, sizeof(LOGPROB), n, fp, &ok_p);
+  wrt(wchmm->stend, sizeof(WORD_ID), n, fp, &ok_p);
+
+  /* arcs: number of cells per node, then cells in chain order */
+  total = 0;
+  for (i = 0; i < n; i++) {
+    c = 0;
+    for (ac = wchmm->ac[i]; ac; ac = ac->next) c++;
+    buf[i] = c;
+    total += c;
+  }
+  wrt(&total, sizeof(int), 1, fp, &ok_p);
+  wrt(buf, sizeof(int), n, fp, &ok_p);
+  free(buf);
+  for (i = 0; i < n; i++) {
+    for (ac = wchmm->ac[i]; ac; ac = ac->next) {
+      c = ac->n;
+      wrt(&c, sizeof(int), 1, fp, &ok_p);
+      wrt(ac->arc, sizeof(int), A_CELL2_ALLOC_STEP, fp, &ok_p);
+      wrt(ac->a, sizeof(LOGPROB), A_CELL2_ALLOC_STEP, fp, &ok_p);
+    }
+  }
+
+  /* words */
+  for (i = 0; i < wchmm->winfo->num; i++) {
+    wrt(wchmm->offset[i], sizeof(int), wchmm->winfo->wlen[i], fp, &ok_p);
+  }
+  wrt(wchmm->wordend, sizeof(int), wchmm->winfo->num, fp, &ok_p);
+  wrt(wchmm->startnode, sizeof(int), wchmm->startnum, fp, &ok_p);
+  if (wchmm->hmminfo->multipath) {
+    wrt(wchmm->wordbegin, sizeof(int), wchmm->winfo->num, fp, &ok_p);
+  } else {
+    wrt(wchmm->wordend_a, sizeof(LOGPROB), wchmm->winfo->num, fp, &ok_p);
+  }
+
+  /* LM factoring */
+#ifdef UNIGRAM_FACTORING
+  wrt(wchmm->scword, sizeof(WORD_ID), wchmm->scnum, fp, &ok_p);
+  wrt(&(wchmm->fsnum), sizeof(int), 1, fp, &ok_p);
+  wrt(wchmm->fscore, sizeof(LOGPROB), wchmm->fsnum, fp, &ok_p);
+  wrt(&(wchmm->isolatenum), sizeof(int), 1, fp, &ok_p);
+  wrt(wchmm->start2isolate, sizeof(int), wchmm->startnum, fp, &ok_p);
+#else
+  wrt(wchmm->sclen, sizeof(WORD_ID), wchmm->scnum, fp, &ok_p);
+  for (i = 1; i < wchmm->scnum; i++) {
+    wrt(wchmm->sclist[i], sizeof(WORD_ID), wchmm->sclen[i], fp, &ok_p);
+  }
+#endif
+
+  /* end mark */
+  wrt(key, sizeof(unsigned int), 2, fp, &ok_p);
+
+  if (fclose(fp) != 0) ok_p = FALSE;
+  if (ok_p == FALSE) {
+    jlog("ERROR: wchmm_cache: failed to write to \"%s\"\n", filename);
+    remove(filename);
+    return FALSE;
+  }
+
+  jlog("STAT: wchmm_cache: lexicon tree saved to \"%s\"\n", filename);
+
+  return TRUE;
+}
+
+/**
+ * Free the data partially loaded from a broken cache file.
+ *
+ * @param wchmm [i/o] tree lexicon
+ */
+static void
+wchmm_cache_release(WCHMM_INFO *wchmm)
+{
+  mybfree2(&(wchmm->malloc_root));
+#ifdef UNIGRAM_FACTORING
+  if (wchmm->fscore != NULL) free(wchmm->fscore);
+  if (wchmm->start2isolate != NULL) free(wchmm->start2isolate);
+  wchmm->fscore = NULL;
+  wchmm->start2isolate = NULL;
+#endif
+#ifdef PASS1_IWCD
+  free(wchmm->outstyle);
+#endif
+  if (wchmm->hmminfo->multipath) {
+    free(wchmm->wordbegin);
+    free(wchmm->wrk.out_from);
+    free(wchmm->wrk.out_from_next);
+    free(wchmm->wrk.out_a);
+    free(wchmm->wrk.out_a_next);
+    wchmm->wrk.out_from_len = 0;
+  } else {
+    free(wchmm->wordend_a);
+  }
+  free(wchmm->startnode);
+  free(wchmm->wordend);
+  free(wchmm->offset);
+  free(wchmm->stend);
+  free(wchmm->ac);
+  free(wchmm->next_a);
+  free(wchmm->self_a);
+  free(wchmm->state);
+}
+
+/**
+ * Check that node, word and successor list indices in a loaded lexicon
+ * are within their ranges, so that a stale or broken cache file will
+ * not be used.
+ *
+ * @param wchmm [in] tree lexicon loaded from a cache file
+ *
+ * @return TRUE if all indices are valid, or FALSE if not.
+ */
+static boolean
+wchmm_cache_check(WCHMM_INFO *wchmm)
+{
+  A_CELL2 *ac;
+  int i, j, n, num, scid;
+
+  n = wchmm->n;
+  num = wchmm->winfo->num;
+  for (i = 0; i < n; i++) {
+    scid = wchmm->state[i].scid;
+    if (scid >= wchmm->scnum) return FALSE;
+#ifdef UNIGRAM_FACTORING
+    if (scid < 0 && -scid >= wchmm->fsnum) return FALSE;
+#else
+    if (scid < 0) return FALSE;
+#endif
+    if (wchmm->stend[i] != WORD_INVALID
+	&& ((int)wchmm->stend[i] < 0 || (int)wchmm->stend[i] >= num)) return FALSE;
+    for (ac = wchmm->ac[i]; ac; ac = ac->next) {
+      for (j = 0; j < ac->n; j++) {
+	if (ac->arc[j] < 0 || ac->arc[j] >= n) return FALSE;
+      }
+    }
+  }
+  for (i = 0; i < num; i++) {
+    for (j = 0; j < wchmm->winfo->wlen[i]; j++) {
+      if (wchmm->offset[i][j] < 0 || wchmm->offset[i][j] >= n) return FALSE;
+    }
+    if (wchmm->wordend[i] < 0 || wchmm->wordend[i] >= n) return FALSE;
+    if (wchmm->hmminfo->multipath) {
+      if (wchmm->wordbegin[i] < 0 || wchmm->wordbegin[i] >= n) return FALSE;
+    }
+  }
+  for (i = 0; i < wchmm->startnum; i++) {
+    if (wchmm->startnode[i] < 0 || wchmm->startnode[i] >= n) return FALSE;
+#ifdef UNIGRAM_FACTORING
+    if (wchmm->start2isolate[i] < -1 || wchmm->start2isolate[i] >= wchmm->isolatenum) return FALSE;
+#endif
+  }
+  for (scid = 1; scid < wchmm->scnum; scid++) {
+#ifdef UNIGRAM_FACTORING
+    if ((int)wchmm->scword[scid] < 0 || (int)wchmm->scword[scid] >= num) return FALSE;
+#else
+    for (j = 0; j < wchmm->sclen[scid]; j++) {
+      if ((int)wchmm->sclist[scid][j] < 0 || (int)wchmm->sclist[scid][j] >= num) return FALSE;
+    }
+#endif
+  }
+
+  return TRUE;
+}
+
+/**
+ * <JA>
+ * キャッシュファイルから木構造化辞書を読み込む．ファイルが存在しない
+ * 場合や，モデル・設定が保存時と異なる場合は FALSE を返す．その場合は
+ * 通常通り build_wchmm2() で辞書を構築すること．
+ *
+ * @param wchmm [i/o] 木構造化辞書（モデルの割り当て済みのもの）
+ * @param lmconf [in] 言語モデル設定
+ * @param filename [in] キャッシュファイル名
+ *
+ * @return 読み込みに成功したら TRUE，そうでなければ FALSE を返す．
+ * </JA>
+ * <EN>
+ * Load a tree lexicon from a cache file.  Returns FALSE when the file
+ * does not exist or the models or configurations differ from those at
+ * saving.  In that case, the lexicon should be built by build_wchmm2().
+ *
+ * @param wchmm [i/o] tree lexicon, to which models are already assigned
+ * @param lmconf [in] LM configuration
+ * @param filename [in] cache file name
+ *
+ * @return TRUE when successfully loaded, or FALSE if not.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+boolean
+wchmm_cache_load(WCHMM_INFO *wchmm, JCONF_LM *lmconf, char *filename)
+{
+  FILE *fp;
+  WCHMM_CACHE_PTRID *lglist, *cds;
+  HTK_HMM_State **states;
+  int lgnum, cdsnum;
+  unsigned int key[2], fkey[2];
+  int head[4];
+  char magic[sizeof(WCHMM_CACHE_MAGIC)];
+  CD_Set *cd;
+  int *code, *buf;
+  A_CELL2 *cells;
+  RC_INFO *rset;
+  LRC_INFO *lrset;
+  int *offsetbuf;
+  int i, j, n, k, c, total, num;
+  boolean ok_p;
+#ifndef UNIGRAM_FACTORING
+  WORD_ID *scbuf;
+#endif
+
+  if (wchmm->category_tree || wchmm->lmtype != LM_PROB || wchmm->lmvar == LM_NGRAM_USER) {
+    return FALSE;
+  }
+  if ((fp = fopen(filename, "rb")) == NULL) {
+    jlog("STAT: wchmm_cache: \"%s\" not found, build lexicon tree\n", filename);
+    return FALSE;
+  }
+
+  /* check header */
+  ok_p = TRUE;
+  rdn(magic, 1, strlen(WCHMM_CACHE_MAGIC), fp, &ok_p);
+  rdn(head, sizeof(int), 4, fp, &ok_p);
+  rdn(fkey, sizeof(unsigned int), 2, fp, &ok_p);
+  if (ok_p == FALSE
+      || strncmp(magic, WCHMM_CACHE_MAGIC, strlen(WCHMM_CACHE_MAGIC)) != 0
+      || head[0] != WCHMM_CACHE_VERSION
+      || head[1] != WCHMM_CACHE_BYTEORDER
+      || head[2] != wchmm_cache_flags()) {
+    jlog("WARNING: wchmm_cache: \"%s\" is not a lexicon cache of this version, ignored\n", filename);
+    fclose(fp);
+    return FALSE;
+  }
+  wchmm_cache_key(wchmm, lmconf, key);
+  if (key[0] != fkey[0] || key[1] != fkey[1]) {
+    jlog("STAT: wchmm_cache: models or configurations changed, rebuild lexicon tree\n");
+    fclose(fp);
+    return FALSE;
+  }
+
+  if (wchmm_cache_make_index(wchmm->hmminfo, &lglist, &lgnum, &cds, &cdsnum, &states) == FALSE) {
+    fclose(fp);
+    return FALSE;
+  }
+
+  jlog("STAT: wchmm_cache: loading lexicon tree from \"%s\"\n", filename);
+
+  num = wchmm->winfo->num;
+  rdn(&(wchmm->n), sizeof(int), 1, fp, &ok_p);
+  rdn(&(wchmm->startnum), sizeof(int), 1, fp, &ok_p);
+  rdn(&(wchmm->separated_word_count), sizeof(int), 1, fp, &ok_p);
+  rdn(&(wchmm->scnum), sizeof(int), 1, fp, &ok_p);
+  if (ok_p == FALSE || wchmm->n <= 0 || wchmm->startnum <= 0 || wchmm->scnum < 0) {
+    jlog("ERROR: wchmm_cache: broken cache file \"%s\"\n", filename);
+    free(states);
+    free(cds);
+    free(lglist);
+    fclose(fp);
+    return FALSE;
+  }
+  n = wchmm->n;
+
+  /* allocate, the same as built by build_wchmm2() */
+  wchmm->maxwcn = n;
+  wchmm->state = (WCHMM_STATE *)mymalloc(sizeof(WCHMM_STATE) * n);
+  wchmm->self_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * n);
+  wchmm->next_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * n);
+  wchmm->ac = (A_CELL2 **)mymalloc(sizeof(A_CELL2 *) * n);
+  wchmm->stend = (WORD_ID *)mymalloc(sizeof(WORD_ID) * n);
+  wchmm->offset = (int **)mymalloc(sizeof(int *) * num);
+  wchmm->wordend = (int *)mymalloc(sizeof(int) * num);
+  wchmm->maxstartnum = wchmm->startnum;
+  wchmm->startnode = (int *)mymalloc(sizeof(int) * wchmm->startnum);
+  if (wchmm->hmminfo->multipath) {
+    wchmm->wordbegin = (int *)mymalloc(sizeof(int) * num);
+    wchmm->wrk.out_from = (int *)mymalloc(sizeof(int) * wchmm->winfo->maxwn);
+    wchmm->wrk.out_from_next = (int *)mymalloc(sizeof(int) * wchmm->winfo->maxwn);
+    wchmm->wrk.out_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * wchmm->winfo->maxwn);
+    wchmm->wrk.out_a_next = (LOGPROB *)mymalloc(sizeof(LOGPROB) * wchmm->winfo->maxwn);
+    wchmm->wrk.out_from_len = wchmm->winfo->maxwn;
+  } else {
+    wchmm->wordend_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * num);
+  }
+#ifdef PASS1_IWCD
+  wchmm->outstyle = (unsigned char *)mymalloc(sizeof(unsigned char) * n);
+#endif
+#ifdef UNIGRAM_FACTORING
+  wchmm->scword = NULL;
+  wchmm->fscore = NULL;
+  wchmm->start2isolate = NULL;
+  wchmm->isolatenum = 0;
+#endif
+  wchmm->sclist = NULL;
+  wchmm->sclen = NULL;
+
+  /* nodes */
+#ifdef PASS1_IWCD
+  rdn(wchmm->outstyle, sizeof(unsigned char), n, fp, &ok_p);
+#endif
+  code = (int *)mymalloc(sizeof(int) * n * 2);
+  rdn(code, sizeof(int), n * 2, fp, &ok_p);
+  for (i = 0; i < n && ok_p; i++) {
+#ifdef PASS1_IWCD
+    switch(wchmm->outstyle[i]) {
+    case AS_STATE:
+      if (code[i*2] == -1) {
+	wchmm->state[i].out.state = NULL;
+	break;
+      }
+      if (code[i*2] < 0 || code[i*2] >= wchmm->hmminfo->totalstatenum || states[code[i*2]] == NULL) {
+	ok_p = FALSE;
+	break;
+      }
+      wchmm->state[i].out.state = states[code[i*2]];
+      break;
+    case AS_LSET:
+      if (code[i*2] < 0 || code[i*2] >= cdsnum) {
+	ok_p = FALSE;
+	break;
+      }
+      cd = (CD_Set *)cds[code[i*2]].ptr;
+      if (code[i*2+1] < 0 || code[i*2+1] >= cd->state_num) {
+	ok_p = FALSE;
+	break;
+      }
+      wchmm->state[i].out.lset = &(cd->stateset[code[i*2+1]]);
+      break;
+    case AS_RSET:
+      if (code[i*2] < 0 || code[i*2] >= lgnum) {
+	ok_p = FALSE;
+	break;
+      }
+      rset = (RC_INFO *)mybmalloc2(sizeof(RC_INFO), &(wchmm->malloc_root));
+      rset->hmm = (HMM_Logical *)lglist[code[i*2]].ptr;
+      rset->state_loc = code[i*2+1];
+      rset->last_is_lset = FALSE;
+      rset->cache.state = NULL;
+      rset->lastwid_cache = WORD_INVALID;
+      wchmm->state[i].out.rset = rset;
+      break;
+    case AS_LRSET:
+      if (code[i*2] < 0 || code[i*2] >= lgnum) {
+	ok_p = FALSE;
+	break;
+      }
+      lrset = (LRC_INFO *)mybmalloc2(sizeof(LRC_INFO), &(wchmm->malloc_root));
+      lrset->hmm = (HMM_Logical *)lglist[code[i*2]].ptr;
+      lrset->state_loc = code[i*2+1];
+      lrset->last_is_lset = FALSE;
+      lrset->category = 0;
+      lrset->cache.state = NULL;
+      lrset->lastwid_cache = WORD_INVALID;
+      wchmm->state[i].out.lrset = lrset;
+      break;
+    default:
+      ok_p = FALSE;
+      break;
+    }
+#else
+    if (code[i*2] == -1) {
+      wchmm->state[i].out = NULL;
+      continue;
+    }
+    if (code[i*2] < 0 || code[i*2] >= wchmm->hmminfo->totalstatenum || states[code[i*2]] == NULL) {
+      ok_p = FALSE;
+      break;
+    }
+    wchmm->state[i].out = states[code[i*2]];
+#endif
+  }
+  free(code);
+  free(states);
+  free(cds);
+  free(lglist);
+
+  buf = (int *)mymalloc(sizeof(int) * n);
+  rdn(buf, sizeof(int), n, fp, &ok_p);
+  for (i = 0; i < n; i++) wchmm->state[i].scid = buf[i];
+  rdn(wchmm->self_a, sizeof(LOGPROB), n, fp, &ok_p);
+  rdn(wchmm->next_a, sizeof(LOGPROB), n, fp, &ok_p);
+  rdn(wchmm->stend, sizeof(WORD_ID), n, fp, &ok_p);
+
+  /* arcs */
+  total = 0;
+  rdn(&total, sizeof(int), 1, fp, &ok_p);
+  rdn(buf, sizeof(int), n, fp, &ok_p);
+  if (ok_p && total > 0) {
+    cells = (A_CELL2 *)mybmalloc2(sizeof(A_CELL2) * total, &(wchmm->malloc_root));
+  } else {
+    cells = NULL;
+  }
+  k = 0;
+  for (i = 0; i < n && ok_p; i++) {
+    wchmm->ac[i] = NULL;
+    for (j = 0; j < buf[i]; j++) {
+      if (k >= total) {
+	ok_p = FALSE;
+	break;
+      }
+      rdn(&c, sizeof(int), 1, fp, &ok_p);
+      if (ok_p && (c < 0 || c > A_CELL2_ALLOC_STEP)) ok_p = FALSE;
+      rdn(cells[k].arc, sizeof(int), A_CELL2_ALLOC_STEP, fp, &ok_p);
+      rdn(cells[k].a, sizeof(LOGPROB), A_CELL2_ALLOC_STEP, fp, &ok_p);
+      cells[k].n = c;
+      cells[k].next = NULL;
+      if (j == 0) {
+	wchmm->ac[i] = &(cells[k]);
+      } else {
+	cells[k-1].next = &(cells[k]);
+      }
+      k++;
+    }
+  }
+  free(buf);
+
+  /* words */
+  total = 0;
+  for (i = 0; i < num; i++) total += wchmm->winfo->wlen[i];
+  offsetbuf = (int *)mybmalloc2(sizeof(int) * (total + 1), &(wchmm->malloc_root));
+  rdn(offsetbuf, sizeof(int), total, fp, &ok_p);
+  for (i = 0; i < num; i++) {
+    wchmm->offset[i] = offsetbuf;
+    offsetbuf += wchmm->winfo->wlen[i];
+  }
+  rdn(wchmm->wordend, sizeof(int), num, fp, &ok_p);
+  rdn(wchmm->startnode, sizeof(int), wchmm->startnum, fp, &ok_p);
+  if (wchmm->hmminfo->multipath) {
+    rdn(wchmm->wordbegin, sizeof(int), num, fp, &ok_p);
+  } else {
+    rdn(wchmm->wordend_a, sizeof(LOGPROB), num, fp, &ok_p);
+  }
+
+  /* LM factoring */
+#ifdef UNIGRAM_FACTORING
+  wchmm->scword = (WORD_ID *)mybmalloc2(sizeof(WORD_ID) * wchmm->scnum, &(wchmm->malloc_root));
+  rdn(wchmm->scword, sizeof(WORD_ID), wchmm->scnum, fp, &ok_p);
+  rdn(&(wchmm->fsnum), sizeof(int), 1, fp, &ok_p);
+  if (ok_p && wchmm->fsnum > 0) {
+    wchmm->fscore = (LOGPROB *)mymalloc(sizeof(LOGPROB) * wchmm->fsnum);
+    rdn(wchmm->fscore, sizeof(LOGPROB), wchmm->fsnum, fp, &ok_p);
+  }
+  rdn(&(wchmm->isolatenum), sizeof(int), 1, fp, &ok_p);
+  if (ok_p) {
+    wchmm->start2isolate = (int *)mymalloc(sizeof(int) * wchmm->startnum);
+    rdn(wchmm->start2isolate, sizeof(int), wchmm->startnum, fp, &ok_p);
+  }
+#else
+  wchmm->sclen = (WORD_ID *)mybmalloc2(sizeof(WORD_ID) * wchmm->scnum, &(wchmm->malloc_root));
+  rdn(wchmm->sclen, sizeof(WORD_ID), wchmm->scnum, fp, &ok_p);
+  wchmm->sclist = (WORD_ID **)mybmalloc2(sizeof(WORD_ID *) * wchmm->scnum, &(wchmm->malloc_root));
+  total = 0;
+  for (i = 1; i < wchmm->scnum && ok_p; i++) {
+    if ((int)wchmm->sclen[i] < 0 || (int)wchmm->sclen[i] > num) {
+      ok_p = FALSE;
+      break;
+    }
+    total += wchmm->sclen[i];
+  }
+  scbuf = (WORD_ID *)mybmalloc2(sizeof(WORD_ID) * (total + 1), &(wchmm->malloc_root));
+  rdn(scbuf, sizeof(WORD_ID), total, fp, &ok_p);
+  for (i = 1; i < wchmm->scnum && ok_p; i++) {
+    wchmm->sclist[i] = scbuf;
+    scbuf += wchmm->sclen[i];
+  }
+#endif
+
+  /* end mark */
+  fkey[0] = fkey[1] = 0;
+  rdn(fkey, sizeof(unsigned int), 2, fp, &ok_p);
+  if (fkey[0] != key[0] || fkey[1] != key[1]) ok_p = FALSE;
+  fclose(fp);
+  if (ok_p && wchmm_cache_check(wchmm) == FALSE) ok_p = FALSE;
+
+  if (ok_p == FALSE) {
+    jlog("ERROR: wchmm_cache: broken cache file \"%s\", rebuild lexicon tree\n", filename);
+    wchmm_cache_release(wchmm);
+    return FALSE;
+  }
+
+  jlog("STAT: wchmm_cache: lexicon size: %d nodes\n", wchmm->n);
+
+  return TRUE;
+}
+
+/* end of file */
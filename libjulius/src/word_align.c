@@ -172,6 +172,7 @@ make_phseq(WORD_ID *wseq, short num, boolean **has_sp_ret, int *num_ret, int **e
  * @param per_what [in] 単語・音素・状態のどの単位でアラインメントを取るかを指定
  * @param align [out] アラインメント結果を格納するSentence構造体
  * @param r [i/o] 認識処理インスタンス
+ * @param wrk [i/o] 出力確率計算用ワークエリア
  * </JA>
  * <EN>
  * Build sentence HMM, call viterbi_segment() and output result.
@@ -182,10 +183,11 @@ make_phseq(WORD_ID *wseq, short num, boolean **has_sp_ret, int *num_ret, int **e
  * @param per_what [in] specify the alignment unit (word / phoneme / state)
  * @param s [out] Sentence data area to store the alignment result
  * @param r [i/o] recognition process instance
+ * @param wrk [i/o] HMM computation work area
  * </EN>
  */
 static void
-do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAlign *align, RecogProcess *r)
+do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAlign *align, RecogProcess *r, HMMWork *wrk)
 {
   HMM_Logical **phones;		/* phoneme sequence */
   boolean *has_sp;		/* whether phone can follow short pause */
@@ -212,7 +214,6 @@ do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAli
   /* initialize result storage buffer */
   switch(per_what) {
   case PER_WORD:
-    jlog("ALIGN: === word alignment begin ===\n");
     end_num = wnum;
     phloc = (int *)mymalloc(sizeof(int)*wnum);
     i = 0;
@@ -222,12 +223,10 @@ do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAli
     }
     break;
   case PER_PHONEME:
-    jlog("ALIGN: === phoneme alignment begin ===\n");
     end_num = 0;
     for(w=0;w<wnum;w++) end_num += winfo->wlen[words[w]];
     break;
   case PER_STATE:
-    jlog("ALIGN: === state alignment begin ===\n");
     end_num = 0;
     for(w=0;w<wnum;w++) {
       for (i=0;i<winfo->wlen[words[w]]; i++) {
@@ -265,16 +264,20 @@ do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAli
   }
   end_state = (int *)mymalloc(sizeof(int) * end_num);
 
-  /* make phoneme sequence word sequence */
-  phones = make_phseq(words, wnum, &has_sp, &phonenum, &end_state, per_what, r);
-  /* build the sentence HMMs */
-  shmm = new_make_word_hmm(hmminfo, phones, phonenum, has_sp);
+  /* context HMM lookup uses static buffer, so make them one by one */
+#pragma omp critical (word_align_make_hmm)
+  {
+    /* make phoneme sequence word sequence */
+    phones = make_phseq(words, wnum, &has_sp, &phonenum, &end_state, per_what, r);
+    /* build the sentence HMMs */
+    shmm = new_make_word_hmm(hmminfo, phones, phonenum, has_sp);
+  }
   if (shmm == NULL) {
     j_internal_error("Error: failed to make word hmm for alignment\n");
   }
 
   /* call viterbi segmentation function */
-  allscore = viterbi_segment(shmm, param, r->wchmm->hmmwrk, hmminfo->multipath, end_state, end_num, &id_seq, &end_frame, &end_score, &rlen);
+  allscore = viterbi_segment(shmm, param, wrk, hmminfo->multipath, end_state, end_num, r->config->annotate.align_beam, &id_seq, &end_frame, &end_score, &rlen);
 
   /* store result to s */
   align->num = rlen;
@@ -369,7 +372,8 @@ do_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAli
 void
 word_align(WORD_ID *words, short wnum, HTK_Param *param, SentenceAlign *align, RecogProcess *r)
 {
-  do_align(words, wnum, param, PER_WORD, align, r);
+  jlog("ALIGN: === word alignment begin ===\n");
+  do_align(words, wnum, param, PER_WORD, align, r, r->wchmm->hmmwrk);
 }
 
 /** 
@@ -401,7 +405,8 @@ word_rev_align(WORD_ID *revwords, short wnum, HTK_Param *param, SentenceAlign *a
   int w;
   words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * wnum);
   for (w=0;w<wnum;w++) words[w] = revwords[wnum-w-1];
-  do_align(words, wnum, param, PER_WORD, align, r);
+  jlog("ALIGN: === word alignment begin ===\n");
+  do_align(words, wnum, param, PER_WORD, align, r, r->wchmm->hmmwrk);
   free(words);
 }
 
@@ -430,7 +435,8 @@ word_rev_align(WORD_ID *revwords, short wnum, HTK_Param *param, SentenceAlign *a
 void
 phoneme_align(WORD_ID *words, short num, HTK_Param *param, SentenceAlign *align, RecogProcess *r)
 {
-  do_align(words, num, param, PER_PHONEME, align, r);
+  jlog("ALIGN: === phoneme alignment begin ===\n");
+  do_align(words, num, param, PER_PHONEME, align, r, r->wchmm->hmmwrk);
 }
 
 /** 
@@ -462,7 +468,8 @@ phoneme_rev_align(WORD_ID *revwords, short num, HTK_Param *param, SentenceAlign
   int p;
   words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * num);
   for (p=0;p<num;p++) words[p] = revwords[num-p-1];
-  do_align(words, num, param, PER_PHONEME, align, r);
+  jlog("ALIGN: === phoneme alignment begin ===\n");
+  do_align(words, num, param, PER_PHONEME, align, r, r->wchmm->hmmwrk);
   free(words);
 }
 
@@ -491,7 +498,8 @@ phoneme_rev_align(WORD_ID *revwords, short num, HTK_Param *param, SentenceAlign
 void
 state_align(WORD_ID *words, short num, HTK_Param *param, SentenceAlign *align, RecogProcess *r)
 {
-  do_align(words, num, param, PER_STATE, align, r);
+  jlog("ALIGN: === state alignment begin ===\n");
+  do_align(words, num, param, PER_STATE, align, r, r->wchmm->hmmwrk);
 }
 
 /** 
@@ -523,10 +531,47 @@ state_rev_align(WORD_ID *revwords, short num, HTK_Param *param, SentenceAlign *a
   int p;
   words = (WORD_ID *)mymalloc(sizeof(WORD_ID) * num);
   for (p=0;p<num;p++) words[p] = revwords[num-p-1];
-  do_align(words, num, param, PER_STATE, align, r);
+  jlog("ALIGN: === state alignment begin ===\n");
+  do_align(words, num, param, PER_STATE, align, r, r->wchmm->hmmwrk);
   free(words);
 }
 
+/** 
+ * <JA>
+ * 指定した単位で forced alignment を行う．出力確率計算用のワークエリアを
+ * 呼び出し側が与える．スレッドごとに異なるワークエリアを与えれば，
+ * 複数のスレッドから同時に呼び出すことができる．
+ * 
+ * @param words [in] 単語列
+ * @param wnum [in] @a words の単語数
+ * @param param [in] 入力特徴ベクトル列
+ * @param per_what [in] 単語・音素・状態のどの単位でアラインメントを取るかを指定
+ * @param align [out] アラインメント結果を格納するSentence構造体
+ * @param r [in] 認識処理インスタンス
+ * @param wrk [i/o] 出力確率計算用ワークエリア
+ * </JA>
+ * <EN>
+ * Do forced alignment for the given word sequence by the specified
+ * unit, using the given HMM computation work area.  This can be called
+ * from multiple threads at once if each thread gives its own work area.
+ * 
+ * @param words [in] word sequence
+ * @param wnum [in] length of @a words
+ * @param param [in] input parameter vectors
+ * @param per_what [in] specify the alignment unit (word / phoneme / state)
+ * @param align [out] Sentence data area to store the alignment result
+ * @param r [in] recognition process instance
+ * @param wrk [i/o] HMM computation work area
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+unit_align(WORD_ID *words, short wnum, HTK_Param *param, int per_what, SentenceAlign *align, RecogProcess *r, HMMWork *wrk)
+{
+  do_align(words, wnum, param, per_what, align, r, wrk);
+}
+
 /** 
  * <JA>
  * 認識結果に対して必要なアラインメントを全て実行する．
@@ -109,6 +109,29 @@ typedef struct {
   int buflen; ///< Length of buffer
 } DS_BUFFER;
 
+#define RESAMPLE_ZEROCROSS 16	///< Number of sinc zero-crossings at each side of the resampling filter
+#define RESAMPLE_ROLLOFF 0.92	///< Cutoff of resampling filter relative to the lower Nyquist frequency
+#define RESAMPLE_KAISER_BETA 8.0 ///< Kaiser window parameter of the resampling filter
+/**
+ * Streaming polyphase resampler for arbitrary rate conversion
+ * 
+ */
+typedef struct {
+  int in_rate;			///< Input sampling rate
+  int out_rate;			///< Output sampling rate
+  int up;			///< Interpolation factor (L)
+  int down;			///< Decimation factor (M)
+  int taps;			///< Number of filter taps per phase
+  int tapslen;			///< Padded length of a phase for SIMD
+  float *coef;			///< Polyphase filter coefficients [up][tapslen]
+  float *buf;			///< Input history followed by current input
+  int buflen;			///< Allocated length of buf
+  int rest;			///< Number of input samples left unprocessed at the last call
+  int pos;			///< Index of the next input sample to be processed
+  int phase;			///< Current filter phase (0..up-1)
+  int center;			///< Filter delay in interpolated samples
+} RESAMPLER;
+
 /**
  * Work area for zero-cross computation
  * 
@@ -226,6 +249,14 @@ DS_BUFFER *ds48to16_new();
 void ds48to16_free(DS_BUFFER *ds);
 int ds48to16(SP16 *dst, SP16 *src, int srclen, int maxdstlen, DS_BUFFER *ds);
 
+/* adin/resample.c */
+RESAMPLER *resample_new(int in_rate, int out_rate);
+void resample_free(RESAMPLER *rs);
+void resample_reset(RESAMPLER *rs);
+int resample_max_input(RESAMPLER *rs, int dstlen);
+int resample(SP16 *dst, SP16 *src, int srclen, int maxdstlen, RESAMPLER *rs);
+int resample_flush(SP16 *dst, int maxdstlen, RESAMPLER *rs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,8 @@
 #define DFA_STATESTEP 1000	///< Allocation step of DFA state
 
 #define DFA_CP_MINSTEP 20	///< Minimum initial CP data size per category
+#define DFA_CP_BITSHIFT 5	///< log2 of number of bits in a cpbit word
+#define DFA_CP_BITMASK 31	///< Mask to get the bit position in a cpbit word
 
 #define INITIAL_S 0x10000000	///< Status flag mask specifying an initial state
 #define ACCEPT_S  0x00000001	///< Status flag mask specifying an accept state
@@ -82,6 +84,9 @@ typedef struct {
   int **cp;           ///< Store constraint whether @c c2 can follow @c c1
   int *cplen;			///< Lengthes of each bcp 
   int *cpalloclen;		///< Allocated lengthes of each cp
+  unsigned int **cpbit;		///< Bitset of each cp for dense rows, NULL if the row is held in @c cp
+  int *cpbitbase;		///< Word offset of the first word of each cpbit
+  int *cpbitlen;		///< Number of words of each cpbit
   int *cp_begin;      ///< Store constraint whether @c c can appear at beginning of sentence
   int cp_begin_len;		///< Length of cp_begin
   int cp_begin_alloclen;		///< Allocated length of cp_begin
@@ -105,6 +110,9 @@ boolean rddfa(FILE *fp, DFA_INFO *dinfo);
 boolean rddfa_fp(FILE *fp, DFA_INFO *dinfo);
 boolean rddfa_line(char *line, DFA_INFO *dinfo, int *state_max, int *arc_num, int *terminal_max);
 void dfa_append(DFA_INFO *dst, DFA_INFO *src, int soffset, int coffset);
+boolean wrdfa(FILE *fp, DFA_INFO *dinfo);
+DFA_INFO *dfa_determinize(DFA_INFO *dfa);
+DFA_INFO *dfa_minimize(DFA_INFO *dfa);
 
 boolean init_dfa(DFA_INFO *dinfo, char *filename);
 WORD_ID dfa_symbol_lookup(DFA_INFO *dinfo, char *terminalname);
@@ -118,6 +126,7 @@ boolean dfa_cp_end(DFA_INFO *dfa, int i);
 void set_dfa_cp(DFA_INFO *dfa, int i, int j, boolean value);
 void set_dfa_cp_begin(DFA_INFO *dfa, int i, boolean value);
 void set_dfa_cp_end(DFA_INFO *dfa, int i, boolean value);
+void set_dfa_cp_row(DFA_INFO *dfa, int i, int *list, int len);
 void init_dfa_cp(DFA_INFO *dfa);
 void malloc_dfa_cp(DFA_INFO *dfa, int term_num, int size);
 void realloc_dfa_cp(DFA_INFO *dfa, int old_term_num, int new_term_num);
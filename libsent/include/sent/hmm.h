@@ -95,7 +95,8 @@ typedef struct _seg_token {
   int last_end_frame;		///< Frame at which the last unit ends
   LOGPROB last_end_score;	///< Score at which the last unit ends
   struct _seg_token *next;	///< Pointer to previous token context, NULL if no context
-  struct _seg_token *list;	///< Link to next token, NULL if last
+  struct _seg_token *list;	///< Link to next free token in the token pool
+  int mark;			///< Count of garbage collection that last found this token in use
 } SEGTOKEN;
 
 #ifdef __cplusplus
@@ -107,7 +108,7 @@ HMM *new_make_word_hmm(HTK_HMM_INFO *, HMM_Logical  **, int, boolean *);
 HMM *new_make_word_hmm_with_lm(HTK_HMM_INFO *, HMM_Logical  **, int, boolean *, LOGPROB *);
 void free_hmm(HMM *);
 /* vsegment.c */
-LOGPROB viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int *endstates, int ulen, int **id_ret, int **seg_ret, LOGPROB **uscore_ret, int *retlen);
+LOGPROB viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int *endstates, int ulen, LOGPROB beam, int **id_ret, int **seg_ret, LOGPROB **uscore_ret, int *retlen);
 
 /* hmminfo/outprob.c */
 LOGPROB outprob(HMMWork *wrk, int t, HMM_STATE *hmmstate, HTK_Param *param);
@@ -116,6 +116,8 @@ typedef struct __hmmwork__{
   int outprob_allocframenum;	///< Allocated frames of the cache
   BMALLOC_BASE *croot;	///< Root alloc pointer to state outprob cache
   LOGPROB *last_cache;	///< Local work are to hold cache list of current time
+  int outprob_cache_window;	///< Number of recent frames to keep in cache, 0 to keep all frames
+  int *outprob_cache_frame;	///< Frame held in each cache row when @a outprob_cache_window > 0
 
   /* mixture level cache for tied-mixture model */
   MIXCACHE ***mixture_cache; ///< Codebook cache: [time][book_id][0..computed_mixture_num]
@@ -181,6 +183,7 @@ void outprob_set_batch_computation(HMMWork *wrk, boolean flag);
 /* outprob.c */
 boolean outprob_cache_init(HMMWork *wrk);
 boolean outprob_cache_prepare(HMMWork *wrk);
+void outprob_cache_set_window(HMMWork *wrk, int framenum);
 void outprob_cache_free(HMMWork *wrk);
 LOGPROB outprob_state(HMMWork *wrk, int t, HTK_HMM_State *stateinfo, HTK_Param *param);
 void outprob_cd_nbest_init(HMMWork *wrk, int num);
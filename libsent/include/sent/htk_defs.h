@@ -108,6 +108,9 @@ typedef struct {
 /// A header qualifier string for V2: has mixture pdf macro def
 #define BINHMM_HEADER_V2_MPDFMACRO 'M'
 
+/// Header string for binary HMM file V3 (flat format to be memory-mapped)
+#define BINHMM_HEADER_V3 "JBINHMMV3"
+
 /// Maximum number of input stream
 #define MAXSTREAMNUM 50
 
@@ -406,6 +406,9 @@ typedef struct {
   BMALLOC_BASE *mroot;		///< Pointer for block memory allocation
   BMALLOC_BASE *lroot;		///< Pointer for block memory allocation for logical HMM
   BMALLOC_BASE *cdset_root;		///< Pointer for block memory allocation for logical HMM
+  void *flat_base;		///< File image of flat binary %HMM that the data points into, or NULL
+  size_t flat_len;		///< Length of above in bytes
+  boolean flat_mapped;		///< TRUE if above is mapped by mmap(), FALSE if read into memory
 
   int *tmp_mixnum;		///< Work area for state reading
 
@@ -418,6 +421,145 @@ typedef struct {
   //@}
 } HTK_HMM_INFO;
 
+/**
+ * @name Flat binary %HMM format (V3)
+ *
+ * All data are stored in arrays of fixed-size records linked by array
+ * index, in the byte order of the writing machine, so that the file
+ * image can be mapped into memory and referred to directly.  Names
+ * are offsets in the string pool, vectors and matrices are offsets in
+ * the aligned vector pool, and variable-length lists of references
+ * are ranges in the index pool.
+ */
+//@{
+/// Value of the byte order mark
+#define BINHMM_FLAT_BYTEORDER 0x01020304
+/// Index value meaning no reference
+#define BINHMM_FLAT_NONE 0xffffffff
+/// Alignment of each section in bytes
+#define BINHMM_FLAT_ALIGN 64
+/// Header flag: acoustic analysis parameter embedded
+#define BINHMM_FLAT_EMBEDPARA 0x01
+/// Header flag: variance inversed
+#define BINHMM_FLAT_VARINV 0x02
+
+/// Section IDs of flat binary %HMM
+enum {
+  BINHMM_SEC_STR,		///< String pool (char)
+  BINHMM_SEC_VEC,		///< Vector pool (VECT)
+  BINHMM_SEC_IDX,		///< Index pool (unsigned int)
+  BINHMM_SEC_TRANS,		///< Transition matrices
+  BINHMM_SEC_VAR,		///< Variance vectors
+  BINHMM_SEC_DENS,		///< Gaussian densities
+  BINHMM_SEC_SW,		///< Stream weights
+  BINHMM_SEC_TMIX,		///< Tied-mixture codebooks
+  BINHMM_SEC_PDF,		///< Mixture PDFs
+  BINHMM_SEC_STATE,		///< States
+  BINHMM_SEC_DATA,		///< Models
+  BINHMM_SEC_NUM		///< Number of sections
+};
+
+/// Header of flat binary %HMM
+typedef struct {
+  char magic[16];		///< BINHMM_HEADER_V3, padded by NULL
+  unsigned int byteorder;	///< BINHMM_FLAT_BYTEORDER
+  unsigned int flags;		///< Header flags (BINHMM_FLAT_*)
+  unsigned int filesize;	///< Total file size in bytes
+  short stream_num;		///< HTK_HMM_Options: number of streams
+  short vsize[MAXSTREAMNUM];	///< HTK_HMM_Options: vector size of each stream
+  short vec_size;		///< HTK_HMM_Options: vector length
+  short cov_type;		///< HTK_HMM_Options: covariance matrix type
+  short dur_type;		///< HTK_HMM_Options: duration type
+  short param_type;		///< HTK_HMM_Options: parameter type
+  short pad;			///< Padding
+  int is_tied_mixture;		///< TRUE if tied-mixture model
+  int maxmixturenum;		///< Maximum number of Gaussian per mixture
+  int para_version;		///< VALUE_VERSION of below
+  int smp_period;		///< Value: sampling period
+  int smp_freq;			///< Value: sampling frequency
+  int framesize;		///< Value: window size
+  int frameshift;		///< Value: frame shift
+  float preEmph;		///< Value: pre-emphasis coefficient
+  int lifter;			///< Value: cepstral liftering coefficient
+  int fbank_num;		///< Value: number of filterbank channels
+  int delWin;			///< Value: delta window size
+  int accWin;			///< Value: acceleration window size
+  float silFloor;		///< Value: energy silence floor
+  float escale;			///< Value: scaling coefficient of log energy
+  int hipass;			///< Value: high frequency cut-off
+  int lopass;			///< Value: low frequency cut-off
+  int enormal;			///< Value: energy normalization
+  int raw_e;			///< Value: raw energy
+  int zmeanframe;		///< Value: zero mean frame
+  int usepower;			///< Value: use power in filterbank analysis
+  unsigned int num[BINHMM_SEC_NUM]; ///< Number of elements in each section
+  unsigned int offset[BINHMM_SEC_NUM]; ///< Byte offset of each section
+} BINHMM_FLAT_HEADER;
+
+/// Transition matrix record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int statenum;	///< Number of states
+  unsigned int a;		///< statenum x statenum matrix in vector pool
+} BINHMM_FLAT_TRANS;
+
+/// Variance record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int len;		///< Vector length
+  unsigned int vec;		///< Vector in vector pool
+} BINHMM_FLAT_VAR;
+
+/// Gaussian density record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int meanlen;		///< Vector length
+  unsigned int mean;		///< Mean vector in vector pool
+  unsigned int var;		///< Variance record ID
+  LOGPROB gconst;		///< Gconst value
+} BINHMM_FLAT_DENS;
+
+/// Stream weight record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int len;		///< Vector length
+  unsigned int weight;		///< Weights in vector pool
+} BINHMM_FLAT_SW;
+
+/// Tied-mixture codebook record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int num;		///< Number of densities
+  unsigned int d;		///< Density record IDs in index pool
+} BINHMM_FLAT_TMIX;
+
+/// Mixture PDF record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  short stream_id;		///< Stream ID
+  short mix_num;		///< Number of densities
+  unsigned int tmix;		///< Codebook record ID for tied-mixture, or BINHMM_FLAT_NONE
+  unsigned int b;		///< Density record IDs in index pool
+  unsigned int bweight;		///< Mixture weights in vector pool
+} BINHMM_FLAT_PDF;
+
+/// State record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int pdf;		///< PDF record IDs for each stream in index pool
+  unsigned int w;		///< Stream weight record ID, or BINHMM_FLAT_NONE
+  int id;			///< State ID
+} BINHMM_FLAT_STATE;
+
+/// Model record
+typedef struct {
+  unsigned int name;		///< Name in string pool
+  unsigned int state_num;	///< Number of states
+  unsigned int s;		///< State record IDs in index pool
+  unsigned int tr;		///< Transition record ID
+} BINHMM_FLAT_DATA;
+//@}
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -428,6 +570,7 @@ void htk_hmm_set_pause_model(HTK_HMM_INFO *hmminfo, char *spmodel_name);
 /* rdhmmdef.c */
 void rderr(char *str);
 char *read_token(FILE *fp);
+double read_token_value();
 boolean rdhmmdef(FILE *, HTK_HMM_INFO *);
 void htk_hmm_inverse_variances(HTK_HMM_INFO *hmm);
 #ifdef ENABLE_MSD
@@ -536,6 +679,10 @@ int param_check_and_adjust(HTK_HMM_INFO *hmm, HTK_Param *pinfo, boolean vflag);
 /* binary format */
 boolean write_binhmm(FILE *fp, HTK_HMM_INFO *hmm, Value *para);
 boolean read_binhmm(FILE *fp, HTK_HMM_INFO *hmm, boolean gzfile_p, Value *para);
+boolean write_binhmm_flat(FILE *fp, HTK_HMM_INFO *hmm, Value *para);
+boolean check_binhmm_flat(char *filename);
+boolean read_binhmm_flat(char *filename, HTK_HMM_INFO *hmm, Value *para);
+void free_binhmm_flat(HTK_HMM_INFO *hmm);
 
 #ifdef __cplusplus
 }
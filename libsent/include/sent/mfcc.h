@@ -46,6 +46,7 @@
 
 #define CPMAX 500		///< Maximum number of frames to store ceptral mean for realtime CMN update
 #define CPSTEP 5		///< allocate step of cmean list per sentence
+#define CMN_VAR_FLOOR 1.0e-6	///< Flooring value of variance for sliding-window CVN
 
 #include <sent/stddefs.h>
 #include <sent/htk_defs.h>
@@ -65,6 +66,10 @@
 #define DEF_SILFLOOR    50.0	///< Default energy silence floor in dBs, corresponds to SILFLOOR in HTK
 #define DEF_ESCALE      1.0	///< Default scaling coefficient of log energy, corresponds to ESCALE in HTK
 
+#define MFCC_SIMD_ALIGN 8	///< Vector lengths for SIMD kernels are padded to multiple of this
+#define MFCC_SIMD_PAD(n) (((n) + MFCC_SIMD_ALIGN - 1) / MFCC_SIMD_ALIGN * MFCC_SIMD_ALIGN) ///< Padded length for SIMD kernels
+#define MFCC_BATCH_FRAMES 16	///< Number of frames to be processed at once in batch computation
+
 #define DEF_SSALPHA     2.0	///< Default alpha coefficient for spectral subtraction
 #define DEF_SSFLOOR     0.5	///< Default flooring coefficient for spectral subtraction
 
@@ -126,6 +131,11 @@ typedef struct {
    float *loWt;         ///< Array[1..fftN/2] of loChan weighting
    float *Re;           ///< Array[1..fftN] of fftchans (real part)
    float *Im;           ///< Array[1..fftN] of fftchans (imag part)
+   int *bandStart;      ///< Array[1..fbank_num] of first FFT index covered by each channel
+   int *bandLen;        ///< Array[1..fbank_num] of band width of each channel (padded)
+   float **bandWt;      ///< Array[1..fbank_num] of weights over the band of each channel
+   float *bandWtBuf;    ///< Storage of all the band weights above
+   float *spec;         ///< Array[1..fftN/2] of power (or magnitude) spectrum, zero padded
 } FBankInfo;
 
 /// Cycle buffer for delta computation
@@ -141,9 +151,12 @@ typedef struct {
 } DeltaBuf;
 
 /// Work area for MFCC computation
-typedef struct {
+typedef struct _mfcc_work {
   float *bf;			///< Local buffer to hold windowed waveform 
-  double *fbank;   ///< Local buffer to hold filterbank
+  float *fbank;   ///< Local buffer to hold filterbank [1..fbank_num], zero padded
+  int fbank_stride;		///< Padded length of filterbank for SIMD
+  float *fbank_block;		///< Filterbank outputs of a block of frames for batch computation
+  float *energy_block;		///< Energies of a block of frames for batch computation
   FBankInfo fb;	///< Local buffer to hold filterbank information
   int bflen;			///< Length of above
   boolean fbank_only;		///< True if output is filterbank
@@ -156,7 +169,7 @@ typedef struct {
   double *sintbl_fft; ///< Sin table for FFT
   int tbllen; ///< Length of above
   /* cos table for MakeMFCC */
-  double *costbl_makemfcc; ///< Cos table for DCT
+  float *costbl_makemfcc; ///< DCT matrix [mfcc_dim][fbank_stride], scaled by sqrt2var
   int costbl_makemfcc_len; ///< Length of above
   /* sin table for WeightCepstrum */
   double *sintbl_wcep; ///< Sin table for cepstrum weighting
@@ -167,6 +180,8 @@ typedef struct {
   int ssbuflen;			///< length of @a ssbuf
   float ss_floor;		///< flooring value for SS
   float ss_alpha;		///< alpha scaling value for SS
+  int thread_num;		///< Number of threads for buffered feature extraction
+  struct _mfcc_work **thread_wrk; ///< Per-thread work areas for threads [1..thread_num-1]
 } MFCCWork;
 
 /**
@@ -200,6 +215,11 @@ typedef struct {
   boolean loaded_from_file;	///< TRUE if loaded from file
   boolean do_map;		///< TRUE when perform MAP-CMN
   boolean static_cvn_only;      ///< TRUE when perform static CVN only on buffered input
+  int window;			///< Length of sliding window in frames, 0 if not used
+  float *whist;			///< Vectors in the sliding window [window][veclen]
+  int wpos;			///< Next store point in whist
+  double *wsum;			///< Sum of vectors in the sliding window
+  double *wsqr;			///< Sum of squared vectors in the sliding window
 } CMNWork;
 
 /**
@@ -220,7 +240,10 @@ extern "C" {
 /**** mfcc-core.c ****/
 MFCCWork *WMP_work_new(Value *para);
 void WMP_calc(MFCCWork *w, float *mfcc, Value *para);
+void WMP_calc_frame(MFCCWork *w, float *frame, float *mfcc, Value *para);
+void WMP_calc_batch(MFCCWork *w, SP16 *wave, int t_begin, int num, float **mfcc, Value *para);
 void WMP_free(MFCCWork *w);
+boolean WMP_work_set_threads(MFCCWork *w, Value *para, int num);
 /* Get filterbank information */
 boolean InitFBank(MFCCWork *w, Value *para);
 void FreeFBank(FBankInfo *fb);
@@ -245,6 +268,16 @@ void ZMeanFrame(float *wave, int framesize);
 /* Re-scale cepstral coefficients */
 void WeightCepstrum (float *mfcc, Value *para, MFCCWork *w);
 
+/**** mfcc-simd.c ****/
+void mfcc_simd_init();
+float mfcc_dot(float *a, float *b, int len);
+void mfcc_dot4(float *a, float **b, int len, float *out);
+/* mfcc-simd-*.c */
+float mfcc_dot_avx(float *a, float *b, int len);
+void mfcc_dot4_avx(float *a, float **b, int len, float *out);
+float mfcc_dot_sse(float *a, float *b, int len);
+void mfcc_dot4_sse(float *a, float **b, int len, float *out);
+
 /**** wav2mfcc-buffer.c ****/
 /* Convert wave -> MFCC_E_D_(Z) (batch) */
 int Wav2MFCC(SP16 *wave, float **mfcc, Value *para, int nSamples, MFCCWork *w, CMNWork *c);
@@ -267,6 +300,7 @@ boolean WMP_deltabuf_flush(DeltaBuf *db);
 
 CMNWork *CMN_realtime_new(Value *para, float weight, boolean map);
 void CMN_realtime_free(CMNWork *c);
+void CMN_realtime_set_window(CMNWork *c, int frames);
 void CMN_realtime_prepare(CMNWork *c);
 void CMN_realtime(CMNWork *c, float *mfcc);
 void CMN_realtime_update(CMNWork *c, HTK_Param *param);
@@ -228,6 +228,7 @@ NNID search_ngram(NGRAM_INFO *ndata, int n, WORD_ID *w);
 LOGPROB ngram_prob(NGRAM_INFO *ndata, int n, WORD_ID *w);
 LOGPROB uni_prob(NGRAM_INFO *ndata, WORD_ID w);
 LOGPROB bi_prob(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2);
+void bi_prob_row(NGRAM_INFO *ndata, WORD_ID w1, LOGPROB *row);
 void bi_prob_func_set(NGRAM_INFO *ndata);
 
 boolean ngram_read_arpa(FILE *fp, NGRAM_INFO *ndata, boolean addition);
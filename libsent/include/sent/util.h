@@ -82,6 +82,10 @@ int myfrewind(FILE *fp);
 void *mybmalloc2(unsigned int size, BMALLOC_BASE **list);
 char *mybstrdup2(char *, BMALLOC_BASE **list);
 void mybfree2(BMALLOC_BASE **list);
+void mybmerge2(BMALLOC_BASE **dst, BMALLOC_BASE **src);
+boolean mybmalloc_arena_open(size_t size);
+void mybmalloc_arena_close();
+size_t mybmalloc_arena_used();
 
 /* mymalloc.c */
 void *mymalloc(size_t size);
@@ -79,6 +79,9 @@ typedef struct {
 #ifdef USE_MBR
   float *weight; ///< Word weight (use minimization WWER on MBR)
 #endif
+  WORD_ID	*windex;	///< Hash index of word IDs by name for voca_lookup_wid(), built at the first lookup
+  int		windex_size;	///< Number of slots in @a windex (power of 2)
+  WORD_ID	windex_num;	///< Number of words already registered to @a windex
   APATNODE	*errph_root; ///< Root node of index tree for gathering error %HMM name appeared when reading the dictionary 
   BMALLOC_BASE *mroot;		///< Pointer for block memory allocation
   void		*work;		///< Work buffer for dictionary reading
@@ -0,0 +1,350 @@
+/**
+ * @file   resample.c
+ *
+ * <JA>
+ * @brief  任意のサンプリング周波数変換
+ *
+ * 入力のサンプリング周波数を任意の周波数へ変換します．変換比 L/M に
+ * 対してカイザー窓付き sinc 関数による低域通過フィルタを設計し，
+ * L 個の位相に分解したポリフェーズフィルタで L 倍補間・1/M 間引きを
+ * 一度に行います．入力は分割して与えることができ，フィルタの履歴は
+ * 呼び出し間で保持されます．フィルタの積和は MFCC 計算と同じ SIMD
+ * 関数で計算します．
+ * </JA>
+ * <EN>
+ * @brief  Sampling rate conversion between arbitrary rates
+ *
+ * Convert input samples to an arbitrary sampling rate.  For the rate
+ * ratio L/M, a Kaiser-windowed sinc low-pass filter is designed and
+ * decomposed into L polyphase branches, so that interpolation by L and
+ * decimation by M are done at once, computing only the output samples.
+ * Input may be given in arbitrary chunks: the filter history is kept
+ * between calls.  The filter products are computed by the same SIMD
+ * kernels as MFCC computation.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/adin.h>
+#include <sent/mfcc.h>
+
+/// Initial length of input buffer, will be expanded as required
+#define RESAMPLE_BUFSTEP 4096
+
+/**
+ * Greatest common divisor.
+ *
+ * @param a [in] value
+ * @param b [in] value
+ *
+ * @return the greatest common divisor of @a a and @a b.
+ */
+static int
+gcd(int a, int b)
+{
+  int c;
+
+  while (b != 0) {
+    c = a % b;
+    a = b;
+    b = c;
+  }
+  return a;
+}
+
+/**
+ * Modified Bessel function of the first kind, order 0.
+ *
+ * @param x [in] value
+ *
+ * @return I0(x)
+ */
+static double
+bessel_i0(double x)
+{
+  double sum, term, y;
+  int k;
+
+  sum = term = 1.0;
+  y = x * x / 4.0;
+  for (k = 1; k < 100; k++) {
+    term *= y / ((double)k * (double)k);
+    sum += term;
+    if (term < sum * 1.0e-12) break;
+  }
+  return sum;
+}
+
+/**
+ * Design the low-pass filter and store it as polyphase branches.
+ * Coefficients of each phase are stored in reversed order and aligned
+ * to the end of the padded row, so that the output is an inner product
+ * of the row and the last @a tapslen input samples.
+ *
+ * @param rs [i/o] resampler
+ */
+static void
+make_filter(RESAMPLER *rs)
+{
+  int L, n, i, p, k;
+  double fc, c, x, w, h, beta_i0;
+
+  L = rs->up;
+  /* cutoff relative to the Nyquist frequency of the interpolated signal */
+  fc = RESAMPLE_ROLLOFF / (double)((rs->up > rs->down) ? rs->up : rs->down);
+  rs->taps = (int)ceil(2.0 * RESAMPLE_ZEROCROSS / fc / L);
+  rs->tapslen = MFCC_SIMD_PAD(rs->taps);
+  n = rs->taps * L;
+  /* odd length to make the filter delay an integer */
+  if (n % 2 == 0) n--;
+  rs->center = (n - 1) / 2;
+  c = rs->center;
+  beta_i0 = bessel_i0(RESAMPLE_KAISER_BETA);
+
+  rs->coef = (float *)mymalloc(sizeof(float) * L * rs->tapslen);
+  for (i = 0; i < L * rs->tapslen; i++) rs->coef[i] = 0.0;
+  for (i = 0; i < n; i++) {
+    x = i - c;
+    if (x == 0.0) {
+      h = fc;
+    } else {
+      h = sin(PI * fc * x) / (PI * x);
+    }
+    w = x / (c + 1.0);
+    w = bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - w * w)) / beta_i0;
+    /* gain L compensates the zeros inserted by interpolation */
+    p = i % L;
+    k = i / L;
+    rs->coef[p * rs->tapslen + rs->tapslen - 1 - k] = h * w * L;
+  }
+}
+
+/**
+ * Reset the filter history, to start a new input stream.
+ *
+ * @param rs [i/o] resampler
+ */
+void
+resample_reset(RESAMPLER *rs)
+{
+  int i;
+
+  for (i = 0; i < rs->buflen; i++) rs->buf[i] = 0.0;
+  rs->rest = 0;
+  /* start at the filter delay, to align the output to the input */
+  rs->pos = rs->center / rs->up;
+  rs->phase = rs->center % rs->up;
+}
+
+/**
+ * Setup for sampling rate conversion.
+ *
+ * @param in_rate [in] input sampling rate in Hz
+ * @param out_rate [in] output sampling rate in Hz
+ *
+ * @return newly allocated resampler, or NULL on error.
+ */
+RESAMPLER *
+resample_new(int in_rate, int out_rate)
+{
+  RESAMPLER *rs;
+  int g;
+
+  if (in_rate <= 0 || out_rate <= 0) {
+    jlog("Error: resample: invalid sampling rate: %d -> %d\n", in_rate, out_rate);
+    return NULL;
+  }
+  mfcc_simd_init();
+
+  rs = (RESAMPLER *)mymalloc(sizeof(RESAMPLER));
+  rs->in_rate = in_rate;
+  rs->out_rate = out_rate;
+  g = gcd(in_rate, out_rate);
+  rs->up = out_rate / g;
+  rs->down = in_rate / g;
+  make_filter(rs);
+  rs->buflen = rs->tapslen - 1 + RESAMPLE_BUFSTEP;
+  rs->buf = (float *)mymalloc(sizeof(float) * rs->buflen);
+  resample_reset(rs);
+
+  jlog("Stat: resample: %dHz -> %dHz, %d phases x %d taps\n", in_rate, out_rate, rs->up, rs->taps);
+
+  return(rs);
+}
+
+/**
+ * Free the resampler.
+ *
+ * @param rs [i/o] resampler to free
+ */
+void
+resample_free(RESAMPLER *rs)
+{
+  free(rs->buf);
+  free(rs->coef);
+  free(rs);
+}
+
+/**
+ * Return the number of input samples that can be given to resample()
+ * without producing more than @a dstlen output samples.
+ *
+ * @param rs [in] resampler
+ * @param dstlen [in] length of output buffer
+ *
+ * @return the maximum number of input samples.
+ */
+int
+resample_max_input(RESAMPLER *rs, int dstlen)
+{
+  int len;
+
+  len = (int)(((double)dstlen * rs->down - rs->up) / rs->up) - rs->rest;
+  if (len < 0) len = 0;
+  return len;
+}
+
+/**
+ * Append input samples after the filter history and the samples left
+ * at the previous call.
+ *
+ * @param rs [i/o] resampler
+ * @param src [in] input samples, or NULL to append zeros
+ * @param srclen [in] number of input samples
+ *
+ * @return the number of samples after the history.
+ */
+static int
+resample_append(RESAMPLER *rs, SP16 *src, int srclen)
+{
+  int hist, len, i;
+  float *buf;
+
+  hist = rs->tapslen - 1;
+  len = rs->rest + srclen;
+  if (hist + len > rs->buflen) {
+    rs->buflen = hist + len + RESAMPLE_BUFSTEP;
+    rs->buf = (float *)myrealloc(rs->buf, sizeof(float) * rs->buflen);
+  }
+  buf = &(rs->buf[hist + rs->rest]);
+  if (src == NULL) {
+    for (i = 0; i < srclen; i++) buf[i] = 0.0;
+  } else {
+    for (i = 0; i < srclen; i++) buf[i] = src[i];
+  }
+  return len;
+}
+
+/**
+ * Compute output samples from the buffered input.  The conversion stops
+ * when @a maxdstlen samples are output, and the unprocessed input is
+ * kept for the next call.  When @a end is not negative, outputs are
+ * computed only for the time before the @a end -th sample.
+ *
+ * @param rs [i/o] resampler
+ * @param dst [out] store the resulting samples
+ * @param maxdstlen [in] maximum length of dst
+ * @param len [in] number of samples after the history
+ * @param end [in] index of the end of input, or -1 for no limit
+ *
+ * @return the number of samples written to dst.
+ */
+static int
+resample_proc(RESAMPLER *rs, SP16 *dst, int maxdstlen, int len, int end)
+{
+  int hist, i, n, p, k, shift, dstlen;
+  float *coef, *buf;
+  float *x[4];
+  float y[4];
+  float v;
+
+  hist = rs->tapslen - 1;
+  buf = rs->buf;
+  n = rs->pos;
+  p = rs->phase;
+  dstlen = 0;
+  while (n < len && dstlen < maxdstlen) {
+    if (end >= 0 && n * rs->up + p - rs->center >= end * rs->up) break;
+    if (rs->up == 1 && end < 0 && n + 3 * rs->down < len && dstlen + 4 <= maxdstlen) {
+      /* decimation only: four outputs share the same filter */
+      for (k = 0; k < 4; k++) x[k] = &(buf[n + k * rs->down]);
+      mfcc_dot4(rs->coef, x, rs->tapslen, y);
+      k = 4;
+      n += 4 * rs->down;
+    } else {
+      coef = &(rs->coef[p * rs->tapslen]);
+      y[0] = mfcc_dot(coef, &(buf[n]), rs->tapslen);
+      k = 1;
+      p += rs->down;
+      n += p / rs->up;
+      p %= rs->up;
+    }
+    for (i = 0; i < k; i++) {
+      v = y[i];
+      if (v > 32767.0) v = 32767.0;
+      else if (v < -32768.0) v = -32768.0;
+      dst[dstlen++] = (SP16)(v >= 0.0 ? v + 0.5 : v - 0.5);
+    }
+  }
+
+  /* keep the history and the unprocessed input for the next call */
+  shift = (n < len) ? n : len;
+  memmove(buf, &(buf[shift]), sizeof(float) * (hist + len - shift));
+  rs->rest = len - shift;
+  rs->pos = n - shift;
+  rs->phase = p;
+
+  return dstlen;
+}
+
+/**
+ * Convert sampling rate of input samples.  The last samples are kept
+ * in the resampler and used at the next call.  When @a dst is full,
+ * the rest of input is also kept and converted at the next call.
+ *
+ * @param dst [out] store the resulting samples
+ * @param src [in] input samples
+ * @param srclen [in] number of input samples
+ * @param maxdstlen [in] maximum length of dst
+ * @param rs [i/o] resampler
+ *
+ * @return the number of samples written to dst.
+ */
+int
+resample(SP16 *dst, SP16 *src, int srclen, int maxdstlen, RESAMPLER *rs)
+{
+  int len;
+
+  len = resample_append(rs, src, srclen);
+  return(resample_proc(rs, dst, maxdstlen, len, -1));
+}
+
+/**
+ * Output the samples remaining in the resampler at end of input, by
+ * feeding zeros to the filter until the output reaches the end of the
+ * input.  The resampler is reset for the next input stream.  Samples
+ * that do not fit in @a dst are discarded.
+ *
+ * @param dst [out] store the resulting samples
+ * @param maxdstlen [in] maximum length of dst
+ * @param rs [i/o] resampler
+ *
+ * @return the number of samples written to dst.
+ */
+int
+resample_flush(SP16 *dst, int maxdstlen, RESAMPLER *rs)
+{
+  int end, len, dstlen;
+
+  end = rs->rest;
+  len = resample_append(rs, NULL, rs->center / rs->up + 2);
+  dstlen = resample_proc(rs, dst, maxdstlen, len, end);
+  resample_reset(rs);
+  return dstlen;
+}
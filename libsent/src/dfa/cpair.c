@@ -5,6 +5,11 @@
  * @brief  カテゴリ対制約へのアクセス関数およびメモリ管理
  *
  * カテゴリ対制約のメモリ確保，およびカテゴリ間の接続の可否を返す関数です．
+ *
+ * カテゴリ対行列の各行は，カテゴリIDのソート済みリスト，あるいはリスト
+ * 中のIDの範囲を覆うビット列のいずれかで保持されます．ビット列の方が
+ * リストより小さくなる行ではビット列を用い，密な文法で定数時間の参照
+ * を可能にします．
  * </JA>
  * 
  * <EN>
@@ -13,6 +18,11 @@
  * Functions to allocate memory for category-pair constraint, and functions
  * to return whether the given category pairs can be connected or not are
  * defined here.
+ *
+ * Each row of the category-pair matrix is held either as a sorted list of
+ * category IDs, or as a bitset covering the range of the listed IDs.
+ * The bitset is chosen for rows in which it is not larger than the
+ * list, giving constant-time lookup for dense grammars.
  * </EN>
  * 
  * @author Akinobu LEE
@@ -91,12 +101,47 @@ boolean
 dfa_cp(DFA_INFO *dfa, int i, int j)
 {
   int loc;
+  unsigned int w;
 
   /*return(dfa->cp[i][j]);*/
-  //return((dfa->cp[i][j>>3] & cp_table[j&7]) ? TRUE : FALSE);
+  if (dfa->cpbit[i] != NULL) {
+    w = (unsigned int)((j >> DFA_CP_BITSHIFT) - dfa->cpbitbase[i]);
+    if (w >= (unsigned int)dfa->cpbitlen[i]) return FALSE;
+    return((dfa->cpbit[i][w] & (1U << (j & DFA_CP_BITMASK))) ? TRUE : FALSE);
+  }
   return(cp_find(dfa->cp[i], dfa->cplen[i], j, &loc) != -1 ? TRUE : FALSE);
 }
 
+/** 
+ * Get all category IDs in a row of category-pair matrix.
+ * 
+ * @param dfa [in] DFA grammar holding category pair matrix
+ * @param i [in] category id of the row
+ * @param buf [out] buffer to store the category IDs in ascending order,
+ * should have length of at least dfa->cplen[i]
+ * 
+ * @return the number of stored IDs.
+ */
+static int
+cp_row_get(DFA_INFO *dfa, int i, int *buf)
+{
+  int w, k, n;
+  unsigned int x;
+
+  if (dfa->cpbit[i] == NULL) {
+    memcpy(buf, dfa->cp[i], sizeof(int) * dfa->cplen[i]);
+    return(dfa->cplen[i]);
+  }
+  n = 0;
+  for (w = 0; w < dfa->cpbitlen[i]; w++) {
+    x = dfa->cpbit[i][w];
+    for (k = 0; x != 0; k++, x >>= 1) {
+      if (x & 1) buf[n++] = ((dfa->cpbitbase[i] + w) << DFA_CP_BITSHIFT) + k;
+    }
+  }
+  return n;
+}
+
 /** 
  * Return whether the category can be appear at the beginning of sentence.
  * 
@@ -200,6 +245,44 @@ void
 set_dfa_cp(DFA_INFO *dfa, int i, int j, boolean value)
 {
   int loc;
+  int w, base, len, newbase, newlen;
+  unsigned int *b;
+  unsigned int mask;
+
+  if (dfa->cpbit[i] != NULL) {
+    /* bitset row */
+    w = j >> DFA_CP_BITSHIFT;
+    base = dfa->cpbitbase[i];
+    len = dfa->cpbitlen[i];
+    if (w < base || w >= base + len) {
+      if (! value) return;
+      /* expand the range */
+      newbase = (w < base) ? w : base;
+      newlen = ((w >= base + len) ? w + 1 : base + len) - newbase;
+      b = (unsigned int *)mymalloc(sizeof(unsigned int) * newlen);
+      memset(b, 0, sizeof(unsigned int) * newlen);
+      memcpy(&(b[base - newbase]), dfa->cpbit[i], sizeof(unsigned int) * len);
+      free(dfa->cpbit[i]);
+      dfa->cpbit[i] = b;
+      dfa->cpbitbase[i] = base = newbase;
+      dfa->cpbitlen[i] = newlen;
+    }
+    b = &(dfa->cpbit[i][w - base]);
+    mask = 1U << (j & DFA_CP_BITMASK);
+    if (value) {
+      if ((*b & mask) == 0) {
+	*b |= mask;
+	dfa->cplen[i]++;
+      }
+    } else {
+      if ((*b & mask) != 0) {
+	*b &= ~mask;
+	dfa->cplen[i]--;
+      }
+    }
+    return;
+  }
+
   if (value) {
     /* add j to cp list of i */
     if (cp_find(dfa->cp[i], dfa->cplen[i], j, &loc) == -1) { /* not exist */
@@ -265,6 +348,58 @@ set_dfa_cp_end(DFA_INFO *dfa, int i, boolean value)
   }
 }
 
+/** 
+ * Set a whole row of category-pair matrix at once.  The row is stored
+ * as a bitset if it is not larger than the list, or as a list
+ * otherwise.
+ * 
+ * @param dfa [i/o] DFA grammar holding category pair matrix
+ * @param i [in] category id of the row
+ * @param list [in] category IDs in the row, sorted in ascending order
+ * without duplicates
+ * @param len [in] length of @a list
+ */
+void
+set_dfa_cp_row(DFA_INFO *dfa, int i, int *list, int len)
+{
+  int base, n, k, size;
+
+  if (dfa->cpbit[i] != NULL) {
+    free(dfa->cpbit[i]);
+    dfa->cpbit[i] = NULL;
+  }
+  if (len > 0) {
+    base = list[0] >> DFA_CP_BITSHIFT;
+    n = (list[len-1] >> DFA_CP_BITSHIFT) - base + 1;
+    if (n <= len) {
+      /* dense row, bitset is not larger than the list */
+      dfa->cpbit[i] = (unsigned int *)mymalloc(sizeof(unsigned int) * n);
+      memset(dfa->cpbit[i], 0, sizeof(unsigned int) * n);
+      for (k = 0; k < len; k++) {
+	dfa->cpbit[i][(list[k] >> DFA_CP_BITSHIFT) - base] |= 1U << (list[k] & DFA_CP_BITMASK);
+      }
+      dfa->cpbitbase[i] = base;
+      dfa->cpbitlen[i] = n;
+      dfa->cplen[i] = len;
+      if (dfa->cp[i] != NULL) {
+	free(dfa->cp[i]);
+	dfa->cp[i] = NULL;
+	dfa->cpalloclen[i] = 0;
+      }
+      return;
+    }
+  }
+  /* sparse row, hold as list */
+  if (dfa->cp[i] == NULL || dfa->cpalloclen[i] < len) {
+    size = len;
+    if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
+    dfa->cp[i] = (int *)myrealloc(dfa->cp[i], sizeof(int) * size);
+    dfa->cpalloclen[i] = size;
+  }
+  memcpy(dfa->cp[i], list, sizeof(int) * len);
+  dfa->cplen[i] = len;
+}
+
 /** 
  * Initialize category pair matrix in the grammar data.
  * 
@@ -276,6 +411,9 @@ init_dfa_cp(DFA_INFO *dfa)
   dfa->cp = NULL;
   dfa->cplen = NULL;
   dfa->cpalloclen = NULL;
+  dfa->cpbit = NULL;
+  dfa->cpbitbase = NULL;
+  dfa->cpbitlen = NULL;
   dfa->cp_begin = NULL;
   dfa->cp_begin_len = 0;
   dfa->cp_begin_alloclen = 0;
@@ -299,10 +437,16 @@ malloc_dfa_cp(DFA_INFO *dfa, int term_num, int size)
   dfa->cp = (int **)mymalloc(sizeof(int *) * term_num);
   dfa->cplen = (int *)mymalloc(sizeof(int) * term_num);
   dfa->cpalloclen = (int *)mymalloc(sizeof(int) * term_num);
+  dfa->cpbit = (unsigned int **)mymalloc(sizeof(unsigned int *) * term_num);
+  dfa->cpbitbase = (int *)mymalloc(sizeof(int) * term_num);
+  dfa->cpbitlen = (int *)mymalloc(sizeof(int) * term_num);
   for(i=0;i<term_num;i++) {
     dfa->cp[i] = (int *)mymalloc(sizeof(int) * size);
     dfa->cpalloclen[i] = size;
     dfa->cplen[i] = 0;
+    dfa->cpbit[i] = NULL;
+    dfa->cpbitbase[i] = 0;
+    dfa->cpbitlen[i] = 0;
   }
   dfa->cp_begin = (int *)mymalloc(sizeof(int) * size);
   dfa->cp_begin_alloclen = size;
@@ -326,7 +470,8 @@ malloc_dfa_cp(DFA_INFO *dfa, int term_num, int size)
 boolean
 dfa_cp_append(DFA_INFO *dfa, DFA_INFO *src, int offset)
 {
-  int i, j, size;
+  int i, j, n, size;
+  int *buf;
 
   if (dfa->cp == NULL) {
     /* no category pair information exist on target */
@@ -334,47 +479,43 @@ dfa_cp_append(DFA_INFO *dfa, DFA_INFO *src, int offset)
       jlog("InternalError: dfa_cp_append\n");
       return FALSE;
     }
-    /* just malloc and copy */
+    offset = 0;
     dfa->cp = (int **)mymalloc(sizeof(int *) * dfa->term_num);
     dfa->cplen = (int *)mymalloc(sizeof(int) * dfa->term_num);
     dfa->cpalloclen = (int *)mymalloc(sizeof(int) * dfa->term_num);
-    for(i=0;i<dfa->term_num;i++) {
-      size = src->cplen[i];
-      if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
-      dfa->cp[i] = (int *)mymalloc(sizeof(int) * size);
-      dfa->cpalloclen[i] = size;
-      memcpy(dfa->cp[i], src->cp[i], sizeof(int) * src->cplen[i]);
-      dfa->cplen[i] = src->cplen[i];
-    }
-    size = src->cp_begin_len;
-    if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
+    dfa->cpbit = (unsigned int **)mymalloc(sizeof(unsigned int *) * dfa->term_num);
+    dfa->cpbitbase = (int *)mymalloc(sizeof(int) * dfa->term_num);
+    dfa->cpbitlen = (int *)mymalloc(sizeof(int) * dfa->term_num);
+    size = DFA_CP_MINSTEP;
     dfa->cp_begin = (int *)mymalloc(sizeof(int) * size);
     dfa->cp_begin_alloclen = size;
-    memcpy(dfa->cp_begin, src->cp_begin, sizeof(int) * src->cp_begin_len);
-    dfa->cp_begin_len = src->cp_begin_len;
-    size = src->cp_end_len;
-    if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
+    dfa->cp_begin_len = 0;
     dfa->cp_end = (int *)mymalloc(sizeof(int) * size);
     dfa->cp_end_alloclen = size;
-    memcpy(dfa->cp_end, src->cp_end, sizeof(int) * src->cp_end_len);
-    dfa->cp_end_len = src->cp_end_len;
-    return TRUE;
+    dfa->cp_end_len = 0;
+  } else {
+    /* expand index */
+    dfa->cp = (int **)myrealloc(dfa->cp, sizeof(int *) * dfa->term_num);
+    dfa->cplen = (int *)myrealloc(dfa->cplen, sizeof(int) * dfa->term_num);
+    dfa->cpalloclen = (int *)myrealloc(dfa->cpalloclen, sizeof(int) * dfa->term_num);
+    dfa->cpbit = (unsigned int **)myrealloc(dfa->cpbit, sizeof(unsigned int *) * dfa->term_num);
+    dfa->cpbitbase = (int *)myrealloc(dfa->cpbitbase, sizeof(int) * dfa->term_num);
+    dfa->cpbitlen = (int *)myrealloc(dfa->cpbitlen, sizeof(int) * dfa->term_num);
   }
-  /* expand index */
-  dfa->cp = (int **)myrealloc(dfa->cp, sizeof(int *) * dfa->term_num);
-  dfa->cplen = (int *)myrealloc(dfa->cplen, sizeof(int) * dfa->term_num);
-  dfa->cpalloclen = (int *)myrealloc(dfa->cpalloclen, sizeof(int) * dfa->term_num);
-  /* copy src->cp[i][j] to target->cp[i+offset][j+offset] */
+  /* set src->cp[i][j] to target->cp[i+offset][j+offset], the
+     representation of each row is chosen again after shifting */
+  buf = (int *)mymalloc(sizeof(int) * (src->term_num + 1));
   for(i=offset;i<dfa->term_num;i++) {
-    size = src->cplen[i-offset];
-    if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
-    dfa->cp[i] = (int *)mymalloc(sizeof(int) * size);
-    dfa->cpalloclen[i] = size;
-    for(j=0;j<src->cplen[i-offset];j++) {
-      dfa->cp[i][j] = src->cp[i-offset][j] + offset;
-    }
-    dfa->cplen[i] = src->cplen[i-offset];
+    dfa->cp[i] = NULL;
+    dfa->cpalloclen[i] = 0;
+    dfa->cpbit[i] = NULL;
+    dfa->cpbitbase[i] = 0;
+    dfa->cpbitlen[i] = 0;
+    n = cp_row_get(src, i - offset, buf);
+    for(j=0;j<n;j++) buf[j] += offset;
+    set_dfa_cp_row(dfa, i, buf, n);
   }
+  free(buf);
   if (dfa->cp_begin_alloclen < dfa->cp_begin_len + src->cp_begin_len) {
     dfa->cp_begin_alloclen = dfa->cp_begin_len + src->cp_begin_len;
     dfa->cp_begin = (int *)myrealloc(dfa->cp_begin, sizeof(int) * dfa->cp_begin_alloclen);
@@ -408,7 +549,13 @@ free_dfa_cp(DFA_INFO *dfa)
   if (dfa->cp != NULL) {
     free(dfa->cp_end);
     free(dfa->cp_begin);
-    for(i=0;i<dfa->term_num;i++) free(dfa->cp[i]);
+    for(i=0;i<dfa->term_num;i++) {
+      if (dfa->cp[i] != NULL) free(dfa->cp[i]);
+      if (dfa->cpbit[i] != NULL) free(dfa->cpbit[i]);
+    }
+    free(dfa->cpbitlen);
+    free(dfa->cpbitbase);
+    free(dfa->cpbit);
     free(dfa->cpalloclen);
     free(dfa->cplen);
     free(dfa->cp);
@@ -419,17 +566,21 @@ free_dfa_cp(DFA_INFO *dfa)
 void
 dfa_cp_output_rawdata(FILE *fp, DFA_INFO *dfa)
 {
-  int i, j;
+  int i, j, n;
+  int *buf;
 
   if (dfa->cp == NULL) return;
 
+  buf = (int *)mymalloc(sizeof(int) * (dfa->term_num + 1));
   for(i=0;i<dfa->term_num;i++) {
     fprintf(fp, "%d:", i);
-    for(j=0;j<dfa->cplen[i];j++) {
-      fprintf(fp, " %d", dfa->cp[i][j]);
+    n = cp_row_get(dfa, i, buf);
+    for(j=0;j<n;j++) {
+      fprintf(fp, " %d", buf[j]);
     }
     fprintf(fp, "\n");
   }
+  free(buf);
   fprintf(fp, "bgn:");
   for(j=0;j<dfa->cp_begin_len;j++) {
     fprintf(fp, " %d", dfa->cp_begin[j]);
@@ -457,15 +608,20 @@ dfa_cp_count_size(DFA_INFO *dfa, unsigned long *size_ret, unsigned long *allocsi
   size = 0;
   allocsize = 0;
   for(i=0;i<dfa->term_num;i++) {
-    size += sizeof(int) * dfa->cplen[i];
-    allocsize += sizeof(int) * dfa->cpalloclen[i];
+    if (dfa->cpbit[i] != NULL) {
+      size += sizeof(unsigned int) * dfa->cpbitlen[i];
+      allocsize += sizeof(unsigned int) * dfa->cpbitlen[i];
+    } else {
+      size += sizeof(int) * dfa->cplen[i];
+      allocsize += sizeof(int) * dfa->cpalloclen[i];
+    }
   }
   size += sizeof(int) * dfa->cp_begin_len;
   allocsize += sizeof(int) * dfa->cp_begin_alloclen;
   size += sizeof(int) * dfa->cp_end_len;
   allocsize += sizeof(int) * dfa->cp_end_alloclen;
 
-  allocsize += (sizeof(int *) + sizeof(int) + sizeof(int)) * dfa->term_num;
+  allocsize += (sizeof(int *) + sizeof(int) + sizeof(int) + sizeof(unsigned int *) + sizeof(int) + sizeof(int)) * dfa->term_num;
 
   *size_ret = size;
   *allocsize_ret = allocsize;
@@ -0,0 +1,667 @@
+/**
+ * @file   dfa_optimize.c
+ *
+ * <JA>
+ * @brief  DFA文法の決定化と最小化
+ *
+ * 文法ネットワークの決定化と最小化を行います．決定化では状態集合を
+ * ハッシュで管理し，同じ状態集合を定数時間で見つけます．最小化は
+ * Hopcroft のアルゴリズムにより，遷移数 m, 状態数 n に対して
+ * O(m log n) で行います．どちらも元の文法から新たな DFA_INFO を生成します．
+ * </JA>
+ *
+ * <EN>
+ * @brief  Determinization and minimization of DFA grammar
+ *
+ * Functions to determinize and minimize a grammar network.  On
+ * determinization, the generated state sets are interned by hash so that
+ * an existing set is found in constant time.  Minimization is done by
+ * Hopcroft's partition refinement in O(m log n) for m transitions and n
+ * states.  Both functions generate a new DFA_INFO from the given grammar.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/dfa.h>
+
+/**
+ * Create a new grammar to hold the result.
+ *
+ * @param state_num [in] number of states
+ * @param term_num [in] number of categories
+ *
+ * @return the newly allocated grammar.
+ */
+static DFA_INFO *
+dfa_result_new(int state_num, int term_num)
+{
+  DFA_INFO *d;
+
+  d = dfa_info_new();
+  dfa_state_init(d);
+  if (state_num > d->maxstatenum) dfa_state_expand(d, state_num);
+  d->state_num = state_num;
+  d->term_num = term_num;
+  d->st[0].status |= INITIAL_S;
+  return d;
+}
+
+/**
+ * Add an arc at the head of the arc list of a state.  Adding arcs in
+ * descending order of label gives an ascending list.
+ *
+ * @param d [i/o] grammar
+ * @param state [in] state ID
+ * @param label [in] category ID
+ * @param to [in] destination state ID
+ */
+static void
+dfa_result_add_arc(DFA_INFO *d, int state, int label, int to)
+{
+  DFA_ARC *newarc;
+
+  newarc = (DFA_ARC *)mymalloc(sizeof(DFA_ARC));
+  newarc->label = label;
+  newarc->to_state = to;
+  newarc->next = d->st[state].arc;
+  d->st[state].arc = newarc;
+  d->arc_num++;
+}
+
+/**
+ * Find the initial state of a grammar.
+ *
+ * @param dfa [in] grammar
+ * @param caller [in] function name for error message
+ *
+ * @return the initial state ID, or -1 if more than one initial state exists.
+ */
+static int
+dfa_find_initial(DFA_INFO *dfa, char *caller)
+{
+  int i, init;
+
+  init = -1;
+  for(i=0;i<dfa->state_num;i++) {
+    if (dfa->st[i].status & INITIAL_S) {
+      if (init != -1) {
+	jlog("Error: %s: more than one initial node: %d, %d\n", caller, init, i);
+	return -1;
+      }
+      init = i;
+    }
+  }
+  if (init == -1) init = 0;
+  return init;
+}
+
+/**
+ * Count the states of a grammar.  A state which appears only as a
+ * destination of arcs may exceed the state_num.
+ *
+ * @param dfa [in] grammar
+ *
+ * @return the number of states.
+ */
+static int
+dfa_count_states(DFA_INFO *dfa)
+{
+  int i, n;
+  DFA_ARC *ac;
+
+  n = dfa->state_num;
+  for(i=0;i<dfa->state_num;i++) {
+    for(ac=dfa->st[i].arc;ac;ac=ac->next) {
+      if (n <= ac->to_state) n = ac->to_state + 1;
+    }
+  }
+  return n;
+}
+
+/************************************************************************/
+/* determinization */
+
+/// Work area for determinization
+typedef struct {
+  int *pool;			///< State IDs of all state sets
+  int poollen;			///< Used length of @a pool
+  int poolalloc;		///< Allocated length of @a pool
+  int *ofs;			///< Offset of each state set in @a pool
+  int *len;			///< Number of states in each state set
+  unsigned int *hval;		///< Hash value of each state set
+  int num;			///< Number of state sets
+  int alloc;			///< Allocated number of state sets
+  int *htab;			///< Hash table of state set IDs, -1 if empty
+  unsigned int hsize;		///< Size of @a htab, power of 2
+} DFA_SSET;
+
+/**
+ * Compute hash value of a sorted state list.
+ *
+ * @param s [in] state list
+ * @param len [in] length of @a s
+ *
+ * @return the hash value.
+ */
+static unsigned int
+sset_hash(int *s, int len)
+{
+  unsigned int h;
+  int i;
+
+  h = 2166136261U;
+  for(i=0;i<len;i++) {
+    h ^= (unsigned int)s[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/**
+ * Double the hash table of state sets.
+ *
+ * @param ss [i/o] work area
+ */
+static void
+sset_rehash(DFA_SSET *ss)
+{
+  unsigned int i, h;
+
+  free(ss->htab);
+  ss->hsize *= 2;
+  ss->htab = (int *)mymalloc(sizeof(int) * ss->hsize);
+  for(i=0;i<ss->hsize;i++) ss->htab[i] = -1;
+  for(i=0;i<(unsigned int)ss->num;i++) {
+    h = ss->hval[i] & (ss->hsize - 1);
+    while(ss->htab[h] != -1) h = (h + 1) & (ss->hsize - 1);
+    ss->htab[h] = i;
+  }
+}
+
+/**
+ * Find a state set, or register it as new if not found.
+ *
+ * @param ss [i/o] work area
+ * @param s [in] sorted state list without duplicates
+ * @param len [in] length of @a s
+ *
+ * @return the ID of the state set.
+ */
+static int
+sset_intern(DFA_SSET *ss, int *s, int len)
+{
+  unsigned int hv, h;
+  int id;
+
+  hv = sset_hash(s, len);
+  h = hv & (ss->hsize - 1);
+  while((id = ss->htab[h]) != -1) {
+    if (ss->hval[id] == hv && ss->len[id] == len
+	&& memcmp(&(ss->pool[ss->ofs[id]]), s, sizeof(int) * len) == 0) {
+      return id;
+    }
+    h = (h + 1) & (ss->hsize - 1);
+  }
+  /* register as new */
+  if (ss->num >= ss->alloc) {
+    ss->alloc *= 2;
+    ss->ofs = (int *)myrealloc(ss->ofs, sizeof(int) * ss->alloc);
+    ss->len = (int *)myrealloc(ss->len, sizeof(int) * ss->alloc);
+    ss->hval = (unsigned int *)myrealloc(ss->hval, sizeof(unsigned int) * ss->alloc);
+  }
+  if (ss->poollen + len > ss->poolalloc) {
+    while(ss->poollen + len > ss->poolalloc) ss->poolalloc *= 2;
+    ss->pool = (int *)myrealloc(ss->pool, sizeof(int) * ss->poolalloc);
+  }
+  id = ss->num++;
+  memcpy(&(ss->pool[ss->poollen]), s, sizeof(int) * len);
+  ss->ofs[id] = ss->poollen;
+  ss->len[id] = len;
+  ss->hval[id] = hv;
+  ss->poollen += len;
+  ss->htab[h] = id;
+  if ((unsigned int)ss->num * 2 > ss->hsize) sset_rehash(ss);
+  return id;
+}
+
+/// Outgoing transition gathered from the states in a state set
+typedef struct {
+  int label;			///< Category ID
+  int to;			///< Destination state ID
+} DFA_LABELED;
+
+/**
+ * qsort callback to sort transitions by label and destination.
+ *
+ * @param a [in] element
+ * @param b [in] element
+ *
+ * @return the comparison result.
+ */
+static int
+compare_labeled(const void *a, const void *b)
+{
+  const DFA_LABELED *x = a, *y = b;
+
+  if (x->label != y->label) return(x->label < y->label ? -1 : 1);
+  if (x->to != y->to) return(x->to < y->to ? -1 : 1);
+  return 0;
+}
+
+/**
+ * @brief  Determinize a grammar network.
+ *
+ * Subset construction is performed from the initial state.  Each
+ * generated state set is held as a sorted state list and interned by
+ * hash.  State 0 of the result is the initial state, and the arcs of
+ * each state are sorted by category ID.
+ *
+ * @param dfa [in] grammar network, may be non-deterministic
+ *
+ * @return newly allocated deterministic grammar, or NULL on error.
+ */
+DFA_INFO *
+dfa_determinize(DFA_INFO *dfa)
+{
+  DFA_SSET ss;
+  DFA_LABELED *tr;
+  int tralloc, trnum;
+  int *dst;
+  int *arclabel, *arcto, *arcofs;
+  int arcnum, arcalloc, arcofsalloc;
+  int init, cur, i, j, k, n, s;
+  unsigned int u;
+  DFA_ARC *ac;
+  DFA_INFO *d;
+
+  if ((init = dfa_find_initial(dfa, "dfa_determinize")) == -1) return NULL;
+
+  /* initialize work area */
+  ss.alloc = 256;
+  ss.ofs = (int *)mymalloc(sizeof(int) * ss.alloc);
+  ss.len = (int *)mymalloc(sizeof(int) * ss.alloc);
+  ss.hval = (unsigned int *)mymalloc(sizeof(unsigned int) * ss.alloc);
+  ss.poolalloc = 1024;
+  ss.pool = (int *)mymalloc(sizeof(int) * ss.poolalloc);
+  ss.poollen = 0;
+  ss.num = 0;
+  ss.hsize = 512;
+  ss.htab = (int *)mymalloc(sizeof(int) * ss.hsize);
+  for(u=0;u<ss.hsize;u++) ss.htab[u] = -1;
+  tralloc = 256;
+  tr = (DFA_LABELED *)mymalloc(sizeof(DFA_LABELED) * tralloc);
+  dst = (int *)mymalloc(sizeof(int) * (dfa_count_states(dfa) + 1));
+  arcalloc = 1024;
+  arclabel = (int *)mymalloc(sizeof(int) * arcalloc);
+  arcto = (int *)mymalloc(sizeof(int) * arcalloc);
+  arcnum = 0;
+  arcofsalloc = 256;
+  arcofs = (int *)mymalloc(sizeof(int) * arcofsalloc);
+
+  /* the initial state set */
+  sset_intern(&ss, &init, 1);
+
+  /* process the state sets in order of generation */
+  for(cur=0;cur<ss.num;cur++) {
+    /* gather all outgoing transitions of the states in the set */
+    trnum = 0;
+    for(i=0;i<ss.len[cur];i++) {
+      s = ss.pool[ss.ofs[cur] + i];
+      for(ac=dfa->st[s].arc;ac;ac=ac->next) {
+	if (trnum >= tralloc) {
+	  tralloc *= 2;
+	  tr = (DFA_LABELED *)myrealloc(tr, sizeof(DFA_LABELED) * tralloc);
+	}
+	tr[trnum].label = ac->label;
+	tr[trnum].to = ac->to_state;
+	trnum++;
+      }
+    }
+    qsort(tr, trnum, sizeof(DFA_LABELED), compare_labeled);
+    if (cur + 1 >= arcofsalloc) {
+      arcofsalloc *= 2;
+      arcofs = (int *)myrealloc(arcofs, sizeof(int) * arcofsalloc);
+    }
+    arcofs[cur] = arcnum;
+    /* each label makes a transition to the set of destination states */
+    for(i=0;i<trnum;i=j) {
+      n = 0;
+      for(j=i;j<trnum && tr[j].label == tr[i].label;j++) {
+	if (n == 0 || dst[n-1] != tr[j].to) dst[n++] = tr[j].to;
+      }
+      k = sset_intern(&ss, dst, n);
+      if (arcnum >= arcalloc) {
+	arcalloc *= 2;
+	arclabel = (int *)myrealloc(arclabel, sizeof(int) * arcalloc);
+	arcto = (int *)myrealloc(arcto, sizeof(int) * arcalloc);
+      }
+      arclabel[arcnum] = tr[i].label;
+      arcto[arcnum] = k;
+      arcnum++;
+    }
+  }
+  arcofs[ss.num] = arcnum;
+
+  /* build the result */
+  d = dfa_result_new(ss.num, dfa->term_num);
+  for(cur=0;cur<ss.num;cur++) {
+    for(i=0;i<ss.len[cur];i++) {
+      if (dfa->st[ss.pool[ss.ofs[cur] + i]].status & ACCEPT_S) {
+	d->st[cur].status |= ACCEPT_S;
+	break;
+      }
+    }
+    for(i=arcofs[cur+1]-1;i>=arcofs[cur];i--) {
+      dfa_result_add_arc(d, cur, arclabel[i], arcto[i]);
+    }
+  }
+
+  free(arcofs);
+  free(arcto);
+  free(arclabel);
+  free(dst);
+  free(tr);
+  free(ss.htab);
+  free(ss.pool);
+  free(ss.hval);
+  free(ss.len);
+  free(ss.ofs);
+
+  return d;
+}
+
+/************************************************************************/
+/* minimization */
+
+/**
+ * @brief  Minimize a deterministic grammar network.
+ *
+ * States not reachable from the initial state are discarded, and a
+ * missing transition is treated as a transition to an implicit dead
+ * state.  The states are partitioned by Hopcroft's algorithm, where
+ * only the blocks without the dead state are used as splitters.  The
+ * block containing the dead state is removed from the result together
+ * with the arcs to it.
+ *
+ * The resulting states are numbered in order of the smallest original
+ * state ID in each block, with the initial state swapped to 0.  The
+ * arcs of each state are sorted by category ID.
+ *
+ * @param dfa [in] deterministic grammar network
+ *
+ * @return newly allocated minimal grammar, or NULL on error.
+ */
+DFA_INFO *
+dfa_minimize(DFA_INFO *dfa)
+{
+  int init, n, m, i, j, k, s, q, p, b, nb, a;
+  int *id, *orig;		/* original ID <-> reachable state ID */
+  int *fofs, *flabel, *fto;	/* forward transitions of each state */
+  int *iofs, *ilabel, *isrc;	/* inverse transitions to each state */
+  int *elem, *loc, *blk;	/* partition: elements, location, block */
+  int *bfirst, *bend, *bmid;	/* block range, marked part is [bfirst,bmid) */
+  int bnum, sink;
+  int *wl, wnum;		/* waiting splitters */
+  char *inw;			/* TRUE if a block is in the waiting list */
+  int *cnt, *cofs, *tlabels, tnum, *xsrc;
+  int *touched, touchnum;
+  int *gid, gnum, ginit;
+  char *done;
+  DFA_ARC *ac;
+  DFA_INFO *d;
+
+  if ((init = dfa_find_initial(dfa, "dfa_minimize")) == -1) return NULL;
+
+  /* find reachable states, numbered in ascending order of original ID */
+  k = dfa_count_states(dfa);
+  id = (int *)mymalloc(sizeof(int) * k);
+  orig = (int *)mymalloc(sizeof(int) * (k + 1));
+  for(s=0;s<k;s++) id[s] = -1;
+  id[init] = 0;
+  orig[0] = init;
+  n = 1;
+  m = 0;
+  for(i=0;i<n;i++) {
+    for(ac=dfa->st[orig[i]].arc;ac;ac=ac->next) {
+      m++;
+      if (id[ac->to_state] == -1) {
+	id[ac->to_state] = 0;
+	orig[n++] = ac->to_state;
+      }
+    }
+  }
+  n = 0;
+  for(s=0;s<k;s++) {
+    if (id[s] != -1) {
+      id[s] = n;
+      orig[n++] = s;
+    }
+  }
+
+  /* forward transitions sorted by label */
+  fofs = (int *)mymalloc(sizeof(int) * (n + 1));
+  flabel = (int *)mymalloc(sizeof(int) * (m + 1));
+  fto = (int *)mymalloc(sizeof(int) * (m + 1));
+  k = 0;
+  for(q=0;q<n;q++) {
+    fofs[q] = k;
+    for(ac=dfa->st[orig[q]].arc;ac;ac=ac->next) {
+      /* insertion sort, arc lists are short */
+      for(j=k;j>fofs[q] && flabel[j-1] > ac->label;j--) {
+	flabel[j] = flabel[j-1];
+	fto[j] = fto[j-1];
+      }
+      if (j > fofs[q] && flabel[j-1] == ac->label) {
+	jlog("Error: dfa_minimize: not deterministic: state %d has more than one arc of category %d\n", orig[q], ac->label);
+	free(fto); free(flabel); free(fofs); free(orig); free(id);
+	return NULL;
+      }
+      flabel[j] = ac->label;
+      fto[j] = id[ac->to_state];
+      k++;
+    }
+  }
+  fofs[n] = k;
+
+  /* inverse transitions */
+  iofs = (int *)mymalloc(sizeof(int) * (n + 2));
+  ilabel = (int *)mymalloc(sizeof(int) * (m + 1));
+  isrc = (int *)mymalloc(sizeof(int) * (m + 1));
+  for(q=0;q<=n+1;q++) iofs[q] = 0;
+  for(k=0;k<m;k++) iofs[fto[k] + 2]++;
+  for(q=0;q<n;q++) iofs[q+2] += iofs[q+1];
+  for(q=0;q<n;q++) {
+    for(k=fofs[q];k<fofs[q+1];k++) {
+      j = iofs[fto[k] + 1]++;
+      ilabel[j] = flabel[k];
+      isrc[j] = q;
+    }
+  }
+
+  /* initial partition: accepting states, and others with the dead state */
+  sink = n;
+  elem = (int *)mymalloc(sizeof(int) * (n + 1));
+  loc = (int *)mymalloc(sizeof(int) * (n + 1));
+  blk = (int *)mymalloc(sizeof(int) * (n + 1));
+  bfirst = (int *)mymalloc(sizeof(int) * (n + 1));
+  bend = (int *)mymalloc(sizeof(int) * (n + 1));
+  bmid = (int *)mymalloc(sizeof(int) * (n + 1));
+  inw = (char *)mymalloc(sizeof(char) * (n + 1));
+  wl = (int *)mymalloc(sizeof(int) * (n + 1));
+  wnum = 0;
+  bnum = 0;
+  k = 0;
+  for(q=0;q<n;q++) {
+    if (dfa->st[orig[q]].status & ACCEPT_S) {
+      elem[k] = q; loc[q] = k; blk[q] = 0; k++;
+    }
+  }
+  if (k > 0) {
+    bfirst[0] = bmid[0] = 0;
+    bend[0] = k;
+    inw[0] = TRUE;
+    wl[wnum++] = 0;
+    bnum = 1;
+  }
+  bfirst[bnum] = bmid[bnum] = k;
+  for(q=0;q<=n;q++) {
+    if (q == sink || (dfa->st[orig[q]].status & ACCEPT_S) == 0) {
+      elem[k] = q; loc[q] = k; blk[q] = bnum; k++;
+    }
+  }
+  bend[bnum] = k;
+  inw[bnum] = FALSE;
+  bnum++;
+
+  /* refine the partition */
+  cnt = (int *)mymalloc(sizeof(int) * (dfa->term_num + 1));
+  cofs = (int *)mymalloc(sizeof(int) * (dfa->term_num + 1));
+  for(a=0;a<=dfa->term_num;a++) cnt[a] = 0;
+  tlabels = (int *)mymalloc(sizeof(int) * (dfa->term_num + 1));
+  xsrc = (int *)mymalloc(sizeof(int) * (m + 1));
+  touched = (int *)mymalloc(sizeof(int) * (n + 1));
+  while(wnum > 0) {
+    b = wl[--wnum];
+    inw[b] = FALSE;
+    /* group the transitions into the splitter by label */
+    tnum = 0;
+    for(i=bfirst[b];i<bend[b];i++) {
+      q = elem[i];
+      for(j=iofs[q];j<iofs[q+1];j++) {
+	if (cnt[ilabel[j]]++ == 0) tlabels[tnum++] = ilabel[j];
+      }
+    }
+    k = 0;
+    for(i=0;i<tnum;i++) {
+      cofs[tlabels[i]] = k;
+      k += cnt[tlabels[i]];
+    }
+    for(i=bfirst[b];i<bend[b];i++) {
+      q = elem[i];
+      for(j=iofs[q];j<iofs[q+1];j++) {
+	xsrc[cofs[ilabel[j]]++] = isrc[j];
+      }
+    }
+    /* split blocks by the predecessors of each label */
+    k = 0;
+    for(i=0;i<tnum;i++) {
+      a = tlabels[i];
+      touchnum = 0;
+      for(j=k;j<k+cnt[a];j++) {
+	p = xsrc[j];
+	nb = blk[p];
+	if (loc[p] < bmid[nb]) continue; /* already marked */
+	if (bmid[nb] == bfirst[nb]) touched[touchnum++] = nb;
+	/* move to the marked part */
+	s = elem[bmid[nb]];
+	elem[loc[p]] = s;
+	loc[s] = loc[p];
+	elem[bmid[nb]] = p;
+	loc[p] = bmid[nb];
+	bmid[nb]++;
+      }
+      k += cnt[a];
+      cnt[a] = 0;
+      for(j=0;j<touchnum;j++) {
+	nb = touched[j];
+	if (bmid[nb] == bend[nb]) {
+	  /* all marked, no split */
+	  bmid[nb] = bfirst[nb];
+	  continue;
+	}
+	/* the smaller part becomes a new block */
+	if (bmid[nb] - bfirst[nb] <= bend[nb] - bmid[nb]) {
+	  bfirst[bnum] = bfirst[nb];
+	  bend[bnum] = bmid[nb];
+	  bfirst[nb] = bmid[nb];
+	} else {
+	  bfirst[bnum] = bmid[nb];
+	  bend[bnum] = bend[nb];
+	  bend[nb] = bmid[nb];
+	}
+	bmid[nb] = bfirst[nb];
+	bmid[bnum] = bfirst[bnum];
+	for(s=bfirst[bnum];s<bend[bnum];s++) blk[elem[s]] = bnum;
+	/* add splitter, never using the block with the dead state */
+	if (inw[nb]) {
+	  inw[bnum] = TRUE;
+	  wl[wnum++] = bnum;
+	} else if (blk[sink] == bnum) {
+	  inw[bnum] = FALSE;
+	  inw[nb] = TRUE;
+	  wl[wnum++] = nb;
+	} else {
+	  inw[bnum] = TRUE;
+	  wl[wnum++] = bnum;
+	}
+	bnum++;
+      }
+    }
+  }
+
+  /* number the blocks in order of smallest original state ID */
+  gid = (int *)mymalloc(sizeof(int) * bnum);
+  for(b=0;b<bnum;b++) gid[b] = -1;
+  gnum = 0;
+  for(q=0;q<n;q++) {
+    if (blk[q] == blk[sink]) continue;
+    if (gid[blk[q]] == -1) gid[blk[q]] = gnum++;
+  }
+  if (blk[id[init]] == blk[sink]) {
+    /* nothing is accepted */
+    d = dfa_result_new(1, dfa->term_num);
+  } else {
+    /* the initial state should be 0 */
+    ginit = gid[blk[id[init]]];
+    for(b=0;b<bnum;b++) {
+      if (gid[b] == 0) gid[b] = ginit;
+      else if (gid[b] == ginit) gid[b] = 0;
+    }
+    /* build the result from the first state of each block */
+    d = dfa_result_new(gnum, dfa->term_num);
+    done = (char *)mymalloc(sizeof(char) * bnum);
+    for(b=0;b<bnum;b++) done[b] = FALSE;
+    for(q=0;q<n;q++) {
+      b = blk[q];
+      if (b == blk[sink] || done[b]) continue;
+      if (dfa->st[orig[q]].status & ACCEPT_S) d->st[gid[b]].status |= ACCEPT_S;
+      for(k=fofs[q+1]-1;k>=fofs[q];k--) {
+	if (blk[fto[k]] == blk[sink]) continue;
+	dfa_result_add_arc(d, gid[b], flabel[k], gid[blk[fto[k]]]);
+      }
+      done[b] = TRUE;
+    }
+    free(done);
+  }
+
+  free(gid);
+  free(touched);
+  free(xsrc);
+  free(tlabels);
+  free(cofs);
+  free(cnt);
+  free(wl);
+  free(inw);
+  free(bmid);
+  free(bend);
+  free(bfirst);
+  free(blk);
+  free(loc);
+  free(elem);
+  free(isrc);
+  free(ilabel);
+  free(iofs);
+  free(fto);
+  free(flabel);
+  free(fofs);
+  free(orig);
+  free(id);
+
+  return d;
+}
@@ -54,16 +54,28 @@
 /** 
  * Extract category-pair constraint from DFA grammar and newly set the category
  * pair matrix of the give DFA.
+ *
+ * Instead of adding pairs one by one, the rows are built directly: for
+ * each right category, the states it leaves from (considering skipping
+ * of short pause) are indexed, and the left categories reaching to these
+ * states are gathered by a bit mark, which gives a sorted unique row to
+ * be stored at once.
  * 
  * @param dinfo [i/o] DFA grammar, in which the category-pair matrix will be created.
  */
 boolean
 extract_cpair(DFA_INFO *dinfo)
 {
-  int i;
+  int i, j, k, n;
   DFA_ARC *arc_l, *arc_r, *arc_r2;
   int left, right;
   int size;
+  int *inidx, *inlabel;		/* left categories of arcs reaching each state */
+  int *outidx, *outstate;	/* states each right category leaves from */
+  int *pos, *buf;
+  unsigned int *mark;
+  int wmin, wmax;
+  unsigned int x;
 
   /* initialize */
   /* initial size = average fun-out num per state */
@@ -71,7 +83,7 @@ extract_cpair(DFA_INFO *dinfo)
   if (size < DFA_CP_MINSTEP) size = DFA_CP_MINSTEP;
   malloc_dfa_cp(dinfo, dinfo->term_num, size);
 
-  /* extract cpair info */
+  /* extract beginning and end of sentence */
   for (i=0;i<dinfo->state_num;i++) {
     if ((dinfo->st[i].status & INITIAL_S) != 0) { /* arc from initial state */
       for (arc_r = dinfo->st[i].arc; arc_r; arc_r = arc_r->next) {
@@ -83,31 +95,102 @@ extract_cpair(DFA_INFO *dinfo)
       }
     }
     for(arc_l = dinfo->st[i].arc; arc_l; arc_l = arc_l->next) {
-      left = arc_l->label;
       if ((dinfo->st[arc_l->to_state].status & ACCEPT_S) != 0) {/* arc to accept state */
-	if (dinfo->is_sp[left]) {
+	if (dinfo->is_sp[arc_l->label]) {
 	  jlog("Error: mkcpair: skippable sp should not appear at beginning of sentence\n");
 	  return FALSE;
 	}
-	set_dfa_cp_begin(dinfo, left, TRUE);
+	set_dfa_cp_begin(dinfo, arc_l->label, TRUE);
       }
-      /* others */
-      for (arc_r = dinfo->st[arc_l->to_state].arc; arc_r; arc_r = arc_r->next) {
-	right = arc_r->label;
-	set_dfa_cp(dinfo, right, left, TRUE);
-	if (dinfo->is_sp[right]) {
-	  for (arc_r2 = dinfo->st[arc_r->to_state].arc; arc_r2; arc_r2 = arc_r2->next) {
-	    if (dinfo->is_sp[arc_r2->label]) { /* sp model continues twice */
-	      jlog("Error: mkcpair: skippable sp should not repeat\n");
-	      return FALSE;
-	    }
-	    set_dfa_cp(dinfo, arc_r2->label, left, TRUE);
+    }
+  }
+
+  /* count arcs for the indexes */
+  inidx = (int *)mymalloc(sizeof(int) * (dinfo->state_num + 1));
+  outidx = (int *)mymalloc(sizeof(int) * (dinfo->term_num + 1));
+  for (i=0;i<=dinfo->state_num;i++) inidx[i] = 0;
+  for (i=0;i<=dinfo->term_num;i++) outidx[i] = 0;
+  for (i=0;i<dinfo->state_num;i++) {
+    for(arc_l = dinfo->st[i].arc; arc_l; arc_l = arc_l->next) {
+      inidx[arc_l->to_state + 1]++;
+    }
+    for (arc_r = dinfo->st[i].arc; arc_r; arc_r = arc_r->next) {
+      outidx[arc_r->label + 1]++;
+      if (dinfo->is_sp[arc_r->label]) {
+	/* categories after the skippable sp also leave from this state */
+	for (arc_r2 = dinfo->st[arc_r->to_state].arc; arc_r2; arc_r2 = arc_r2->next) {
+	  if (dinfo->is_sp[arc_r2->label]) { /* sp model continues twice */
+	    jlog("Error: mkcpair: skippable sp should not repeat\n");
+	    free(outidx);
+	    free(inidx);
+	    return FALSE;
 	  }
+	  outidx[arc_r2->label + 1]++;
+	}
+      }
+    }
+  }
+  for (i=0;i<dinfo->state_num;i++) inidx[i+1] += inidx[i];
+  for (i=0;i<dinfo->term_num;i++) outidx[i+1] += outidx[i];
+
+  /* fill the indexes */
+  inlabel = (int *)mymalloc(sizeof(int) * (inidx[dinfo->state_num] + 1));
+  outstate = (int *)mymalloc(sizeof(int) * (outidx[dinfo->term_num] + 1));
+  n = (dinfo->state_num > dinfo->term_num) ? dinfo->state_num : dinfo->term_num;
+  pos = (int *)mymalloc(sizeof(int) * n);
+  for (i=0;i<dinfo->state_num;i++) pos[i] = inidx[i];
+  for (i=0;i<dinfo->state_num;i++) {
+    for(arc_l = dinfo->st[i].arc; arc_l; arc_l = arc_l->next) {
+      inlabel[pos[arc_l->to_state]++] = arc_l->label;
+    }
+  }
+  for (i=0;i<dinfo->term_num;i++) pos[i] = outidx[i];
+  for (i=0;i<dinfo->state_num;i++) {
+    for (arc_r = dinfo->st[i].arc; arc_r; arc_r = arc_r->next) {
+      outstate[pos[arc_r->label]++] = i;
+      if (dinfo->is_sp[arc_r->label]) {
+	for (arc_r2 = dinfo->st[arc_r->to_state].arc; arc_r2; arc_r2 = arc_r2->next) {
+	  outstate[pos[arc_r2->label]++] = i;
 	}
       }
+    }
+  }
+  free(pos);
 
+  /* build each row */
+  n = (dinfo->term_num >> DFA_CP_BITSHIFT) + 1;
+  mark = (unsigned int *)mymalloc(sizeof(unsigned int) * n);
+  for (i=0;i<n;i++) mark[i] = 0;
+  buf = (int *)mymalloc(sizeof(int) * (dinfo->term_num + 1));
+  for (right=0;right<dinfo->term_num;right++) {
+    wmin = n;
+    wmax = -1;
+    for (j=outidx[right];j<outidx[right+1];j++) {
+      i = outstate[j];
+      for (k=inidx[i];k<inidx[i+1];k++) {
+	left = inlabel[k];
+	mark[left >> DFA_CP_BITSHIFT] |= 1U << (left & DFA_CP_BITMASK);
+	if (wmin > (left >> DFA_CP_BITSHIFT)) wmin = left >> DFA_CP_BITSHIFT;
+	if (wmax < (left >> DFA_CP_BITSHIFT)) wmax = left >> DFA_CP_BITSHIFT;
+      }
+    }
+    /* collect in ascending order, clearing the marks */
+    size = 0;
+    for (i=wmin;i<=wmax;i++) {
+      x = mark[i];
+      for (k = 0; x != 0; k++, x >>= 1) {
+	if (x & 1) buf[size++] = (i << DFA_CP_BITSHIFT) + k;
+      }
+      mark[i] = 0;
     }
+    set_dfa_cp_row(dinfo, right, buf, size);
   }
+  free(buf);
+  free(mark);
+  free(outstate);
+  free(outidx);
+  free(inlabel);
+  free(inidx);
 
   return TRUE;
 }
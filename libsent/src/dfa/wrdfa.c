@@ -0,0 +1,49 @@
+/**
+ * @file   wrdfa.c
+ * 
+ * <JA>
+ * @brief  DFA文法の書き出し
+ * </JA>
+ * 
+ * <EN>
+ * @brief  Write DFA grammar to a file
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/dfa.h>
+
+/** 
+ * Write DFA grammar in the format of ".dfa" file.  States are written
+ * in order of ID, and arcs in order of the arc list of each state.  The
+ * accept flag is set at the first line of the state.
+ * 
+ * @param fp [in] file pointer to write to
+ * @param dinfo [in] DFA grammar
+ * 
+ * @return TRUE on success, FALSE on write failure.
+ */
+boolean
+wrdfa(FILE *fp, DFA_INFO *dinfo)
+{
+  DFA_ARC *ac;
+  int i, acc;
+
+  for(i=0;i<dinfo->state_num;i++) {
+    acc = (dinfo->st[i].status & ACCEPT_S) ? 1 : 0;
+    for(ac=dinfo->st[i].arc;ac;ac=ac->next) {
+      if (fprintf(fp, "%d %d %d %d 0\n", i, ac->label, ac->to_state, acc) < 0) return FALSE;
+      acc = 0;
+    }
+    if (acc == 1) {
+      if (fprintf(fp, "%d -1 -1 1 0\n", i) < 0) return FALSE;
+    }
+  }
+  return TRUE;
+}
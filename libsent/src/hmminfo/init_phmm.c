@@ -41,6 +41,9 @@ hmminfo_new()
   new->lroot = NULL;
   new->cdset_root = NULL;
   new->tmp_mixnum = NULL;
+  new->flat_base = NULL;
+  new->flat_len = 0;
+  new->flat_mapped = FALSE;
 
   new->opt.stream_info.num = 0;
   new->opt.cov_type = C_DIAG_C;
@@ -107,6 +110,8 @@ hmminfo_free(HTK_HMM_INFO *hmm)
   /* free all memory that has been allocated by bmalloc2() */
   if (hmm->mroot != NULL) mybfree2(&(hmm->mroot));
   if (hmm->lroot != NULL) mybfree2(&(hmm->lroot));
+  /* release file image of flat binary HMM */
+  free_binhmm_flat(hmm);
 
   /* free whole */
   free(hmm);
@@ -117,7 +122,8 @@ hmminfo_free(HTK_HMM_INFO *hmm)
 /** 
  * @brief Load HTK %HMM definition file and HMMList file, and setup phone %HMM information.
  *
- * First try ascii format, then try binary format.
+ * A flat binary file is mapped into memory.  Otherwise first try ascii
+ * format, then try binary format.
  * 
  * @param hmminfo [out] pointer to store all the %HMM definition data.
  * @param hmmfilename [in] file name of HTK %HMM definition file, NULL if not.
@@ -135,17 +141,27 @@ init_hmminfo(HTK_HMM_INFO *hmminfo, char *hmmfilename, char *namemapfile, Value
 
   /* read hmmdef file */
   jlog("Stat: init_phmm: Reading in HMM definition\n");
-  /* first, try ascii format */
-  if ((fp = fopen_readfile(hmmfilename)) == NULL) {
-    jlog("Error: init_phmm: failed to open %s\n",hmmfilename);
-    return FALSE;
-  }
-  if (rdhmmdef(fp, hmminfo) == TRUE) {
+  if (check_binhmm_flat(hmmfilename)) {
+    /* flat binary format, map the file into memory */
+    if (read_binhmm_flat(hmmfilename, hmminfo, para) == FALSE) {
+      jlog("Error: init_phmm: failed to read %s\n", hmmfilename);
+      return FALSE;
+    }
     ok_p = TRUE;
   }
-  if (fclose_readfile(fp) < 0) {
-    jlog("Error: init_phmm: failed to close %s\n", hmmfilename);
-    return FALSE;
+  if (ok_p == FALSE) {
+    /* first, try ascii format */
+    if ((fp = fopen_readfile(hmmfilename)) == NULL) {
+      jlog("Error: init_phmm: failed to open %s\n",hmmfilename);
+      return FALSE;
+    }
+    if (rdhmmdef(fp, hmminfo) == TRUE) {
+      ok_p = TRUE;
+    }
+    if (fclose_readfile(fp) < 0) {
+      jlog("Error: init_phmm: failed to close %s\n", hmmfilename);
+      return FALSE;
+    }
   }
   if (ok_p == FALSE) {
     /* second, try binary format */
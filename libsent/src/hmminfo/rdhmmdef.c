@@ -12,6 +12,9 @@
  * %HMM 定義ファイルは read_token() によってトークン単位で順次読み込まれ，
  * グローバル変数 rdhmmdef_token に格納されます．各関数群はこの
  * rdhmmdef_token を参照して現在のトークンを得ます．
+ * 入力は完結した行からなる大きなブロック単位で読み込まれ，ブロック内の
+ * トークン分割と数値トークンの変換 (atof) は改行位置で分割した部分ごとに
+ * 並列に行われます．数値は read_token_value() で参照できます．
  * </JA>
  * 
  * <EN>
@@ -25,6 +28,10 @@
  * will read the file per token, and the read token is stored in a global
  * variable rdhmmdef_token.  The other reading function will refer to this
  * variable to read the current token.
+ * The input is read per large block of complete lines.  Tokenizing the
+ * block and converting numeric tokens by atof() are done at once, in
+ * parallel for parts of the block divided at newlines.  The converted
+ * value of the current token can be obtained by read_token_value().
  * </EN>
  * 
  * @author Akinobu LEE
@@ -47,13 +54,32 @@
 #include <zlib.h>
 #endif
 
-#define MAXBUFLEN  4096		///< Maximum length of a line in the input
+#include <float.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define RDHMMDEF_BLOCKSIZE 4194304 ///< Bytes to read at once from the input
+#define RDHMMDEF_CHUNKSIZE 262144 ///< Minimum bytes to be tokenized by a thread
 
 char *rdhmmdef_token;		///< Current token string (GLOBAL)
-static boolean last_line_full = FALSE;
-static char buf[MAXBUFLEN];	///< Local work area for token reading
 static int line;		///< Input Line count
 
+/* input is read per block of complete lines and tokenized at once */
+static char *blk = NULL;	///< Input block buffer
+static size_t blkalloc = 0;	///< Allocated length of @a blk
+static size_t blklen;		///< Length of data in @a blk
+static size_t blkend;		///< Length of complete lines in @a blk
+static boolean blkeof;		///< TRUE when reached end of file
+static int blkline;		///< Line number at beginning of the block
+static boolean delimtbl[256];	///< TRUE for delimiter characters
+static char **tok = NULL;	///< Tokens in the current block
+static double *tokval = NULL;	///< atof() of the numeric tokens
+static int *tokline = NULL;	///< Line number of the tokens
+static int tokalloc = 0;	///< Allocated length of token arrays
+static int toknum;		///< Number of tokens in the current block
+static int tokcur;		///< Index of the next token
+
 /* global functions for rdhmmdef_*.c */
 
 /** 
@@ -74,64 +100,376 @@ rderr(char *str)
 }
 
 /** 
- * Read next token and ste it to rdhmmdef_token.
+ * Read next block of complete lines from the input.  The incomplete
+ * last line of the previous block will be moved to the head.
  * 
  * @param fp [in] file pointer
  * 
- * @return the pointer to the read token, or NULL on end of file or error.
+ * @return TRUE if some data has been read, or FALSE on end of file.
  */
-char *
-read_token(FILE *fp)
+static boolean
+block_read(FILE *fp)
 {
-  int len;
-  int bp = 0;
-  int maxlen = MAXBUFLEN;
-  static char delims[] = HMMDEF_DELM;
-
-  if ((rdhmmdef_token = mystrtok_quote(NULL, HMMDEF_DELM)) != NULL) {
-    /* has token */
-    if (mystrtok_movetonext(NULL, HMMDEF_DELM) != NULL || last_line_full == FALSE) {
-      /* return the current token, if this is not a last token, or
-	 last is newline terminated */
-      return rdhmmdef_token;
-    } else {
-      /* concatinate the last token with next line */
-      len = strlen(rdhmmdef_token);
-      memmove(buf, rdhmmdef_token, len);
-      bp = len;
-      maxlen -= len;
+  size_t n, i;
+
+  if (blkend < blklen) memmove(blk, &(blk[blkend]), blklen - blkend);
+  blklen -= blkend;
+  blkend = 0;
+
+  for (;;) {
+    if (blklen + RDHMMDEF_BLOCKSIZE + 1 > blkalloc) {
+      blkalloc = blklen + RDHMMDEF_BLOCKSIZE + 1;
+      blk = (char *)myrealloc(blk, blkalloc);
+    }
+    if (! blkeof) {
+      n = myfread(&(blk[blklen]), 1, RDHMMDEF_BLOCKSIZE, fp);
+      if (n == 0 || n > RDHMMDEF_BLOCKSIZE) {
+	blkeof = TRUE;
+      } else {
+	blklen += n;
+      }
+    }
+    blk[blklen] = '\0';
+    if (blkeof) {
+      blkend = blklen;
+      break;
+    }
+    /* cut at the last newline */
+    for (i = blklen; i > 0; i--) {
+      if (blk[i-1] == '\n') break;
     }
+    if (i > 0) {
+      blkend = i;
+      break;
+    }
+    /* no newline in the whole block, read more */
   }
 
-  /* read new 1 line a*/
-  while(
-#ifdef HAVE_ZLIB
-	gzgets((gzFile)fp, &(buf[bp]), maxlen) != Z_NULL
+  return(blkend > 0);
+}
+
+/** 
+ * Convert a numeric token to double, with the same result as atof().
+ * Decimal numbers whose significand fits in 53 bits and whose decimal
+ * exponent is small enough are converted by one exact multiplication
+ * or division, which is correctly rounded as strtod().  Others are
+ * converted by atof().
+ * 
+ * @param str [in] token string
+ * 
+ * @return the converted value.
+ */
+static double
+token_atof(char *str)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  static const double pow10tbl[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  char *p;
+  unsigned long long m;
+  int ndigit, e, ev, esign;
+  boolean neg, has_digit;
+  double v;
+
+  p = str;
+  neg = FALSE;
+  if (*p == '-') {
+    neg = TRUE;
+    p++;
+  } else if (*p == '+') {
+    p++;
+  }
+  m = 0;
+  ndigit = 0;
+  e = 0;
+  has_digit = FALSE;
+  /* skip leading zeros, not counted as significant digits */
+  while (*p == '0') {
+    has_digit = TRUE;
+    p++;
+  }
+  while (*p >= '0' && *p <= '9') {
+    if (ndigit >= 19) return(atof(str));
+    m = m * 10 + (*p - '0');
+    ndigit++;
+    has_digit = TRUE;
+    p++;
+  }
+  if (*p == '.') {
+    p++;
+    if (ndigit == 0) {
+      while (*p == '0') {
+	has_digit = TRUE;
+	e--;
+	p++;
+      }
+    }
+    while (*p >= '0' && *p <= '9') {
+      if (ndigit >= 19) return(atof(str));
+      m = m * 10 + (*p - '0');
+      ndigit++;
+      e--;
+      has_digit = TRUE;
+      p++;
+    }
+  }
+  if (! has_digit) return(atof(str));
+  if (*p == 'e' || *p == 'E') {
+    p++;
+    esign = 1;
+    if (*p == '-') {
+      esign = -1;
+      p++;
+    } else if (*p == '+') {
+      p++;
+    }
+    if (*p < '0' || *p > '9') return(atof(str));
+    ev = 0;
+    while (*p >= '0' && *p <= '9') {
+      if (ev > 10000) return(atof(str));
+      ev = ev * 10 + (*p - '0');
+      p++;
+    }
+    e += esign * ev;
+  }
+  if (*p != '\0') return(atof(str));
+  if (m == 0) return(neg ? -0.0 : 0.0);
+  if (m > (1ULL << 53) || e < -22 || e > 22) return(atof(str));
+  v = (double)m;
+  if (e < 0) {
+    v /= pow10tbl[-e];
+  } else {
+    v *= pow10tbl[e];
+  }
+  return(neg ? -v : v);
 #else
-	fgets(&(buf[bp]), maxlen, fp) != NULL
+  return(atof(str));
 #endif
-	) {
-    /* chop delimiters at end of line (incl. newline) */
-    /* if no delimiter at end of line, last_line_full is TRUE */
-    last_line_full = TRUE;
-    len = strlen(buf)-1;
-    while (len >= 0 && strchr(delims, buf[len])) {
-      last_line_full = FALSE;
-      buf[len--] = '\0';
-    }
-    if (buf[0] != '\0') {
-      /* start getting next token */
-      rdhmmdef_token = mystrtok_quote(buf, HMMDEF_DELM);
-      /* increment line */
-      line++;
-      return rdhmmdef_token;
+}
+
+/** 
+ * Split a part of the block into tokens, as mystrtok_quote() does for
+ * each line.  The part should end at a newline or at the end of file.
+ * When @a store is FALSE, just count the tokens and lines without
+ * modifying the buffer.  Numeric tokens are converted here, so that the
+ * conversion can be done in parallel.
+ * 
+ * @param s [i/o] beginning of the part
+ * @param e [in] end of the part
+ * @param store [in] TRUE to terminate and store the tokens
+ * @param t [in] index in the token arrays to store the first token
+ * @param ln [i/o] line number at @a s, will be updated to the line at @a e
+ * 
+ * @return the number of tokens in the part.
+ */
+static int
+block_tokenize_part(char *s, char *e, boolean store, int t, int *ln)
+{
+  char *p, *from, *r;
+  int num, c, d;
+  int l;
+
+  num = 0;
+  l = *ln;
+  p = s;
+  while (p < e) {
+    /* find start point */
+    while (p < e && delimtbl[(unsigned char)*p]) {
+      if (*p == '\n') l++;
+      p++;
+    }
+    if (p >= e) break;
+    if (*p == '"') {
+      /* quoted token ends at a quotation followed by delimiter */
+      from = p + 1;
+      for (r = from; r < e && *r != '\n'; r++) {
+	if (*r == '"' && (r + 1 >= e || delimtbl[(unsigned char)*(r+1)])) break;
+      }
+      if (r >= e || *r == '\n') {
+	/* not terminated: allow the rest of line as one token */
+	while (r > from && delimtbl[(unsigned char)*(r-1)]) r--;
+	if (r == from) {
+	  p = r;
+	  continue;
+	}
+      }
+    } else {
+      from = p;
+      for (r = from; r < e && ! delimtbl[(unsigned char)*r]; r++);
     }
+    /* the character at end of token will be overwritten */
+    c = (r < e) ? *r : '\0';
+    if (store) {
+      *r = '\0';
+      tok[t + num] = from;
+      tokline[t + num] = l;
+      d = from[0];
+      if ((d >= '0' && d <= '9') || d == '-' || d == '+' || d == '.') {
+	tokval[t + num] = token_atof(from);
+      } else {
+	tokval[t + num] = 0.0;
+      }
+    }
+    if (c == '\n') l++;
+    num++;
+    p = r + 1;
   }
-  /* when reading error, return NULL */
+  *ln = l;
+
+  return num;
+}
+/** 
+ * Split the complete lines in the current block into tokens.  The block
+ * is divided into parts at newlines and the parts are processed in
+ * parallel: first count tokens in each part, and then store them to
+ * the token arrays from the offset of each part.
+ * 
+ */
+static void
+block_tokenize()
+{
+  int nchunk, i, n, l, k;
+  size_t *cbgn;
+  int *cnum, *cline;
+
+  nchunk = 1;
+#ifdef _OPENMP
+  nchunk = omp_get_max_threads() * 4;
+  if (nchunk > blkend / RDHMMDEF_CHUNKSIZE + 1) nchunk = blkend / RDHMMDEF_CHUNKSIZE + 1;
+#endif
+  cbgn = (size_t *)mymalloc(sizeof(size_t) * (nchunk + 1));
+  cnum = (int *)mymalloc(sizeof(int) * nchunk);
+  cline = (int *)mymalloc(sizeof(int) * nchunk);
+
+  /* divide at newlines */
+  cbgn[0] = 0;
+  for (i = 1; i < nchunk; i++) {
+    cbgn[i] = blkend / nchunk * i;
+    if (cbgn[i] < cbgn[i-1]) cbgn[i] = cbgn[i-1];
+    while (cbgn[i] > 0 && cbgn[i] < blkend && blk[cbgn[i]-1] != '\n') cbgn[i]++;
+  }
+  cbgn[nchunk] = blkend;
+
+  /* count tokens and lines in each part */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i = 0; i < nchunk; i++) {
+    cline[i] = 0;
+    cnum[i] = block_tokenize_part(&(blk[cbgn[i]]), &(blk[cbgn[i+1]]), FALSE, 0, &(cline[i]));
+  }
+
+  /* set token index and line number at beginning of each part */
+  n = 0;
+  l = blkline;
+  for (i = 0; i < nchunk; i++) {
+    k = cnum[i];
+    cnum[i] = n;
+    n += k;
+    k = cline[i];
+    cline[i] = l;
+    l += k;
+  }
+  toknum = n;
+  tokcur = 0;
+  blkline = l;
+  if (toknum > tokalloc) {
+    tokalloc = toknum;
+    tok = (char **)myrealloc(tok, sizeof(char *) * tokalloc);
+    tokval = (double *)myrealloc(tokval, sizeof(double) * tokalloc);
+    tokline = (int *)myrealloc(tokline, sizeof(int) * tokalloc);
+  }
+
+  /* store tokens */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i = 0; i < nchunk; i++) {
+    block_tokenize_part(&(blk[cbgn[i]]), &(blk[cbgn[i+1]]), TRUE, cnum[i], &(cline[i]));
+  }
+
+  free(cline);
+  free(cnum);
+  free(cbgn);
+}
+
+/** 
+ * Prepare for reading tokens from the input.
+ * 
+ */
+static void
+token_init()
+{
+  int i;
+  char *p;
+
+  for (i = 0; i < 256; i++) delimtbl[i] = FALSE;
+  for (p = HMMDEF_DELM; *p != '\0'; p++) delimtbl[(unsigned char)*p] = TRUE;
+  delimtbl[0] = TRUE;
+  blklen = blkend = 0;
+  blkeof = FALSE;
+  blkline = 1;
+  toknum = tokcur = 0;
   rdhmmdef_token = NULL;
+}
+
+/** 
+ * Free work area for reading tokens.
+ * 
+ */
+static void
+token_free()
+{
+  if (blk != NULL) free(blk);
+  if (tok != NULL) free(tok);
+  if (tokval != NULL) free(tokval);
+  if (tokline != NULL) free(tokline);
+  blk = NULL;
+  tok = NULL;
+  tokval = NULL;
+  tokline = NULL;
+  blkalloc = 0;
+  tokalloc = 0;
+}
+
+/** 
+ * Read next token and set it to rdhmmdef_token.
+ * 
+ * @param fp [in] file pointer
+ * 
+ * @return the pointer to the read token, or NULL on end of file or error.
+ */
+char *
+read_token(FILE *fp)
+{
+  while (tokcur >= toknum) {
+    /* read and tokenize next block */
+    if (block_read(fp) == FALSE) {
+      rdhmmdef_token = NULL;
+      return rdhmmdef_token;
+    }
+    block_tokenize();
+  }
+  rdhmmdef_token = tok[tokcur];
+  line = tokline[tokcur];
+  tokcur++;
+
   return rdhmmdef_token;
 }
 
+/** 
+ * Return the numeric value of the current token, as atof(rdhmmdef_token).
+ * 
+ * @return the value of the current token.
+ */
+double
+read_token_value()
+{
+  return(tokval[tokcur - 1]);
+}
+
 /** 
  * Convert all the transition probabilities to log10 scale.
  * 
@@ -263,22 +601,29 @@ rdhmmdef(FILE *fp, HTK_HMM_INFO *hmm)
 {
   char macrosw;
   char *name;
+  char *p;
 
   /* variances in htkdefs are not inversed yet */
   hmm->variance_inversed = FALSE;
 
   /* read the first token */
-  /* read new 1 line */
-  line = 1;
-  if (getl(buf, MAXBUFLEN, fp) == NULL) {
-    rdhmmdef_token = NULL;
-  } else {
-    rdhmmdef_token = mystrtok_quote(buf, HMMDEF_DELM);
+  token_init();
+  if (block_read(fp) == TRUE) {
+    /* check the first character before tokenizing whole block,
+       since binary HMM will be also given here at first */
+    for (p = blk; p < &(blk[blkend]) && delimtbl[(unsigned char)*p]; p++);
+    if (p < &(blk[blkend]) && *p != '~') {
+      token_free();
+      return FALSE;
+    }
+    block_tokenize();
   }
+  read_token(fp);
   
   /* the toplevel loop */
   while (rdhmmdef_token != NULL) {/* break on EOF */
     if (rdhmmdef_token[0] != '~') { /* toplevel commands are always macro */
+      token_free();
       return FALSE;
     }
     macrosw = rdhmmdef_token[1];
@@ -286,6 +631,7 @@ rdhmmdef(FILE *fp, HTK_HMM_INFO *hmm)
     switch(macrosw) {
     case 'o':			/* global option */
       if (set_global_opt(fp,hmm) == FALSE) {
+	token_free();
 	return FALSE;
       }
       break;
@@ -340,6 +686,8 @@ rdhmmdef(FILE *fp, HTK_HMM_INFO *hmm)
     }
   }
 
+  token_free();
+
   /* convert transition prob to log scale */
   conv_log_arc(hmm);
 
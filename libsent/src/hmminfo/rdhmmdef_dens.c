@@ -159,7 +159,7 @@ dens_read( FILE *fp, HTK_HMM_INFO *hmm)
   /* needs comversion if integerized */
   for (i=0;i<new->meanlen;i++) {
     NoTokErr("missing MEAN element");
-    new->mean[i] = (VECT)atof(rdhmmdef_token);
+    new->mean[i] = (VECT)read_token_value();
     read_token(fp);
   }
 
@@ -173,7 +173,7 @@ dens_read( FILE *fp, HTK_HMM_INFO *hmm)
   if (currentis("GCONST")) {
     read_token(fp);
     NoTokErr("GCONST found but no value");
-    new->gconst = (LOGPROB)atof(rdhmmdef_token);
+    new->gconst = (LOGPROB)read_token_value();
     read_token(fp);
   } else {
     /* calc */
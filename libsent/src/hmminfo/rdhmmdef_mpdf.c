@@ -186,7 +186,7 @@ mpdf_read(FILE *fp, HTK_HMM_INFO *hmm, int mix_num)
 	mid = atoi(rdhmmdef_token) - 1;
 	read_token(fp);
 	NoTokErr("missing MIXTURE weight");
-	new->bweight[mid] = (PROB)log(atof(rdhmmdef_token));
+	new->bweight[mid] = (PROB)log(read_token_value());
 	read_token(fp);
 	new->b[mid] = get_dens_data(fp, hmm);
       }
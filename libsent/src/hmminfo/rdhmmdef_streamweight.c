@@ -134,7 +134,7 @@ sw_read(FILE *fp, HTK_HMM_INFO *hmm)
     /* needs conversion if integerized */
     for (i=0;i<new->len;i++) {
       NoTokErr("missing some SWEIGHTS element");
-      new->weight[i] = (VECT)atof(rdhmmdef_token);
+      new->weight[i] = (VECT)read_token_value();
       read_token(fp);
     }
   }
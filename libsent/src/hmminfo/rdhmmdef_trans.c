@@ -147,7 +147,7 @@ trans_read(FILE *fp, HTK_HMM_INFO *hmm)
   for (i=0;i<new->statenum; i++) {
     for (j=0;j<new->statenum; j++) {
       NoTokErr("missing some TRANSP value");
-      prob = (PROB)atof(rdhmmdef_token);
+      prob = (PROB)read_token_value();
       new->a[i][j] = prob;
       read_token(fp);
     }
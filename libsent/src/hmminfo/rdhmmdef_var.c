@@ -138,7 +138,7 @@ var_read(FILE *fp, HTK_HMM_INFO *hmm)
     /* needs comversion if integerized */
     for (i=0;i<new->len;i++) {
       NoTokErr("missing some VARIANCE element");
-      new->vec[i] = (VECT)atof(rdhmmdef_token);
+      new->vec[i] = (VECT)read_token_value();
       read_token(fp);
     }
   }
@@ -35,6 +35,14 @@
 #include <sent/htk_param.h>
 #include <sent/htk_hmm.h>
 
+#if defined(_WIN32) && !defined(__CYGWIN32__)
+/* no mmap(), flat binary HMM will be read into memory */
+#else
+#define HAVE_BINHMM_MMAP	///< Map flat binary HMM into memory by mmap()
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #undef DMES			/* define to enable debug message */
 
 static boolean gzfile;	      ///< TRUE when opened by fopen_readfile
@@ -241,6 +249,10 @@ rd_header(FILE *fp, HTK_HMM_INFO *hmm, Value *para, boolean *mpdf_macro_ret)
     } else {
       hmm->variance_inversed = FALSE;
     }
+  } else if (strmatch(p, BINHMM_HEADER_V3)) {
+    /* flat format should be read by read_binhmm_flat() */
+    jlog("Error: read_binhmm: flat binary HMM cannot be read from compressed file\n");
+    return FALSE;
   } else {
     /* failed to read header */
     return FALSE;
@@ -743,6 +755,78 @@ rd_data(FILE *fp, HTK_HMM_INFO *hmm)
 
 
 
+/** 
+ * Set up information derived from the read %HMM definitions: maximum
+ * state number, total number of PDFs, transition IDs, multipath
+ * requirement and MSD, and inverse variances if not yet.
+ * 
+ * @param hmm [i/o] %HMM definition structure
+ * 
+ * @return TRUE on success, FALSE on error.
+ */
+static boolean
+binhmm_setup(HTK_HMM_INFO *hmm)
+{
+  /* count maximum state num (it is not stored in binhmm... */
+  {
+    HTK_HMM_Data *dtmp;
+    int maxlen = 0;
+    for (dtmp = hmm->start; dtmp; dtmp = dtmp->next) {
+      if (maxlen < dtmp->state_num) maxlen = dtmp->state_num;
+    }
+    hmm->maxstatenum = maxlen;
+  }
+
+  /* compute total number of mixture PDFs */
+  {
+    HTK_HMM_PDF *p;
+    int n = 0;
+    for (p = hmm->pdfstart; p; p = p->next) {
+      n++;
+    }
+    hmm->totalpdfnum = n;
+  }
+
+  /* check state id */
+  {
+    /* check if each state is assigned a valid sid */
+    if (htk_hmm_check_sid(hmm) == FALSE) {
+      jlog("Error: rdhmmdef: error in SID\n");
+      return FALSE;
+    }
+  }
+  /* assign ID number for all HTK_HMM_Trans */
+  {
+    HTK_HMM_Trans *ttmp;
+    int n = 0;
+    for (ttmp = hmm->trstart; ttmp; ttmp = ttmp->next) {
+      ttmp->id = n++;
+    }
+    hmm->totaltransnum = n;
+  }
+
+  /* determine whether this model needs multi-path handling */
+  hmm->need_multipath = htk_hmm_has_several_arc_on_edge(hmm);
+  if (hmm->need_multipath) {
+    jlog("Stat: read_binhmm: this HMM requires multipath handling at decoding\n");
+  } else {
+    jlog("Stat: read_binhmm: this HMM does not need multipath handling\n");
+  }
+  
+  if (! hmm->variance_inversed) {
+    /* inverse all variance values for faster computation */
+    htk_hmm_inverse_variances(hmm);
+    hmm->variance_inversed = TRUE;
+  }
+
+#ifdef ENABLE_MSD
+  /* check if MSD-HMM */
+  htk_hmm_check_msd(hmm);
+#endif
+
+  return TRUE;
+}
+
 /** 
  * Top function to read a binary %HMM file from @a fp.
  * 
@@ -842,62 +926,527 @@ read_binhmm(FILE *fp, HTK_HMM_INFO *hmm, boolean gzfile_p, Value *para)
   if (hmm->is_tied_mixture) free(tm_index);
   free(st_index);
 
-  /* count maximum state num (it is not stored in binhmm... */
-  {
-    HTK_HMM_Data *dtmp;
-    int maxlen = 0;
-    for (dtmp = hmm->start; dtmp; dtmp = dtmp->next) {
-      if (maxlen < dtmp->state_num) maxlen = dtmp->state_num;
+  /* set up derived information */
+  if (binhmm_setup(hmm) == FALSE) return FALSE;
+
+  return (TRUE);
+}
+
+
+/* read flat format (V3) */
+static BINHMM_FLAT_HEADER *fl_h; ///< Header of the flat binary HMM
+static char *fl_base;		///< Top of the file image
+static boolean fl_err;		///< Set to TRUE when a broken reference was found
+
+/** 
+ * Get a name string in the string pool of flat binary %HMM.
+ * 
+ * @param o [in] offset in the string pool, or BINHMM_FLAT_NONE
+ * 
+ * @return pointer to the string, or NULL if no name.
+ */
+static char *
+flat_name(unsigned int o)
+{
+  if (o == BINHMM_FLAT_NONE) return NULL;
+  if (o >= fl_h->num[BINHMM_SEC_STR]) {
+    fl_err = TRUE;
+    return NULL;
+  }
+  return(fl_base + fl_h->offset[BINHMM_SEC_STR] + o);
+}
+
+/** 
+ * Get a vector in the vector pool of flat binary %HMM.
+ * 
+ * @param o [in] offset in the vector pool
+ * @param len [in] length of the vector
+ * 
+ * @return pointer to the vector.
+ */
+static VECT *
+flat_vec(unsigned int o, unsigned int len)
+{
+  if (o > fl_h->num[BINHMM_SEC_VEC] || len > fl_h->num[BINHMM_SEC_VEC] - o) {
+    fl_err = TRUE;
+    return NULL;
+  }
+  return((VECT *)(fl_base + fl_h->offset[BINHMM_SEC_VEC]) + o);
+}
+
+/** 
+ * Get a list of record IDs in the index pool of flat binary %HMM.
+ * 
+ * @param o [in] offset in the index pool
+ * @param len [in] length of the list
+ * 
+ * @return pointer to the list.
+ */
+static unsigned int *
+flat_idx(unsigned int o, unsigned int len)
+{
+  if (o > fl_h->num[BINHMM_SEC_IDX] || len > fl_h->num[BINHMM_SEC_IDX] - o) {
+    fl_err = TRUE;
+    return NULL;
+  }
+  return((unsigned int *)(fl_base + fl_h->offset[BINHMM_SEC_IDX]) + o);
+}
+
+/** 
+ * Check if the file is a flat binary %HMM (V3).
+ * 
+ * @param filename [in] file name
+ * 
+ * @return TRUE if the file begins with the V3 header, FALSE otherwise.
+ */
+boolean
+check_binhmm_flat(char *filename)
+{
+  FILE *fp;
+  char magic[sizeof(BINHMM_HEADER_V3)];
+  boolean ret;
+
+  if ((fp = fopen(filename, "rb")) == NULL) return FALSE;
+  ret = FALSE;
+  if (fread(magic, 1, sizeof(BINHMM_HEADER_V3), fp) == sizeof(BINHMM_HEADER_V3)
+      && memcmp(magic, BINHMM_HEADER_V3, sizeof(BINHMM_HEADER_V3)) == 0) {
+    ret = TRUE;
+  }
+  fclose(fp);
+  return ret;
+}
+
+/** 
+ * Check the header of flat binary %HMM.
+ * 
+ * @param len [in] length of the file image
+ * 
+ * @return TRUE if the header is valid, FALSE otherwise.
+ */
+static boolean
+flat_check_header(size_t len)
+{
+  static size_t unit[BINHMM_SEC_NUM] = {
+    sizeof(char), sizeof(VECT), sizeof(unsigned int),
+    sizeof(BINHMM_FLAT_TRANS), sizeof(BINHMM_FLAT_VAR),
+    sizeof(BINHMM_FLAT_DENS), sizeof(BINHMM_FLAT_SW),
+    sizeof(BINHMM_FLAT_TMIX), sizeof(BINHMM_FLAT_PDF),
+    sizeof(BINHMM_FLAT_STATE), sizeof(BINHMM_FLAT_DATA)
+  };
+  int j;
+
+  if (len < sizeof(BINHMM_FLAT_HEADER)
+      || memcmp(fl_h->magic, BINHMM_HEADER_V3, sizeof(BINHMM_HEADER_V3)) != 0) {
+    jlog("Error: read_binhmm: not a flat binary HMM\n");
+    return FALSE;
+  }
+  if (fl_h->byteorder != BINHMM_FLAT_BYTEORDER) {
+    jlog("Error: read_binhmm: flat binary HMM was written on a machine of different byte order\n");
+    jlog("Error: read_binhmm: please convert it again by mkbinhmm on this machine\n");
+    return FALSE;
+  }
+  if (fl_h->filesize != len) {
+    jlog("Error: read_binhmm: file size mismatch (%u != %u), file may be truncated\n", fl_h->filesize, (unsigned int)len);
+    return FALSE;
+  }
+  for (j = 0; j < BINHMM_SEC_NUM; j++) {
+    if (fl_h->offset[j] % sizeof(unsigned int) != 0
+	|| fl_h->offset[j] > len
+	|| fl_h->num[j] > (len - fl_h->offset[j]) / unit[j]) {
+      jlog("Error: read_binhmm: broken section header in flat binary HMM\n");
+      return FALSE;
     }
-    hmm->maxstatenum = maxlen;
   }
+  if (fl_h->num[BINHMM_SEC_STR] > 0
+      && fl_base[fl_h->offset[BINHMM_SEC_STR] + fl_h->num[BINHMM_SEC_STR] - 1] != '\0') {
+    jlog("Error: read_binhmm: broken string pool in flat binary HMM\n");
+    return FALSE;
+  }
+  return TRUE;
+}
 
-  /* compute total number of mixture PDFs */
-  {
-    HTK_HMM_PDF *p;
-    int n = 0;
-    for (p = hmm->pdfstart; p; p = p->next) {
-      n++;
+/** 
+ * @brief  Build %HMM definition structures on the file image of flat
+ * binary %HMM.
+ *
+ * Each kind of structure is allocated at once as an array, and
+ * their name strings, vectors and matrices point directly into the
+ * file image.  Only the pointer arrays corresponding to the index pool
+ * and the row pointers of transition matrices are newly allocated.
+ * 
+ * @param hmm [out] %HMM definition structure to hold the models.
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+flat_build(HTK_HMM_INFO *hmm)
+{
+  BINHMM_FLAT_TRANS *ft;
+  BINHMM_FLAT_VAR *fv;
+  BINHMM_FLAT_DENS *fd;
+  BINHMM_FLAT_SW *fw;
+  BINHMM_FLAT_TMIX *fm;
+  BINHMM_FLAT_PDF *fpd;
+  BINHMM_FLAT_STATE *fs;
+  BINHMM_FLAT_DATA *fh;
+  HTK_HMM_Trans *tr;
+  HTK_HMM_Var *vr;
+  HTK_HMM_Dens *dn;
+  HTK_HMM_StreamWeight *sw;
+  GCODEBOOK *tm;
+  HTK_HMM_PDF *pdf;
+  HTK_HMM_State *st;
+  HTK_HMM_Data *dt;
+  unsigned int *num;
+  void **ptr;
+  PROB **row;
+  unsigned int *x;
+  VECT *a;
+  unsigned int i, k, n;
+
+  num = fl_h->num;
+  ft = (BINHMM_FLAT_TRANS *)(fl_base + fl_h->offset[BINHMM_SEC_TRANS]);
+  fv = (BINHMM_FLAT_VAR *)(fl_base + fl_h->offset[BINHMM_SEC_VAR]);
+  fd = (BINHMM_FLAT_DENS *)(fl_base + fl_h->offset[BINHMM_SEC_DENS]);
+  fw = (BINHMM_FLAT_SW *)(fl_base + fl_h->offset[BINHMM_SEC_SW]);
+  fm = (BINHMM_FLAT_TMIX *)(fl_base + fl_h->offset[BINHMM_SEC_TMIX]);
+  fpd = (BINHMM_FLAT_PDF *)(fl_base + fl_h->offset[BINHMM_SEC_PDF]);
+  fs = (BINHMM_FLAT_STATE *)(fl_base + fl_h->offset[BINHMM_SEC_STATE]);
+  fh = (BINHMM_FLAT_DATA *)(fl_base + fl_h->offset[BINHMM_SEC_DATA]);
+
+  tr = (HTK_HMM_Trans *)mybmalloc2(sizeof(HTK_HMM_Trans) * num[BINHMM_SEC_TRANS], &(hmm->mroot));
+  vr = (HTK_HMM_Var *)mybmalloc2(sizeof(HTK_HMM_Var) * num[BINHMM_SEC_VAR], &(hmm->mroot));
+  dn = (HTK_HMM_Dens *)mybmalloc2(sizeof(HTK_HMM_Dens) * num[BINHMM_SEC_DENS], &(hmm->mroot));
+  sw = (HTK_HMM_StreamWeight *)mybmalloc2(sizeof(HTK_HMM_StreamWeight) * num[BINHMM_SEC_SW], &(hmm->mroot));
+  tm = (GCODEBOOK *)mybmalloc2(sizeof(GCODEBOOK) * num[BINHMM_SEC_TMIX], &(hmm->mroot));
+  pdf = (HTK_HMM_PDF *)mybmalloc2(sizeof(HTK_HMM_PDF) * num[BINHMM_SEC_PDF], &(hmm->mroot));
+  st = (HTK_HMM_State *)mybmalloc2(sizeof(HTK_HMM_State) * num[BINHMM_SEC_STATE], &(hmm->mroot));
+  dt = (HTK_HMM_Data *)mybmalloc2(sizeof(HTK_HMM_Data) * num[BINHMM_SEC_DATA], &(hmm->mroot));
+  /* pointer array corresponding to the index pool */
+  ptr = (void **)mybmalloc2(sizeof(void *) * num[BINHMM_SEC_IDX], &(hmm->mroot));
+  fl_err = FALSE;
+
+  /* transition */
+  n = 0;
+  for (i = 0; i < num[BINHMM_SEC_TRANS]; i++) {
+    if (ft[i].statenum > 0 && ft[i].statenum > num[BINHMM_SEC_VEC] / ft[i].statenum) {
+      jlog("Error: read_binhmm: broken transition data in flat binary HMM\n");
+      return FALSE;
     }
-    hmm->totalpdfnum = n;
+    n += ft[i].statenum;
+  }
+  row = (PROB **)mybmalloc2(sizeof(PROB *) * n, &(hmm->mroot));
+  hmm->trstart = NULL;
+  hmm->tr_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_TRANS]; i++) {
+    tr[i].name = flat_name(ft[i].name);
+    tr[i].statenum = ft[i].statenum;
+    a = flat_vec(ft[i].a, ft[i].statenum * ft[i].statenum);
+    if (fl_err) break;
+    tr[i].a = row;
+    for (k = 0; k < ft[i].statenum; k++) *(row++) = &(a[k * ft[i].statenum]);
+    trans_add(hmm, &(tr[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken transition data in flat binary HMM\n");
+    return FALSE;
   }
 
-  /* check state id */
+  /* variance */
+  hmm->vrstart = NULL;
+  hmm->vr_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_VAR]; i++) {
+    vr[i].name = flat_name(fv[i].name);
+    vr[i].len = fv[i].len;
+    vr[i].vec = flat_vec(fv[i].vec, fv[i].len);
+    if (fl_err) break;
+    var_add(hmm, &(vr[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken variance data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* density */
+  hmm->totalmixnum = num[BINHMM_SEC_DENS];
+  hmm->dnstart = NULL;
+  hmm->dn_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_DENS]; i++) {
+    dn[i].name = flat_name(fd[i].name);
+    dn[i].meanlen = fd[i].meanlen;
+    dn[i].mean = flat_vec(fd[i].mean, fd[i].meanlen);
+    if (fd[i].var >= num[BINHMM_SEC_VAR]) fl_err = TRUE;
+    if (fl_err) break;
+    dn[i].var = &(vr[fd[i].var]);
+    dn[i].gconst = fd[i].gconst;
+    dens_add(hmm, &(dn[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken density data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* stream weight */
+  hmm->swstart = NULL;
+  hmm->sw_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_SW]; i++) {
+    sw[i].name = flat_name(fw[i].name);
+    sw[i].len = fw[i].len;
+    sw[i].weight = flat_vec(fw[i].weight, fw[i].len);
+    if (fl_err) break;
+    sw_add(hmm, &(sw[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken stream weight data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* codebook */
+  hmm->codebooknum = num[BINHMM_SEC_TMIX];
+  hmm->maxcodebooksize = 0;
+  hmm->codebook_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_TMIX]; i++) {
+    tm[i].name = flat_name(fm[i].name);
+    tm[i].num = fm[i].num;
+    x = flat_idx(fm[i].d, fm[i].num);
+    if (fl_err) break;
+    if (hmm->maxcodebooksize < tm[i].num) hmm->maxcodebooksize = tm[i].num;
+    tm[i].d = (HTK_HMM_Dens **)&(ptr[fm[i].d]);
+    for (k = 0; k < fm[i].num; k++) {
+      tm[i].d[k] = (x[k] >= num[BINHMM_SEC_DENS]) ? NULL : &(dn[x[k]]);
+    }
+    tm[i].id = i;
+    codebook_add(hmm, &(tm[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken tied-mixture codebook data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* mixture pdf */
+  hmm->pdfstart = NULL;
+  hmm->pdf_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_PDF]; i++) {
+    pdf[i].name = flat_name(fpd[i].name);
+    pdf[i].stream_id = fpd[i].stream_id;
+    if (fpd[i].tmix != BINHMM_FLAT_NONE) {
+      if (fpd[i].tmix >= num[BINHMM_SEC_TMIX]) {
+	fl_err = TRUE;
+	break;
+      }
+      pdf[i].b = (HTK_HMM_Dens **)&(tm[fpd[i].tmix]);
+      pdf[i].mix_num = tm[fpd[i].tmix].num;
+      pdf[i].tmix = TRUE;
+    } else {
+      x = flat_idx(fpd[i].b, fpd[i].mix_num);
+      if (fl_err) break;
+      pdf[i].b = (HTK_HMM_Dens **)&(ptr[fpd[i].b]);
+      pdf[i].mix_num = fpd[i].mix_num;
+      for (k = 0; k < fpd[i].mix_num; k++) {
+	pdf[i].b[k] = (x[k] >= num[BINHMM_SEC_DENS]) ? NULL : &(dn[x[k]]);
+      }
+      pdf[i].tmix = FALSE;
+    }
+    pdf[i].bweight = flat_vec(fpd[i].bweight, pdf[i].mix_num);
+    if (fl_err) break;
+    mpdf_add(hmm, &(pdf[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken mixture PDF data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* state */
+  hmm->totalstatenum = num[BINHMM_SEC_STATE];
+  hmm->ststart = NULL;
+  hmm->st_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_STATE]; i++) {
+    st[i].name = flat_name(fs[i].name);
+    st[i].nstream = hmm->opt.stream_info.num;
+    x = flat_idx(fs[i].pdf, st[i].nstream);
+    if (fl_err) break;
+    st[i].pdf = (HTK_HMM_PDF **)&(ptr[fs[i].pdf]);
+    for (k = 0; k < st[i].nstream; k++) {
+      st[i].pdf[k] = (x[k] >= num[BINHMM_SEC_PDF]) ? NULL : &(pdf[x[k]]);
+    }
+    st[i].w = (fs[i].w >= num[BINHMM_SEC_SW]) ? NULL : &(sw[fs[i].w]);
+    st[i].id = fs[i].id;
+    state_add(hmm, &(st[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken state data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  /* model */
+  hmm->totalhmmnum = num[BINHMM_SEC_DATA];
+  hmm->start = NULL;
+  hmm->physical_root = NULL;
+  for (i = 0; i < num[BINHMM_SEC_DATA]; i++) {
+    dt[i].name = flat_name(fh[i].name);
+    dt[i].state_num = fh[i].state_num;
+    x = flat_idx(fh[i].s, fh[i].state_num);
+    if (fh[i].tr >= num[BINHMM_SEC_TRANS]) fl_err = TRUE;
+    if (fl_err) break;
+    dt[i].s = (HTK_HMM_State **)&(ptr[fh[i].s]);
+    for (k = 0; k < fh[i].state_num; k++) {
+      dt[i].s[k] = (x[k] >= num[BINHMM_SEC_STATE]) ? NULL : &(st[x[k]]);
+    }
+    dt[i].tr = &(tr[fh[i].tr]);
+    htk_hmmdata_add(hmm, &(dt[i]));
+  }
+  if (fl_err) {
+    jlog("Error: read_binhmm: broken HMM data in flat binary HMM\n");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/** 
+ * @brief  Top function to read a flat binary %HMM file (V3).
+ *
+ * The file is mapped into memory by mmap() as a private mapping, so
+ * that the pages are shared among processes using the same model.
+ * On systems without mmap(), the whole file is read into memory.
+ * The mapped image is kept in @a hmm and released by
+ * free_binhmm_flat().
+ * 
+ * @param filename [in] file name, should not be compressed
+ * @param hmm [out] %HMM definition structure to hold the read models.
+ * @param para [out] store acoustic parameters if embedded
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+read_binhmm_flat(char *filename, HTK_HMM_INFO *hmm, Value *para)
+{
+  size_t len;
+  int i;
+
+#ifdef HAVE_BINHMM_MMAP
   {
-    /* check if each state is assigned a valid sid */
-    if (htk_hmm_check_sid(hmm) == FALSE) {
-      jlog("Error: rdhmmdef: error in SID\n");
+    int fd;
+    struct stat st;
+    void *p;
+
+    if ((fd = open(filename, O_RDONLY)) < 0) {
+      jlog("Error: read_binhmm: failed to open %s\n", filename);
+      return FALSE;
+    }
+    if (fstat(fd, &st) < 0) {
+      jlog("Error: read_binhmm: failed to stat %s\n", filename);
+      close(fd);
       return FALSE;
     }
+    len = st.st_size;
+    /* data will not be modified, so the pages are kept shared */
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      jlog("Error: read_binhmm: failed to map %s into memory\n", filename);
+      return FALSE;
+    }
+    hmm->flat_base = p;
+    hmm->flat_len = len;
+    hmm->flat_mapped = TRUE;
   }
-  /* assign ID number for all HTK_HMM_Trans */
+#else
   {
-    HTK_HMM_Trans *ttmp;
-    int n = 0;
-    for (ttmp = hmm->trstart; ttmp; ttmp = ttmp->next) {
-      ttmp->id = n++;
+    FILE *fp;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+      jlog("Error: read_binhmm: failed to open %s\n", filename);
+      return FALSE;
     }
-    hmm->totaltransnum = n;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    hmm->flat_base = mymalloc(len);
+    hmm->flat_len = len;
+    hmm->flat_mapped = FALSE;
+    if (fread(hmm->flat_base, 1, len, fp) < len) {
+      jlog("Error: read_binhmm: failed to read %s\n", filename);
+      fclose(fp);
+      return FALSE;
+    }
+    fclose(fp);
   }
+#endif
 
-  /* determine whether this model needs multi-path handling */
-  hmm->need_multipath = htk_hmm_has_several_arc_on_edge(hmm);
-  if (hmm->need_multipath) {
-    jlog("Stat: read_binhmm: this HMM requires multipath handling at decoding\n");
-  } else {
-    jlog("Stat: read_binhmm: this HMM does not need multipath handling\n");
+  fl_base = (char *)hmm->flat_base;
+  fl_h = (BINHMM_FLAT_HEADER *)fl_base;
+  if (flat_check_header(len) == FALSE) return FALSE;
+
+  jlog("Stat: read_binhmm: flat binary format HMM definition\n");
+
+  if (fl_h->flags & BINHMM_FLAT_EMBEDPARA) {
+    if (fl_h->para_version > VALUE_VERSION) {
+      jlog("Error: read_binhmm: unknown embedded parameter format version: %d\n", fl_h->para_version);
+      return FALSE;
+    }
+    para->smp_period = fl_h->smp_period;
+    para->smp_freq = fl_h->smp_freq;
+    para->framesize = fl_h->framesize;
+    para->frameshift = fl_h->frameshift;
+    para->preEmph = fl_h->preEmph;
+    para->lifter = fl_h->lifter;
+    para->fbank_num = fl_h->fbank_num;
+    para->delWin = fl_h->delWin;
+    para->accWin = fl_h->accWin;
+    para->silFloor = fl_h->silFloor;
+    para->escale = fl_h->escale;
+    para->hipass = fl_h->hipass;
+    para->lopass = fl_h->lopass;
+    para->enormal = fl_h->enormal;
+    para->raw_e = fl_h->raw_e;
+    para->zmeanframe = fl_h->zmeanframe;
+    para->usepower = fl_h->usepower;
+    para->loaded = 1;
+    jlog("Stat: read_binhmm: has acoutic analysis configurations in its header\n");
   }
-  
-  if (! hmm->variance_inversed) {
-    /* inverse all variance values for faster computation */
-    htk_hmm_inverse_variances(hmm);
+  if (fl_h->flags & BINHMM_FLAT_VARINV) {
     hmm->variance_inversed = TRUE;
+  } else {
+    hmm->variance_inversed = FALSE;
   }
 
-#ifdef ENABLE_MSD
-  /* check if MSD-HMM */
-  htk_hmm_check_msd(hmm);
-#endif
+  hmm->opt.stream_info.num = fl_h->stream_num;
+  for (i = 0; i < MAXSTREAMNUM; i++) hmm->opt.stream_info.vsize[i] = fl_h->vsize[i];
+  hmm->opt.vec_size = fl_h->vec_size;
+  hmm->opt.cov_type = fl_h->cov_type;
+  hmm->opt.dur_type = fl_h->dur_type;
+  hmm->opt.param_type = fl_h->param_type;
+  hmm->is_tied_mixture = fl_h->is_tied_mixture;
+  hmm->maxmixturenum = fl_h->maxmixturenum;
 
-  return (TRUE);
+  if (flat_build(hmm) == FALSE) return FALSE;
+
+  /* set up derived information */
+  if (binhmm_setup(hmm) == FALSE) return FALSE;
+
+  return TRUE;
+}
+
+/** 
+ * Release the file image of flat binary %HMM.  All the %HMM data
+ * read by read_binhmm_flat() become invalid after this call.
+ * 
+ * @param hmm [i/o] %HMM definition structure
+ */
+void
+free_binhmm_flat(HTK_HMM_INFO *hmm)
+{
+  if (hmm->flat_base == NULL) return;
+#ifdef HAVE_BINHMM_MMAP
+  if (hmm->flat_mapped) {
+    munmap(hmm->flat_base, hmm->flat_len);
+  } else {
+    free(hmm->flat_base);
+  }
+#else
+  free(hmm->flat_base);
+#endif
+  hmm->flat_base = NULL;
+  hmm->flat_len = 0;
 }
@@ -222,6 +222,26 @@ qsort_tr_index(HTK_HMM_Trans **t1, HTK_HMM_Trans **t2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all transition matrixes and sort them by the
+ * address for indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_tr_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_Trans *t;
+  unsigned int idx;
+
+  tr_num = 0;
+  for(t = hmm->trstart; t; t = t->next) tr_num++;
+  tr_index = (HTK_HMM_Trans **)mymalloc(sizeof(HTK_HMM_Trans *) * tr_num);
+  idx = 0;
+  for(t = hmm->trstart; t; t = t->next) tr_index[idx++] = t;
+  qsort(tr_index, tr_num, sizeof(HTK_HMM_Trans *), (int (*)(const void *, const void *))qsort_tr_index);
+}
+
 /** 
  * @brief  Write all transition matrix data.
  *
@@ -240,12 +260,7 @@ wt_trans(FILE *fp, HTK_HMM_INFO *hmm)
   unsigned int idx;
   int i;
 
-  tr_num = 0;
-  for(t = hmm->trstart; t; t = t->next) tr_num++;
-  tr_index = (HTK_HMM_Trans **)mymalloc(sizeof(HTK_HMM_Trans *) * tr_num);
-  idx = 0;
-  for(t = hmm->trstart; t; t = t->next) tr_index[idx++] = t;
-  qsort(tr_index, tr_num, sizeof(HTK_HMM_Trans *), (int (*)(const void *, const void *))qsort_tr_index);
+  make_tr_index(hmm);
   
   wrt(fp, &tr_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < tr_num; idx++) {
@@ -309,6 +324,26 @@ qsort_vr_index(HTK_HMM_Var **v1, HTK_HMM_Var **v2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all variance vectors and sort them by the
+ * address for indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_vr_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_Var *v;
+  unsigned int idx;
+
+  vr_num = 0;
+  for(v = hmm->vrstart; v; v = v->next) vr_num++;
+  vr_index = (HTK_HMM_Var **)mymalloc(sizeof(HTK_HMM_Var *) * vr_num);
+  idx = 0;
+  for(v = hmm->vrstart; v; v = v->next) vr_index[idx++] = v;
+  qsort(vr_index, vr_num, sizeof(HTK_HMM_Var *), (int (*)(const void *, const void *))qsort_vr_index);  
+}
+
 /** 
  * @brief  Write all variance data.
  *
@@ -326,12 +361,7 @@ wt_var(FILE *fp, HTK_HMM_INFO *hmm)
   HTK_HMM_Var *v;
   unsigned int idx;
 
-  vr_num = 0;
-  for(v = hmm->vrstart; v; v = v->next) vr_num++;
-  vr_index = (HTK_HMM_Var **)mymalloc(sizeof(HTK_HMM_Var *) * vr_num);
-  idx = 0;
-  for(v = hmm->vrstart; v; v = v->next) vr_index[idx++] = v;
-  qsort(vr_index, vr_num, sizeof(HTK_HMM_Var *), (int (*)(const void *, const void *))qsort_vr_index);  
+  make_vr_index(hmm);
 
   wrt(fp, &vr_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < vr_num; idx++) {
@@ -392,6 +422,25 @@ qsort_dens_index(HTK_HMM_Dens **d1, HTK_HMM_Dens **d2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all mixture densities and sort them by the
+ * address for indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_dens_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_Dens *d;
+  unsigned int idx;
+
+  dens_num = hmm->totalmixnum;
+  dens_index = (HTK_HMM_Dens **)mymalloc(sizeof(HTK_HMM_Dens *) * dens_num);
+  idx = 0;
+  for(d = hmm->dnstart; d; d = d->next) dens_index[idx++] = d;
+  qsort(dens_index, dens_num, sizeof(HTK_HMM_Dens *), (int (*)(const void *, const void *))qsort_dens_index);
+}
+
 /** 
  * @brief  Write all mixture density data.
  *
@@ -412,11 +461,7 @@ wt_dens(FILE *fp, HTK_HMM_INFO *hmm)
   unsigned int idx;
   unsigned int vid;
 
-  dens_num = hmm->totalmixnum;
-  dens_index = (HTK_HMM_Dens **)mymalloc(sizeof(HTK_HMM_Dens *) * dens_num);
-  idx = 0;
-  for(d = hmm->dnstart; d; d = d->next) dens_index[idx++] = d;
-  qsort(dens_index, dens_num, sizeof(HTK_HMM_Dens *), (int (*)(const void *, const void *))qsort_dens_index);
+  make_dens_index(hmm);
   
   wrt(fp, &dens_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < dens_num; idx++) {
@@ -484,6 +529,26 @@ qsort_streamweight_index(HTK_HMM_StreamWeight **d1, HTK_HMM_StreamWeight **d2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all stream weights and sort them by the
+ * address for indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_streamweight_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_StreamWeight *sw;
+  unsigned int idx;
+
+  streamweight_num = 0;
+  for(sw=hmm->swstart;sw;sw=sw->next) streamweight_num++;
+  streamweight_index = (HTK_HMM_StreamWeight **)mymalloc(sizeof(HTK_HMM_StreamWeight *) * streamweight_num);
+  idx = 0;
+  for(sw = hmm->swstart; sw; sw = sw->next) streamweight_index[idx++] = sw;
+  qsort(streamweight_index, streamweight_num, sizeof(HTK_HMM_StreamWeight *), (int (*)(const void *, const void *))qsort_streamweight_index);
+}
+
 /** 
  * @brief  Write all stream weight data.
  *
@@ -503,12 +568,7 @@ wt_streamweight(FILE *fp, HTK_HMM_INFO *hmm)
   HTK_HMM_StreamWeight *sw;
   unsigned int idx;
 
-  streamweight_num = 0;
-  for(sw=hmm->swstart;sw;sw=sw->next) streamweight_num++;
-  streamweight_index = (HTK_HMM_StreamWeight **)mymalloc(sizeof(HTK_HMM_StreamWeight *) * streamweight_num);
-  idx = 0;
-  for(sw = hmm->swstart; sw; sw = sw->next) streamweight_index[idx++] = sw;
-  qsort(streamweight_index, streamweight_num, sizeof(HTK_HMM_StreamWeight *), (int (*)(const void *, const void *))qsort_streamweight_index);
+  make_streamweight_index(hmm);
   
   wrt(fp, &streamweight_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < streamweight_num; idx++) {
@@ -583,6 +643,22 @@ qsort_tm_index(GCODEBOOK **tm1, GCODEBOOK **tm2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all codebooks and sort them by the address for
+ * indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_tm_index(HTK_HMM_INFO *hmm)
+{
+  tm_num = hmm->codebooknum;
+  tm_index = (GCODEBOOK **)mymalloc(sizeof(GCODEBOOK *) * tm_num);
+  tm_idx = 0;
+  aptree_traverse_and_do(hmm->codebook_root, tmix_list_callback);
+  qsort(tm_index, tm_num, sizeof(GCODEBOOK *), (int (*)(const void *, const void *))qsort_tm_index);  
+}
+
 /** 
  * @brief  Write all codebook data.
  *
@@ -604,11 +680,7 @@ wt_tmix(FILE *fp, HTK_HMM_INFO *hmm)
   unsigned int did;
   int i;
 
-  tm_num = hmm->codebooknum;
-  tm_index = (GCODEBOOK **)mymalloc(sizeof(GCODEBOOK *) * tm_num);
-  tm_idx = 0;
-  aptree_traverse_and_do(hmm->codebook_root, tmix_list_callback);
-  qsort(tm_index, tm_num, sizeof(GCODEBOOK *), (int (*)(const void *, const void *))qsort_tm_index);  
+  make_tm_index(hmm);
 
   wrt(fp, &tm_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < tm_num; idx++) {
@@ -681,6 +753,26 @@ qsort_mpdf_index(HTK_HMM_PDF **d1, HTK_HMM_PDF **d2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all mixture pdfs and sort them by the address for
+ * indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_mpdf_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_PDF *m;
+  unsigned int idx;
+
+  mpdf_num = 0;
+  for(m=hmm->pdfstart;m;m=m->next) mpdf_num++;
+  mpdf_index = (HTK_HMM_PDF **)mymalloc(sizeof(HTK_HMM_PDF *) * mpdf_num);
+  idx = 0;
+  for(m=hmm->pdfstart;m;m=m->next) mpdf_index[idx++] = m;
+  qsort(mpdf_index, mpdf_num, sizeof(HTK_HMM_PDF *), (int (*)(const void *, const void *))qsort_mpdf_index);
+}
+
 /**
  * Write a mixture PDF.
  * 
@@ -761,12 +853,7 @@ wt_mpdf(FILE *fp, HTK_HMM_INFO *hmm)
   HTK_HMM_PDF *m;
   unsigned int idx;
 
-  mpdf_num = 0;
-  for(m=hmm->pdfstart;m;m=m->next) mpdf_num++;
-  mpdf_index = (HTK_HMM_PDF **)mymalloc(sizeof(HTK_HMM_PDF *) * mpdf_num);
-  idx = 0;
-  for(m=hmm->pdfstart;m;m=m->next) mpdf_index[idx++] = m;
-  qsort(mpdf_index, mpdf_num, sizeof(HTK_HMM_PDF *), (int (*)(const void *, const void *))qsort_mpdf_index);
+  make_mpdf_index(hmm);
   
   wrt(fp, &mpdf_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < mpdf_num; idx++) {
@@ -829,6 +916,25 @@ qsort_st_index(HTK_HMM_State **s1, HTK_HMM_State **s2)
   else return 0;
 }
 
+/** 
+ * Gather pointers of all states and sort them by the state ID for
+ * indexing.
+ * 
+ * @param hmm [in] writing %HMM definition data 
+ */
+static void
+make_st_index(HTK_HMM_INFO *hmm)
+{
+  HTK_HMM_State *s;
+  unsigned int idx;
+
+  st_num = hmm->totalstatenum;
+  st_index = (HTK_HMM_State **)mymalloc(sizeof(HTK_HMM_State *) * st_num);
+  idx = 0;
+  for(s = hmm->ststart; s; s = s->next) st_index[idx++] = s;
+  qsort(st_index, st_num, sizeof(HTK_HMM_State *), (int (*)(const void *, const void *))qsort_st_index);
+}
+
 /** 
  * @brief  Write all state data.
  *
@@ -852,11 +958,7 @@ wt_state(FILE *fp, HTK_HMM_INFO *hmm, boolean mpdf_macro)
   unsigned int swid;
   int m;
 
-  st_num = hmm->totalstatenum;
-  st_index = (HTK_HMM_State **)mymalloc(sizeof(HTK_HMM_State *) * st_num);
-  idx = 0;
-  for(s = hmm->ststart; s; s = s->next) st_index[idx++] = s;
-  qsort(st_index, st_num, sizeof(HTK_HMM_State *), (int (*)(const void *, const void *))qsort_st_index);
+  make_st_index(hmm);
   
   wrt(fp, &st_num, sizeof(unsigned int), 1);
   for (idx = 0; idx < st_num; idx++) {
@@ -1095,3 +1197,423 @@ write_binhmm(FILE *fp, HTK_HMM_INFO *hmm, Value *para)
 
   return (TRUE);
 }
+
+
+/* write flat format (V3) */
+static char *fl_str;		///< String pool
+static unsigned int fl_strlen;	///< Used length of above
+static unsigned int fl_stralloc; ///< Allocated length of above
+static VECT *fl_vec;		///< Vector pool
+static unsigned int fl_veclen;	///< Used length of above
+static unsigned int fl_vecalloc; ///< Allocated length of above
+static unsigned int *fl_idx;	///< Index pool
+static unsigned int fl_idxlen;	///< Used length of above
+static unsigned int fl_idxalloc; ///< Allocated length of above
+
+/** 
+ * Store a string to the string pool of flat format.
+ * 
+ * @param str [in] string, or NULL
+ * 
+ * @return offset of the stored string, or BINHMM_FLAT_NONE if @a str is NULL.
+ */
+static unsigned int
+flat_str(char *str)
+{
+  unsigned int len, ret;
+
+  if (str == NULL) return BINHMM_FLAT_NONE;
+  len = strlen(str) + 1;
+  if (fl_strlen + len > fl_stralloc) {
+    while (fl_strlen + len > fl_stralloc) fl_stralloc *= 2;
+    fl_str = (char *)myrealloc(fl_str, fl_stralloc);
+  }
+  memcpy(&(fl_str[fl_strlen]), str, len);
+  ret = fl_strlen;
+  fl_strlen += len;
+  return ret;
+}
+
+/** 
+ * Store a vector to the vector pool of flat format.  Vectors stored
+ * by successive calls are placed contiguously.
+ * 
+ * @param v [in] vector
+ * @param len [in] length of @a v
+ * 
+ * @return offset of the stored vector.
+ */
+static unsigned int
+flat_vec(VECT *v, int len)
+{
+  unsigned int ret;
+
+  if (fl_veclen + len > fl_vecalloc) {
+    while (fl_veclen + len > fl_vecalloc) fl_vecalloc *= 2;
+    fl_vec = (VECT *)myrealloc(fl_vec, sizeof(VECT) * fl_vecalloc);
+  }
+  memcpy(&(fl_vec[fl_veclen]), v, sizeof(VECT) * len);
+  ret = fl_veclen;
+  fl_veclen += len;
+  return ret;
+}
+
+/** 
+ * Reserve area in the index pool of flat format.
+ * 
+ * @param len [in] number of indices to be stored
+ * 
+ * @return offset of the reserved area.
+ */
+static unsigned int
+flat_idx(int len)
+{
+  unsigned int ret;
+
+  if (fl_idxlen + len > fl_idxalloc) {
+    while (fl_idxlen + len > fl_idxalloc) fl_idxalloc *= 2;
+    fl_idx = (unsigned int *)myrealloc(fl_idx, sizeof(unsigned int) * fl_idxalloc);
+  }
+  ret = fl_idxlen;
+  fl_idxlen += len;
+  return ret;
+}
+
+/** 
+ * Get the scholar ID of a density for flat format.
+ * 
+ * @param d [in] pointer to a mixture density, or NULL
+ * @param ret [out] the corresponding scholar ID
+ * 
+ * @return TRUE on success, FALSE if not found.
+ */
+static boolean
+flat_did(HTK_HMM_Dens *d, unsigned int *ret)
+{
+  if (d == NULL) {
+    *ret = BINHMM_FLAT_NONE;
+    return TRUE;
+  }
+  *ret = search_did(d);
+  if (d != dens_index[*ret]) {
+    jlog("Error: write_binhmm: index not match!!!\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/** 
+ * @brief  Top function to write %HMM definition data to a flat binary file.
+ *
+ * All data are first converted to arrays of records linked by index
+ * and the pools of strings, vectors and indices, and then written at
+ * once with the header.  The sections are aligned to BINHMM_FLAT_ALIGN
+ * bytes.  Values are written in the byte order of this machine, so
+ * that the file can be mapped into memory and used as is by
+ * read_binhmm_flat().
+ * 
+ * @param fp [in] file pointer, should not be compressed
+ * @param hmm [in] %HMM definition structure to be written
+ * @param para [in] acoustic analysis parameter, or NULL if not available
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+write_binhmm_flat(FILE *fp, HTK_HMM_INFO *hmm, Value *para)
+{
+  BINHMM_FLAT_HEADER h;
+  BINHMM_FLAT_TRANS *ft;
+  BINHMM_FLAT_VAR *fv;
+  BINHMM_FLAT_DENS *fd;
+  BINHMM_FLAT_SW *fw;
+  BINHMM_FLAT_TMIX *fm;
+  BINHMM_FLAT_PDF *fpd;
+  BINHMM_FLAT_STATE *fs;
+  BINHMM_FLAT_DATA *fh;
+  HTK_HMM_Data *dt;
+  void *sec[BINHMM_SEC_NUM];
+  size_t size[BINHMM_SEC_NUM];
+  size_t pos;
+  static char zero[BINHMM_FLAT_ALIGN];
+  unsigned int idx, n, x;
+  int i, j;
+  boolean ok_p;
+
+  ok_p = FALSE;
+
+  /* build pointer->index mapping */
+  make_tr_index(hmm);
+  make_vr_index(hmm);
+  make_dens_index(hmm);
+  if (hmm->opt.stream_info.num > 1) {
+    make_streamweight_index(hmm);
+  } else {
+    streamweight_num = 0;
+  }
+  if (hmm->is_tied_mixture) {
+    make_tm_index(hmm);
+  } else {
+    tm_num = 0;
+  }
+  make_mpdf_index(hmm);
+  make_st_index(hmm);
+
+  fl_stralloc = 65536;
+  fl_str = (char *)mymalloc(fl_stralloc);
+  fl_strlen = 0;
+  fl_vecalloc = 65536;
+  fl_vec = (VECT *)mymalloc(sizeof(VECT) * fl_vecalloc);
+  fl_veclen = 0;
+  fl_idxalloc = 65536;
+  fl_idx = (unsigned int *)mymalloc(sizeof(unsigned int) * fl_idxalloc);
+  fl_idxlen = 0;
+  ft = (BINHMM_FLAT_TRANS *)mymalloc(sizeof(BINHMM_FLAT_TRANS) * (tr_num + 1));
+  fv = (BINHMM_FLAT_VAR *)mymalloc(sizeof(BINHMM_FLAT_VAR) * (vr_num + 1));
+  fd = (BINHMM_FLAT_DENS *)mymalloc(sizeof(BINHMM_FLAT_DENS) * (dens_num + 1));
+  fw = (BINHMM_FLAT_SW *)mymalloc(sizeof(BINHMM_FLAT_SW) * (streamweight_num + 1));
+  fm = (BINHMM_FLAT_TMIX *)mymalloc(sizeof(BINHMM_FLAT_TMIX) * (tm_num + 1));
+  fpd = (BINHMM_FLAT_PDF *)mymalloc(sizeof(BINHMM_FLAT_PDF) * (mpdf_num + 1));
+  fs = (BINHMM_FLAT_STATE *)mymalloc(sizeof(BINHMM_FLAT_STATE) * (st_num + 1));
+  fh = (BINHMM_FLAT_DATA *)mymalloc(sizeof(BINHMM_FLAT_DATA) * (hmm->totalhmmnum + 1));
+
+  /* transition */
+  for (idx = 0; idx < tr_num; idx++) {
+    ft[idx].name = flat_str(tr_index[idx]->name);
+    ft[idx].statenum = tr_index[idx]->statenum;
+    ft[idx].a = fl_veclen;
+    for (i = 0; i < tr_index[idx]->statenum; i++) {
+      flat_vec(tr_index[idx]->a[i], tr_index[idx]->statenum);
+    }
+  }
+  /* variance */
+  for (idx = 0; idx < vr_num; idx++) {
+    fv[idx].name = flat_str(vr_index[idx]->name);
+    fv[idx].len = vr_index[idx]->len;
+    fv[idx].vec = flat_vec(vr_index[idx]->vec, vr_index[idx]->len);
+  }
+  /* density */
+  for (idx = 0; idx < dens_num; idx++) {
+    fd[idx].name = flat_str(dens_index[idx]->name);
+    fd[idx].meanlen = dens_index[idx]->meanlen;
+    fd[idx].mean = flat_vec(dens_index[idx]->mean, dens_index[idx]->meanlen);
+    fd[idx].var = search_vid(dens_index[idx]->var);
+    if (dens_index[idx]->var != vr_index[fd[idx].var]) {
+      jlog("Error: write_binhmm: index not match!!!\n");
+      goto end;
+    }
+    fd[idx].gconst = dens_index[idx]->gconst;
+  }
+  /* stream weight */
+  for (idx = 0; idx < streamweight_num; idx++) {
+    fw[idx].name = flat_str(streamweight_index[idx]->name);
+    fw[idx].len = streamweight_index[idx]->len;
+    fw[idx].weight = flat_vec(streamweight_index[idx]->weight, streamweight_index[idx]->len);
+  }
+  /* codebook */
+  for (idx = 0; idx < tm_num; idx++) {
+    fm[idx].name = flat_str(tm_index[idx]->name);
+    fm[idx].num = tm_index[idx]->num;
+    fm[idx].d = flat_idx(tm_index[idx]->num);
+    for (i = 0; i < tm_index[idx]->num; i++) {
+      if (flat_did(tm_index[idx]->d[i], &x) == FALSE) goto end;
+      fl_idx[fm[idx].d + i] = x;
+    }
+  }
+  /* mixture pdf, in-line pdfs are also stored here */
+  for (idx = 0; idx < mpdf_num; idx++) {
+    fpd[idx].name = flat_str(mpdf_index[idx]->name);
+    fpd[idx].stream_id = mpdf_index[idx]->stream_id;
+    fpd[idx].mix_num = mpdf_index[idx]->mix_num;
+    if (mpdf_index[idx]->tmix) {
+      fpd[idx].tmix = search_tmid((GCODEBOOK *)(mpdf_index[idx]->b));
+      if ((GCODEBOOK *)(mpdf_index[idx]->b) != tm_index[fpd[idx].tmix]) {
+	jlog("Error: write_binhmm: index not match!!!\n");
+	goto end;
+      }
+      fpd[idx].b = BINHMM_FLAT_NONE;
+    } else {
+      fpd[idx].tmix = BINHMM_FLAT_NONE;
+      fpd[idx].b = flat_idx(mpdf_index[idx]->mix_num);
+      for (i = 0; i < mpdf_index[idx]->mix_num; i++) {
+	if (flat_did(mpdf_index[idx]->b[i], &x) == FALSE) goto end;
+	fl_idx[fpd[idx].b + i] = x;
+      }
+    }
+    fpd[idx].bweight = flat_vec(mpdf_index[idx]->bweight, mpdf_index[idx]->mix_num);
+  }
+  /* state */
+  for (idx = 0; idx < st_num; idx++) {
+    fs[idx].name = flat_str(st_index[idx]->name);
+    fs[idx].pdf = flat_idx(st_index[idx]->nstream);
+    for (i = 0; i < st_index[idx]->nstream; i++) {
+      if (st_index[idx]->pdf[i] == NULL) {
+	x = BINHMM_FLAT_NONE;
+      } else {
+	x = search_mpdfid(st_index[idx]->pdf[i]);
+	if (st_index[idx]->pdf[i] != mpdf_index[x]) {
+	  jlog("Error: write_binhmm: index not match!!!\n");
+	  goto end;
+	}
+      }
+      fl_idx[fs[idx].pdf + i] = x;
+    }
+    if (st_index[idx]->w == NULL) {
+      fs[idx].w = BINHMM_FLAT_NONE;
+    } else {
+      fs[idx].w = search_swid(st_index[idx]->w);
+      if (st_index[idx]->w != streamweight_index[fs[idx].w]) {
+	jlog("Error: write_binhmm: index not match!!!\n");
+	goto end;
+      }
+    }
+    fs[idx].id = st_index[idx]->id;
+  }
+  /* model */
+  n = 0;
+  for (dt = hmm->start; dt; dt = dt->next) {
+    fh[n].name = flat_str(dt->name);
+    fh[n].state_num = dt->state_num;
+    fh[n].s = flat_idx(dt->state_num);
+    for (i = 0; i < dt->state_num; i++) {
+      if (dt->s[i] == NULL) {
+	x = BINHMM_FLAT_NONE;
+      } else {
+	x = search_stid(dt->s[i]);
+	if (dt->s[i] != st_index[x]) {
+	  jlog("Error: write_binhmm: index not match!!!\n");
+	  goto end;
+	}
+      }
+      fl_idx[fh[n].s + i] = x;
+    }
+    fh[n].tr = search_trid(dt->tr);
+    if (dt->tr != tr_index[fh[n].tr]) {
+      jlog("Error: write_binhmm: index not match!!!\n");
+      goto end;
+    }
+    n++;
+  }
+
+  /* header */
+  memset(&h, 0, sizeof(BINHMM_FLAT_HEADER));
+  strcpy(h.magic, BINHMM_HEADER_V3);
+  h.byteorder = BINHMM_FLAT_BYTEORDER;
+  h.flags = 0;
+  if (hmm->variance_inversed) h.flags |= BINHMM_FLAT_VARINV;
+  h.stream_num = hmm->opt.stream_info.num;
+  for (i = 0; i < MAXSTREAMNUM; i++) h.vsize[i] = hmm->opt.stream_info.vsize[i];
+  h.vec_size = hmm->opt.vec_size;
+  h.cov_type = hmm->opt.cov_type;
+  h.dur_type = hmm->opt.dur_type;
+  h.param_type = hmm->opt.param_type;
+  h.is_tied_mixture = hmm->is_tied_mixture;
+  h.maxmixturenum = hmm->maxmixturenum;
+  if (para) {
+    h.flags |= BINHMM_FLAT_EMBEDPARA;
+    h.para_version = VALUE_VERSION;
+    h.smp_period = para->smp_period;
+    h.smp_freq = para->smp_freq;
+    h.framesize = para->framesize;
+    h.frameshift = para->frameshift;
+    h.preEmph = para->preEmph;
+    h.lifter = para->lifter;
+    h.fbank_num = para->fbank_num;
+    h.delWin = para->delWin;
+    h.accWin = para->accWin;
+    h.silFloor = para->silFloor;
+    h.escale = para->escale;
+    h.hipass = para->hipass;
+    h.lopass = para->lopass;
+    h.enormal = para->enormal;
+    h.raw_e = para->raw_e;
+    h.zmeanframe = para->zmeanframe;
+    h.usepower = para->usepower;
+  }
+
+  /* section layout */
+  sec[BINHMM_SEC_STR] = fl_str;
+  h.num[BINHMM_SEC_STR] = fl_strlen;
+  size[BINHMM_SEC_STR] = fl_strlen;
+  sec[BINHMM_SEC_VEC] = fl_vec;
+  h.num[BINHMM_SEC_VEC] = fl_veclen;
+  size[BINHMM_SEC_VEC] = sizeof(VECT) * fl_veclen;
+  sec[BINHMM_SEC_IDX] = fl_idx;
+  h.num[BINHMM_SEC_IDX] = fl_idxlen;
+  size[BINHMM_SEC_IDX] = sizeof(unsigned int) * fl_idxlen;
+  sec[BINHMM_SEC_TRANS] = ft;
+  h.num[BINHMM_SEC_TRANS] = tr_num;
+  size[BINHMM_SEC_TRANS] = sizeof(BINHMM_FLAT_TRANS) * tr_num;
+  sec[BINHMM_SEC_VAR] = fv;
+  h.num[BINHMM_SEC_VAR] = vr_num;
+  size[BINHMM_SEC_VAR] = sizeof(BINHMM_FLAT_VAR) * vr_num;
+  sec[BINHMM_SEC_DENS] = fd;
+  h.num[BINHMM_SEC_DENS] = dens_num;
+  size[BINHMM_SEC_DENS] = sizeof(BINHMM_FLAT_DENS) * dens_num;
+  sec[BINHMM_SEC_SW] = fw;
+  h.num[BINHMM_SEC_SW] = streamweight_num;
+  size[BINHMM_SEC_SW] = sizeof(BINHMM_FLAT_SW) * streamweight_num;
+  sec[BINHMM_SEC_TMIX] = fm;
+  h.num[BINHMM_SEC_TMIX] = tm_num;
+  size[BINHMM_SEC_TMIX] = sizeof(BINHMM_FLAT_TMIX) * tm_num;
+  sec[BINHMM_SEC_PDF] = fpd;
+  h.num[BINHMM_SEC_PDF] = mpdf_num;
+  size[BINHMM_SEC_PDF] = sizeof(BINHMM_FLAT_PDF) * mpdf_num;
+  sec[BINHMM_SEC_STATE] = fs;
+  h.num[BINHMM_SEC_STATE] = st_num;
+  size[BINHMM_SEC_STATE] = sizeof(BINHMM_FLAT_STATE) * st_num;
+  sec[BINHMM_SEC_DATA] = fh;
+  h.num[BINHMM_SEC_DATA] = n;
+  size[BINHMM_SEC_DATA] = sizeof(BINHMM_FLAT_DATA) * n;
+  pos = sizeof(BINHMM_FLAT_HEADER);
+  for (j = 0; j < BINHMM_SEC_NUM; j++) {
+    pos = (pos + BINHMM_FLAT_ALIGN - 1) / BINHMM_FLAT_ALIGN * BINHMM_FLAT_ALIGN;
+    if (pos + size[j] > 0xffffffffUL) {
+      jlog("Error: write_binhmm: flat binary HMM exceeds 4GB\n");
+      goto end;
+    }
+    h.offset[j] = pos;
+    pos += size[j];
+  }
+  h.filesize = pos;
+
+  /* write */
+  if (myfwrite(&h, sizeof(BINHMM_FLAT_HEADER), 1, fp) < 1) {
+    jlog("Error: write_binhmm: failed to write header\n");
+    goto end;
+  }
+  pos = sizeof(BINHMM_FLAT_HEADER);
+  for (j = 0; j < BINHMM_SEC_NUM; j++) {
+    if (myfwrite(zero, 1, h.offset[j] - pos, fp) < h.offset[j] - pos
+	|| myfwrite(sec[j], 1, size[j], fp) < size[j]) {
+      jlog("Error: write_binhmm: failed to write %d bytes\n", (int)size[j]);
+      goto end;
+    }
+    pos = h.offset[j] + size[j];
+  }
+  jlog("Stat: write_binhmm: written header: \"%s\"\n", BINHMM_HEADER_V3);
+  jlog("Stat: write_binhmm: %d transitions, %d variances, %d densities, %d mixture PDFs, %d states, %d HMMs written in flat format\n", tr_num, vr_num, dens_num, mpdf_num, st_num, n);
+
+  ok_p = TRUE;
+
+ end:
+  free(fh);
+  free(fs);
+  free(fpd);
+  free(fm);
+  free(fw);
+  free(fd);
+  free(fv);
+  free(ft);
+  free(fl_idx);
+  free(fl_vec);
+  free(fl_str);
+  free(st_index);
+  free(mpdf_index);
+  if (hmm->is_tied_mixture) free(tm_index);
+  if (hmm->opt.stream_info.num > 1) free(streamweight_index);
+  free(dens_index);
+  free(vr_index);
+  free(tr_index);
+
+  return ok_p;
+}
@@ -437,6 +437,57 @@ bi_prob(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2)
   return p;
 }
 
+/**
+ * Get 2-gram probabilities of all words for a context word at once.
+ * When the 2-gram is indexed by the context (LR), the row is filled
+ * with back-off values and then overwritten by the defined 2-grams of
+ * the context, without searching for each word.  Otherwise each word
+ * is looked up as the same as bi_prob().  The resulting values are
+ * the same as bi_prob().
+ * 
+ * @param ndata [in] N-gram data that holds the 2-gram
+ * @param w1 [in] left context word
+ * @param row [out] log N-gram probabilities P(w|w1) for all words [0..max_word_num-1]
+ * 
+ */
+void
+bi_prob_row(NGRAM_INFO *ndata, WORD_ID w1, LOGPROB *row)
+{
+  NGRAM_TUPLE_INFO *t;
+  LOGPROB *p2, bo;
+  NNID n2, nend;
+  WORD_ID w;
+
+  if (ndata->bigram_index_reversed || ndata->dir == DIR_LR) {
+    /* index is LR: 2-grams of the context are stored sequentially */
+    t = &(ndata->d[1]);
+    if (ndata->bigram_index_reversed) {
+      p2 = ndata->p_2;
+      bo = ndata->bo_wt_1[w1];
+    } else {
+      p2 = t->prob;
+      bo = ndata->d[0].bo_wt[w1];
+    }
+    for (w = 0; w < ndata->max_word_num; w++) {
+      row[w] = bo + ndata->d[0].prob[w];
+    }
+    if ((n2 = t->bgn[w1]) != NNID_INVALID) {
+      nend = n2 + t->num[w1];
+      for (; n2 < nend; n2++) {
+	row[t->nnid2wid[n2]] = p2[n2];
+      }
+    }
+    if (ndata->unk_id < ndata->max_word_num) {
+      row[ndata->unk_id] -= ndata->unk_num_log;
+    }
+  } else {
+    /* index is RL: look up for each word */
+    for (w = 0; w < ndata->max_word_num; w++) {
+      row[w] = (*(ndata->bigram_prob))(ndata, w1, w);
+    }
+  }
+}
+
 /** 
  * Determinte which bi-gram computation function to be used according to
  * the N-gram type, and set pointer to the proper function into the
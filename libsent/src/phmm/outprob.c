@@ -82,9 +82,46 @@ outprob_cache_init(HMMWork *wrk)
   wrk->outprob_allocframenum = 0;
   wrk->OP_time = -1;
   wrk->croot = NULL;
+  wrk->outprob_cache_window = 0;
+  wrk->outprob_cache_frame = NULL;
   return TRUE;
 }
 
+/** 
+ * @brief  Keep the cache only for the given number of recent frames.
+ *
+ * The cache rows are used cyclically, so the cache size does not
+ * grow with input length.  This is for computations that proceed
+ * frame by frame, such as forced alignment of long input.  A frame
+ * that is gone from the cache will be computed again when required.
+ * The cache of all frames is needed for recognition, so this should
+ * not be used on the work area for recognition.
+ * 
+ * @param wrk [i/o] HMM computation work area
+ * @param framenum [in] number of frames to keep (> 0)
+ */
+void
+outprob_cache_set_window(HMMWork *wrk, int framenum)
+{
+  int t, s;
+  LOGPROB *tmpp;
+
+  outprob_cache_free(wrk);
+  wrk->outprob_cache = (LOGPROB **)mymalloc(sizeof(LOGPROB *) * framenum);
+  wrk->outprob_cache_frame = (int *)mymalloc(sizeof(int) * framenum);
+  tmpp = (LOGPROB *)mybmalloc2(sizeof(LOGPROB) * framenum * wrk->statenum, &(wrk->croot));
+  for(t = 0; t < framenum; t++) {
+    wrk->outprob_cache[t] = &(tmpp[t * wrk->statenum]);
+    for (s = 0; s < wrk->statenum; s++) {
+      wrk->outprob_cache[t][s] = LOG_UNDEF;
+    }
+    wrk->outprob_cache_frame[t] = -1;
+  }
+  wrk->outprob_allocframenum = framenum;
+  wrk->outprob_cache_window = framenum;
+  wrk->OP_time = -1;
+}
+
 /** 
  * Prepare cache for the next input, by clearing the existing cache.
  * 
@@ -102,6 +139,7 @@ outprob_cache_prepare(HMMWork *wrk)
     for (s = 0; s < wrk->statenum; s++) {
       wrk->outprob_cache[t][s] = LOG_UNDEF;
     }
+    if (wrk->outprob_cache_window > 0) wrk->outprob_cache_frame[t] = -1;
   }
   
   return TRUE;
@@ -159,6 +197,10 @@ outprob_cache_free(HMMWork *wrk)
 {
   if (wrk->croot != NULL) mybfree2(&(wrk->croot));
   if (wrk->outprob_cache != NULL) free(wrk->outprob_cache);
+  if (wrk->outprob_cache_frame != NULL) free(wrk->outprob_cache_frame);
+  wrk->outprob_cache = NULL;
+  wrk->outprob_cache_frame = NULL;
+  wrk->outprob_allocframenum = 0;
 }
 
 
@@ -202,8 +244,18 @@ outprob_state(HMMWork *wrk, int t, HTK_HMM_State *stateinfo, HTK_Param *param)
       d += wrk->OP_veclen_stream[i];
     }
 
-    outprob_cache_extend(wrk, t);	/* extend cache if needed */
-    wrk->last_cache = wrk->outprob_cache[t]; /* reduce 2-d array access */
+    if (wrk->outprob_cache_window > 0) {
+      /* reuse the row of an old frame */
+      i = t % wrk->outprob_cache_window;
+      if (wrk->outprob_cache_frame[i] != t) {
+	for (d = 0; d < wrk->statenum; d++) wrk->outprob_cache[i][d] = LOG_UNDEF;
+	wrk->outprob_cache_frame[i] = t;
+      }
+      wrk->last_cache = wrk->outprob_cache[i];
+    } else {
+      outprob_cache_extend(wrk, t);	/* extend cache if needed */
+      wrk->last_cache = wrk->outprob_cache[t]; /* reduce 2-d array access */
+    }
   }
 
   if (param->is_outprob) {
@@ -26,6 +26,118 @@
 #include <sent/htk_param.h>
 #include <sent/hmm.h>
 
+/// Minimum number of tokens to be allocated at once
+#define SEGTOKEN_BLOCK_SIZE 1024
+
+/// Pool of tokens for viterbi segmentation
+typedef struct {
+  SEGTOKEN **block;		///< Allocated token blocks
+  int *blocklen;		///< Number of tokens in each block
+  int blocknum;			///< Number of blocks
+  int blockalloc;		///< Allocated length of @a block
+  int num;			///< Total number of tokens
+  SEGTOKEN *freelist;		///< List of free tokens, linked by "list"
+  int freenum;			///< Number of free tokens
+  int mark;			///< Count of garbage collection
+} SEGTOKEN_POOL;
+
+/** 
+ * Add a new block of free tokens to the pool.
+ * 
+ * @param pool [i/o] token pool
+ * @param num [in] number of tokens to add
+ */
+static void
+segtoken_pool_expand(SEGTOKEN_POOL *pool, int num)
+{
+  SEGTOKEN *b;
+  int i;
+
+  if (pool->blocknum >= pool->blockalloc) {
+    pool->blockalloc += 16;
+    pool->block = (SEGTOKEN **)myrealloc(pool->block, sizeof(SEGTOKEN *) * pool->blockalloc);
+    pool->blocklen = (int *)myrealloc(pool->blocklen, sizeof(int) * pool->blockalloc);
+  }
+  b = (SEGTOKEN *)mymalloc(sizeof(SEGTOKEN) * num);
+  for (i = 0; i < num; i++) {
+    b[i].mark = pool->mark;
+    b[i].list = pool->freelist;
+    pool->freelist = &(b[i]);
+  }
+  pool->block[pool->blocknum] = b;
+  pool->blocklen[pool->blocknum] = num;
+  pool->blocknum++;
+  pool->num += num;
+  pool->freenum += num;
+}
+
+/** 
+ * Make sure that the pool has the required number of free tokens.
+ * When short, tokens that are not reachable from the given tokens are
+ * collected, and new tokens are allocated if still not enough.
+ * 
+ * @param pool [i/o] token pool
+ * @param root [in] tokens in use, indexed by node
+ * @param lo [in] first node to check
+ * @param hi [in] last node to check
+ * @param req [in] number of tokens required
+ */
+static void
+segtoken_pool_reserve(SEGTOKEN_POOL *pool, SEGTOKEN **root, int lo, int hi, int req)
+{
+  SEGTOKEN *token;
+  int i, n;
+
+  if (pool->freenum >= req) return;
+
+  if (pool->num > 0) {
+    /* mark tokens in use */
+    pool->mark++;
+    for (n = lo; n <= hi; n++) {
+      for (token = root[n]; token && token->mark != pool->mark; token = token->next) {
+	token->mark = pool->mark;
+      }
+    }
+    /* collect the rest */
+    pool->freelist = NULL;
+    pool->freenum = 0;
+    for (i = 0; i < pool->blocknum; i++) {
+      for (n = 0; n < pool->blocklen[i]; n++) {
+	token = &(pool->block[i][n]);
+	if (token->mark == pool->mark) continue;
+	token->list = pool->freelist;
+	pool->freelist = token;
+	pool->freenum++;
+      }
+    }
+  }
+  /* keep at least half of the pool free to reduce collection */
+  if (pool->freenum < req || pool->freenum < pool->num / 2) {
+    n = pool->num;
+    if (n < req) n = req;
+    if (n < SEGTOKEN_BLOCK_SIZE) n = SEGTOKEN_BLOCK_SIZE;
+    segtoken_pool_expand(pool, n);
+  }
+}
+
+/** 
+ * Take a free token from the pool.
+ * 
+ * @param pool [i/o] token pool
+ * 
+ * @return the token.
+ */
+static SEGTOKEN *
+segtoken_new(SEGTOKEN_POOL *pool)
+{
+  SEGTOKEN *token;
+
+  token = pool->freelist;
+  pool->freelist = token->list;
+  pool->freenum--;
+  return(token);
+}
+
 /** 
  * @brief  Perform Viterbi alignment.
  *
@@ -35,6 +147,15 @@
  * specifying a list of state id which are the end of each unit.
  * For example, if you want to obtain phoneme alignment, the list of state
  * number that exist at the end of phones should be specified by @a endstates.
+ *
+ * Only the range of states between the first and last active ones is
+ * processed at each frame.  When @a beam is given, states whose score
+ * is lower than the best one at the frame by more than @a beam are
+ * pruned, so that the range becomes a narrow band along the best path.
+ * Unit boundaries on the paths are held by tokens instead of back
+ * pointers of all frames, and tokens no longer on any active path are
+ * reused, so the memory does not grow with input length.  Scores are
+ * shifted when they approach LOG_ZERO on long input.
  * 
  * @param hmm [in] sentence HMM to be matched
  * @param param [in] input parameter data
@@ -42,6 +163,7 @@
  * @param multipath [in] TRUE if need multi-path handling
  * @param endstates [in] list of state id that corrsponds to the ends of units
  * @param ulen [in] total number of units in the @a hmm
+ * @param beam [in] score beam width for pruning, or 0 to disable pruning
  * @param id_ret [out] Pointer to store the newly allocated array of the resulting id sequence of units on the best path.
  * @param seg_ret [out] Pointer to store the newly allocated array of the resulting end frame of each unit on the best path.
  * @param uscore_ret [out] Pointer to store the newly allocated array of the resulting score at the end frame of each unit on the best path.
@@ -50,23 +172,27 @@
  * @return the total acoustic score for the whole input.
  */
 LOGPROB
-viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int *endstates, int ulen, int **id_ret, int **seg_ret, LOGPROB **uscore_ret, int *slen_ret)
+viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int *endstates, int ulen, LOGPROB beam, int **id_ret, int **seg_ret, LOGPROB **uscore_ret, int *slen_ret)
 {
   /* for viterbi */
   LOGPROB *nodescore[2];	/* node buffer */
   SEGTOKEN **tokenp[2];		/* propagating token which holds segment info */
+  int lo[2], hi[2];		/* range of active nodes in each buffer */
   int startt, endt;
   int *from_node;
   int *u_end, *u_start;	/* the node is an end of the word, or -1 for non-multipath mode*/
+  int *u_of;			/* unit that contains the node, for multipath mode */
   int i, n;
   unsigned int t;
   int tl,tn;
   LOGPROB tmpsum;
   A_CELL *ac;
-  SEGTOKEN *newtoken, *token, *tmptoken, *root;
+  SEGTOKEN *newtoken, *token;
+  SEGTOKEN starttoken;		/* context at the beginning */
+  SEGTOKEN_POOL pool;
   LOGPROB result_score;
-  LOGPROB maxscore, minscore;	/* for debug */
-  int maxnode;			/* for debug */
+  LOGPROB maxscore, thres;
+  LOGPROB offset;		/* score subtracted from nodes to keep them above LOG_ZERO */
   int *id, *seg, slen;
   LOGPROB *uscore;
 
@@ -76,6 +202,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
     return LOG_ZERO;
   }
 
+  u_start = u_end = u_of = NULL;
   if (!multipath) {
     /* initialize unit start/end marker */
     u_start = (int *)mymalloc(hmm->len * sizeof(int));
@@ -95,41 +222,56 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
       printf("unit %d: start=%d, end=%d\n", i, u_start[i], u_end[i]);
     }
 #endif
+  } else {
+    /* unit that contains each node */
+    u_of = (int *)mymalloc(hmm->len * sizeof(int));
+    i = 0;
+    for (n = 0; n < hmm->len; n++) {
+      while (i < ulen - 1 && n > endstates[i]) i++;
+      u_of[n] = i;
+    }
   }
 
   /* initialize node buffers */
   tn = 0;
   tl = 1;
-  root = NULL;
   for (i=0;i<2;i++){
     nodescore[i] = (LOGPROB *)mymalloc(hmm->len * sizeof(LOGPROB));
     tokenp[i] = (SEGTOKEN **)mymalloc(hmm->len * sizeof(SEGTOKEN *));
     for (n = 0; n < hmm->len; n++) {
+      nodescore[i][n] = LOG_ZERO;
       tokenp[i][n] = NULL;
     }
+    lo[i] = 0;
+    hi[i] = -1;
   }
-  for (n = 0; n < hmm->len; n++) {
-    nodescore[tn][n] = LOG_ZERO;
-    newtoken = (SEGTOKEN *)mymalloc(sizeof(SEGTOKEN));
-    newtoken->last_id = -1;
-    newtoken->last_end_frame = -1;
-    newtoken->last_end_score = 0.0;
-    newtoken->list = root;
-    root = newtoken;
-    newtoken->next = NULL;
-    tokenp[tn][n] = newtoken;
-  }
+  starttoken.last_id = -1;
+  starttoken.last_end_frame = -1;
+  starttoken.last_end_score = 0.0;
+  starttoken.next = NULL;
+  starttoken.mark = 0;
+  pool.block = NULL;
+  pool.blocklen = NULL;
+  pool.blocknum = pool.blockalloc = 0;
+  pool.num = 0;
+  pool.freelist = NULL;
+  pool.freenum = 0;
+  pool.mark = 0;
   from_node = (int *)mymalloc(sizeof(int) * hmm->len);
+  for (n = 0; n < hmm->len; n++) from_node[n] = -1;
+  offset = 0.0;
   
   /* first frame: only set initial score */
   /*if (hmm->state[0].is_pseudo_state) {
-    jlog("Warning: state %d: pseudo state?\n", 0);
+    jlog("Warning: %d: pseudo state?\n", 0);
     }*/
   if (multipath) {
     nodescore[tn][0] = 0.0;
   } else {
     nodescore[tn][0] = outprob(wrk, 0, &(hmm->state[0]), param);
   }
+  tokenp[tn][0] = &starttoken;
+  lo[tn] = hi[tn] = 0;
 
   /* do viterbi for rest frame */
   if (multipath) {
@@ -142,40 +284,41 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
     tl = tn;
     tn = i;
     maxscore = LOG_ZERO;
-    minscore = 0.0;
 
     /* clear next scores */
-    for (i=0;i<hmm->len;i++) {
-      nodescore[tn][i] = LOG_ZERO;
-      from_node[i] = -1;
+    for (n = lo[tn]; n <= hi[tn]; n++) {
+      nodescore[tn][n] = LOG_ZERO;
     }
+    lo[tn] = hmm->len;
+    hi[tn] = -1;
 
     /* select viterbi path for each node */
-    for (n = 0; n < hmm->len; n++) {
+    for (n = lo[tl]; n <= hi[tl]; n++) {
       if (nodescore[tl][n] <= LOG_ZERO) continue;
       for (ac = hmm->state[n].ac; ac; ac = ac->next) {
         tmpsum = nodescore[tl][n] + ac->a;
         if (nodescore[tn][ac->arc] < tmpsum) {
           nodescore[tn][ac->arc] = tmpsum;
 	  from_node[ac->arc] = n;
+	  if (lo[tn] > ac->arc) lo[tn] = ac->arc;
+	  if (hi[tn] < ac->arc) hi[tn] = ac->arc;
 	}
       }
     }
+    /* each node can append at most one new token */
+    segtoken_pool_reserve(&pool, tokenp[tl], lo[tl], hi[tl], hi[tn] - lo[tn] + 1);
     /* propagate token, appending new if path was selected between units */
     if (multipath) {
-      for (n = 0; n < hmm->len; n++) {
+      for (n = lo[tn]; n <= hi[tn]; n++) {
 	if (from_node[n] == -1 || nodescore[tn][n] <= LOG_ZERO) {
-	  /*tokenp[tn][n] = NULL;*/
+	  tokenp[tn][n] = NULL;
 	} else {
-	  i=0;
-	  while (from_node[n] > endstates[i]) i++;
+	  i = u_of[from_node[n]];
 	  if (n > endstates[i]) {
-	    newtoken = (SEGTOKEN *)mymalloc(sizeof(SEGTOKEN));
+	    newtoken = segtoken_new(&pool);
 	    newtoken->last_id = i;
 	    newtoken->last_end_frame = t-1;
-	    newtoken->last_end_score = nodescore[tl][from_node[n]];
-	    newtoken->list = root;
-	    root = newtoken;
+	    newtoken->last_end_score = nodescore[tl][from_node[n]] + offset;
 	    newtoken->next = tokenp[tl][from_node[n]];
 	    tokenp[tn][n] = newtoken;
 	  } else {
@@ -184,7 +327,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
 	}
       }
     } else {			/* not multipath */
-      for (n = 0; n < hmm->len; n++) {
+      for (n = lo[tn]; n <= hi[tn]; n++) {
 	if (from_node[n] == -1) {
 	  tokenp[tn][n] = NULL;
 	} else if (nodescore[tn][n] <= LOG_ZERO) {
@@ -192,12 +335,10 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
 	} else {
 	  if (u_end[from_node[n]] != -1 && u_start[n] != -1
 	      && from_node[n] !=  n) {
-	    newtoken = (SEGTOKEN *)mymalloc(sizeof(SEGTOKEN));
+	    newtoken = segtoken_new(&pool);
 	    newtoken->last_id = u_end[from_node[n]];
 	    newtoken->last_end_frame = t-1;
-	    newtoken->last_end_score = nodescore[tl][from_node[n]];
-	    newtoken->list = root;
-	    root = newtoken;
+	    newtoken->last_end_score = nodescore[tl][from_node[n]] + offset;
 	    newtoken->next = tokenp[tl][from_node[n]];
 	    tokenp[tn][n] = newtoken;
 	  } else {
@@ -206,6 +347,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
 	}
       }
     }
+    for (n = lo[tn]; n <= hi[tn]; n++) from_node[n] = -1;
 
     if (multipath) {
       /* if this is next of last frame, loop ends here */
@@ -213,7 +355,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
     }
 	
     /* calc outprob to new nodes */
-    for (n = 0; n < hmm->len; n++) {
+    for (n = lo[tn]; n <= hi[tn]; n++) {
       if (multipath) {
 	if (hmm->state[n].out.state == NULL) continue;
       }
@@ -223,11 +365,28 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
 	}
 	nodescore[tn][n] += outprob(wrk, t, &(hmm->state[n]), param);
       }
-      if (nodescore[tn][n] > maxscore) { /* for debug */
+      if (nodescore[tn][n] > maxscore) {
 	maxscore = nodescore[tn][n];
-	maxnode = n;
       }
     }
+
+    /* prune nodes out of beam, and narrow the range */
+    if (beam > 0.0 && maxscore > LOG_ZERO) {
+      thres = maxscore - beam;
+      for (n = lo[tn]; n <= hi[tn]; n++) {
+	if (nodescore[tn][n] < thres) nodescore[tn][n] = LOG_ZERO;
+      }
+      while (lo[tn] <= hi[tn] && nodescore[tn][lo[tn]] <= LOG_ZERO) lo[tn]++;
+      while (hi[tn] >= lo[tn] && nodescore[tn][hi[tn]] <= LOG_ZERO) hi[tn]--;
+    }
+
+    /* on long input, scores may go below LOG_ZERO: shift them by the best one */
+    if (maxscore > LOG_ZERO && maxscore < LOG_ZERO * 0.5) {
+      for (n = lo[tn]; n <= hi[tn]; n++) {
+	if (nodescore[tn][n] > LOG_ZERO) nodescore[tn][n] -= maxscore;
+      }
+      offset += maxscore;
+    }
     
 #if 0
     for (i=0;i<ulen;i++) {
@@ -237,18 +396,26 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
     }
 #endif
 
-    /* printf("t=%3d max=%f n=%d\n",t,maxscore, maxnode); */
+    /* printf("t=%3d max=%f\n",t,maxscore); */
     
   }
 
-  result_score = nodescore[tn][hmm->len-1];
+  if (hmm->len - 1 >= lo[tn] && hmm->len - 1 <= hi[tn]) {
+    result_score = nodescore[tn][hmm->len-1];
+    if (result_score > LOG_ZERO) result_score += offset;
+    token = tokenp[tn][hmm->len-1];
+  } else {
+    /* the end node was not reached */
+    result_score = LOG_ZERO;
+    token = NULL;
+  }
 
   /* parse back the last token to see the trail of best viterbi path */
   /* and store the informations to returning buffer */
   slen = 0;
   if (!multipath) slen++;
-  for(token = tokenp[tn][hmm->len-1]; token; token = token->next) {
-    if (token->last_end_frame == -1) break;
+  for(newtoken = token; newtoken; newtoken = newtoken->next) {
+    if (newtoken->last_end_frame == -1) break;
     slen++;
   }
   id = (int *)mymalloc(sizeof(int)*slen);
@@ -263,7 +430,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
     uscore[slen-1] = result_score;
     i = slen - 2;
   }
-  for(token = tokenp[tn][hmm->len-1]; token; token = token->next) {
+  for(; token; token = token->next) {
     if (i < 0 || token->last_end_frame == -1) break;
     id[i] = token->last_id;
     seg[i] = token->last_end_frame;
@@ -275,7 +442,7 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
   for (i=slen-1;i>0;i--) {
     uscore[i] = (uscore[i] - uscore[i-1]) / (seg[i] - seg[i-1]);
   }
-  uscore[0] = uscore[0] / (seg[0] + 1);
+  if (slen > 0) uscore[0] = uscore[0] / (seg[0] + 1);
 
   /* set return value */
   *id_ret = id;
@@ -287,14 +454,13 @@ viterbi_segment(HMM *hmm, HTK_Param *param, HMMWork *wrk, boolean multipath, int
   if (!multipath) {
     free(u_start);
     free(u_end);
+  } else {
+    free(u_of);
   }
   free(from_node);
-  token = root;
-  while(token) {
-    tmptoken = token->list;
-    free(token);
-    token = tmptoken;
-  }
+  for (i = 0; i < pool.blocknum; i++) free(pool.block[i]);
+  if (pool.block) free(pool.block);
+  if (pool.blocklen) free(pool.blocklen);
   for (i=0;i<2;i++) {
     free(nodescore[i]);
     free(tokenp[i]);
@@ -39,12 +39,24 @@
 
 #include <sent/stddefs.h>
 
+#if defined(_WIN32) && !defined(__CYGWIN32__)
+/* no mmap(), arena is not available */
+#else
+#define HAVE_BMALLOC_ARENA	///< Memory blocks can be placed on an arena
+#include <sys/mman.h>
+#endif
+
 static boolean mybmalloc_initialized = FALSE; ///< TRUE if mybmalloc has already initialized
 static unsigned int pagesize;		///< Page size for memoly allocation
 static unsigned int blocksize;  ///< Block size in bytes
 static int align;		///< Allocation alignment size in bytes
 static unsigned int align_mask; ///< Bit mask to compute the actual aligned memory size
 
+static char *arena_base = NULL;	///< Beginning of the arena, NULL if not used
+static char *arena_now;		///< Beginning of unused area in the arena
+static char *arena_end;		///< End of the arena
+static boolean arena_active = FALSE; ///< TRUE while new blocks are placed on the arena
+
 /** 
  * Set block size and memory alignment factor.
  * 
@@ -72,6 +84,129 @@ mybmalloc_set_param()
   mybmalloc_initialized = TRUE;
 }
 
+/**
+ * @brief  Open an arena to place the memory blocks of mybmalloc2().
+ *
+ * While the arena is open, all new memory blocks of mybmalloc2() are
+ * taken from a dedicated anonymous memory mapping instead of the heap.
+ * This is used to load models before forking worker processes: the
+ * blocks stay on pages separated from the heap, on which the workers
+ * allocate and free their own work areas, so they remain shared
+ * between the processes by copy-on-write.
+ *
+ * The mapping is private, not shared: a page written by a worker
+ * after fork is copied for the worker, not seen by the others.
+ * Only address space is reserved here, and memory is given as used.
+ * 
+ * @param size [in] maximum size of the arena in bytes
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+mybmalloc_arena_open(size_t size)
+{
+#ifdef HAVE_BMALLOC_ARENA
+  void *p;
+  int flags;
+
+  if (!mybmalloc_initialized) mybmalloc_set_param();  /* initialize if not yet */
+  if (arena_base != NULL) {
+    jlog("Error: mybmalloc_arena_open: arena already opened\n");
+    return FALSE;
+  }
+  flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  size = (size + pagesize - 1) / pagesize * pagesize;
+  p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (p == MAP_FAILED) {
+    jlog("Error: mybmalloc_arena_open: failed to map %lu bytes\n", (unsigned long)size);
+    return FALSE;
+  }
+  arena_base = arena_now = (char *)p;
+  arena_end = arena_base + size;
+  arena_active = TRUE;
+  return TRUE;
+#else
+  jlog("Error: mybmalloc_arena_open: not supported on this system\n");
+  return FALSE;
+#endif
+}
+
+/**
+ * @brief  Close the arena.
+ *
+ * New memory blocks will be allocated from the heap again.  The blocks
+ * on the arena are kept until the process exits, and a block list whose
+ * last block is on the arena will begin a new block at the next
+ * allocation, so that the arena is not written for allocation any more.
+ * 
+ */
+void
+mybmalloc_arena_close()
+{
+  arena_active = FALSE;
+}
+
+/**
+ * Return the total size of memory blocks placed on the arena.
+ * 
+ * @return the size in bytes.
+ */
+size_t
+mybmalloc_arena_used()
+{
+  if (arena_base == NULL) return 0;
+  return(arena_now - arena_base);
+}
+
+/**
+ * Check if a pointer is on the arena.
+ * 
+ * @param p [in] pointer
+ * 
+ * @return TRUE if on the arena, FALSE if not.
+ */
+static boolean
+in_arena(void *p)
+{
+  return(arena_base != NULL && (char *)p >= arena_base && (char *)p < arena_end);
+}
+
+/**
+ * Allocate memory, from the arena if it is open.
+ * 
+ * @param size [in] size in bytes, should be a multiple of alignment
+ * 
+ * @return pointer to the newly allocated area.
+ */
+static void *
+block_alloc(unsigned int size)
+{
+  void *p;
+
+  p = NULL;
+  if (arena_active) {
+    /* lexicon tree may be built by threads */
+#ifdef _OPENMP
+#pragma omp critical (mybmalloc_arena)
+#endif
+    {
+      if (arena_now + size <= arena_end) {
+	p = arena_now;
+	arena_now += size;
+      }
+    }
+    if (p == NULL) {
+      jlog("Warning: mybmalloc2: arena exhausted, use heap\n");
+      arena_active = FALSE;
+    }
+  }
+  if (p == NULL) p = mymalloc(size);
+  return(p);
+}
+
 /** 
  * Another version of memory block allocation, used for tree lexicon.
  * 
@@ -89,15 +224,16 @@ mybmalloc2(unsigned int size, BMALLOC_BASE **list)
   if (!mybmalloc_initialized) mybmalloc_set_param();  /* initialize if not yet */
   /* malloc segment should be aligned to a word boundary */
   size = (size + align - 1) & align_mask;
-  if (*list == NULL || (*list)->now + size >= (*list)->end) {
-    new = (BMALLOC_BASE *)mymalloc(sizeof(BMALLOC_BASE));
+  if (*list == NULL || (*list)->now + size >= (*list)->end
+      || (!arena_active && in_arena((*list)->base))) {
+    new = (BMALLOC_BASE *)block_alloc((sizeof(BMALLOC_BASE) + align - 1) & align_mask);
     if (size > blocksize) {
       /* large block, allocate a whole block */
-      new->base = mymalloc(size);
+      new->base = block_alloc(size);
       new->end = (char *)new->base + size;
     } else {
       /* allocate per blocksize */
-      new->base = mymalloc(blocksize);
+      new->base = block_alloc(blocksize);
       new->end = (char *)new->base + blocksize;
     }
     new->now = (char *)new->base;
@@ -141,9 +277,31 @@ mybfree2(BMALLOC_BASE **list)
   b = *list;
   while (b) {
     btmp = b->next;
-    free(b->base);
-    free(b);
+    /* blocks on the arena are kept */
+    if (!in_arena(b->base)) free(b->base);
+    if (!in_arena(b)) free(b);
     b = btmp;
   }
   *list = NULL;
 }
+
+/** 
+ * Move all memories allocated by mybmalloc2() on a list to another list.
+ * The moved memories will be freed by mybfree2() on the destination list.
+ * This is used to gather the memories allocated separately by threads.
+ * 
+ * @param dst [i/o] destination memory management information
+ * @param src [i/o] source memory management information (will be cleaned here)
+ */
+void
+mybmerge2(BMALLOC_BASE **dst, BMALLOC_BASE **src)
+{
+  BMALLOC_BASE *b;
+
+  if (*src == NULL) return;
+  /* keep the source head, which may have free area, at the head */
+  for (b = *src; b->next; b = b->next);
+  b->next = *dst;
+  *dst = *src;
+  *src = NULL;
+}
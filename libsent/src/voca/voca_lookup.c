@@ -5,14 +5,16 @@
  * @brief  単語辞書上の単語の検索
  *
  * 単語を，「言語エントリ名」あるいは「言語エントリ名[出力文字列]」
- * ，あるいは「#単語番号」から検索します．
+ * ，あるいは「#単語番号」から検索します．単語名の検索には，最初の
+ * 検索時に作成し単語の追加に応じて更新されるハッシュ索引を用います．
  * </JA>
  * 
  * <EN>
  * @brief  Look up a word on dictionary by string
  *
  * String can be "langentry" or "langentry[outputstring]", or
- * "#number".
+ * "#number".  Word names are looked up by a hash index, which is built
+ * at the first lookup and extended as words are appended.
  * </EN>
  * 
  * @author Akinobu LEE
@@ -31,6 +33,86 @@
 #include <sent/stddefs.h>
 #include <sent/vocabulary.h>
 
+/** 
+ * Compute hash value of a word name.
+ * 
+ * @param s [in] word name
+ * @param len [in] number of characters to be used
+ * 
+ * @return the hash value.
+ */
+static unsigned int
+voca_name_hash(char *s, int len)
+{
+  unsigned int h;
+  int i;
+
+  h = 2166136261U;
+  for (i = 0; i < len && s[i] != '\0'; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/** 
+ * Register words to the word name index.  Words are registered in
+ * ascending order of word ID, and since linear probing puts an entry
+ * behind those of the same name, the first entry of a name found in the
+ * probing sequence is always the one with the smallest ID.
+ * 
+ * @param winfo [i/o] word dictionary
+ * @param bgn [in] word ID to start registering
+ */
+static void
+voca_index_add(WORD_INFO *winfo, WORD_ID bgn)
+{
+  WORD_ID w;
+  unsigned int mask, h;
+
+  mask = winfo->windex_size - 1;
+  for (w = bgn; w < winfo->num; w++) {
+    if (winfo->wname[w] == NULL) continue;
+    h = voca_name_hash(winfo->wname[w], strlen(winfo->wname[w])) & mask;
+    while (winfo->windex[h] != WORD_INVALID) h = (h + 1) & mask;
+    winfo->windex[h] = w;
+  }
+  winfo->windex_num = winfo->num;
+}
+
+/** 
+ * Prepare the word name index for lookup.  The index is built at the
+ * first lookup, and words added to the dictionary after that (by
+ * voca_append() for multiple grammars, etc.) are registered here at the
+ * next lookup.  When the table becomes too small or the dictionary has
+ * been re-initialized, the whole index is re-built.
+ * 
+ * @param winfo [i/o] word dictionary
+ */
+static void
+voca_index_update(WORD_INFO *winfo)
+{
+  int size, i;
+
+  if (winfo->windex != NULL && winfo->windex_num == winfo->num) return;
+
+  if (winfo->windex == NULL || winfo->windex_num > winfo->num || winfo->windex_num == 0 || winfo->num * 2 > winfo->windex_size) {
+    /* (re-)build whole index with load factor <= 0.5 */
+    size = 64;
+    while (size < winfo->num * 2) size *= 2;
+    if (size != winfo->windex_size) {
+      if (winfo->windex != NULL) free(winfo->windex);
+      winfo->windex = (WORD_ID *)mymalloc(sizeof(WORD_ID) * size);
+      winfo->windex_size = size;
+    }
+    for (i = 0; i < size; i++) winfo->windex[i] = WORD_INVALID;
+    voca_index_add(winfo, 0);
+  } else {
+    /* register only the newly added words */
+    voca_index_add(winfo, winfo->windex_num);
+  }
+}
+
 /** 
  * Look up a word on dictionary by string.
  * 
@@ -42,11 +124,12 @@
 WORD_ID
 voca_lookup_wid(char *keyword, WORD_INFO *winfo)
 {
-  WORD_ID i, found;
-  int plen,totallen;
+  WORD_ID i, w, found;
+  int plen, olen, totallen;
   boolean numflag = TRUE;
   int wid;
-  char *c;
+  char *c, *out;
+  unsigned int mask, h;
 
   if (keyword == NULL) return WORD_INVALID;
   
@@ -69,31 +152,37 @@ voca_lookup_wid(char *keyword, WORD_INFO *winfo)
       return(WORD_INVALID);
     }
   }
+
+  if (winfo->num == 0) return WORD_INVALID;
       
-  found = WORD_INVALID;
   totallen = strlen(keyword);
   if ((c = strchr(keyword, '[')) != NULL) {
     plen = c - keyword;
-    for (i=0;i<winfo->num;i++) {
-      if (strnmatch(keyword,winfo->wname[i], plen)
-	  && strnmatch(c+1, winfo->woutput[i], totallen-plen-2)) {
-	if (found == WORD_INVALID) {
-	  found = i;
-	} else {
-	  jlog("Warning: voca_lookup: several \"%s\" found in dictionary, use the first one..\n");
-	  break;
-	}
-      }
-    }
+    out = c + 1;
+    olen = totallen - plen - 2;
+    if (olen < 0) olen = 0;
   } else {
-    for (i=0;i<winfo->num;i++) {
-      if (strmatch(keyword,winfo->wname[i])) {
-	if (found == WORD_INVALID) {
-	  found = i;
-	} else {
-	  jlog("Warning: voca_lookup: several \"%s\" found in dictionary, use the first one..\n");
-	  break;
-	}
+    plen = totallen;
+    out = NULL;
+    olen = 0;
+  }
+
+  voca_index_update(winfo);
+  mask = winfo->windex_size - 1;
+
+  found = WORD_INVALID;
+  h = voca_name_hash(keyword, plen) & mask;
+  for (; (w = winfo->windex[h]) != WORD_INVALID; h = (h + 1) & mask) {
+    if (strnmatch(keyword, winfo->wname[w], plen) && winfo->wname[w][plen] == '\0') {
+      if (out != NULL) {
+	if (winfo->woutput[w] == NULL) continue;
+	if (! strnmatch(out, winfo->woutput[w], olen) || winfo->woutput[w][olen] != '\0') continue;
+      }
+      if (found == WORD_INVALID) {
+	found = w;
+      } else {
+	jlog("Warning: voca_lookup: several \"%s\" found in dictionary, use the first one..\n", keyword);
+	break;
       }
     }
   }
@@ -52,6 +52,9 @@ word_info_new()
 #ifdef USE_MBR
   new->weight = NULL;
 #endif
+  new->windex = NULL;
+  new->windex_size = 0;
+  new->windex_num = 0;
 
   return(new);
 }
@@ -76,6 +79,7 @@ word_info_free(WORD_INFO *winfo)
   if (winfo->cprob != NULL) free(winfo->cprob);
 #endif
   if (winfo->is_transparent != NULL) free(winfo->is_transparent);
+  if (winfo->windex != NULL) free(winfo->windex);
   /* free whole */
 #ifdef USE_MBR
   if (winfo->weight != NULL) free(winfo->weight);
@@ -111,6 +115,8 @@ winfo_init(WORD_INFO *winfo)
   winfo->maxwlen = 0;
   winfo->errnum = 0;
   winfo->errph_root = NULL;
+  /* lookup index will be re-built at next lookup */
+  winfo->windex_num = 0;
 }
 
 /** 
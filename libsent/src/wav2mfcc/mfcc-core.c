@@ -84,7 +84,9 @@ make_fft_table(MFCCWork *w, int n)
 }
 
 /** 
- * Generate table for DCT operation to make mfcc from fbank.
+ * Generate table for DCT operation to make mfcc from fbank.  The table
+ * is a dense [mfcc_dim][fbank_stride] matrix whose rows are zero-padded
+ * for the SIMD inner product, and already scaled by sqrt2var.
  * 
  * @param w [i/o] MFCC calculation work area
  * @param fbank_num [in] number of filer banks
@@ -97,22 +99,26 @@ make_costbl_makemfcc(MFCCWork *w, int fbank_num, int mfcc_dim)
   int i, j, k;
   float B, C;
 
-  size = fbank_num * mfcc_dim;
-  w->costbl_makemfcc = (double *)mymalloc(sizeof(double) * size);
+  size = w->fbank_stride * mfcc_dim;
+  w->costbl_makemfcc = (float *)mymalloc(sizeof(float) * size);
 
   B = PI / fbank_num;
   k = 0;
   for(i=1;i<=mfcc_dim;i++) {
     C = i * B;
     for(j=1;j<=fbank_num;j++) {
-      w->costbl_makemfcc[k] = cos(C * (j - 0.5));
+      w->costbl_makemfcc[k] = cos(C * (j - 0.5)) * w->sqrt2var;
+      k++;
+    }
+    for(;j<=w->fbank_stride;j++) {
+      w->costbl_makemfcc[k] = 0.0;
       k++;
     }
   }
   w->costbl_makemfcc_len = size;
 #ifdef MFCC_TABLE_DEBUG
   jlog("Stat: mfcc-core: generated MakeMFCC cos table (%d bytes)\n",
-       w->costbl_makemfcc_len * sizeof(double));
+       w->costbl_makemfcc_len * sizeof(float));
 #endif
 }
 
@@ -230,6 +236,7 @@ InitFBank(MFCCWork *w, Value *para)
 {
   float mlo, mhi, ms, melk;
   int k, chan, maxChan, nv2;
+  int i, len, kstart, kend;
 
   /* Calculate FFT size */
   w->fb.fftN = 2;  w->fb.n = 1;
@@ -293,6 +300,55 @@ InitFBank(MFCCWork *w, Value *para)
     }
   }
   
+  /* Create sparse-banded filterbank matrix from loChan and loWt:
+     FFT bin k contributes to channel loChan[k] by loWt[k] and to
+     channel loChan[k]+1 by (1 - loWt[k]), so each channel covers a
+     contiguous range of bins */
+  w->fb.bandStart = (int *)mymalloc((para->fbank_num + 1) * sizeof(int));
+  w->fb.bandLen = (int *)mymalloc((para->fbank_num + 1) * sizeof(int));
+  w->fb.bandWt = (float **)mymalloc((para->fbank_num + 1) * sizeof(float *));
+  len = 0;
+  for(chan = 1; chan <= para->fbank_num; chan++) {
+    kstart = kend = -1;
+    for(k = w->fb.klo; k <= w->fb.khi; k++) {
+      if (w->fb.loChan[k] == chan || w->fb.loChan[k] == chan - 1) {
+	if (kstart < 0) kstart = k;
+	kend = k;
+      }
+    }
+    if (kstart < 0) {
+      w->fb.bandStart[chan] = w->fb.klo;
+      w->fb.bandLen[chan] = 0;
+    } else {
+      w->fb.bandStart[chan] = kstart;
+      w->fb.bandLen[chan] = MFCC_SIMD_PAD(kend - kstart + 1);
+    }
+    len += w->fb.bandLen[chan];
+  }
+  w->fb.bandWtBuf = (float *)mymalloc((len + 1) * sizeof(float));
+  len = 0;
+  for(chan = 1; chan <= para->fbank_num; chan++) {
+    w->fb.bandWt[chan] = &(w->fb.bandWtBuf[len]);
+    for(k = 0; k < w->fb.bandLen[chan]; k++) {
+      i = w->fb.bandStart[chan] + k;
+      if (i > w->fb.khi) {
+	w->fb.bandWt[chan][k] = 0.0;
+      } else if (w->fb.loChan[i] == chan) {
+	w->fb.bandWt[chan][k] = w->fb.loWt[i];
+      } else if (w->fb.loChan[i] == chan - 1) {
+	w->fb.bandWt[chan][k] = 1.0 - w->fb.loWt[i];
+      } else {
+	w->fb.bandWt[chan][k] = 0.0;
+      }
+    }
+    len += w->fb.bandLen[chan];
+  }
+  /* spectrum buffer, padded and cleared so that reading the padded
+     region of the last band is safe */
+  len = nv2 + 1 + MFCC_SIMD_ALIGN;
+  w->fb.spec = (float *)mymalloc(len * sizeof(float));
+  for(k = 0; k < len; k++) w->fb.spec[k] = 0.0;
+
   /* Create workspace for fft */
   w->fb.Re = (float *)mymalloc((w->fb.fftN + 1) * sizeof(float));
   w->fb.Im = (float *)mymalloc((w->fb.fftN + 1) * sizeof(float));
@@ -313,6 +369,11 @@ FreeFBank(FBankInfo *fb)
   free(fb->cf);
   free(fb->loChan);
   free(fb->loWt);
+  free(fb->bandStart);
+  free(fb->bandLen);
+  free(fb->bandWt);
+  free(fb->bandWtBuf);
+  free(fb->spec);
   free(fb->Re);
   free(fb->Im);
 }
@@ -448,17 +509,21 @@ void FFT(float *xRe, float *xIm, int p, MFCCWork *w)
 
 
 /** 
- * Convert wave -> (spectral subtraction) -> mel-frequency filterbank
+ * Convert wave -> (spectral subtraction) -> mel-frequency filterbank,
+ * storing the result to the given buffer.
  * 
  * @param wave [in] waveform data in the current frame
+ * @param fbank [out] buffer to store filterbank [1..fbank_num]
  * @param w [i/o] MFCC calculation work area
  * @param para [in] configuration parameters
  */
-void
-MakeFBank(float *wave, MFCCWork *w, Value *para)
+static void
+make_fbank(float *wave, float *fbank, MFCCWork *w, Value *para)
 {
-  int k, bin, i;
-  double Re, Im, A, P, NP, H, temp;
+  int k, bin;
+  double Re, Im, P, NP, H;
+  float fRe, fIm, temp;
+  float *spec;
 
   for(k = 1; k <= para->framesize; k++){
     w->fb.Re[k - 1] = wave[k];  w->fb.Im[k - 1] = 0.0;  /* copy to workspace */
@@ -486,40 +551,48 @@ MakeFBank(float *wave, MFCCWork *w, Value *para)
     }
   }
 
-  /* Fill filterbank channels */ 
-  for(i = 1; i <= para->fbank_num; i++)
-    w->fbank[i] = 0.0;
-  
+  /* power (or magnitude) spectrum within the cut-off */
+  spec = w->fb.spec;
   if (para->usepower) {
     for(k = w->fb.klo; k <= w->fb.khi; k++){
-      Re = w->fb.Re[k-1]; Im = w->fb.Im[k-1];
-      A = Re * Re + Im * Im;
-      bin = w->fb.loChan[k];
-      Re = w->fb.loWt[k] * A;
-      if(bin > 0) w->fbank[bin] += Re;
-      if(bin < para->fbank_num) w->fbank[bin + 1] += A - Re;
+      fRe = w->fb.Re[k-1]; fIm = w->fb.Im[k-1];
+      spec[k] = fRe * fRe + fIm * fIm;
     }
   } else {
     for(k = w->fb.klo; k <= w->fb.khi; k++){
-      Re = w->fb.Re[k-1]; Im = w->fb.Im[k-1];
-      A = sqrt(Re * Re + Im * Im);
-      bin = w->fb.loChan[k];
-      Re = w->fb.loWt[k] * A;
-      if(bin > 0) w->fbank[bin] += Re;
-      if(bin < para->fbank_num) w->fbank[bin + 1] += A - Re;
+      fRe = w->fb.Re[k-1]; fIm = w->fb.Im[k-1];
+      spec[k] = sqrt(fRe * fRe + fIm * fIm);
     }
   }
 
+  /* Fill filterbank channels by the banded filterbank matrix */ 
+  for(bin = 1; bin <= para->fbank_num; bin++) {
+    fbank[bin] = mfcc_dot(w->fb.bandWt[bin], &(spec[w->fb.bandStart[bin]]), w->fb.bandLen[bin]);
+  }
+
   if (w->log_fbank) {
     /* Take logs */
     for(bin = 1; bin <= para->fbank_num; bin++){ 
-      temp = w->fbank[bin];
+      temp = fbank[bin];
       if(temp < 1.0) temp = 1.0;
-      w->fbank[bin] = log(temp);  
+      fbank[bin] = log(temp);  
     }
   }
 }
 
+/** 
+ * Convert wave -> (spectral subtraction) -> mel-frequency filterbank
+ * 
+ * @param wave [in] waveform data in the current frame
+ * @param w [i/o] MFCC calculation work area
+ * @param para [in] configuration parameters
+ */
+void
+MakeFBank(float *wave, MFCCWork *w, Value *para)
+{
+  make_fbank(wave, w->fbank, w, para);
+}
+
 /** 
  * Calculate 0'th cepstral coefficient.
  * 
@@ -549,14 +622,13 @@ float CalcC0(MFCCWork *w, Value *para)
 void MakeMFCC(float *mfcc, Value *para, MFCCWork *w)
 {
 #ifdef MFCC_SINCOS_TABLE
-  int i, j, k;
-  k = 0;
-  /* Take DCT */
+  int i;
+  float *row;
+  /* Take DCT by the DCT matrix (already scaled by sqrt2var) */
+  row = w->costbl_makemfcc;
   for(i = 0; i < para->mfcc_dim; i++){
-    mfcc[i] = 0.0;
-    for(j = 1; j <= para->fbank_num; j++)
-      mfcc[i] += w->fbank[j] * w->costbl_makemfcc[k++];
-    mfcc[i] *= w->sqrt2var;
+    mfcc[i] = mfcc_dot(row, &(w->fbank[1]), w->fbank_stride);
+    row += w->fbank_stride;
   }
 #else
   int i, j;
@@ -626,6 +698,7 @@ WMP_work_new(Value *para)
   /* newly allocated area should be cleared */
   w = (MFCCWork *)mymalloc(sizeof(MFCCWork));
   memset(w, 0, sizeof(MFCCWork));
+  w->thread_num = 1;
 
   /* set switches by the parameter type */
   switch(para->basetype) {
@@ -647,8 +720,12 @@ WMP_work_new(Value *para)
     return NULL;
   }
 
+  /* select SIMD kernels */
+  mfcc_simd_init();
+
   /* set filterbank information */
   if (InitFBank(w, para) == FALSE) return NULL;
+  w->fbank_stride = MFCC_SIMD_PAD(para->fbank_num);
 
 #ifdef MFCC_SINCOS_TABLE
   /* prepare tables */
@@ -661,7 +738,12 @@ WMP_work_new(Value *para)
 #endif
 
   /* prepare some buffers */
-  w->fbank = (double *)mymalloc((para->fbank_num+1)*sizeof(double));
+  /* filterbank buffers are zero padded for the SIMD inner product */
+  w->fbank = (float *)mymalloc((w->fbank_stride + 1) * sizeof(float));
+  memset(w->fbank, 0, (w->fbank_stride + 1) * sizeof(float));
+  w->fbank_block = (float *)mymalloc((w->fbank_stride + 1) * MFCC_BATCH_FRAMES * sizeof(float));
+  memset(w->fbank_block, 0, (w->fbank_stride + 1) * MFCC_BATCH_FRAMES * sizeof(float));
+  w->energy_block = (float *)mymalloc(MFCC_BATCH_FRAMES * sizeof(float));
   w->bf = (float *)mymalloc(w->fb.fftN * sizeof(float));
   w->bflen = w->fb.fftN;
 
@@ -669,38 +751,92 @@ WMP_work_new(Value *para)
 }
 
 /** 
- * Calculate MFCC and log energy for one frame.  Perform spectral subtraction
- * if @a ssbuf is specified.
+ * Apply pre-processing to a frame of waveform and compute its filterbank.
+ * DC removal, pre-emphasis and windowing are done in one pass reading
+ * from @a frame and writing to the work area, so the frame can be a
+ * window on a longer sample buffer.  @a frame may also point to
+ * &(w->bf[1]), in which case the work area is processed in place.
  * 
  * @param w [i/o] MFCC calculation work area
- * @param mfcc [out] buffer to hold the resulting MFCC vector
+ * @param frame [in] waveform of the frame [0..framesize-1]
+ * @param fbank [out] buffer to store filterbank [1..fbank_num]
  * @param para [in] configuration parameters
+ * 
+ * @return the log energy of the frame, or 0.0 if not required.
  */
-void
-WMP_calc(MFCCWork *w, float *mfcc, Value *para)
+static float
+wmp_frame_fbank(MFCCWork *w, float *frame, float *fbank, Value *para)
 {
   float energy = 0.0;
-  float c0 = 0.0;
-  int p;
+  float mean, x, x1;
+  double raw_E;
+  float *bf;
+  int i, len;
 
+  len = para->framesize;
+  bf = &(w->bf[1]);
+
+  mean = 0.0;
   if (para->zmeanframe) {
-    ZMeanFrame(w->bf, para->framesize);
+    for(i = 0; i < len; i++) mean += frame[i];
+    mean /= len;
   }
 
   if (para->energy && para->raw_e) {
     /* calculate log raw energy */
-    energy = CalcLogRawE(w->bf, para->framesize);
+    raw_E = 0.0;
+    for(i = 0; i < len; i++) {
+      x = frame[i] - mean;
+      raw_E += x * x;
+    }
+    energy = (float)log(raw_E);
+  }
+  /* pre-emphasize and hamming window, backward to allow in-place */
+  x = frame[len - 1] - mean;
+  for(i = len - 1; i >= 1; i--) {
+    x1 = frame[i - 1] - mean;
+    x -= x1 * para->preEmph;
+#ifdef MFCC_SINCOS_TABLE
+    x *= w->costbl_hamming[i];
+#endif
+    bf[i] = x;
+    x = x1;
   }
-  /* pre-emphasize */
-  PreEmphasise(w->bf, para->framesize, para->preEmph);
-  /* hamming window */
-  Hamming(w->bf, para->framesize, w);
+  x *= 1.0 - para->preEmph;
+#ifdef MFCC_SINCOS_TABLE
+  x *= w->costbl_hamming[0];
+#endif
+  bf[0] = x;
+#ifndef MFCC_SINCOS_TABLE
+  Hamming(w->bf, len, w);
+#endif
   if (para->energy && ! para->raw_e) {
     /* calculate log energy */
-    energy = CalcLogRawE(w->bf, para->framesize);
+    energy = CalcLogRawE(w->bf, len);
   }
   /* filterbank */
-  MakeFBank(w->bf, w, para);
+  make_fbank(w->bf, fbank, w, para);
+
+  return energy;
+}
+
+/** 
+ * Calculate MFCC and log energy for one frame.
+ * 
+ * @param w [i/o] MFCC calculation work area
+ * @param frame [in] waveform of the frame [0..framesize-1]
+ * @param mfcc [out] buffer to hold the resulting MFCC vector
+ * @param para [in] configuration parameters
+ */
+void
+WMP_calc_frame(MFCCWork *w, float *frame, float *mfcc, Value *para)
+{
+  float energy = 0.0;
+  float c0 = 0.0;
+  int p;
+
+  /* pre-processing and filterbank */
+  energy = wmp_frame_fbank(w, frame, w->fbank, para);
 
   if (w->fbank_only) {
     /* return the filterbank */
@@ -722,6 +858,156 @@ WMP_calc(MFCCWork *w, float *mfcc, Value *para)
   if (para->energy) mfcc[p++] = energy;
 }
 
+/** 
+ * Calculate MFCC and log energy for one frame stored in the work area
+ * (w->bf[1..framesize]).
+ * 
+ * @param w [i/o] MFCC calculation work area
+ * @param mfcc [out] buffer to hold the resulting MFCC vector
+ * @param para [in] configuration parameters
+ */
+void
+WMP_calc(MFCCWork *w, float *mfcc, Value *para)
+{
+  WMP_calc_frame(w, &(w->bf[1]), mfcc, para);
+}
+
+/** 
+ * Calculate MFCC and log energy for successive frames in a waveform
+ * buffer.  The frames are processed by blocks of MFCC_BATCH_FRAMES:
+ * filterbanks of all frames in a block are computed first, then the
+ * DCT is applied to four frames at a time to share the loads of the
+ * DCT matrix.  The result is the same as calling WMP_calc() for each
+ * frame.
+ * 
+ * @param w [i/o] MFCC calculation work area
+ * @param wave [in] waveform data, frame @a t begins at sample t * frameshift
+ * @param t_begin [in] first frame to compute
+ * @param num [in] number of frames to compute
+ * @param mfcc [out] buffer to hold the resulting MFCC vectors [t][0..]
+ * @param para [in] configuration parameters
+ */
+void
+WMP_calc_batch(MFCCWork *w, SP16 *wave, int t_begin, int num, float **mfcc, Value *para)
+{
+  int t, n, i, j, p, stride;
+  float *row, *fb;
+  float c0;
+  SP16 *s;
+#ifdef MFCC_SINCOS_TABLE
+  float *fb4[4];
+  float out[4];
+  int k;
+#endif
+
+  stride = w->fbank_stride + 1;
+
+  for (t = t_begin; t < t_begin + num; t += n) {
+    n = t_begin + num - t;
+    if (n > MFCC_BATCH_FRAMES) n = MFCC_BATCH_FRAMES;
+
+    /* filterbank of each frame in this block */
+    for (j = 0; j < n; j++) {
+      s = &(wave[(t + j) * para->frameshift]);
+      for (i = 0; i < para->framesize; i++) w->bf[i + 1] = (float)s[i];
+      w->energy_block[j] = wmp_frame_fbank(w, &(w->bf[1]), &(w->fbank_block[j * stride]), para);
+    }
+
+    if (w->fbank_only) {
+      /* return the filterbank */
+      for (j = 0; j < n; j++) {
+	fb = &(w->fbank_block[j * stride]);
+	for (p = 0; p < para->mfcc_dim; p++) mfcc[t + j][p] = fb[p + 1];
+      }
+      continue;
+    }
+
+    /* MFCC */
+#ifdef MFCC_SINCOS_TABLE
+    for (j = 0; j + 3 < n; j += 4) {
+      for (k = 0; k < 4; k++) fb4[k] = &(w->fbank_block[(j + k) * stride + 1]);
+      row = w->costbl_makemfcc;
+      for (i = 0; i < para->mfcc_dim; i++) {
+	mfcc_dot4(row, fb4, w->fbank_stride, out);
+	for (k = 0; k < 4; k++) mfcc[t + j + k][i] = out[k];
+	row += w->fbank_stride;
+      }
+    }
+    for (; j < n; j++) {
+      fb = &(w->fbank_block[j * stride + 1]);
+      row = w->costbl_makemfcc;
+      for (i = 0; i < para->mfcc_dim; i++) {
+	mfcc[t + j][i] = mfcc_dot(row, fb, w->fbank_stride);
+	row += w->fbank_stride;
+      }
+    }
+#else
+    for (j = 0; j < n; j++) {
+      memcpy(w->fbank, &(w->fbank_block[j * stride]), sizeof(float) * stride);
+      MakeMFCC(mfcc[t + j], para, w);
+    }
+#endif
+
+    for (j = 0; j < n; j++) {
+      /* weight cepstrum */
+      WeightCepstrum(mfcc[t + j], para, w);
+      /* set energy to mfcc */
+      p = para->mfcc_dim;
+      if (para->c0) {
+	/* 0'th cepstral parameter */
+	fb = &(w->fbank_block[j * stride]);
+	c0 = 0.0;
+	for (i = 1; i <= para->fbank_num; i++) c0 += fb[i];
+	mfcc[t + j][p++] = c0 * w->sqrt2var;
+      }
+      if (para->energy) mfcc[t + j][p++] = w->energy_block[j];
+    }
+  }
+}
+
+/** 
+ * Set number of threads to compute features on buffered input by
+ * Wav2MFCC().  A separate work area will be allocated for each
+ * additional thread.
+ * 
+ * @param w [i/o] MFCC calculation work area
+ * @param para [in] configuration parameters
+ * @param num [in] number of threads, 1 to disable multi-threading
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+WMP_work_set_threads(MFCCWork *w, Value *para, int num)
+{
+  int i;
+
+  if (w->thread_wrk) {
+    for (i = 1; i < w->thread_num; i++) WMP_free(w->thread_wrk[i]);
+    free(w->thread_wrk);
+    w->thread_wrk = NULL;
+  }
+  w->thread_num = 1;
+  if (num <= 1) return TRUE;
+
+#ifndef _OPENMP
+  jlog("Warning: mfcc-core: compiled without OpenMP, multi-threaded feature extraction disabled\n");
+  return TRUE;
+#else
+  w->thread_wrk = (MFCCWork **)mymalloc(sizeof(MFCCWork *) * num);
+  w->thread_wrk[0] = w;
+  for (i = 1; i < num; i++) {
+    if ((w->thread_wrk[i] = WMP_work_new(para)) == NULL) {
+      for (i--; i > 0; i--) WMP_free(w->thread_wrk[i]);
+      free(w->thread_wrk);
+      w->thread_wrk = NULL;
+      return FALSE;
+    }
+  }
+  w->thread_num = num;
+  return TRUE;
+#endif
+}
+
 /** 
  * Free all work area for MFCC computation
  * 
@@ -730,11 +1016,22 @@ WMP_calc(MFCCWork *w, float *mfcc, Value *para)
 void
 WMP_free(MFCCWork *w)
 {
+  int i;
+
+  if (w->thread_wrk) {
+    for (i = 1; i < w->thread_num; i++) WMP_free(w->thread_wrk[i]);
+    free(w->thread_wrk);
+    w->thread_wrk = NULL;
+  }
   if (w->fbank) {
     FreeFBank(&(w->fb));
     free(w->fbank);
+    free(w->fbank_block);
+    free(w->energy_block);
     free(w->bf);
     w->fbank = NULL;
+    w->fbank_block = NULL;
+    w->energy_block = NULL;
     w->bf = NULL;
   }
 #ifdef MFCC_SINCOS_TABLE
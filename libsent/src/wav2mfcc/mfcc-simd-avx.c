@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/mfcc.h>
+
+#ifdef HAS_SIMD_AVX
+#include <immintrin.h>
+#endif
+
+/* inner product of two vectors, len should be multiple of 8 */
+float
+mfcc_dot_avx(float *a, float *b, int len)
+{
+#ifdef HAS_SIMD_AVX
+  float fstore[8];
+  __m256 x = _mm256_setzero_ps();
+  int j;
+
+  for (j = 0; j < len; j += 8) {
+    __m256 va = _mm256_loadu_ps(a + j);
+    __m256 vb = _mm256_loadu_ps(b + j);
+    x = _mm256_add_ps(x, _mm256_mul_ps(va, vb));
+  }
+  _mm256_storeu_ps(fstore, x);
+  return(fstore[0] + fstore[1] + fstore[2] + fstore[3] + fstore[4] + fstore[5] + fstore[6] + fstore[7]);
+#else
+  return 0.0;
+#endif	/* HAS_SIMD_AVX */
+}
+
+/* inner products of a vector against 4 vectors at once, len should be multiple of 8 */
+void
+mfcc_dot4_avx(float *a, float **b, int len, float *out)
+{
+#ifdef HAS_SIMD_AVX
+  float fstore[8];
+  float *b1, *b2, *b3, *b4;
+  __m256 x1 = _mm256_setzero_ps();
+  __m256 x2 = _mm256_setzero_ps();
+  __m256 x3 = _mm256_setzero_ps();
+  __m256 x4 = _mm256_setzero_ps();
+  int j;
+
+  b1 = b[0]; b2 = b[1]; b3 = b[2]; b4 = b[3];
+  for (j = 0; j < len; j += 8) {
+    __m256 va = _mm256_loadu_ps(a + j);
+    x1 = _mm256_add_ps(x1, _mm256_mul_ps(va, _mm256_loadu_ps(b1 + j)));
+    x2 = _mm256_add_ps(x2, _mm256_mul_ps(va, _mm256_loadu_ps(b2 + j)));
+    x3 = _mm256_add_ps(x3, _mm256_mul_ps(va, _mm256_loadu_ps(b3 + j)));
+    x4 = _mm256_add_ps(x4, _mm256_mul_ps(va, _mm256_loadu_ps(b4 + j)));
+  }
+  _mm256_storeu_ps(fstore, x1);
+  out[0] = fstore[0] + fstore[1] + fstore[2] + fstore[3] + fstore[4] + fstore[5] + fstore[6] + fstore[7];
+  _mm256_storeu_ps(fstore, x2);
+  out[1] = fstore[0] + fstore[1] + fstore[2] + fstore[3] + fstore[4] + fstore[5] + fstore[6] + fstore[7];
+  _mm256_storeu_ps(fstore, x3);
+  out[2] = fstore[0] + fstore[1] + fstore[2] + fstore[3] + fstore[4] + fstore[5] + fstore[6] + fstore[7];
+  _mm256_storeu_ps(fstore, x4);
+  out[3] = fstore[0] + fstore[1] + fstore[2] + fstore[3] + fstore[4] + fstore[5] + fstore[6] + fstore[7];
+#endif	/* HAS_SIMD_AVX */
+}
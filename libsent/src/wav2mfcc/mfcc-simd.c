@@ -0,0 +1,116 @@
+/**
+ * @file   mfcc-simd.c
+ *
+ * <JA>
+ * @brief  MFCC 計算のための SIMD 演算
+ *
+ * フィルタバンク行列およびDCT行列とベクトルとの内積を，CPUで利用可能な
+ * SIMD 命令 (AVX/SSE) で計算する関数を振り分けます．SIMDが利用できない
+ * 場合は通常の計算を行います．
+ * </JA>
+ *
+ * <EN>
+ * @brief  SIMD kernel selection for MFCC computation
+ *
+ * Inner products against the banded filterbank matrix and the DCT matrix
+ * are computed by the SIMD instruction (AVX/SSE) available on the running
+ * CPU.  Falls back to plain C loops when no SIMD is available.
+ * </EN>
+ */
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/mfcc.h>
+#include <sent/hmm_calc.h>
+
+/// SIMD type to be used for MFCC computation, -1 when not checked yet
+static int mfcc_simd = -1;
+
+/**
+ * Determine which SIMD kernel to use for MFCC computation.
+ *
+ */
+void
+mfcc_simd_init()
+{
+  if (mfcc_simd >= 0) return;
+  mfcc_simd = check_avail_simd();
+}
+
+/**
+ * Compute inner product of two vectors.
+ *
+ * @param a [in] vector
+ * @param b [in] vector
+ * @param len [in] length, should be a multiple of MFCC_SIMD_ALIGN
+ *
+ * @return the inner product.
+ */
+float
+mfcc_dot(float *a, float *b, int len)
+{
+  float x;
+  int j;
+
+  switch(mfcc_simd) {
+#ifdef HAS_SIMD_AVX
+  case USE_SIMD_FMA:
+  case USE_SIMD_AVX:
+    return(mfcc_dot_avx(a, b, len));
+#endif
+#ifdef HAS_SIMD_SSE
+  case USE_SIMD_SSE:
+    return(mfcc_dot_sse(a, b, len));
+#endif
+  default:
+    break;
+  }
+
+  x = 0.0;
+  for (j = 0; j < len; j++) x += a[j] * b[j];
+  return(x);
+}
+
+/**
+ * Compute inner products of a vector against four vectors, used for
+ * computing the DCT of four frames at a time.
+ *
+ * @param a [in] vector
+ * @param b [in] array of four vectors
+ * @param len [in] length, should be a multiple of MFCC_SIMD_ALIGN
+ * @param out [out] the four inner products
+ */
+void
+mfcc_dot4(float *a, float **b, int len, float *out)
+{
+  int j;
+
+  switch(mfcc_simd) {
+#ifdef HAS_SIMD_AVX
+  case USE_SIMD_FMA:
+  case USE_SIMD_AVX:
+    mfcc_dot4_avx(a, b, len, out);
+    return;
+#endif
+#ifdef HAS_SIMD_SSE
+  case USE_SIMD_SSE:
+    mfcc_dot4_sse(a, b, len, out);
+    return;
+#endif
+  default:
+    break;
+  }
+
+  out[0] = out[1] = out[2] = out[3] = 0.0;
+  for (j = 0; j < len; j++) {
+    out[0] += a[j] * b[0][j];
+    out[1] += a[j] * b[1][j];
+    out[2] += a[j] * b[2][j];
+    out[3] += a[j] * b[3][j];
+  }
+}
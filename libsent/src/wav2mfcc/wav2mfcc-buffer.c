@@ -40,10 +40,19 @@
 
 #include <sent/stddefs.h>
 #include <sent/mfcc.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /** 
  * Convert wave data to MFCC.  Also does spectral subtraction
  * if @a ssbuf specified.
+ *
+ * When multiple threads are set to the work area by
+ * WMP_work_set_threads(), the frames are split into contiguous chunks
+ * and each chunk is computed by a thread with its own work area.
+ * Delta, acceleration and normalization are applied after all frames
+ * are computed.
  * 
  * @param wave [in] waveform data
  * @param mfcc [out] buffer to store the resulting MFCC parameter vector [t][0..veclen-1], should be already allocated
@@ -56,9 +65,8 @@
 int
 Wav2MFCC(SP16 *wave, float **mfcc, Value *para, int nSamples, MFCCWork *w, CMNWork *c)
 {
-  int i, k, t;
-  int end = 0, start = 1;
   int frame_num;                    /* Number of samples in output file */
+  int t;
 
   /* set noise spectrum if any */
   if (w->ssbuf != NULL) {
@@ -71,18 +79,31 @@ Wav2MFCC(SP16 *wave, float **mfcc, Value *para, int nSamples, MFCCWork *w, CMNWo
 
   frame_num = (int)((nSamples - para->framesize) / para->frameshift) + 1;
   
-  for(t = 0; t < frame_num; t++){
-    if(end != 0) start = end - (para->framesize - para->frameshift) - 1;
-
-    k = 1;
-    for(i = start; i <= start + para->framesize; i++){
-      w->bf[k] = (float)wave[i - 1];  k++;
+  /* Calculate base MFCC coefficients */
+#ifdef _OPENMP
+  if (w->thread_num > 1 && frame_num >= w->thread_num * MFCC_BATCH_FRAMES) {
+#pragma omp parallel num_threads(w->thread_num)
+    {
+      int id = omp_get_thread_num();
+      int n = omp_get_num_threads();
+      int begin = (int)((long)frame_num * id / n);
+      int end = (int)((long)frame_num * (id + 1) / n);
+      MFCCWork *tw = w->thread_wrk[id];
+      
+      if (tw != w) {
+	tw->ssbuf = w->ssbuf;
+	tw->ssbuflen = w->ssbuflen;
+	tw->ss_alpha = w->ss_alpha;
+	tw->ss_floor = w->ss_floor;
+      }
+      WMP_calc_batch(tw, wave, begin, end - begin, mfcc, para);
     }
-    end = i;
-    
-    /* Calculate base MFCC coefficients */
-    WMP_calc(w, mfcc[t], para);
+  } else {
+    WMP_calc_batch(w, wave, 0, frame_num, mfcc, para);
   }
+#else
+  WMP_calc_batch(w, wave, 0, frame_num, mfcc, para);
+#endif
   
   /* Normalise Log Energy */
   if (para->energy && para->enormal) NormaliseLogE(mfcc, frame_num, para);
@@ -94,7 +115,11 @@ Wav2MFCC(SP16 *wave, float **mfcc, Value *para, int nSamples, MFCCWork *w, CMNWo
   if (para->acc) Accel(mfcc, frame_num, para);
 
   /* Cepstrum Mean and/or Variance Normalization */
-  if (para->cmn && ! para->cvn) CMN(mfcc, frame_num, para->mfcc_dim + (para->c0 ? 1 : 0), c);
+  if (c != NULL && c->window > 0) {
+    /* sliding window, the same as on-line processing */
+    CMN_realtime_prepare(c);
+    for (t = 0; t < frame_num; t++) CMN_realtime(c, mfcc[t]);
+  } else if (para->cmn && ! para->cvn) CMN(mfcc, frame_num, para->mfcc_dim + (para->c0 ? 1 : 0), c);
   else if (para->cmn || para->cvn) MVN(mfcc, frame_num, para, c);
 
   return(frame_num);
@@ -133,7 +158,8 @@ void NormaliseLogE(float **mfcc, int frame_num, Value *para)
 }
 
 /** 
- * Calculate delta coefficients
+ * Calculate delta coefficients.  The coefficients of a frame are
+ * computed at once as contiguous vectors.
  * 
  * @param c [i/o] MFCC vectors, in which the delta coeff. will be appended.
  * @param frame [in] number of frames
@@ -142,36 +168,48 @@ void NormaliseLogE(float **mfcc, int frame_num, Value *para)
 void Delta(float **c, int frame, Value *para)
 {
   int theta, t, n, B = 0;
-  float A1, A2, sum;
+  int len, dst;
+  float *A1, *A2, *sum, *buf;
 
   for(theta = 1; theta <= para->delWin; theta++)
     B += theta * theta;
 
-  for(n = para->baselen - 1; n >=0; n--){
-    for(t = 0; t < frame; t++){
-      sum = 0;
-      for(theta = 1; theta <= para->delWin; theta++){
-	/* Replicate the first or last vector */
-	/* at the beginning and end of speech */
-	if (t - theta < 0) A1 = c[0][n];
-	else A1 = c[t - theta][n];
-	if (t + theta >= frame) A2 = c[frame - 1][n];
-	else A2 = c[t + theta][n];
-	sum += theta * (A2 - A1);
-      }
-      sum /= (2.0 * B);
-      if (para->absesup) {
-	c[t][para->baselen + n - 1] = sum;
-      } else {
-	c[t][para->baselen + n] = sum;
-      }
+  len = para->baselen;
+  dst = para->absesup ? len - 1 : len;
+  sum = (float *)mymalloc(sizeof(float) * len);
+  /* when absolute energy is suppressed, the delta of the first
+     coefficient overwrites the energy of the frame, which is still
+     referred by the following frames.  Hold all results in a buffer
+     and store them at last */
+  buf = para->absesup ? (float *)mymalloc(sizeof(float) * len * frame) : NULL;
+
+  for(t = 0; t < frame; t++){
+    for(n = 0; n < len; n++) sum[n] = 0.0;
+    for(theta = 1; theta <= para->delWin; theta++){
+      /* Replicate the first or last vector */
+      /* at the beginning and end of speech */
+      A1 = (t - theta < 0) ? c[0] : c[t - theta];
+      A2 = (t + theta >= frame) ? c[frame - 1] : c[t + theta];
+      for(n = 0; n < len; n++) sum[n] += theta * (A2[n] - A1[n]);
     }
+    if (buf) {
+      for(n = 0; n < len; n++) buf[t * len + n] = sum[n] / (2.0 * B);
+    } else {
+      for(n = 0; n < len; n++) c[t][dst + n] = sum[n] / (2.0 * B);
+    }
+  }
+
+  if (buf) {
+    for(t = 0; t < frame; t++) memcpy(&(c[t][dst]), &(buf[t * len]), sizeof(float) * len);
+    free(buf);
   }
+  free(sum);
 }
 
 
 /** 
- * Calculate acceleration coefficients.
+ * Calculate acceleration coefficients.  The coefficients of a frame are
+ * computed at once as contiguous vectors.
  * 
  * @param c [i/o] MFCC vectors, in which the delta coeff. will be appended.
  * @param frame [in] number of frames
@@ -180,32 +218,30 @@ void Delta(float **c, int frame, Value *para)
 void Accel(float **c, int frame, Value *para)
 {
   int theta, t, n, B = 0;
-  int src, dst;
-  float A1, A2, sum;
+  int len, src, dst;
+  float *A1, *A2, *sum;
 
   for(theta = 1; theta <= para->accWin; theta++)
     B += theta * theta;
 
+  len = para->baselen;
+  src = para->absesup ? len - 1 : len;
+  dst = src + len;
+  sum = (float *)mymalloc(sizeof(float) * len);
+
   for(t = 0; t < frame; t++){
-    src = para->baselen * 2 - 1;
-    if (para->absesup) src--;
-    dst = src + para->baselen;
-    for(n = 0; n < para->baselen; n++){
-      sum = 0;
-      for(theta = 1; theta <= para->accWin; theta++){
-	/* Replicate the first or last vector */
-	/* at the beginning and end of speech */
-	if (t - theta < 0) A1 = c[0][src];
-	else A1 = c[t - theta][src];
-	if (t + theta >= frame) A2 = c[frame - 1][src];
-	else A2 = c[t + theta][src];
-	sum += theta * (A2 - A1);
-      }
-      c[t][dst] = sum / (2 * B);
-      src--;
-      dst--;
+    for(n = 0; n < len; n++) sum[n] = 0.0;
+    for(theta = 1; theta <= para->accWin; theta++){
+      /* Replicate the first or last vector */
+      /* at the beginning and end of speech */
+      A1 = (t - theta < 0) ? &(c[0][src]) : &(c[t - theta][src]);
+      A2 = (t + theta >= frame) ? &(c[frame - 1][src]) : &(c[t + theta][src]);
+      for(n = 0; n < len; n++) sum[n] += theta * (A2[n] - A1[n]);
     }
+    for(n = 0; n < len; n++) c[t][dst + n] = sum[n] / (2 * B);
   }
+
+  free(sum);
 }
 
 /** 
@@ -219,27 +255,30 @@ void Accel(float **c, int frame, Value *para)
 void CMN(float **mfcc, int frame_num, int dim, CMNWork *c)
 {
   int i, t;
-  float *mfcc_ave, *sum;
+  float *mfcc_ave, *sum, *v;
 
   if (c != NULL && c->cmean_init_set) {
     /* has initial param, use it permanently */
     for(t = 0; t < frame_num; t++){
+      v = mfcc[t];
       for(i = 0; i < dim; i++)
-	mfcc[t][i] -= c->cmean_init[i];
+	v[i] -= c->cmean_init[i];
     }
   } else {
     /* compute from current input */
     mfcc_ave = (float *)mycalloc(dim, sizeof(float));
     sum = (float *)mycalloc(dim, sizeof(float));
-    for(i = 0; i < dim; i++){
-      sum[i] = 0.0;
-      for(t = 0; t < frame_num; t++)
-	sum[i] += mfcc[t][i];
-      mfcc_ave[i] = sum[i] / frame_num;
+    for(i = 0; i < dim; i++) sum[i] = 0.0;
+    for(t = 0; t < frame_num; t++){
+      v = mfcc[t];
+      for(i = 0; i < dim; i++)
+	sum[i] += v[i];
     }
+    for(i = 0; i < dim; i++) mfcc_ave[i] = sum[i] / frame_num;
     for(t = 0; t < frame_num; t++){
+      v = mfcc[t];
       for(i = 0; i < dim; i++)
-	mfcc[t][i] = mfcc[t][i] - mfcc_ave[i];
+	v[i] = v[i] - mfcc_ave[i];
     }
     free(sum);
     free(mfcc_ave);
@@ -256,7 +295,8 @@ void CMN(float **mfcc, int frame_num, int dim, CMNWork *c)
 void MVN(float **mfcc, int frame_num, Value *para, CMNWork *c)
 {
   int i, t;
-  float *mfcc_mean, *mfcc_sd;
+  float *mfcc_mean, *mfcc_sd, *v;
+  double *sd_init;
   float x;
   int basedim;
   boolean static_cvn_only_flag;
@@ -269,18 +309,27 @@ void MVN(float **mfcc, int frame_num, Value *para, CMNWork *c)
     static_cvn_only_flag = FALSE;
   }
 
+  /* standard deviation from the initial variance */
+  sd_init = NULL;
+  if (c != NULL && c->cmean_init_set && para->cvn) {
+    sd_init = (double *)mymalloc(sizeof(double) * para->veclen);
+    for(i = 0; i < para->veclen; i++) sd_init[i] = sqrt(c->cvar_init[i]);
+  }
+
   if (c != NULL && c->cmean_init_set && static_cvn_only_flag == FALSE) {
     /* has initial param, use it permanently */
     for(t = 0; t < frame_num; t++){
+      v = mfcc[t];
       if (para->cmn) {
 	/* mean normalization (base MFCC only) */
-	for(i = 0; i < basedim; i++) mfcc[t][i] -= c->cmean_init[i];
+	for(i = 0; i < basedim; i++) v[i] -= c->cmean_init[i];
       }
       if (para->cvn) {
 	/* variance normalization (full MFCC) */
-	for(i = 0; i < para->veclen; i++) mfcc[t][i] /= sqrt(c->cvar_init[i]);
+	for(i = 0; i < para->veclen; i++) v[i] /= sd_init[i];
       }
     }
+    if (sd_init) free(sd_init);
     return;
   }
 
@@ -289,39 +338,42 @@ void MVN(float **mfcc, int frame_num, Value *para, CMNWork *c)
   if (para->cvn && static_cvn_only_flag == FALSE) mfcc_sd = (float *)mycalloc(para->veclen, sizeof(float));
 
   /* get mean */
-  for(i = 0; i < para->veclen; i++){
-    mfcc_mean[i] = 0.0;
-    for(t = 0; t < frame_num; t++)
-      mfcc_mean[i] += mfcc[t][i];
-    mfcc_mean[i] /= (float)frame_num;
+  for(i = 0; i < para->veclen; i++) mfcc_mean[i] = 0.0;
+  for(t = 0; t < frame_num; t++) {
+    v = mfcc[t];
+    for(i = 0; i < para->veclen; i++) mfcc_mean[i] += v[i];
   }
+  for(i = 0; i < para->veclen; i++) mfcc_mean[i] /= (float)frame_num;
   if (para->cvn && static_cvn_only_flag == FALSE) {
     /* get standard deviation */
-    for(i = 0; i < para->veclen; i++){
-      mfcc_sd[i] = 0.0;
-      for(t = 0; t < frame_num; t++) {
-	x = mfcc[t][i] - mfcc_mean[i];
+    for(i = 0; i < para->veclen; i++) mfcc_sd[i] = 0.0;
+    for(t = 0; t < frame_num; t++) {
+      v = mfcc[t];
+      for(i = 0; i < para->veclen; i++) {
+	x = v[i] - mfcc_mean[i];
 	mfcc_sd[i] += x * x;
       }
-      mfcc_sd[i] = sqrt(mfcc_sd[i] / (float)frame_num);
     }
+    for(i = 0; i < para->veclen; i++) mfcc_sd[i] = sqrt(mfcc_sd[i] / (float)frame_num);
   }
   for(t = 0; t < frame_num; t++){
+    v = mfcc[t];
     if (para->cmn) {
       /* mean normalization (base MFCC only) */
-      for(i = 0; i < basedim; i++) mfcc[t][i] -= mfcc_mean[i];
+      for(i = 0; i < basedim; i++) v[i] -= mfcc_mean[i];
     }
     if (para->cvn) {
       if (static_cvn_only_flag == TRUE) {
 	/* variance normalization (full MFCC, static) */
-	for(i = 0; i < para->veclen; i++) mfcc[t][i] /= sqrt(c->cvar_init[i]);
+	for(i = 0; i < para->veclen; i++) v[i] /= sd_init[i];
       } else {
 	/* variance normalization (full MFCC) */
-	for(i = 0; i < para->veclen; i++) mfcc[t][i] /= mfcc_sd[i];
+	for(i = 0; i < para->veclen; i++) v[i] /= mfcc_sd[i];
       } 
     }
   }
 
   if (para->cvn && static_cvn_only_flag == FALSE) free(mfcc_sd);
+  if (sd_init) free(sd_init);
   free(mfcc_mean);
 }
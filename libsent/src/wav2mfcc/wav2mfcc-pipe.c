@@ -285,9 +285,31 @@ CMN_realtime_new(Value *para, float weight, boolean map)
   }
   c->all.framenum = 0;
 
+  c->window = 0;
+  c->whist = NULL;
+  c->wsum = c->wsqr = NULL;
+
   return c;
 }
 
+/**
+ * Enable sliding-window CMN/CVN.  The mean and variance are computed
+ * from the last @a frames frames and updated in constant time per
+ * frame.  While the window is not filled yet, the initial mean (and
+ * variance) is mixed with a weight decreasing as the window fills.
+ * 
+ * @param c [i/o] CMN calculation work area
+ * @param frames [in] window length in frames
+ */
+void
+CMN_realtime_set_window(CMNWork *c, int frames)
+{
+  c->window = frames;
+  c->whist = (float *)mymalloc(sizeof(float) * c->veclen * frames);
+  c->wsum = (double *)mymalloc(sizeof(double) * c->veclen);
+  c->wsqr = (double *)mymalloc(sizeof(double) * c->veclen);
+}
+
 /** 
  * Free work area for real-time CMN.
  * 
@@ -311,6 +333,11 @@ CMN_realtime_free(CMNWork *c)
     free(c->clist[i].mfcc_sum);
   }
   free(c->clist);
+  if (c->window > 0) {
+    free(c->whist);
+    free(c->wsum);
+    free(c->wsqr);
+  }
   free(c);
 }
 
@@ -329,6 +356,76 @@ CMN_realtime_prepare(CMNWork *c)
     for(d=0;d<c->veclen;d++) c->now.mfcc_var[d] = 0.0;
   }
   c->now.framenum = 0;
+  if (c->window > 0) {
+    for(d=0;d<c->veclen;d++) c->wsum[d] = c->wsqr[d] = 0.0;
+    c->wpos = 0;
+  }
+}
+
+/**
+ * Perform sliding-window CMN/CVN for an incoming MFCC vector.
+ * 
+ * @param c [i/o] CMN calculation work area
+ * @param mfcc [in] MFCC vector
+ */
+static void
+CMN_window(CMNWork *c, float *mfcc)
+{
+  int d, n;
+  float *old;
+  double w, m, v, x;
+  boolean do_var;
+
+  /* replace the oldest vector in the window */
+  old = &(c->whist[c->wpos * c->veclen]);
+  if (c->now.framenum >= c->window) {
+    for(d=0;d<c->veclen;d++) {
+      c->wsum[d] -= old[d];
+      c->wsqr[d] -= old[d] * old[d];
+    }
+  }
+  for(d=0;d<c->veclen;d++) {
+    x = mfcc[d];
+    c->wsum[d] += x;
+    c->wsqr[d] += x * x;
+    old[d] = mfcc[d];
+  }
+  if (++c->wpos >= c->window) c->wpos = 0;
+  c->now.framenum++;
+  n = (c->now.framenum < c->window) ? c->now.framenum : c->window;
+
+  /* weight of initial data decreases as the window fills */
+  if (c->cmean_init_set) {
+    w = c->cweight * (c->window - n) / c->window;
+    do_var = c->var;
+  } else {
+    w = 0.0;
+    /* without initial data, apply CVN after the window is filled */
+    do_var = (c->var && n >= c->window) ? TRUE : FALSE;
+  }
+
+  for(d=0;d<c->veclen;d++) {
+    if (w > 0.0) {
+      m = (c->wsum[d] + w * c->cmean_init[d]) / (n + w);
+    } else {
+      m = c->wsum[d] / n;
+    }
+    if (do_var) {
+      /* squared deviation from m in the window, plus initial variance */
+      v = c->wsqr[d] - 2.0 * m * c->wsum[d] + n * m * m;
+      if (w > 0.0) v += w * c->cvar_init[d];
+      v /= n + w;
+      if (v < CMN_VAR_FLOOR) v = CMN_VAR_FLOOR;
+    }
+    if (c->mean && d < c->mfcc_dim) {
+      /* mean normalization */
+      mfcc[d] -= m;
+    }
+    if (do_var) {
+      /* variance normalization */
+      mfcc[d] /= sqrt(v);
+    }
+  }
 }
 
 /**
@@ -344,6 +441,11 @@ CMN_realtime(CMNWork *c, float *mfcc)
   int d;
   double x, y;
 
+  if (c->window > 0) {
+    CMN_window(c, mfcc);
+    return;
+  }
+
   c->now.framenum++;
   if (c->cmean_init_set) {
     /* initial data exists */
@@ -414,6 +516,20 @@ CMN_realtime_update(CMNWork *c, HTK_Param *param)
   /* this may occur by pausing just after startup */
   if (c->now.framenum == 0) return;
 
+  if (c->window > 0) {
+    /* sliding window: take the current window as initial data */
+    i = (c->now.framenum < c->window) ? c->now.framenum : c->window;
+    for(d=0;d<c->veclen;d++) c->cmean_init[d] = c->wsum[d] / i;
+    if (c->loaded_from_file == FALSE && c->var) {
+      for(d=0;d<c->veclen;d++) {
+	c->cvar_init[d] = c->wsqr[d] / i - (c->wsum[d] / i) * (c->wsum[d] / i);
+	if (c->cvar_init[d] < CMN_VAR_FLOOR) c->cvar_init[d] = CMN_VAR_FLOOR;
+      }
+    }
+    c->cmean_init_set = TRUE;
+    return;
+  }
+
   /* re-calculate variance based on the final mean at the given param */
   if (c->var && param != NULL) {
     float m, x;
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 1991-2016 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2016 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+/*
+ * mkwchmm --- pre-generate lexicon tree cache for Julius
+ *
+ * Load models and build lexicon trees as Julius does with the given
+ * options, and save them to the cache files specified by "-wchmmcache".
+ * A cache file is always re-written, so that a stale file left by an
+ * earlier run will not be taken as the result.
+ *
+ */
+
+#include <julius/juliuslib.h>
+
+static boolean
+opt_help(Jconf *jconf, char *arg[], int argnum)
+{
+  fprintf(stderr, "mkwchmm --- pre-generate lexicon tree cache for Julius\n");
+  fprintf(stderr, "Usage: mkwchmm [Julius options..]\n");
+  fprintf(stderr, "    Models and options are the same as Julius.  Lexicon tree of each\n");
+  fprintf(stderr, "    N-gram LM will be saved to the file specified by \"-wchmmcache\".\n");
+  fprintf(stderr, "Library configuration: ");
+  confout_version(stderr);
+  confout_lm(stderr);
+  confout_process(stderr);
+  fprintf(stderr, "\n");
+  exit(1);			/* exit here */
+  return TRUE;
+}
+
+int
+main(int argc, char *argv[])
+{
+  Jconf *jconf;
+  Recog *recog;
+  RecogProcess *r;
+  JCONF_LM *lm;
+  int n;
+  boolean ok_p;
+
+  /* set application-specific additional options */
+  j_add_option("-h", 0, 0, "display this help", opt_help);
+  j_add_option("-help", 0, 0, "display this help", opt_help);
+  j_add_option("--help", 0, 0, "display this help", opt_help);
+
+  /* when no argument, output help and exit */
+  if (argc <= 1) {
+    opt_help(NULL, NULL, 0);
+    return 0;
+  }
+
+  /* process config */
+  jconf = j_config_load_args_new(argc, argv);
+  if (jconf == NULL) {
+    fprintf(stderr, "Error reading arguments\n");
+    return 1;
+  }
+
+  n = 0;
+  for (lm = jconf->lm_root; lm; lm = lm->next) {
+    if (lm->wchmm_cache_file != NULL) n++;
+  }
+  if (n == 0) {
+    fprintf(stderr, "Error: no cache file specified by \"-wchmmcache\"\n");
+    return 1;
+  }
+
+  /* load models and build lexicon trees */
+  recog = j_create_instance_from_jconf(jconf);
+  if (recog == NULL) {
+    fprintf(stderr, "Error in startup\n");
+    return 1;
+  }
+
+  /* save the lexicon trees */
+  ok_p = TRUE;
+  for (lm = jconf->lm_root; lm; lm = lm->next) {
+    if (lm->wchmm_cache_file == NULL) continue;
+    if (lm->lmtype != LM_PROB) {
+      fprintf(stderr, "Warning: LM \"%s\" is not N-gram, no cache generated\n", lm->name);
+      continue;
+    }
+    for (r = recog->process_list; r; r = r->next) {
+      if (r->lm->config == lm && r->wchmm != NULL) break;
+    }
+    if (r == NULL || wchmm_cache_save(r->wchmm, lm, lm->wchmm_cache_file) == FALSE) {
+      fprintf(stderr, "Error: failed to generate \"%s\"\n", lm->wchmm_cache_file);
+      ok_p = FALSE;
+    } else {
+      fprintf(stderr, "%s: lexicon tree cache generated\n", lm->wchmm_cache_file);
+    }
+  }
+
+  j_recog_free(recog);
+
+  return(ok_p ? 0 : 1);
+}